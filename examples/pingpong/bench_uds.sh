@@ -0,0 +1,23 @@
+#!/bin/sh
+# Compares pingpong throughput over loopback TCP and a Unix domain socket.
+# Usage: bench_uds.sh [bin_dir] [blocksize] [sessions]
+
+BIN=${1:-.}
+BLOCKSIZE=${2:-16384}
+SESSIONS=${3:-10}
+SOCKPATH=/tmp/pingpong_bench.sock
+
+run()
+{
+  echo "=== $1 ==="
+  $BIN/pingpong_server $2 33333 1 &
+  srv=$!
+  sleep 1
+  $BIN/pingpong_client $2 33333 1 $BLOCKSIZE $SESSIONS 10
+  kill $srv
+  wait $srv 2>/dev/null
+}
+
+run "loopback TCP" 127.0.0.1
+run "Unix domain socket" unix:$SOCKPATH
+rm -f $SOCKPATH
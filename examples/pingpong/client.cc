@@ -13,6 +13,7 @@
 
 #include <mcheck.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 using namespace muduo;
@@ -189,6 +190,7 @@ int main(int argc, char* argv[])
   {
     fprintf(stderr, "Usage: client <host_ip> <port> <threads> <blocksize> ");
     fprintf(stderr, "<sessions> <time>\n");
+    fprintf(stderr, "       host_ip unix:<path> connects to a Unix domain socket\n");
   }
   else
   {
@@ -203,7 +205,9 @@ int main(int argc, char* argv[])
     int timeout = atoi(argv[6]);
 
     EventLoop loop;
-    InetAddress serverAddr(ip, port);
+    InetAddress serverAddr = strncmp(ip, "unix:", 5) == 0
+                           ? InetAddress::fromUnixPath(ip + 5)
+                           : InetAddress(ip, port);
 
     Client client(&loop, serverAddr, blockSize, sessionCount, timeout, threadCount);
     loop.loop();
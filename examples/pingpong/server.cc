@@ -12,6 +12,7 @@
 
 #include <mcheck.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 using namespace muduo;
@@ -35,6 +36,7 @@ int main(int argc, char* argv[])
   if (argc < 4)
   {
     fprintf(stderr, "Usage: server <address> <port> <threads>\n");
+    fprintf(stderr, "       address unix:<path> listens on a Unix domain socket\n");
   }
   else
   {
@@ -43,7 +45,9 @@ int main(int argc, char* argv[])
 
     const char* ip = argv[1];
     uint16_t port = static_cast<uint16_t>(atoi(argv[2]));
-    InetAddress listenAddr(ip, port);
+    InetAddress listenAddr = strncmp(ip, "unix:", 5) == 0
+                           ? InetAddress::fromUnixPath(ip + 5)
+                           : InetAddress(ip, port);
     int threadCount = atoi(argv[3]);
 
     EventLoop loop;
@@ -58,6 +58,7 @@ class QueryClient : boost::noncopyable
     }
     else
     {
+      codec_.removeConnection(conn);
       loop_->quit();
     }
   }
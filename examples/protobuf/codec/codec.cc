@@ -8,6 +8,7 @@
 
 #include "codec.h"
 
+#include <muduo/base/Crc32c.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/Endian.h>
 #include <muduo/net/protorpc/google-inl.h>
@@ -19,15 +20,62 @@
 using namespace muduo;
 using namespace muduo::net;
 
-void ProtobufCodec::fillEmptyBuffer(Buffer* buf, const google::protobuf::Message& message)
+namespace
+{
+  const int kChecksumShift = 24;
+  const int32_t kTypeIdFlag = 1 << 23;
+  const int32_t kNameLenMask = kTypeIdFlag - 1;
+
+  int32_t checksumOf(ProtobufCodec::Checksum checksum, const char* data, size_t len)
+  {
+    switch (checksum)
+    {
+     case ProtobufCodec::kAdler32:
+       return static_cast<int32_t>(
+           ::adler32(1, reinterpret_cast<const Bytef*>(data), static_cast<int>(len)));
+     case ProtobufCodec::kCrc32c:
+       return static_cast<int32_t>(Crc32c::value(data, len));
+     default:
+       return 0;
+    }
+  }
+}
+
+void ProtobufTypeRegistry::add(int typeId, const google::protobuf::Descriptor* descriptor)
+{
+  assert(typeId > 0 && typeId <= kMaxTypeId);
+  assert(typeIds_.find(descriptor) == typeIds_.end());
+  if (prototypes_.size() <= static_cast<size_t>(typeId))
+  {
+    prototypes_.resize(typeId + 1);
+  }
+  assert(prototypes_[typeId] == NULL);
+  prototypes_[typeId] =
+    google::protobuf::MessageFactory::generated_factory()->GetPrototype(descriptor);
+  typeIds_[descriptor] = typeId;
+}
+
+void ProtobufCodec::fillEmptyBuffer(Buffer* buf,
+                                    const google::protobuf::Message& message,
+                                    Checksum checksum,
+                                    const ProtobufTypeRegistry* registry)
 {
   // buf->retrieveAll();
   assert(buf->readableBytes() == 0);
 
-  const std::string& typeName = message.GetTypeName();
-  int32_t nameLen = static_cast<int32_t>(typeName.size()+1);
-  buf->appendInt32(nameLen);
-  buf->append(typeName.c_str(), nameLen);
+  int32_t nameLen = 0;
+  int typeId = registry ? registry->typeIdOf(message.GetDescriptor()) : 0;
+  if (typeId > 0)
+  {
+    buf->appendInt32(typeId | kTypeIdFlag | (checksum << kChecksumShift));
+  }
+  else
+  {
+    const std::string& typeName = message.GetTypeName();
+    nameLen = static_cast<int32_t>(typeName.size()+1);
+    buf->appendInt32(nameLen | (checksum << kChecksumShift));
+    buf->append(typeName.c_str(), nameLen);
+  }
 
   // code copied from MessageLite::SerializeToArray() and MessageLite::SerializePartialToArray().
   GOOGLE_DCHECK(message.IsInitialized()) << InitializationErrorMessage("serialize", message);
@@ -43,10 +91,7 @@ void ProtobufCodec::fillEmptyBuffer(Buffer* buf, const google::protobuf::Message
   }
   buf->hasWritten(byte_size);
 
-  int32_t checkSum = static_cast<int32_t>(
-      ::adler32(1,
-                reinterpret_cast<const Bytef*>(buf->peek()),
-                static_cast<int>(buf->readableBytes())));
+  int32_t checkSum = checksumOf(checksum, buf->peek(), buf->readableBytes());
   buf->appendInt32(checkSum);
   assert(buf->readableBytes() == sizeof nameLen + nameLen + byte_size + sizeof checkSum);
   int32_t len = sockets::hostToNetwork32(static_cast<int32_t>(buf->readableBytes()));
@@ -122,19 +167,29 @@ void ProtobufCodec::onMessage(const TcpConnectionPtr& conn,
     if (len > kMaxMessageLen || len < kMinMessageLen)
     {
       errorCallback_(conn, buf, receiveTime, kInvalidLength);
+      break;
     }
     else if (buf->readableBytes() >= implicit_cast<size_t>(len + kHeaderLen))
     {
       ErrorCode errorCode = kNoError;
-      MessagePtr message = parse(buf->peek()+kHeaderLen, len, &errorCode);
+      Checksum checksum = kAdler32;
+      MessagePtr message = parse(buf->peek()+kHeaderLen, len, &errorCode,
+                                 acceptedChecksums_ | (1 << checksum_), &checksum,
+                                 registry_);
       if (errorCode == kNoError && message)
       {
+        if (conn)
+        {
+          // answers in kind, on this connection only
+          setPeerChecksum(conn->name(), checksum);
+        }
         messageCallback_(conn, message, receiveTime);
         buf->retrieve(kHeaderLen+len);
       }
       else
       {
         errorCallback_(conn, buf, receiveTime, errorCode);
+        break;
       }
     }
     else
@@ -144,6 +199,19 @@ void ProtobufCodec::onMessage(const TcpConnectionPtr& conn,
   }
 }
 
+void ProtobufCodec::setPeerChecksum(const string& name, Checksum checksum)
+{
+  MutexLockGuard lock(mutex_);
+  if (checksum != checksum_)
+  {
+    peerChecksums_[name] = checksum;
+  }
+  else
+  {
+    peerChecksums_.erase(name);
+  }
+}
+
 google::protobuf::Message* ProtobufCodec::createMessage(const std::string& typeName)
 {
   google::protobuf::Message* message = NULL;
@@ -161,20 +229,63 @@ google::protobuf::Message* ProtobufCodec::createMessage(const std::string& typeN
   return message;
 }
 
-MessagePtr ProtobufCodec::parse(const char* buf, int len, ErrorCode* error)
+MessagePtr ProtobufCodec::parse(const char* buf,
+                                int len,
+                                ErrorCode* error,
+                                int acceptedChecksums,
+                                Checksum* checksum,
+                                const ProtobufTypeRegistry* registry)
 {
   MessagePtr message;
 
+  int32_t nameLenAndChecksum = asInt32(buf);
+  int kind = (nameLenAndChecksum >> kChecksumShift) & 0xff;
+  if (kind > kNoChecksum || (acceptedChecksums & (1 << kind)) == 0)
+  {
+    *error = kInvalidNameLen;
+    return message;
+  }
+  if (checksum)
+  {
+    *checksum = static_cast<Checksum>(kind);
+  }
+
   // check sum
   int32_t expectedCheckSum = asInt32(buf + len - kHeaderLen);
-  int32_t checkSum = static_cast<int32_t>(
-      ::adler32(1,
-                reinterpret_cast<const Bytef*>(buf),
-                static_cast<int>(len - kHeaderLen)));
-  if (checkSum == expectedCheckSum)
+  int32_t checkSum = checksumOf(static_cast<Checksum>(kind), buf,
+                                static_cast<size_t>(len - kHeaderLen));
+  if (checkSum != expectedCheckSum)
+  {
+    *error = kCheckSumError;
+  }
+  else if (nameLenAndChecksum & kTypeIdFlag)
+  {
+    // an array index instead of looking up the type name
+    const google::protobuf::Message* prototype =
+      registry ? registry->prototypeOf(nameLenAndChecksum & kNameLenMask) : NULL;
+    if (prototype)
+    {
+      message.reset(prototype->New());
+      const char* data = buf + kHeaderLen;
+      int32_t dataLen = len - 2*kHeaderLen;
+      if (message->ParseFromArray(data, dataLen))
+      {
+        *error = kNoError;
+      }
+      else
+      {
+        *error = kParseError;
+      }
+    }
+    else
+    {
+      *error = kUnknownMessageType;
+    }
+  }
+  else
   {
     // get message type name
-    int32_t nameLen = asInt32(buf);
+    int32_t nameLen = nameLenAndChecksum & kNameLenMask;
     if (nameLen >= 2 && nameLen <= len - 2*kHeaderLen)
     {
       std::string typeName(buf + kHeaderLen, buf + kHeaderLen + nameLen - 1);
@@ -204,10 +315,6 @@ MessagePtr ProtobufCodec::parse(const char* buf, int len, ErrorCode* error)
       *error = kInvalidNameLen;
     }
   }
-  else
-  {
-    *error = kCheckSumError;
-  }
 
   return message;
 }
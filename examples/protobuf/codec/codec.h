@@ -9,6 +9,7 @@
 #ifndef MUDUO_EXAMPLES_PROTOBUF_CODEC_CODEC_H
 #define MUDUO_EXAMPLES_PROTOBUF_CODEC_CODEC_H
 
+#include <muduo/base/Mutex.h>
 #include <muduo/net/Buffer.h>
 #include <muduo/net/TcpConnection.h>
 
@@ -18,17 +19,61 @@
 
 #include <google/protobuf/message.h>
 
+#include <map>
+#include <vector>
+
 // struct ProtobufTransportFormat __attribute__ ((__packed__))
 // {
 //   int32_t  len;
-//   int32_t  nameLen;
+//   int32_t  nameLen;  // highest byte is Checksum, 0 for adler32 as before
 //   char     typeName[nameLen];
 //   char     protobufData[len-nameLen-8];
-//   int32_t  checkSum; // adler32 of nameLen, typeName and protobufData
+//   int32_t  checkSum; // of nameLen, typeName and protobufData
 // }
+//
+// With a ProtobufTypeRegistry, bit 23 of nameLen is set and the lower bits
+// are the type id, typeName is omitted.
 
 typedef boost::shared_ptr<google::protobuf::Message> MessagePtr;
 
+//
+// Numeric ids of message types, for the codecs at both ends of a connection
+// to send ids instead of type names.  Both ends must register the same ids.
+//
+// Filled before any codec uses it, then read only.
+//
+class ProtobufTypeRegistry : boost::noncopyable
+{
+ public:
+  static const int kMaxTypeId = (1 << 23) - 1;
+
+  // typeId from 1 to kMaxTypeId, keep them small, prototypes are indexed by it.
+  void add(int typeId, const google::protobuf::Descriptor* descriptor);
+
+  template<typename T>
+  void add(int typeId)
+  { add(typeId, T::descriptor()); }
+
+  // 0 if not registered
+  int typeIdOf(const google::protobuf::Descriptor* descriptor) const
+  {
+    std::map<const google::protobuf::Descriptor*, int>::const_iterator it
+      = typeIds_.find(descriptor);
+    return it != typeIds_.end() ? it->second : 0;
+  }
+
+  // NULL if not registered
+  const google::protobuf::Message* prototypeOf(int typeId) const
+  {
+    return typeId > 0 && static_cast<size_t>(typeId) < prototypes_.size()
+      ? prototypes_[typeId] : NULL;
+  }
+
+ private:
+  std::vector<const google::protobuf::Message*> prototypes_;
+  std::map<const google::protobuf::Descriptor*, int> typeIds_;
+};
+
 //
 // FIXME: merge with RpcCodec
 //
@@ -46,6 +91,15 @@ class ProtobufCodec : boost::noncopyable
     kParseError,
   };
 
+  enum Checksum
+  {
+    kAdler32 = 0,
+    kCrc32c = 1,
+    kNoChecksum = 2,  // for trusted links only
+  };
+
+  static const int kDefaultAcceptedChecksums = (1 << kAdler32) | (1 << kCrc32c);
+
   typedef boost::function<void (const muduo::net::TcpConnectionPtr&,
                                 const MessagePtr&,
                                 muduo::Timestamp)> ProtobufMessageCallback;
@@ -57,16 +111,54 @@ class ProtobufCodec : boost::noncopyable
 
   explicit ProtobufCodec(const ProtobufMessageCallback& messageCb)
     : messageCallback_(messageCb),
-      errorCallback_(defaultErrorCallback)
+      errorCallback_(defaultErrorCallback),
+      checksum_(kAdler32),
+      acceptedChecksums_(kDefaultAcceptedChecksums),
+      registry_(NULL)
   {
   }
 
   ProtobufCodec(const ProtobufMessageCallback& messageCb, const ErrorCallback& errorCb)
     : messageCallback_(messageCb),
-      errorCallback_(errorCb)
+      errorCallback_(errorCb),
+      checksum_(kAdler32),
+      acceptedChecksums_(kDefaultAcceptedChecksums),
+      registry_(NULL)
   {
   }
 
+  // Checksum of messages sent, kAdler32 by default.  Set it before use.
+  void setChecksum(Checksum checksum)
+  { checksum_ = checksum; }
+
+  Checksum checksum() const
+  { return checksum_; }
+
+  // Checksum of messages sent on conn, that of the last message received
+  // on it, or checksum() before any.  Connections are told apart by name.
+  Checksum checksum(const muduo::net::TcpConnectionPtr& conn) const
+  {
+    muduo::MutexLockGuard lock(mutex_);
+    std::map<muduo::string, Checksum>::const_iterator it = peerChecksums_.find(conn->name());
+    return it != peerChecksums_.end() ? it->second : checksum_;
+  }
+
+  // Forgets the checksum of conn, call it when conn is down.
+  void removeConnection(const muduo::net::TcpConnectionPtr& conn)
+  {
+    muduo::MutexLockGuard lock(mutex_);
+    peerChecksums_.erase(conn->name());
+  }
+
+  // Bit mask of (1 << Checksum) taken from the peer, besides the one sent.
+  void setAcceptedChecksums(int mask)
+  { acceptedChecksums_ = mask; }
+
+  // Sends registered types by id and takes ids from the peer, which must
+  // use the same registry.  Others are still sent by name.
+  void setTypeRegistry(const ProtobufTypeRegistry* registry)
+  { registry_ = registry; }
+
   void onMessage(const muduo::net::TcpConnectionPtr& conn,
                  muduo::net::Buffer* buf,
                  muduo::Timestamp receiveTime);
@@ -76,14 +168,21 @@ class ProtobufCodec : boost::noncopyable
   {
     // FIXME: serialize to TcpConnection::outputBuffer()
     muduo::net::Buffer buf;
-    fillEmptyBuffer(&buf, message);
+    fillEmptyBuffer(&buf, message, checksum(conn), registry_);
     conn->send(&buf);
   }
 
   static const muduo::string& errorCodeToString(ErrorCode errorCode);
-  static void fillEmptyBuffer(muduo::net::Buffer* buf, const google::protobuf::Message& message);
+  static void fillEmptyBuffer(muduo::net::Buffer* buf,
+                              const google::protobuf::Message& message,
+                              Checksum checksum = kAdler32,
+                              const ProtobufTypeRegistry* registry = NULL);
   static google::protobuf::Message* createMessage(const std::string& type_name);
-  static MessagePtr parse(const char* buf, int len, ErrorCode* errorCode);
+  // checksum, if not NULL, is set to the one of the message
+  static MessagePtr parse(const char* buf, int len, ErrorCode* errorCode,
+                          int acceptedChecksums = kDefaultAcceptedChecksums,
+                          Checksum* checksum = NULL,
+                          const ProtobufTypeRegistry* registry = NULL);
 
  private:
   static void defaultErrorCallback(const muduo::net::TcpConnectionPtr&,
@@ -91,11 +190,19 @@ class ProtobufCodec : boost::noncopyable
                                    muduo::Timestamp,
                                    ErrorCode);
 
+  void setPeerChecksum(const muduo::string& name, Checksum checksum);
+
   ProtobufMessageCallback messageCallback_;
   ErrorCallback errorCallback_;
+  Checksum checksum_;
+  int acceptedChecksums_;
+  const ProtobufTypeRegistry* registry_;
+  mutable muduo::MutexLock mutex_;
+  // of connections whose peer sent another one than checksum_
+  std::map<muduo::string, Checksum> peerChecksums_;  // @GuardedBy mutex_
 
   const static int kHeaderLen = sizeof(int32_t);
-  const static int kMinMessageLen = 2*kHeaderLen + 2; // nameLen + typeName + checkSum
+  const static int kMinMessageLen = 2*kHeaderLen; // nameLen + checkSum, typeName may be an id
   const static int kMaxMessageLen = 64*1024*1024; // same as codec_stream.h kDefaultTotalBytesLimit
 };
 
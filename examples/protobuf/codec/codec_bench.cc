@@ -0,0 +1,197 @@
+#include "codec.h"
+#include <muduo/base/Crc32c.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/protorpc/RpcCodec.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+#include <examples/protobuf/codec/query.pb.h>
+
+#include <stdio.h>
+#include <zlib.h>  // adler32
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Throughput of encoding and parsing one message of each size, with each
+// checksum, in MiB/s of payload.
+
+const size_t kTotalBytes = 256 * 1024 * 1024;
+const size_t kSizes[] = { 1024, 64 * 1024, 1024 * 1024 };
+const char* const kChecksumNames[] = { "adler32", "crc32c", "none" };
+
+int iterations(size_t size)
+{
+  return static_cast<int>(kTotalBytes / size);
+}
+
+double mibPerSecond(size_t size, int n, Timestamp start)
+{
+  double seconds = timeDifference(Timestamp::now(), start);
+  return static_cast<double>(size) * n / seconds / (1024 * 1024);
+}
+
+void benchChecksums(size_t size)
+{
+  std::string data(size, 'x');
+  uint32_t sum = 0;
+  int n = iterations(size);
+
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    sum += static_cast<uint32_t>(
+        ::adler32(1, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(size)));
+  }
+  double adler = mibPerSecond(size, n, start);
+
+  start = Timestamp::now();
+  for (int i = 0; i < n; ++i)
+  {
+    sum += Crc32c::value(data.data(), size);
+  }
+  double crc = mibPerSecond(size, n, start);
+
+  start = Timestamp::now();
+  for (int i = 0; i < n; ++i)
+  {
+    sum += Crc32c::extendPortable(0, data.data(), size);
+  }
+  double portable = mibPerSecond(size, n, start);
+
+  printf("%-14s %8zu %10.0f %10.0f %10.0f   (%u)\n",
+         "checksum", size, adler, crc, portable, sum);
+}
+
+void benchProtobufCodec(size_t size)
+{
+  muduo::Query query;
+  query.set_id(1);
+  query.set_questioner("Chen Shuo");
+  query.add_question(std::string(size, 'x'));
+  const int all = (1 << ProtobufCodec::kAdler32)
+                | (1 << ProtobufCodec::kCrc32c)
+                | (1 << ProtobufCodec::kNoChecksum);
+
+  printf("%-14s %8zu", "ProtobufCodec", size);
+  for (int c = ProtobufCodec::kAdler32; c <= ProtobufCodec::kNoChecksum; ++c)
+  {
+    ProtobufCodec::Checksum checksum = static_cast<ProtobufCodec::Checksum>(c);
+    int n = iterations(size);
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < n; ++i)
+    {
+      Buffer buf;
+      ProtobufCodec::fillEmptyBuffer(&buf, query, checksum);
+      const int32_t len = buf.readInt32();
+      ProtobufCodec::ErrorCode errorCode = ProtobufCodec::kNoError;
+      MessagePtr message = ProtobufCodec::parse(buf.peek(), len, &errorCode, all);
+      assert(errorCode == ProtobufCodec::kNoError);
+      (void) errorCode;
+    }
+    printf(" %10.0f", mibPerSecond(size, n, start));
+  }
+  printf("\n");
+}
+
+void benchRpcCodec(size_t size)
+{
+  muduo::Query query;
+  query.set_id(1);
+  query.set_questioner("Chen Shuo");
+  query.add_question(std::string(size, 'x'));
+  RpcMessage message;
+  message.set_type(REQUEST);
+  message.set_id(1);
+  message.set_service("muduo.QueryService");
+  message.set_method("Query");
+  const int all = (1 << RpcCodec::kAdler32)
+                | (1 << RpcCodec::kCrc32c)
+                | (1 << RpcCodec::kNoChecksum);
+
+  printf("%-14s %8zu", "RpcCodec", size);
+  for (int c = RpcCodec::kAdler32; c <= RpcCodec::kNoChecksum; ++c)
+  {
+    RpcCodec::Checksum checksum = static_cast<RpcCodec::Checksum>(c);
+    int n = iterations(size);
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < n; ++i)
+    {
+      Buffer buf;
+      RpcCodec::encode(&buf, message, &query, checksum);
+      const int32_t len = buf.readInt32();
+      RpcMessage parsed;
+      StringPiece payload;
+      RpcCodec::Checksum received;
+      RpcCodec::ErrorCode errorCode =
+          RpcCodec::parse(buf.peek(), len, all, &parsed, &payload, &received);
+      assert(errorCode == RpcCodec::kNoError);
+      (void) errorCode;
+      muduo::Query request;
+      request.ParseFromArray(payload.data(), payload.size());
+    }
+    printf(" %10.0f", mibPerSecond(size, n, start));
+  }
+  printf("\n");
+}
+
+// a few bytes of payload, where the type name costs the most
+void benchTypeRegistry()
+{
+  ProtobufTypeRegistry registry;
+  registry.add<muduo::Query>(1);
+  muduo::Query query;
+  query.set_id(1);
+  query.set_questioner("Chen Shuo");
+  query.add_question("Running?");
+  const int n = 1000 * 1000;
+
+  const ProtobufTypeRegistry* registries[] = { NULL, &registry };
+  for (int r = 0; r < 2; ++r)
+  {
+    size_t frameBytes = 0;
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < n; ++i)
+    {
+      Buffer buf;
+      ProtobufCodec::fillEmptyBuffer(&buf, query, ProtobufCodec::kCrc32c, registries[r]);
+      frameBytes = buf.readableBytes();
+      const int32_t len = buf.readInt32();
+      ProtobufCodec::ErrorCode errorCode = ProtobufCodec::kNoError;
+      MessagePtr message = ProtobufCodec::parse(buf.peek(), len, &errorCode,
+                                                ProtobufCodec::kDefaultAcceptedChecksums,
+                                                NULL, registries[r]);
+      assert(errorCode == ProtobufCodec::kNoError);
+      (void) errorCode;
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    printf("%-14s %8zu %10.0f  messages/s, %s\n", "ProtobufCodec", frameBytes,
+           n / seconds, registries[r] ? "by type id" : "by type name");
+  }
+}
+
+int main()
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  printf("crc32c instruction: %s\n", Crc32c::hardwareAccelerated() ? "yes" : "no");
+  printf("%-14s %8s %10s %10s %10s  MiB/s\n", "", "bytes", "adler32", "crc32c", "portable");
+  for (size_t i = 0; i < sizeof kSizes / sizeof kSizes[0]; ++i)
+  {
+    benchChecksums(kSizes[i]);
+  }
+
+  printf("\n%-14s %8s %10s %10s %10s  MiB/s, encode and parse\n",
+         "", "bytes", kChecksumNames[0], kChecksumNames[1], kChecksumNames[2]);
+  for (size_t i = 0; i < sizeof kSizes / sizeof kSizes[0]; ++i)
+  {
+    benchProtobufCodec(kSizes[i]);
+  }
+  for (size_t i = 0; i < sizeof kSizes / sizeof kSizes[0]; ++i)
+  {
+    benchRpcCodec(kSizes[i]);
+  }
+
+  printf("\n%-14s %8s\n", "", "frame");
+  benchTypeRegistry();
+
+  google::protobuf::ShutdownProtobufLibrary();
+}
@@ -1,8 +1,10 @@
 #include "codec.h"
 #include <muduo/net/Endian.h>
+#include <muduo/net/EventLoop.h>
 #include <examples/protobuf/codec/query.pb.h>
 
 #include <stdio.h>
+#include <sys/socket.h>
 #include <zlib.h>  // adler32
 
 using namespace muduo;
@@ -190,6 +192,97 @@ void testBadBuffer()
   }
 }
 
+void testChecksums()
+{
+  muduo::Query query;
+  query.set_id(1);
+  query.set_questioner("Chen Shuo");
+  query.add_question("Running?");
+
+  const ProtobufCodec::Checksum kinds[] = {
+    ProtobufCodec::kAdler32, ProtobufCodec::kCrc32c, ProtobufCodec::kNoChecksum
+  };
+  for (size_t i = 0; i < sizeof kinds / sizeof kinds[0]; ++i)
+  {
+    Buffer buf;
+    ProtobufCodec::fillEmptyBuffer(&buf, query, kinds[i]);
+    const int32_t len = buf.readInt32();
+    string data(buf.peek(), len);
+
+    const int all = (1 << ProtobufCodec::kAdler32)
+                  | (1 << ProtobufCodec::kCrc32c)
+                  | (1 << ProtobufCodec::kNoChecksum);
+    ProtobufCodec::ErrorCode errorCode = ProtobufCodec::kNoError;
+    ProtobufCodec::Checksum checksum = ProtobufCodec::kAdler32;
+    MessagePtr message = ProtobufCodec::parse(data.c_str(), len, &errorCode, all, &checksum);
+    assert(errorCode == ProtobufCodec::kNoError);
+    assert(message != NULL);
+    assert(message->DebugString() == query.DebugString());
+    assert(checksum == kinds[i]);
+
+    // not accepted
+    message = ProtobufCodec::parse(data.c_str(), len, &errorCode, all & ~(1 << kinds[i]));
+    assert(message == NULL);
+    assert(errorCode == ProtobufCodec::kInvalidNameLen);
+
+    if (kinds[i] != ProtobufCodec::kNoChecksum)
+    {
+      data[len-6]++;
+      message = ProtobufCodec::parse(data.c_str(), len, &errorCode, all);
+      assert(message == NULL);
+      assert(errorCode == ProtobufCodec::kCheckSumError);
+    }
+  }
+}
+
+void testTypeRegistry()
+{
+  ProtobufTypeRegistry registry;
+  registry.add<muduo::Query>(1);
+  registry.add<muduo::Empty>(3);
+  assert(registry.typeIdOf(muduo::Empty::descriptor()) == 3);
+  assert(registry.typeIdOf(muduo::Answer::descriptor()) == 0);
+  assert(registry.prototypeOf(2) == NULL);
+  assert(registry.prototypeOf(4) == NULL);
+
+  muduo::Empty empty;
+  empty.set_id(43);
+
+  Buffer byName;
+  ProtobufCodec::fillEmptyBuffer(&byName, empty);
+  Buffer byId;
+  ProtobufCodec::fillEmptyBuffer(&byId, empty, ProtobufCodec::kAdler32, &registry);
+  printf("by name %zd bytes, by id %zd bytes\n", byName.readableBytes(), byId.readableBytes());
+  assert(byId.readableBytes() == byName.readableBytes() - empty.GetTypeName().size() - 1);
+
+  const int32_t len = byId.readInt32();
+  ProtobufCodec::ErrorCode errorCode = ProtobufCodec::kNoError;
+  MessagePtr message = ProtobufCodec::parse(byId.peek(), len, &errorCode,
+                                            ProtobufCodec::kDefaultAcceptedChecksums,
+                                            NULL, &registry);
+  assert(errorCode == ProtobufCodec::kNoError);
+  assert(message != NULL);
+  assert(message->DebugString() == empty.DebugString());
+
+  // peer without the registry
+  message = ProtobufCodec::parse(byId.peek(), len, &errorCode);
+  assert(message == NULL);
+  assert(errorCode == ProtobufCodec::kUnknownMessageType);
+
+  // not registered, by name
+  muduo::Answer answer;
+  answer.set_id(1);
+  answer.set_questioner("Chen Shuo");
+  answer.set_answerer("blog.csdn.net/Solstice");
+  Buffer buf;
+  ProtobufCodec::fillEmptyBuffer(&buf, answer, ProtobufCodec::kCrc32c, &registry);
+  const int32_t answerLen = buf.readInt32();
+  message = ProtobufCodec::parse(buf.peek(), answerLen, &errorCode);
+  assert(errorCode == ProtobufCodec::kNoError);
+  assert(message != NULL);
+  assert(message->DebugString() == answer.DebugString());
+}
+
 int g_count = 0;
 
 void onMessage(const muduo::net::TcpConnectionPtr& conn,
@@ -242,6 +335,47 @@ void testOnMessage()
   }
 }
 
+// feeds a message of checksum to codec on conn
+void receive(ProtobufCodec* codec, const TcpConnectionPtr& conn, ProtobufCodec::Checksum checksum)
+{
+  muduo::Empty empty;
+  empty.set_id(1);
+  Buffer input;
+  ProtobufCodec::fillEmptyBuffer(&input, empty, checksum);
+  codec->onMessage(conn, &input, muduo::Timestamp());
+  assert(input.readableBytes() == 0);
+}
+
+void testAnswerInKind()
+{
+  EventLoop loop;
+  InetAddress addr(0);
+  TcpConnectionPtr a(new TcpConnection(&loop, "a", ::socket(AF_INET, SOCK_STREAM, 0), addr, addr));
+  TcpConnectionPtr b(new TcpConnection(&loop, "b", ::socket(AF_INET, SOCK_STREAM, 0), addr, addr));
+  ProtobufCodec codec(onMessage);
+
+  // each connection answers in the checksum of its own peer
+  receive(&codec, a, ProtobufCodec::kCrc32c);
+  receive(&codec, b, ProtobufCodec::kAdler32);
+  assert(codec.checksum() == ProtobufCodec::kAdler32);
+  assert(codec.checksum(a) == ProtobufCodec::kCrc32c);
+  assert(codec.checksum(b) == ProtobufCodec::kAdler32);
+
+  // and follows it when it changes
+  receive(&codec, a, ProtobufCodec::kAdler32);
+  assert(codec.checksum(a) == ProtobufCodec::kAdler32);
+
+  // the context of a connection is the user's
+  b->setContext(string("user"));
+  receive(&codec, b, ProtobufCodec::kCrc32c);
+  assert(codec.checksum(b) == ProtobufCodec::kCrc32c);
+  assert(boost::any_cast<string>(b->getContext()) == "user");
+
+  // forgotten when the connection is down
+  codec.removeConnection(b);
+  assert(codec.checksum(b) == ProtobufCodec::kAdler32);
+}
+
 int main()
 {
   GOOGLE_PROTOBUF_VERIFY_VERSION;
@@ -254,8 +388,14 @@ int main()
   puts("");
   testBadBuffer();
   puts("");
+  testChecksums();
+  puts("");
+  testTypeRegistry();
+  puts("");
   testOnMessage();
   puts("");
+  testAnswerInKind();
+  puts("");
 
   puts("All pass!!!");
 
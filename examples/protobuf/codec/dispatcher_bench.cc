@@ -0,0 +1,90 @@
+#include "dispatcher.h"
+
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/protorpc/ProtobufDispatcher.h>
+
+#include <examples/protobuf/codec/dispatcher_bench.pb.h>
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/repetition/repeat.hpp>
+
+#include <stdio.h>
+
+// Dispatches messages of 200 types through the std::map based dispatcher
+// of this example and muduo::net::ProtobufDispatcher.
+
+#define NUM_TYPES 200
+
+const int kRounds = 50 * 1000;
+
+int64_t g_sum = 0;
+
+template<typename T>
+void onMessage(const muduo::net::TcpConnectionPtr&,
+               const boost::shared_ptr<T>& message,
+               muduo::Timestamp)
+{
+  g_sum += message->id();
+}
+
+void onUnknownMessageType(const muduo::net::TcpConnectionPtr&,
+                          const MessagePtr&,
+                          muduo::Timestamp)
+{
+  abort();
+}
+
+#define REGISTER(z, n, dispatcher) \
+  dispatcher.registerMessageCallback<bench::BOOST_PP_CAT(M, n)>( \
+      onMessage<bench::BOOST_PP_CAT(M, n)>);
+
+#define CREATE(z, n, messages) \
+  { \
+    boost::shared_ptr<bench::BOOST_PP_CAT(M, n)> message(new bench::BOOST_PP_CAT(M, n)); \
+    message->set_id(n); \
+    messages.push_back(message); \
+  }
+
+template<typename Dispatcher>
+double dispatch(const Dispatcher& dispatcher, const std::vector<MessagePtr>& messages)
+{
+  muduo::net::TcpConnectionPtr conn;
+  muduo::Timestamp t;
+  g_sum = 0;
+  muduo::Timestamp start(muduo::Timestamp::now());
+  for (int r = 0; r < kRounds; ++r)
+  {
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+      dispatcher.onProtobufMessage(conn, messages[i], t);
+    }
+  }
+  double seconds = timeDifference(muduo::Timestamp::now(), start);
+  // every message reached its own callback
+  assert(g_sum == static_cast<int64_t>(kRounds) * (NUM_TYPES - 1) * NUM_TYPES / 2);
+  (void) g_sum;
+  return seconds;
+}
+
+int main()
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  std::vector<MessagePtr> messages;
+  BOOST_PP_REPEAT(NUM_TYPES, CREATE, messages)
+
+  ProtobufDispatcher mapDispatcher(onUnknownMessageType);
+  BOOST_PP_REPEAT(NUM_TYPES, REGISTER, mapDispatcher)
+
+  muduo::net::ProtobufDispatcher flatDispatcher(onUnknownMessageType);
+  BOOST_PP_REPEAT(NUM_TYPES, REGISTER, flatDispatcher)
+  assert(flatDispatcher.numCallbacks() == NUM_TYPES);
+
+  const double n = static_cast<double>(kRounds) * NUM_TYPES;
+  double mapSeconds = dispatch(mapDispatcher, messages);
+  printf("std::map      %d types %6.1f ns/message\n", NUM_TYPES, mapSeconds * 1e9 / n);
+  double flatSeconds = dispatch(flatDispatcher, messages);
+  printf("open address  %d types %6.1f ns/message\n", NUM_TYPES, flatSeconds * 1e9 / n);
+
+  google::protobuf::ShutdownProtobufLibrary();
+}
@@ -1,5 +1,7 @@
 #include "dispatcher.h"
 
+#include <muduo/net/protorpc/ProtobufDispatcher.h>
+
 #include <examples/protobuf/codec/query.pb.h>
 
 #include <iostream>
@@ -21,11 +23,18 @@ void test_down_pointer_cast()
   }
 }
 
+// hits of each callback
+int g_queries = 0;
+int g_answers = 0;
+int g_staleAnswers = 0;
+int g_unknowns = 0;
+
 void onQuery(const muduo::net::TcpConnectionPtr&,
              const QueryPtr& message,
              muduo::Timestamp)
 {
   cout << "onQuery: " << message->GetTypeName() << endl;
+  ++g_queries;
 }
 
 void onAnswer(const muduo::net::TcpConnectionPtr&,
@@ -33,6 +42,15 @@ void onAnswer(const muduo::net::TcpConnectionPtr&,
               muduo::Timestamp)
 {
   cout << "onAnswer: " << message->GetTypeName() << endl;
+  ++g_answers;
+}
+
+void onStaleAnswer(const muduo::net::TcpConnectionPtr&,
+                   const AnswerPtr& message,
+                   muduo::Timestamp)
+{
+  cout << "onStaleAnswer: " << message->GetTypeName() << endl;
+  ++g_staleAnswers;
 }
 
 void onUnknownMessageType(const muduo::net::TcpConnectionPtr&,
@@ -40,6 +58,36 @@ void onUnknownMessageType(const muduo::net::TcpConnectionPtr&,
                           muduo::Timestamp)
 {
   cout << "onUnknownMessageType: " << message->GetTypeName() << endl;
+  ++g_unknowns;
+}
+
+void resetHits()
+{
+  g_queries = g_answers = g_staleAnswers = g_unknowns = 0;
+}
+
+void testFlatDispatcher()
+{
+  muduo::net::ProtobufDispatcher dispatcher(onUnknownMessageType);
+  dispatcher.registerMessageCallback<muduo::Query>(onQuery);
+  // the second one replaces the first
+  dispatcher.registerMessageCallback<muduo::Answer>(onStaleAnswer);
+  dispatcher.registerMessageCallback<muduo::Answer>(onAnswer);
+  assert(dispatcher.numCallbacks() == 2);
+
+  muduo::net::TcpConnectionPtr conn;
+  muduo::Timestamp t;
+
+  boost::shared_ptr<muduo::Query> query(new muduo::Query);
+  boost::shared_ptr<muduo::Answer> answer(new muduo::Answer);
+  boost::shared_ptr<muduo::Empty> empty(new muduo::Empty);
+  resetHits();
+  dispatcher.onProtobufMessage(conn, query, t);
+  dispatcher.onProtobufMessage(conn, answer, t);
+  dispatcher.onProtobufMessage(conn, empty, t);
+  assert(g_queries == 1);
+  assert(g_answers == 1 && g_staleAnswers == 0);
+  assert(g_unknowns == 1);
 }
 
 int main()
@@ -60,6 +108,9 @@ int main()
   dispatcher.onProtobufMessage(conn, query, t);
   dispatcher.onProtobufMessage(conn, answer, t);
   dispatcher.onProtobufMessage(conn, empty, t);
+  assert(g_queries == 1 && g_answers == 1 && g_unknowns == 1);
+
+  testFlatDispatcher();
 
   google::protobuf::ShutdownProtobufLibrary();
 }
@@ -48,6 +48,10 @@ class QueryServer : boost::noncopyable
     LOG_INFO << conn->localAddress().toIpPort() << " -> "
         << conn->peerAddress().toIpPort() << " is "
         << (conn->connected() ? "UP" : "DOWN");
+    if (!conn->connected())
+    {
+      codec_.removeConnection(conn);
+    }
   }
 
   void onUnknownMessage(const TcpConnectionPtr& conn,
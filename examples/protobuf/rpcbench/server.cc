@@ -1,7 +1,9 @@
 #include <examples/protobuf/rpcbench/echo.pb.h>
 
+#include <muduo/base/Atomic.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/EventLoop.h>
+#include <muduo/net/inspect/Inspector.h>
 #include <muduo/net/protorpc/RpcServer.h>
 
 #include <boost/bind.hpp>
@@ -21,13 +23,29 @@ class EchoServiceImpl : public EchoService
                     ::google::protobuf::Closure* done)
   {
     //LOG_INFO << "EchoServiceImpl::Solve";
+    requests_.increment();
     response->set_payload(request->payload());
     done->Run();
   }
+
+  int64_t requests()
+  {
+    return requests_.get();
+  }
+
+ private:
+  AtomicInt64 requests_;
 };
 
 }
 
+// requests and responses are recycled, allocations stay flat
+void printStats(echo::EchoServiceImpl* impl, RpcServer* server)
+{
+  LOG_INFO << impl->requests() << " requests, "
+           << server->services().numAllocated() << " messages allocated";
+}
+
 int main()
 {
   LOG_INFO << "pid = " << getpid();
@@ -37,7 +55,11 @@ int main()
   RpcServer server(&loop, listenAddr);
   server.setThreadNum(2);
   server.registerService(&impl);
+  // curl localhost:12345/rpc/methods
+  Inspector inspector(&loop, InetAddress(12345), "rpcbench");
+  server.stats().registerCommands(&inspector, "rpc");
   server.start();
+  loop.runEvery(5.0, boost::bind(printStats, &impl, &server));
   loop.loop();
 }
 
@@ -30,6 +30,7 @@ class Condition : boost::noncopyable
 
   void wait()
   {
+    MutexLock::UnassignGuard ug(mutex_);
     pthread_cond_wait(&pcond_, mutex_.getPthreadMutex());
   }
 
@@ -0,0 +1,160 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/base/Crc32c.h>
+
+#include <endian.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+using namespace muduo;
+
+namespace
+{
+
+const uint32_t kPolynomial = 0x82f63b78;  // 0x1edc6f41 reversed
+
+// tables_[k][b] is the crc of byte b followed by k zero bytes,
+// so eight bytes are folded with eight lookups
+struct Tables
+{
+  Tables()
+  {
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+      uint32_t crc = i;
+      for (int j = 0; j < 8; ++j)
+      {
+        crc = (crc >> 1) ^ (kPolynomial & (0 - (crc & 1)));
+      }
+      t[0][i] = crc;
+    }
+    for (int i = 0; i < 256; ++i)
+    {
+      for (int k = 1; k < 8; ++k)
+      {
+        t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xff];
+      }
+    }
+  }
+
+  uint32_t t[8][256];
+};
+
+const Tables tables;
+
+inline uint32_t portableByte(uint32_t crc, uint8_t byte)
+{
+  return tables.t[0][(crc ^ byte) & 0xff] ^ (crc >> 8);
+}
+
+uint32_t portable(uint32_t crc, const uint8_t* p, size_t len)
+{
+  crc = ~crc;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+  while (len > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0)
+  {
+    crc = portableByte(crc, *p++);
+    --len;
+  }
+  const uint32_t (*t)[256] = tables.t;
+  while (len >= 8)
+  {
+    uint32_t lo, hi;
+    memcpy(&lo, p, sizeof lo);
+    memcpy(&hi, p + 4, sizeof hi);
+    lo ^= crc;
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+        ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    p += 8;
+    len -= 8;
+  }
+#endif
+  while (len > 0)
+  {
+    crc = portableByte(crc, *p++);
+    --len;
+  }
+  return ~crc;
+}
+
+#if defined(__x86_64__)
+
+// asm instead of intrinsics, so it builds without -msse4.2
+uint32_t hardware(uint32_t crc, const uint8_t* p, size_t len)
+{
+  uint32_t c = ~crc;
+  while (len > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0)
+  {
+    __asm__("crc32b %1, %0" : "+r"(c) : "rm"(*p));
+    ++p;
+    --len;
+  }
+  uint64_t c64 = c;
+  while (len >= 8)
+  {
+    uint64_t v;
+    memcpy(&v, p, sizeof v);
+    __asm__("crc32q %1, %0" : "+r"(c64) : "rm"(v));
+    p += 8;
+    len -= 8;
+  }
+  c = static_cast<uint32_t>(c64);
+  while (len > 0)
+  {
+    __asm__("crc32b %1, %0" : "+r"(c) : "rm"(*p));
+    ++p;
+    --len;
+  }
+  return ~c;
+}
+
+bool hasSse42()
+{
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+}
+
+#else
+
+uint32_t hardware(uint32_t crc, const uint8_t* p, size_t len)
+{
+  return portable(crc, p, len);
+}
+
+bool hasSse42()
+{
+  return false;
+}
+
+#endif
+
+typedef uint32_t (*ExtendFunc)(uint32_t crc, const uint8_t* p, size_t len);
+
+const bool accelerated = hasSse42();
+const ExtendFunc extendFunc = accelerated ? hardware : portable;
+
+}
+
+uint32_t Crc32c::extend(uint32_t crc, const void* data, size_t len)
+{
+  return extendFunc(crc, static_cast<const uint8_t*>(data), len);
+}
+
+uint32_t Crc32c::extendPortable(uint32_t crc, const void* data, size_t len)
+{
+  return portable(crc, static_cast<const uint8_t*>(data), len);
+}
+
+bool Crc32c::hardwareAccelerated()
+{
+  return accelerated;
+}
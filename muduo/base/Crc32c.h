@@ -0,0 +1,38 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_BASE_CRC32C_H
+#define MUDUO_BASE_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace muduo
+{
+
+/// CRC-32C (Castagnoli), as in iSCSI and SCTP.
+/// Uses the crc32 instruction of SSE4.2 if the CPU has it.
+namespace Crc32c
+{
+  /// crc of data appended to what crc was computed over, 0 to start.
+  uint32_t extend(uint32_t crc, const void* data, size_t len);
+
+  inline uint32_t value(const void* data, size_t len)
+  { return extend(0, data, len); }
+
+  /// Same result as extend(), without the crc32 instruction.
+  uint32_t extendPortable(uint32_t crc, const void* data, size_t len);
+
+  bool hardwareAccelerated();
+}
+
+}
+
+#endif  // MUDUO_BASE_CRC32C_H
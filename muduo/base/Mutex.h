@@ -61,6 +61,26 @@ class MutexLock : boost::noncopyable
   }
 
  private:
+  friend class Condition;
+
+  // the mutex is released while waiting on a condition, others may hold it
+  class UnassignGuard : boost::noncopyable
+  {
+   public:
+    explicit UnassignGuard(MutexLock& owner)
+      : owner_(owner)
+    {
+      owner_.holder_ = 0;
+    }
+
+    ~UnassignGuard()
+    {
+      owner_.holder_ = CurrentThread::tid();
+    }
+
+   private:
+    MutexLock& owner_;
+  };
 
   pthread_mutex_t mutex_;
   pid_t holder_;
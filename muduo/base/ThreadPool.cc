@@ -16,7 +16,9 @@ using namespace muduo;
 ThreadPool::ThreadPool(const string& name)
   : mutex_(),
     cond_(mutex_),
+    notFull_(mutex_),
     name_(name),
+    maxQueueSize_(0),
     running_(false)
 {
 }
@@ -50,6 +52,7 @@ void ThreadPool::stop()
   MutexLockGuard lock(mutex_);
   running_ = false;
   cond_.notifyAll();
+  notFull_.notifyAll();
   }
   for_each(threads_.begin(),
            threads_.end(),
@@ -65,9 +68,48 @@ void ThreadPool::run(const Task& task)
   else
   {
     MutexLockGuard lock(mutex_);
+    while (isFull() && running_)
+    {
+      notFull_.wait();
+    }
+    if (!running_)
+    {
+      return;
+    }
+    queue_.push_back(task);
+    cond_.notify();
+  }
+}
+
+bool ThreadPool::tryRun(const Task& task)
+{
+  if (threads_.empty())
+  {
+    task();
+  }
+  else
+  {
+    MutexLockGuard lock(mutex_);
+    if (isFull())
+    {
+      return false;
+    }
     queue_.push_back(task);
     cond_.notify();
   }
+  return true;
+}
+
+size_t ThreadPool::queueSize() const
+{
+  MutexLockGuard lock(mutex_);
+  return queue_.size();
+}
+
+bool ThreadPool::isFull() const
+{
+  mutex_.assertLocked();
+  return maxQueueSize_ > 0 && queue_.size() >= maxQueueSize_;
 }
 
 ThreadPool::Task ThreadPool::take()
@@ -83,6 +125,10 @@ ThreadPool::Task ThreadPool::take()
   {
     task = queue_.front();
     queue_.pop_front();
+    if (maxQueueSize_ > 0)
+    {
+      notFull_.notify();
+    }
   }
   return task;
 }
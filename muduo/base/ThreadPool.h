@@ -28,20 +28,33 @@ class ThreadPool : boost::noncopyable
   explicit ThreadPool(const string& name = string());
   ~ThreadPool();
 
+  // Must be called before start().  0 for no limit, the default.
+  void setMaxQueueSize(size_t maxSize) { maxQueueSize_ = maxSize; }
+
   void start(int numThreads);
+  // Joins the threads after their running tasks, queued tasks are dropped.
   void stop();
 
+  // Blocks while the queue is full, returns without running f once stop()
+  // is called.
   void run(const Task& f);
+  // return false if the queue is full, f is not run
+  bool tryRun(const Task& f);
+
+  size_t queueSize() const;
 
  private:
+  bool isFull() const;
   void runInThread();
   Task take();
 
-  MutexLock mutex_;
+  mutable MutexLock mutex_;
   Condition cond_;
+  Condition notFull_;
   string name_;
   boost::ptr_vector<muduo::Thread> threads_;
   std::deque<Task> queue_;
+  size_t maxQueueSize_;
   bool running_;
 };
 
@@ -0,0 +1,65 @@
+#include <muduo/base/Crc32c.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace muduo;
+
+// test vectors from RFC 3720 section B.4
+void testKnownValues()
+{
+  char buf[32];
+
+  memset(buf, 0, sizeof buf);
+  assert(Crc32c::value(buf, sizeof buf) == 0x8a9136aa);
+
+  memset(buf, 0xff, sizeof buf);
+  assert(Crc32c::value(buf, sizeof buf) == 0x62a8ab43);
+
+  for (int i = 0; i < 32; ++i)
+  {
+    buf[i] = static_cast<char>(i);
+  }
+  assert(Crc32c::value(buf, sizeof buf) == 0x46dd794e);
+
+  for (int i = 0; i < 32; ++i)
+  {
+    buf[i] = static_cast<char>(31 - i);
+  }
+  assert(Crc32c::value(buf, sizeof buf) == 0x113fdb5c);
+
+  assert(Crc32c::value("123456789", 9) == 0xe3069283);
+  assert(Crc32c::value("", 0) == 0);
+}
+
+// every length and alignment, in one piece or two
+void testAgainstPortable()
+{
+  char buf[256];
+  for (size_t i = 0; i < sizeof buf; ++i)
+  {
+    buf[i] = static_cast<char>(rand());
+  }
+  for (size_t offset = 0; offset < 8; ++offset)
+  {
+    for (size_t len = 0; offset + len <= sizeof buf; ++len)
+    {
+      uint32_t expected = Crc32c::extendPortable(0, buf + offset, len);
+      assert(Crc32c::value(buf + offset, len) == expected);
+      size_t half = len / 2;
+      uint32_t crc = Crc32c::value(buf + offset, half);
+      assert(Crc32c::extend(crc, buf + offset + half, len - half) == expected);
+      crc = Crc32c::extendPortable(0, buf + offset, half);
+      assert(Crc32c::extendPortable(crc, buf + offset + half, len - half) == expected);
+    }
+  }
+}
+
+int main()
+{
+  printf("hardware accelerated: %d\n", Crc32c::hardwareAccelerated());
+  testKnownValues();
+  testAgainstPortable();
+  printf("All tests passed.\n");
+}
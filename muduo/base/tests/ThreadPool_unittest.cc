@@ -0,0 +1,94 @@
+#include <muduo/base/ThreadPool.h>
+#include <muduo/base/Atomic.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+
+#include <boost/bind.hpp>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+// occupies a thread of the pool until gate is opened
+void block(CountDownLatch* started, CountDownLatch* gate)
+{
+  started->countDown();
+  gate->wait();
+}
+
+void count(AtomicInt32* n)
+{
+  n->increment();
+}
+
+void runAndMark(ThreadPool* pool, AtomicInt32* ran, AtomicInt32* returned)
+{
+  pool->run(boost::bind(count, ran));
+  returned->increment();
+}
+
+void testTryRunFull()
+{
+  ThreadPool pool("TryRun");
+  pool.setMaxQueueSize(1);
+  pool.start(1);
+  CountDownLatch started(1);
+  CountDownLatch gate(1);
+  pool.run(boost::bind(block, &started, &gate));
+  started.wait();
+
+  AtomicInt32 ran;
+  bool queued = pool.tryRun(boost::bind(count, &ran));
+  assert(queued);
+  bool full = !pool.tryRun(boost::bind(count, &ran));
+  assert(full);
+  assert(pool.queueSize() == 1);
+  (void) queued; (void) full;
+
+  gate.countDown();
+  CountDownLatch finished(1);
+  pool.run(boost::bind(&CountDownLatch::countDown, &finished));
+  finished.wait();
+  // only the queued one ran
+  assert(ran.get() == 1);
+  pool.stop();
+}
+
+void testRunUnblockedByStop()
+{
+  ThreadPool pool("Run");
+  pool.setMaxQueueSize(1);
+  pool.start(1);
+  CountDownLatch started(1);
+  CountDownLatch gate(1);
+  pool.run(boost::bind(block, &started, &gate));
+  started.wait();
+  AtomicInt32 queuedRan;
+  pool.run(boost::bind(count, &queuedRan));
+
+  // blocks while the queue is full
+  AtomicInt32 ran;
+  AtomicInt32 returned;
+  Thread producer(boost::bind(runAndMark, &pool, &ran, &returned), "Producer");
+  producer.start();
+  usleep(100 * 1000);
+  assert(returned.get() == 0);
+
+  // until stop(), which joins the pool after the blocking task
+  Thread stopper(boost::bind(&ThreadPool::stop, &pool), "Stopper");
+  stopper.start();
+  producer.join();
+  assert(returned.get() == 1);
+  gate.countDown();
+  stopper.join();
+  assert(ran.get() == 0);
+  // stop() was called before the gate opened, the queued task is dropped
+  assert(queuedRan.get() == 0);
+}
+
+int main()
+{
+  testTryRunFull();
+  testRunUnblockedByStop();
+  puts("All pass!!!");
+}
@@ -8,6 +8,7 @@
 
 #include <muduo/net/Acceptor.h>
 
+#include <muduo/base/Logging.h>
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/InetAddress.h>
 #include <muduo/net/SocketsOps.h>
@@ -16,20 +17,70 @@
 
 #include <errno.h>
 #include <fcntl.h>
-//#include <sys/types.h>
-//#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+// Removes the socket file left by a server that is no longer running, so
+// bind(2) succeeds.  Dies rather than removing a file that is not a
+// socket, or the socket of a live server.
+void removeStaleSocket(const InetAddress& listenAddr)
+{
+  const char* path = listenAddr.getSockAddrUnix().sun_path;
+  struct stat st;
+  if (::lstat(path, &st) < 0)
+  {
+    // nothing there, or bind(2) reports why not
+    return;
+  }
+  if (!S_ISSOCK(st.st_mode))
+  {
+    errno = ENOTSOCK;
+    LOG_SYSFATAL << "Acceptor - " << path << " exists";
+  }
+
+  int sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (sockfd < 0)
+  {
+    LOG_SYSFATAL << "Acceptor - socket";
+  }
+  int ret = ::connect(sockfd, listenAddr.getSockAddr(), listenAddr.getSockAddrLen());
+  int savedErrno = errno;
+  ::close(sockfd);
+  if (ret < 0 && savedErrno == ECONNREFUSED)
+  {
+    LOG_WARN << "Acceptor - removes stale socket " << path;
+    ::unlink(path);
+  }
+  else
+  {
+    // accepted, or queued (EAGAIN) by a busy server
+    errno = ret == 0 ? EADDRINUSE : savedErrno;
+    LOG_SYSFATAL << "Acceptor - " << path << " is in use";
+  }
+}
+
+}
+
 Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr)
-  : loop_(looacceptSocket_p),
-    acceptSocket_(sockets::createNonblockingOrDie()),
+  : loop_(loop),
+    acceptSocket_(sockets::createNonblockingOrDie(listenAddr.family())),
     acceptChannel_(loop, acceptSocket_.fd()),
     listenning_(false),
     idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
   assert(idleFd_ >= 0);
+  if (listenAddr.isUnixDomain())
+  {
+    // a stale socket file of previous run makes bind(2) fail
+    removeStaleSocket(listenAddr);
+  }
   acceptSocket_.setReuseAddr(true);
   acceptSocket_.bindAddress(listenAddr);
   acceptChannel_.setReadCallback(
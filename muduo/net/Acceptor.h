@@ -26,7 +26,7 @@ class EventLoop;
 class InetAddress;
 
 ///
-/// Acceptor of incoming TCP connections.
+/// Acceptor of incoming TCP or Unix domain stream connections.
 ///
 class Acceptor : boost::noncopyable
 {
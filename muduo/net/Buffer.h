@@ -199,6 +199,12 @@ class Buffer : public muduo::copyable
   void hasWritten(size_t len)
   { writerIndex_ += len; }
 
+  void unwrite(size_t len)
+  {
+    assert(len <= readableBytes());
+    writerIndex_ -= len;
+  }
+
   ///
   /// Append int32_t using network endian
   ///
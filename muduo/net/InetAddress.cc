@@ -8,9 +8,12 @@
 
 #include <muduo/net/InetAddress.h>
 
+#include <muduo/base/Logging.h>
 #include <muduo/net/Endian.h>
 #include <muduo/net/SocketsOps.h>
 
+#include <stddef.h>  // offsetof
+#include <string.h>
 #include <strings.h>  // bzero
 #include <netinet/in.h>
 
@@ -37,7 +40,8 @@ static const in_addr_t kInaddrAny = INADDR_ANY;
 using namespace muduo;
 using namespace muduo::net;
 
-BOOST_STATIC_ASSERT(sizeof(InetAddress) == sizeof(struct sockaddr_in));
+// nothing but the union of sockaddr_in and sockaddr_un, with padding
+BOOST_STATIC_ASSERT(sizeof(InetAddress) < sizeof(struct sockaddr_un) + sizeof(in_addr_t));
 
 InetAddress::InetAddress(uint16_t port)
 {
@@ -54,8 +58,57 @@ InetAddress::InetAddress(const StringPiece& ip, uint16_t port)
   sockets::fromIpPort(ip.data(), port, &addr_);
 }
 
+InetAddress InetAddress::fromUnixPath(const StringPiece& path)
+{
+  struct sockaddr_un addr;
+  bzero(&addr, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  if (implicit_cast<size_t>(path.size()) >= sizeof addr.sun_path)
+  {
+    LOG_FATAL << "InetAddress::fromUnixPath - path is too long " << path.as_string();
+  }
+  ::memcpy(addr.sun_path, path.data(), path.size());
+  return InetAddress(addr);
+}
+
+InetAddress InetAddress::localAddressOf(int sockfd)
+{
+  struct sockaddr_un addr;
+  bzero(&addr, sizeof addr);
+  sockets::getLocalAddr(sockfd, sockets::sockaddr_cast(&addr), sizeof addr);
+  return InetAddress(addr);
+}
+
+InetAddress InetAddress::peerAddressOf(int sockfd)
+{
+  struct sockaddr_un addr;
+  bzero(&addr, sizeof addr);
+  sockets::getPeerAddr(sockfd, sockets::sockaddr_cast(&addr), sizeof addr);
+  return InetAddress(addr);
+}
+
+const struct sockaddr* InetAddress::getSockAddr() const
+{
+  return isUnixDomain() ? sockets::sockaddr_cast(&addrUnix_)
+                        : sockets::sockaddr_cast(&addr_);
+}
+
+socklen_t InetAddress::getSockAddrLen() const
+{
+  if (isUnixDomain())
+  {
+    return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path)
+                                  + ::strlen(addrUnix_.sun_path) + 1);
+  }
+  return static_cast<socklen_t>(sizeof addr_);
+}
+
 string InetAddress::toIpPort() const
 {
+  if (isUnixDomain())
+  {
+    return toIp();
+  }
   char buf[32];
   sockets::toIpPort(buf, sizeof buf, addr_);
   return buf;
@@ -63,6 +116,10 @@ string InetAddress::toIpPort() const
 
 string InetAddress::toIp() const
 {
+  if (isUnixDomain())
+  {
+    return string("unix:") + addrUnix_.sun_path;
+  }
   char buf[32];
   sockets::toIp(buf, sizeof buf, addr_);
   return buf;
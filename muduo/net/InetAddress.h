@@ -15,6 +15,7 @@
 #include <muduo/base/StringPiece.h>
 
 #include <netinet/in.h>
+#include <sys/un.h>
 
 namespace muduo
 {
@@ -22,7 +23,7 @@ namespace net
 {
 
 ///
-/// Wrapper of sockaddr_in.
+/// Wrapper of sockaddr_in, or sockaddr_un for Unix domain sockets.
 ///
 /// This is an POD interface class.
 class InetAddress : public muduo::copyable
@@ -42,6 +43,22 @@ class InetAddress : public muduo::copyable
     : addr_(addr)
   { }
 
+  /// Constructs an endpoint of any supported family,
+  /// sockaddr_un is large enough to hold all of them.
+  explicit InetAddress(const struct sockaddr_un& addr)
+    : addrUnix_(addr)
+  { }
+
+  /// Constructs a Unix domain socket endpoint with given file @c path,
+  /// which works with TcpServer and TcpClient as well.
+  /// Dies if @c path does not fit in sockaddr_un::sun_path.
+  static InetAddress fromUnixPath(const StringPiece& path);
+
+  /// Local and peer addresses of a socket, of any supported family.
+  static InetAddress localAddressOf(int sockfd);
+  static InetAddress peerAddressOf(int sockfd);
+
+  /// "unix:" followed by the path for Unix domain sockets.
   string toIp() const;
   string toIpPort() const;
   string toHostPort() const __attribute__ ((deprecated))
@@ -49,14 +66,25 @@ class InetAddress : public muduo::copyable
 
   // default copy/assignment are Okay
 
+  sa_family_t family() const { return addr_.sin_family; }
+  bool isUnixDomain() const { return family() == AF_UNIX; }
+
+  const struct sockaddr* getSockAddr() const;
+  socklen_t getSockAddrLen() const;
+
   const struct sockaddr_in& getSockAddrInet() const { return addr_; }
   void setSockAddrInet(const struct sockaddr_in& addr) { addr_ = addr; }
+  const struct sockaddr_un& getSockAddrUnix() const { return addrUnix_; }
 
   uint32_t ipNetEndian() const { return addr_.sin_addr.s_addr; }
   uint16_t portNetEndian() const { return addr_.sin_port; }
 
  private:
-  struct sockaddr_in addr_;
+  union
+  {
+    struct sockaddr_in addr_;
+    struct sockaddr_un addrUnix_;
+  };
   /*
   struct sockaddr_in {
     short	sin_family; // 意义？
@@ -0,0 +1,479 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/ShmConnection.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Channel.h>
+#include <muduo/net/EventLoop.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+// One cache line for each writer, head and tail count bytes since creation.
+struct ShmRing
+{
+  volatile uint64_t head;  // written by producer
+  char pad0[56];
+  volatile uint64_t tail;  // written by consumer
+  char pad1[56];
+  volatile int32_t consumerWaiting;  // consumer is idle, wake it up
+  volatile int32_t producerWaiting;  // producer waits for room, wake it up
+  volatile int32_t closed;           // producer has shut down
+  char pad2[52];
+};
+
+struct ShmRegionHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ringSize;
+  char pad[48];
+};
+
+}
+}
+}
+
+namespace
+{
+
+typedef muduo::net::detail::ShmRing ShmRing;
+typedef muduo::net::detail::ShmRegionHeader ShmRegionHeader;
+
+const uint32_t kShmMagic = 0x6d73686d;  // "mshm"
+const uint32_t kShmVersion = 1;
+
+BOOST_STATIC_ASSERT(sizeof(ShmRing) == 192);
+BOOST_STATIC_ASSERT(sizeof(ShmRegionHeader) == 64);
+
+size_t regionSizeOf(size_t ringSize)
+{
+  return sizeof(ShmRegionHeader) + 2 * sizeof(ShmRing) + 2 * ringSize;
+}
+
+size_t roundUpPowerOf2(size_t n)
+{
+  size_t size = 4096;
+  while (size < n)
+  {
+    size *= 2;
+  }
+  return size;
+}
+
+}
+
+const size_t ShmConnection::kDefaultRingSize;
+
+bool ShmConnection::createHandles(Handles* handles, size_t ringSize)
+{
+  ringSize = roundUpPowerOf2(ringSize);
+  handles->memfd = static_cast<int>(::syscall(SYS_memfd_create, "muduo-shm", MFD_CLOEXEC));
+  handles->eventfd[0] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  handles->eventfd[1] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (handles->memfd < 0 || handles->eventfd[0] < 0 || handles->eventfd[1] < 0)
+  {
+    LOG_SYSERR << "ShmConnection::createHandles";
+    closeHandles(*handles);
+    return false;
+  }
+
+  const size_t size = regionSizeOf(ringSize);
+  if (::ftruncate(handles->memfd, static_cast<off_t>(size)) < 0)
+  {
+    LOG_SYSERR << "ShmConnection::createHandles - ftruncate";
+    closeHandles(*handles);
+    return false;
+  }
+  void* region = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, handles->memfd, 0);
+  if (region == MAP_FAILED)
+  {
+    LOG_SYSERR << "ShmConnection::createHandles - mmap";
+    closeHandles(*handles);
+    return false;
+  }
+  // ftruncate() zero-fills, rings start empty
+  detail::ShmRegionHeader* header = static_cast<detail::ShmRegionHeader*>(region);
+  header->ringSize = ringSize;
+  header->version = kShmVersion;
+  header->magic = kShmMagic;
+  ::munmap(region, size);
+  return true;
+}
+
+void ShmConnection::closeHandles(const Handles& handles)
+{
+  if (handles.memfd >= 0)
+    ::close(handles.memfd);
+  if (handles.eventfd[0] >= 0)
+    ::close(handles.eventfd[0]);
+  if (handles.eventfd[1] >= 0)
+    ::close(handles.eventfd[1]);
+}
+
+ShmConnection::ShmConnection(EventLoop* loop,
+                             const string& nameArg,
+                             const Handles& handles,
+                             int side)
+  : loop_(CHECK_NOTNULL(loop)),
+    name_(nameArg),
+    side_(side),
+    state_(kConnecting),
+    region_(NULL),
+    regionSize_(0),
+    txRing_(NULL),
+    rxRing_(NULL),
+    txData_(NULL),
+    rxData_(NULL),
+    ringSize_(0),
+    wakeupFd_(::dup(handles.eventfd[side])),
+    peerFd_(::dup(handles.eventfd[1 - side])),
+    channel_(new Channel(loop, wakeupFd_)),
+    signalCount_(0)
+{
+  assert(side == 0 || side == 1);
+  struct stat st;
+  if (::fstat(handles.memfd, &st) < 0)
+  {
+    LOG_SYSFATAL << "ShmConnection::ShmConnection - fstat";
+  }
+  regionSize_ = static_cast<size_t>(st.st_size);
+  region_ = ::mmap(NULL, regionSize_, PROT_READ | PROT_WRITE, MAP_SHARED, handles.memfd, 0);
+  if (region_ == MAP_FAILED)
+  {
+    LOG_SYSFATAL << "ShmConnection::ShmConnection - mmap";
+  }
+
+  char* base = static_cast<char*>(region_);
+  detail::ShmRegionHeader* header = reinterpret_cast<detail::ShmRegionHeader*>(base);
+  if (header->magic != kShmMagic || header->version != kShmVersion
+      || regionSizeOf(header->ringSize) != regionSize_)
+  {
+    LOG_FATAL << "ShmConnection::ShmConnection [" << name_ << "] - bad shared region";
+  }
+  ringSize_ = header->ringSize;
+  detail::ShmRing* rings = reinterpret_cast<detail::ShmRing*>(base + sizeof *header);
+  char* data = base + sizeof *header + 2 * sizeof(detail::ShmRing);
+  txRing_ = &rings[side];
+  rxRing_ = &rings[1 - side];
+  txData_ = data + side * ringSize_;
+  rxData_ = data + (1 - side) * ringSize_;
+
+  channel_->setReadCallback(
+      boost::bind(&ShmConnection::handleRead, this, _1));
+  LOG_DEBUG << "ShmConnection::ctor[" <<  name_ << "] at " << this
+            << " side=" << side_ << " ring=" << ringSize_;
+}
+
+ShmConnection::~ShmConnection()
+{
+  LOG_DEBUG << "ShmConnection::dtor[" <<  name_ << "] at " << this;
+  assert(state_ == kDisconnected || state_ == kConnecting);
+  ::munmap(region_, regionSize_);
+  ::close(wakeupFd_);
+  ::close(peerFd_);
+}
+
+void ShmConnection::start()
+{
+  loop_->runInLoop(boost::bind(&ShmConnection::startInLoop, shared_from_this()));
+}
+
+void ShmConnection::startInLoop()
+{
+  loop_->assertInLoopThread();
+  assert(state_ == kConnecting);
+  setState(kConnected);
+  channel_->tie(shared_from_this());
+  channel_->enableReading();
+  if (connectionCallback_)
+  {
+    connectionCallback_(shared_from_this());
+  }
+  // the peer may have written before we started
+  wakeup();
+}
+
+void ShmConnection::send(const void* data, size_t len)
+{
+  send(StringPiece(static_cast<const char*>(data), static_cast<int>(len)));
+}
+
+void ShmConnection::send(const StringPiece& message)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendInLoop(message);
+    }
+    else
+    {
+      void (ShmConnection::*fp)(const StringPiece& message) = &ShmConnection::sendInLoop;
+      loop_->runInLoop(
+          boost::bind(fp, shared_from_this(), message.as_string()));
+    }
+  }
+}
+
+void ShmConnection::send(Buffer* buf)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendInLoop(buf->peek(), buf->readableBytes());
+      buf->retrieveAll();
+    }
+    else
+    {
+      void (ShmConnection::*fp)(const StringPiece& message) = &ShmConnection::sendInLoop;
+      loop_->runInLoop(
+          boost::bind(fp, shared_from_this(), buf->retrieveAllAsString()));
+    }
+  }
+}
+
+void ShmConnection::sendInLoop(const StringPiece& message)
+{
+  sendInLoop(message.data(), message.size());
+}
+
+void ShmConnection::sendInLoop(const void* data, size_t len)
+{
+  loop_->assertInLoopThread();
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  size_t written = 0;
+  if (outputBuffer_.readableBytes() == 0)
+  {
+    // straight into the ring, no copy to outputBuffer_
+    written = writeRing(static_cast<const char*>(data), len);
+  }
+  if (written < len)
+  {
+    outputBuffer_.append(static_cast<const char*>(data) + written, len - written);
+  }
+  if (flushOutput() && writeCompleteCallback_)
+  {
+    loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
+  }
+}
+
+// Copies as much as fits into txRing_, returns bytes written.
+size_t ShmConnection::writeRing(const char* data, size_t len)
+{
+  const uint64_t head = txRing_->head;
+  const uint64_t tail = txRing_->tail;
+  const size_t n = std::min(ringSize_ - static_cast<size_t>(head - tail), len);
+  if (n > 0)
+  {
+    const size_t pos = static_cast<size_t>(head & (ringSize_ - 1));
+    const size_t first = std::min(n, ringSize_ - pos);
+    ::memcpy(txData_ + pos, data, first);
+    ::memcpy(txData_, data + first, n - first);
+    __sync_synchronize();  // data before head
+    txRing_->head = head + n;
+    __sync_synchronize();  // head before consumerWaiting
+    if (txRing_->consumerWaiting && __sync_lock_test_and_set(&txRing_->consumerWaiting, 0))
+    {
+      notifyPeer();
+    }
+  }
+  return n;
+}
+
+// Moves outputBuffer_ into txRing_, returns true if all went in.
+bool ShmConnection::flushOutput()
+{
+  while (outputBuffer_.readableBytes() > 0)
+  {
+    const uint64_t tail = txRing_->tail;
+    size_t n = writeRing(outputBuffer_.peek(), outputBuffer_.readableBytes());
+    outputBuffer_.retrieve(n);
+    if (n == 0)
+    {
+      // ask the consumer to wake us up, then check again
+      txRing_->producerWaiting = 1;
+      __sync_synchronize();
+      if (txRing_->tail == tail)
+      {
+        return false;
+      }
+      txRing_->producerWaiting = 0;
+    }
+  }
+  return true;
+}
+
+void ShmConnection::notifyPeer()
+{
+  uint64_t one = 1;
+  ssize_t n = ::write(peerFd_, &one, sizeof one);
+  if (n != sizeof one)
+  {
+    LOG_ERROR << "ShmConnection::notifyPeer() writes " << n << " bytes instead of 8";
+  }
+  ++signalCount_;
+}
+
+void ShmConnection::wakeup()
+{
+  uint64_t one = 1;
+  ssize_t n = ::write(wakeupFd_, &one, sizeof one);
+  if (n != sizeof one)
+  {
+    LOG_ERROR << "ShmConnection::wakeup() writes " << n << " bytes instead of 8";
+  }
+}
+
+void ShmConnection::handleRead(Timestamp receiveTime)
+{
+  loop_->assertInLoopThread();
+  uint64_t howmany = 0;
+  ssize_t nr = ::read(wakeupFd_, &howmany, sizeof howmany);
+  if (nr != sizeof howmany)
+  {
+    LOG_ERROR << "ShmConnection::handleRead() reads " << nr << " bytes instead of 8";
+  }
+  // busy from now on, the peer doesn't need to signal us
+  rxRing_->consumerWaiting = 0;
+
+  const uint64_t mask = ringSize_ - 1;
+  const uint64_t tail = rxRing_->tail;
+  const uint64_t head = rxRing_->head;
+  __sync_synchronize();  // head before data
+  const size_t n = static_cast<size_t>(head - tail);
+  if (n > 0)
+  {
+    const size_t pos = static_cast<size_t>(tail & mask);
+    const size_t first = std::min(n, ringSize_ - pos);
+    inputBuffer_.append(rxData_ + pos, first);
+    inputBuffer_.append(rxData_, n - first);
+    __sync_synchronize();  // data before tail
+    rxRing_->tail = head;
+    __sync_synchronize();  // tail before producerWaiting
+    if (rxRing_->producerWaiting && __sync_lock_test_and_set(&rxRing_->producerWaiting, 0))
+    {
+      notifyPeer();
+    }
+  }
+
+  // the peer made room in txRing_
+  if (outputBuffer_.readableBytes() > 0 && flushOutput())
+  {
+    if (writeCompleteCallback_)
+    {
+      loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if (state_ == kDisconnecting)
+    {
+      shutdownInLoop();
+    }
+  }
+
+  if (n > 0)
+  {
+    if (messageCallback_)
+    {
+      messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    }
+    else
+    {
+      inputBuffer_.retrieveAll();
+    }
+  }
+
+  if (state_ == kDisconnected)
+  {
+    return;
+  }
+  if (rxRing_->closed && rxRing_->head == rxRing_->tail)
+  {
+    handleClose();
+    return;
+  }
+
+  // idle now, data written from here on must signal us
+  rxRing_->consumerWaiting = 1;
+  __sync_synchronize();
+  if (rxRing_->head != rxRing_->tail || rxRing_->closed)
+  {
+    // raced with the producer, it may not have seen consumerWaiting
+    rxRing_->consumerWaiting = 0;
+    wakeup();
+  }
+}
+
+void ShmConnection::shutdown()
+{
+  if (state_ == kConnected)
+  {
+    setState(kDisconnecting);
+    loop_->runInLoop(boost::bind(&ShmConnection::shutdownInLoop, shared_from_this()));
+  }
+}
+
+void ShmConnection::shutdownInLoop()
+{
+  loop_->assertInLoopThread();
+  if (outputBuffer_.readableBytes() == 0 && !txRing_->closed)
+  {
+    __sync_synchronize();
+    txRing_->closed = 1;
+    __sync_synchronize();
+    notifyPeer();
+  }
+}
+
+void ShmConnection::handleClose()
+{
+  loop_->assertInLoopThread();
+  LOG_TRACE << "ShmConnection::handleClose [" << name_ << "] state = " << state_;
+  assert(state_ == kConnected || state_ == kDisconnecting);
+  setState(kDisconnected);
+  if (!txRing_->closed)
+  {
+    txRing_->closed = 1;
+    __sync_synchronize();
+    notifyPeer();
+  }
+  channel_->disableAll();
+  channel_->remove();
+  if (connectionCallback_)
+  {
+    connectionCallback_(shared_from_this());
+  }
+}
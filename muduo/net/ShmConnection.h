@@ -0,0 +1,159 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_SHMCONNECTION_H
+#define MUDUO_NET_SHMCONNECTION_H
+
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/Buffer.h>
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class Channel;
+class EventLoop;
+class ShmConnection;
+
+namespace detail
+{
+struct ShmRing;
+}
+
+typedef boost::shared_ptr<ShmConnection> ShmConnectionPtr;
+typedef boost::function<void (const ShmConnectionPtr&)> ShmConnectionCallback;
+typedef boost::function<void (const ShmConnectionPtr&)> ShmWriteCompleteCallback;
+typedef boost::function<void (const ShmConnectionPtr&,
+                              Buffer*,
+                              Timestamp)> ShmMessageCallback;
+
+///
+/// Byte stream between two peers on the same host, over a pair of
+/// single-producer single-consumer rings in a shared memfd mapping.
+///
+/// Side 0 writes ring 0 and reads ring 1, side 1 the other way round.
+/// Each side owns an eventfd registered with its EventLoop, the peer
+/// writes it only if this side has announced it's idle, so a busy pair
+/// exchanges data without any syscall.
+///
+/// The descriptors in Handles are passed to the peer process by fork(2)
+/// or SCM_RIGHTS, the peers then create one ShmConnection each.
+/// A crashed peer is not detected, watch it with a Unix domain socket.
+///
+/// This is an interface class, so don't expose too much details.
+class ShmConnection : boost::noncopyable,
+                      public boost::enable_shared_from_this<ShmConnection>
+{
+ public:
+  struct Handles
+  {
+    int memfd;
+    int eventfd[2];  // eventfd[i] wakes side i
+  };
+
+  static const size_t kDefaultRingSize = 1024 * 1024;
+
+  /// Creates the shared region with two rings of @c ringSize bytes,
+  /// @c ringSize is rounded up to a power of 2.
+  /// Returns false on failure.
+  static bool createHandles(Handles* handles, size_t ringSize = kDefaultRingSize);
+  static void closeHandles(const Handles& handles);
+
+  /// Maps the region as @c side, the descriptors are dup'ed,
+  /// so @c handles can be closed afterwards.
+  ShmConnection(EventLoop* loop,
+                const string& name,
+                const Handles& handles,
+                int side);
+  ~ShmConnection();
+
+  EventLoop* getLoop() const { return loop_; }
+  const string& name() const { return name_; }
+  int side() const { return side_; }
+  bool connected() const { return state_ == kConnected; }
+
+  /// Starts reading, connection callback is called in loop thread.
+  /// Thread safe.
+  void start();
+
+  /// Thread safe.
+  void send(const void* message, size_t len);
+  void send(const StringPiece& message);
+  void send(Buffer* message);  // this one will swap data
+
+  /// Closes our writing side after pending data went into the ring,
+  /// the peer sees the end of stream and disconnects.
+  /// NOT thread safe, no simultaneous calling
+  void shutdown();
+
+  void setConnectionCallback(const ShmConnectionCallback& cb)
+  { connectionCallback_ = cb; }
+
+  void setMessageCallback(const ShmMessageCallback& cb)
+  { messageCallback_ = cb; }
+
+  void setWriteCompleteCallback(const ShmWriteCompleteCallback& cb)
+  { writeCompleteCallback_ = cb; }
+
+  Buffer* inputBuffer()
+  { return &inputBuffer_; }
+
+  /// Number of eventfd writes to the peer, in loop thread.
+  int64_t signalCount() const { return signalCount_; }
+
+ private:
+  enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
+  void startInLoop();
+  void handleRead(Timestamp receiveTime);
+  void handleClose();
+  void sendInLoop(const StringPiece& message);
+  void sendInLoop(const void* message, size_t len);
+  void shutdownInLoop();
+  size_t writeRing(const char* data, size_t len);
+  bool flushOutput();
+  void notifyPeer();
+  void wakeup();
+  void setState(StateE s) { state_ = s; }
+
+  EventLoop* loop_;
+  const string name_;
+  const int side_;
+  StateE state_;  // FIXME: use atomic variable
+  void* region_;
+  size_t regionSize_;
+  detail::ShmRing* txRing_;
+  detail::ShmRing* rxRing_;
+  char* txData_;
+  const char* rxData_;
+  size_t ringSize_;
+  int wakeupFd_;
+  int peerFd_;
+  boost::scoped_ptr<Channel> channel_;
+  ShmConnectionCallback connectionCallback_;
+  ShmMessageCallback messageCallback_;
+  ShmWriteCompleteCallback writeCompleteCallback_;
+  Buffer inputBuffer_;
+  Buffer outputBuffer_;  // waits for room in txRing_
+  int64_t signalCount_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_SHMCONNECTION_H
@@ -63,6 +63,11 @@ class Socket : boost::noncopyable
   ///
   void setReuseAddr(bool on);
 
+  ///
+  /// Enable/disable SO_REUSEPORT
+  ///
+  void setReusePort(bool on);
+
   ///
   /// Enable/disable SO_KEEPALIVE
   ///
@@ -17,6 +17,8 @@
 #include <stdio.h>  // snprintf
 #include <strings.h>  // bzero
 #include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>  // readv
 #include <unistd.h>
 
 using namespace muduo;
@@ -27,16 +29,6 @@ namespace
 
 typedef struct sockaddr SA;
 
-const SA* sockaddr_cast(const struct sockaddr_in* addr)
-{
-  return static_cast<const SA*>(implicit_cast<const void*>(addr));
-}
-
-SA* sockaddr_cast(struct sockaddr_in* addr)
-{
-  return static_cast<SA*>(implicit_cast<void*>(addr));
-}
-
 void setNonBlockAndCloseOnExec(int sockfd)
 {
   // non-block
@@ -56,11 +48,32 @@ void setNonBlockAndCloseOnExec(int sockfd)
 
 }
 
-int sockets::createNonblockingOrDie()
+const SA* sockets::sockaddr_cast(const struct sockaddr_in* addr)
+{
+  return static_cast<const SA*>(implicit_cast<const void*>(addr));
+}
+
+SA* sockets::sockaddr_cast(struct sockaddr_in* addr)
+{
+  return static_cast<SA*>(implicit_cast<void*>(addr));
+}
+
+const SA* sockets::sockaddr_cast(const struct sockaddr_un* addr)
+{
+  return static_cast<const SA*>(implicit_cast<const void*>(addr));
+}
+
+SA* sockets::sockaddr_cast(struct sockaddr_un* addr)
+{
+  return static_cast<SA*>(implicit_cast<void*>(addr));
+}
+
+int sockets::createNonblockingOrDie(sa_family_t family)
 {
+  int protocol = family == AF_INET ? IPPROTO_TCP : 0;
   // socket
 #if VALGRIND
-  int sockfd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  int sockfd = ::socket(family, SOCK_STREAM, protocol);
   if (sockfd < 0)
   {
     LOG_SYSFATAL << "sockets::createNonblockingOrDie";
@@ -68,7 +81,7 @@ int sockets::createNonblockingOrDie()
 
   setNonBlockAndCloseOnExec(sockfd);
 #else
-  int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+  int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
   if (sockfd < 0)
   {
     LOG_SYSFATAL << "sockets::createNonblockingOrDie";
@@ -77,9 +90,24 @@ int sockets::createNonblockingOrDie()
   return sockfd;
 }
 
+int sockets::createNonblockingUdpOrDie()
+{
+  int sockfd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+  if (sockfd < 0)
+  {
+    LOG_SYSFATAL << "sockets::createNonblockingUdpOrDie";
+  }
+  return sockfd;
+}
+
 void sockets::bindOrDie(int sockfd, const struct sockaddr_in& addr)
 {
-  int ret = ::bind(sockfd, sockaddr_cast(&addr), sizeof addr);
+  bindOrDie(sockfd, sockaddr_cast(&addr), static_cast<socklen_t>(sizeof addr));
+}
+
+void sockets::bindOrDie(int sockfd, const struct sockaddr* addr, socklen_t addrlen)
+{
+  int ret = ::bind(sockfd, addr, addrlen);
   if (ret < 0)
   {
     LOG_SYSFATAL << "sockets::bindOrDie";
@@ -97,12 +125,16 @@ void sockets::listenOrDie(int sockfd)
 
 int sockets::accept(int sockfd, struct sockaddr_in* addr)
 {
-  socklen_t addrlen = sizeof *addr;
+  return sockets::accept(sockfd, sockaddr_cast(addr), static_cast<socklen_t>(sizeof *addr));
+}
+
+int sockets::accept(int sockfd, struct sockaddr* addr, socklen_t addrlen)
+{
 #if VALGRIND
-  int connfd = ::accept(sockfd, sockaddr_cast(addr), &addrlen);
+  int connfd = ::accept(sockfd, addr, &addrlen);
   setNonBlockAndCloseOnExec(connfd);
 #else
-  int connfd = ::accept4(sockfd, sockaddr_cast(addr),
+  int connfd = ::accept4(sockfd, addr,
                          &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
 #endif
   if (connfd < 0)
@@ -141,7 +173,12 @@ int sockets::accept(int sockfd, struct sockaddr_in* addr)
 
 int sockets::connect(int sockfd, const struct sockaddr_in& addr)
 {
-  return ::connect(sockfd, sockaddr_cast(&addr), sizeof addr);
+  return sockets::connect(sockfd, sockaddr_cast(&addr), static_cast<socklen_t>(sizeof addr));
+}
+
+int sockets::connect(int sockfd, const struct sockaddr* addr, socklen_t addrlen)
+{
+  return ::connect(sockfd, addr, addrlen);
 }
 
 ssize_t sockets::read(int sockfd, void *buf, size_t count)
@@ -161,6 +198,21 @@ ssize_t sockets::write(int sockfd, const void *buf, size_t count)
   return ::write(sockfd, buf, count);
 }
 
+ssize_t sockets::sendfile(int sockfd, int fd, off_t* offset, size_t count)
+{
+  return ::sendfile(sockfd, fd, offset, count);
+}
+
+int sockets::recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen)
+{
+  return ::recvmmsg(sockfd, msgvec, vlen, 0, NULL);
+}
+
+int sockets::sendmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen)
+{
+  return ::sendmmsg(sockfd, msgvec, vlen, 0);
+}
+
 void sockets::close(int sockfd)
 {
   if (::close(sockfd) < 0)
@@ -245,8 +297,32 @@ struct sockaddr_in sockets::getPeerAddr(int sockfd)
   return peeraddr;
 }
 
+void sockets::getLocalAddr(int sockfd, struct sockaddr* addr, socklen_t addrlen)
+{
+  if (::getsockname(sockfd, addr, &addrlen) < 0)
+  {
+    LOG_SYSERR << "sockets::getLocalAddr";
+  }
+}
+
+void sockets::getPeerAddr(int sockfd, struct sockaddr* addr, socklen_t addrlen)
+{
+  if (::getpeername(sockfd, addr, &addrlen) < 0)
+  {
+    LOG_SYSERR << "sockets::getPeerAddr";
+  }
+}
+
 bool sockets::isSelfConnect(int sockfd)
 {
+  struct sockaddr_un local;
+  bzero(&local, sizeof local);
+  getLocalAddr(sockfd, sockaddr_cast(&local), sizeof local);
+  if (local.sun_family != AF_INET)
+  {
+    // Unix domain sockets never connect to themselves
+    return false;
+  }
   struct sockaddr_in localaddr = getLocalAddr(sockfd);
   struct sockaddr_in peeraddr = getPeerAddr(sockfd);
   return localaddr.sin_port == peeraddr.sin_port
@@ -12,6 +12,7 @@
 #define MUDUO_NET_SOCKETSOPS_H
 
 #include <arpa/inet.h>
+#include <sys/un.h>
 
 namespace muduo
 {
@@ -21,17 +22,29 @@ namespace sockets
 {
 
 ///
-/// Creates a non-blocking socket file descriptor,
+/// Creates a non-blocking stream socket file descriptor,
+/// AF_INET for TCP or AF_UNIX, abort if any error.
+int createNonblockingOrDie(sa_family_t family = AF_INET);
+
+///
+/// Creates a non-blocking UDP socket file descriptor,
 /// abort if any error.
-int createNonblockingOrDie();
+int createNonblockingUdpOrDie();
 
 int  connect(int sockfd, const struct sockaddr_in& addr);
+int  connect(int sockfd, const struct sockaddr* addr, socklen_t addrlen);
 void bindOrDie(int sockfd, const struct sockaddr_in& addr);
+void bindOrDie(int sockfd, const struct sockaddr* addr, socklen_t addrlen);
 void listenOrDie(int sockfd);
 int  accept(int sockfd, struct sockaddr_in* addr);
+/// *addr has room for addrlen bytes
+int  accept(int sockfd, struct sockaddr* addr, socklen_t addrlen);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
+ssize_t sendfile(int sockfd, int fd, off_t* offset, size_t count);
+int  recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen);
+int  sendmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen);
 void close(int sockfd);
 void shutdownWrite(int sockfd);
 
@@ -46,8 +59,15 @@ int getSocketError(int sockfd);
 
 struct sockaddr_in getLocalAddr(int sockfd);
 struct sockaddr_in getPeerAddr(int sockfd);
+void getLocalAddr(int sockfd, struct sockaddr* addr, socklen_t addrlen);
+void getPeerAddr(int sockfd, struct sockaddr* addr, socklen_t addrlen);
 bool isSelfConnect(int sockfd);
 
+const struct sockaddr* sockaddr_cast(const struct sockaddr_in* addr);
+struct sockaddr* sockaddr_cast(struct sockaddr_in* addr);
+const struct sockaddr* sockaddr_cast(const struct sockaddr_un* addr);
+struct sockaddr* sockaddr_cast(struct sockaddr_un* addr);
+
 }
 }
 }
@@ -127,13 +127,14 @@ void TcpClient::stop()
 void TcpClient::newConnection(int sockfd)
 {
   loop_->assertInLoopThread();
-  InetAddress peerAddr(sockets::getPeerAddr(sockfd));
+  InetAddress peerAddr(InetAddress::peerAddressOf(sockfd));
+  // a unix domain path may be longer than any fixed buffer
   char buf[32];
-  snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
+  snprintf(buf, sizeof buf, "#%d", nextConnId_);
   ++nextConnId_;
-  string connName = name_ + buf;
+  string connName = name_ + ":" + peerAddr.toIpPort() + buf;
 
-  InetAddress localAddr(sockets::getLocalAddr(sockfd));
+  InetAddress localAddr(InetAddress::localAddressOf(sockfd));
   // FIXME poll with zero timeout to double confirm the new connection
   // FIXME use make_shared if necessary
   TcpConnectionPtr conn(new TcpConnection(loop_,
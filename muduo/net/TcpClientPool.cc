@@ -0,0 +1,313 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/TcpClientPool.h>
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/TcpClient.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+#include <stdio.h>  // snprintf
+#include <stdlib.h>  // rand_r
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+class PoolBackend : boost::noncopyable
+{
+ public:
+  explicit PoolBackend(const InetAddress& addr)
+    : serverAddr(addr)
+  {
+  }
+
+  bool ejected(int64_t now)
+  { return now < ejectedUntil.get(); }
+
+  const InetAddress serverAddr;
+  AtomicInt32 failures;
+  AtomicInt64 ejectedUntil;  // microSecondsSinceEpoch
+};
+
+class PoolSlot : boost::noncopyable
+{
+ public:
+  PoolSlot(EventLoop* l, PoolBackend* b, const string& name)
+    : loop(l),
+      client(l, b->serverAddr, name),
+      backend(b)
+  {
+  }
+
+  EventLoop* const loop;
+  TcpClient client;
+  PoolBackend* const backend;
+  AtomicInt32 outstanding;
+};
+
+}
+}
+}
+
+namespace
+{
+__thread unsigned int t_seed = 0;
+
+size_t randomIndex(size_t n)
+{
+  if (t_seed == 0)
+  {
+    t_seed = static_cast<unsigned int>(CurrentThread::tid());
+  }
+  return static_cast<size_t>(rand_r(&t_seed)) % n;
+}
+
+// in the loop of slot, so no callback of it is running meanwhile
+void detachSlot(muduo::net::detail::PoolSlot* slot, CountDownLatch* latch)
+{
+  slot->client.setConnectionCallback(defaultConnectionCallback);
+  TcpConnectionPtr conn = slot->client.connection();
+  if (conn)
+  {
+    conn->setConnectionCallback(defaultConnectionCallback);
+  }
+  latch->countDown();
+}
+}
+
+TcpClientPool::TcpClientPool(EventLoop* baseLoop, const string& nameArg)
+  : baseLoop_(CHECK_NOTNULL(baseLoop)),
+    name_(nameArg),
+    threadPool_(new EventLoopThreadPool(baseLoop)),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    connectionsPerBackend_(1),
+    policy_(kLeastOutstanding),
+    maxFailures_(3),
+    ejectSeconds_(10.0),
+    started_(false),
+    entries_(new EntryList)
+{
+}
+
+TcpClientPool::~TcpClientPool()
+{
+  stop();
+  // connections outlive their TcpClient, don't call back into this,
+  // waits for each loop, as a close may be on its way
+  CountDownLatch latch(static_cast<int>(slots_.size()));
+  for (size_t i = 0; i < slots_.size(); ++i)
+  {
+    slots_[i].loop->runInLoop(boost::bind(detachSlot, &slots_[i], &latch));
+  }
+  latch.wait();
+}
+
+void TcpClientPool::setThreadNum(int numThreads)
+{
+  assert(0 <= numThreads);
+  threadPool_->setThreadNum(numThreads);
+}
+
+void TcpClientPool::addBackend(const InetAddress& serverAddr)
+{
+  assert(!started_);
+  backends_.push_back(new detail::PoolBackend(serverAddr));
+}
+
+void TcpClientPool::start()
+{
+  baseLoop_->assertInLoopThread();
+  assert(!started_);
+  started_ = true;
+  threadPool_->start(threadInitCallback_);
+
+  for (size_t i = 0; i < backends_.size(); ++i)
+  {
+    detail::PoolBackend* backend = &backends_[i];
+    for (int j = 0; j < connectionsPerBackend_; ++j)
+    {
+      char buf[32];
+      snprintf(buf, sizeof buf, "#%d", j);
+      // spread connections of one backend over loops
+      detail::PoolSlot* slot =
+          new detail::PoolSlot(threadPool_->getNextLoop(), backend,
+                               name_ + ":" + backend->serverAddr.toIpPort() + buf);
+      slots_.push_back(slot);
+      slot->client.setConnectionCallback(
+          boost::bind(&TcpClientPool::onConnection, this, slot, _1));
+      slot->client.setMessageCallback(messageCallback_);
+      slot->client.setWriteCompleteCallback(writeCompleteCallback_);
+      slot->client.enableRetry();
+      slot->client.connect();
+    }
+  }
+}
+
+void TcpClientPool::stop()
+{
+  stopping_.getAndSet(1);
+  for (size_t i = 0; i < slots_.size(); ++i)
+  {
+    slots_[i].client.stop();
+    slots_[i].client.disconnect();
+  }
+}
+
+void TcpClientPool::onConnection(detail::PoolSlot* slot, const TcpConnectionPtr& conn)
+{
+  Entry entry = { conn, slot };
+  {
+  MutexLockGuard lock(mutex_);
+  if (!entries_.unique())
+  {
+    entries_.reset(new EntryList(*entries_));
+  }
+  assert(entries_.unique());
+
+  EntryList::iterator it = std::lower_bound(entries_->begin(), entries_->end(), entry);
+  if (conn->connected())
+  {
+    entries_->insert(it, entry);
+  }
+  else if (it != entries_->end() && it->conn == conn)
+  {
+    entries_->erase(it);
+  }
+  }
+
+  if (!conn->connected())
+  {
+    // requests in flight are lost along with the connection
+    slot->outstanding.getAndSet(0);
+    if (stopping_.get() == 0)
+    {
+      recordFailure(slot->backend);
+    }
+  }
+  connectionCallback_(conn);
+}
+
+void TcpClientPool::recordFailure(detail::PoolBackend* backend)
+{
+  if (backend->failures.incrementAndGet() >= maxFailures_)
+  {
+    backend->failures.getAndSet(0);
+    Timestamp until = addTime(Timestamp::now(), ejectSeconds_);
+    backend->ejectedUntil.getAndSet(until.microSecondsSinceEpoch());
+    LOG_WARN << "TcpClientPool[" << name_ << "] - eject "
+             << backend->serverAddr.toIpPort() << " for "
+             << ejectSeconds_ << " seconds";
+  }
+}
+
+TcpConnectionPtr TcpClientPool::acquire()
+{
+  EntryListPtr entries = getEntryList();
+  const size_t n = entries->size();
+  if (n == 0)
+  {
+    return TcpConnectionPtr();
+  }
+
+  const int64_t now = Timestamp::now().microSecondsSinceEpoch();
+  const Entry* chosen = NULL;
+  if (policy_ == kPowerOfTwoChoices && n > 1)
+  {
+    const Entry* a = &(*entries)[randomIndex(n)];
+    const Entry* b = &(*entries)[randomIndex(n)];
+    bool aOk = !a->slot->backend->ejected(now);
+    bool bOk = !b->slot->backend->ejected(now);
+    if (aOk && bOk)
+    {
+      chosen = a->slot->outstanding.get() <= b->slot->outstanding.get() ? a : b;
+    }
+    else if (aOk || bOk)
+    {
+      chosen = aOk ? a : b;
+    }
+    // both ejected, fall back to scanning
+  }
+
+  if (chosen == NULL)
+  {
+    const Entry* fallback = NULL;
+    int32_t least = 0;
+    int32_t leastFallback = 0;
+    for (EntryList::const_iterator it = entries->begin(); it != entries->end(); ++it)
+    {
+      int32_t outstanding = it->slot->outstanding.get();
+      if (!it->slot->backend->ejected(now))
+      {
+        if (chosen == NULL || outstanding < least)
+        {
+          chosen = &*it;
+          least = outstanding;
+        }
+      }
+      else if (fallback == NULL || outstanding < leastFallback)
+      {
+        fallback = &*it;
+        leastFallback = outstanding;
+      }
+    }
+    if (chosen == NULL)
+    {
+      chosen = fallback;
+    }
+  }
+
+  assert(chosen != NULL);
+  chosen->slot->outstanding.increment();
+  return chosen->conn;
+}
+
+void TcpClientPool::release(const TcpConnectionPtr& conn, bool ok)
+{
+  EntryListPtr entries = getEntryList();
+  Entry key = { conn, NULL };
+  EntryList::const_iterator it = std::lower_bound(entries->begin(), entries->end(), key);
+  if (it == entries->end() || it->conn != conn)
+  {
+    // connection is gone, its outstanding count has been reset.
+    return;
+  }
+
+  detail::PoolSlot* slot = it->slot;
+  if (slot->outstanding.decrementAndGet() < 0)
+  {
+    slot->outstanding.getAndSet(0);
+  }
+  if (ok)
+  {
+    slot->backend->failures.getAndSet(0);
+  }
+  else
+  {
+    recordFailure(slot->backend);
+  }
+}
+
+size_t TcpClientPool::numConnected() const
+{
+  return getEntryList()->size();
+}
@@ -0,0 +1,162 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_TCPCLIENTPOOL_H
+#define MUDUO_NET_TCPCLIENTPOOL_H
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class EventLoopThreadPool;
+
+namespace detail
+{
+class PoolBackend;
+class PoolSlot;
+}
+
+///
+/// Keeps warm connections to a set of backends, spread over IO threads.
+///
+/// Each connection is a TcpClient with retry enabled, so reconnecting
+/// uses the back-off of Connector.  Callers pick a connection per request
+/// with acquire() and finish it with release(), which is how outstanding
+/// requests and backend health are tracked.
+///
+/// This is an interface class, so don't expose too much details.
+class TcpClientPool : boost::noncopyable
+{
+ public:
+  typedef boost::function<void(EventLoop*)> ThreadInitCallback;
+
+  enum Policy
+  {
+    kLeastOutstanding,    // scan all connections
+    kPowerOfTwoChoices,   // better of two random connections
+  };
+
+  TcpClientPool(EventLoop* baseLoop, const string& name);
+  ~TcpClientPool();  // force out-line dtor, for scoped_ptr members.
+
+  const string& name() const { return name_; }
+
+  /// Set the number of IO threads, see TcpServer::setThreadNum().
+  /// Must be called before @c start
+  void setThreadNum(int numThreads);
+  void setThreadInitCallback(const ThreadInitCallback& cb)
+  { threadInitCallback_ = cb; }
+
+  /// Must be called before @c start
+  void setConnectionsPerBackend(int n) { connectionsPerBackend_ = n; }
+  void setPolicy(Policy policy) { policy_ = policy; }
+
+  /// A backend is ejected for @c ejectSeconds after @c maxFailures
+  /// consecutive failures, lost connections count as failures too.
+  /// Ejected backends are only picked when no other is connected.
+  void setEjection(int maxFailures, double ejectSeconds)
+  { maxFailures_ = maxFailures; ejectSeconds_ = ejectSeconds; }
+
+  /// Must be called before @c start
+  void addBackend(const InetAddress& serverAddr);
+
+  /// Starts the IO threads and connects to all backends.
+  /// Must be called in the loop thread of @c baseLoop.
+  void start();
+
+  /// Closes all connections, no reconnecting afterwards.
+  void stop();
+
+  /// Picks a connection by the policy and counts one outstanding
+  /// request on it, returns an empty pointer if nothing is connected.
+  /// Thread safe.
+  TcpConnectionPtr acquire();
+
+  /// Finishes a request started by acquire() on @c conn,
+  /// @c ok == false counts as a failure of its backend.
+  /// Thread safe.
+  void release(const TcpConnectionPtr& conn, bool ok = true);
+
+  /// Number of connections currently usable.
+  /// Thread safe.
+  size_t numConnected() const;
+
+  /// Set connection callback.
+  /// Not thread safe.
+  void setConnectionCallback(const ConnectionCallback& cb)
+  { connectionCallback_ = cb; }
+
+  /// Set message callback.
+  /// Not thread safe.
+  void setMessageCallback(const MessageCallback& cb)
+  { messageCallback_ = cb; }
+
+  /// Set write complete callback.
+  /// Not thread safe.
+  void setWriteCompleteCallback(const WriteCompleteCallback& cb)
+  { writeCompleteCallback_ = cb; }
+
+ private:
+  struct Entry
+  {
+    TcpConnectionPtr conn;
+    detail::PoolSlot* slot;
+
+    bool operator<(const Entry& rhs) const
+    { return conn < rhs.conn; }
+  };
+  // sorted by conn, copy-on-write
+  typedef std::vector<Entry> EntryList;
+  typedef boost::shared_ptr<EntryList> EntryListPtr;
+
+  void onConnection(detail::PoolSlot* slot, const TcpConnectionPtr& conn);
+  void recordFailure(detail::PoolBackend* backend);
+  EntryListPtr getEntryList() const
+  {
+    MutexLockGuard lock(mutex_);
+    return entries_;
+  }
+
+  EventLoop* baseLoop_;
+  const string name_;
+  boost::scoped_ptr<EventLoopThreadPool> threadPool_;
+  ThreadInitCallback threadInitCallback_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+  WriteCompleteCallback writeCompleteCallback_;
+  int connectionsPerBackend_;
+  Policy policy_;
+  int maxFailures_;
+  double ejectSeconds_;
+  bool started_;
+  AtomicInt32 stopping_;
+  boost::ptr_vector<detail::PoolBackend> backends_;
+  boost::ptr_vector<detail::PoolSlot> slots_;
+  mutable MutexLock mutex_;
+  EntryListPtr entries_; // @GuardedBy mutex_
+};
+
+}
+}
+
+#endif  // MUDUO_NET_TCPCLIENTPOOL_H
@@ -18,10 +18,33 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+void readFile(int fd, off_t offset, size_t count, Buffer* buf)
+{
+  buf->ensureWritableBytes(count);
+  while (count > 0)
+  {
+    ssize_t n = ::pread(fd, buf->beginWrite(), count, offset);
+    if (n <= 0)
+    {
+      LOG_SYSERR << "TcpConnection::sendFile - pread";
+      break;
+    }
+    buf->hasWritten(n);
+    offset += n;
+    count -= n;
+  }
+}
+
+}
+
 void muduo::net::defaultConnectionCallback(const TcpConnectionPtr& conn)
 {
   LOG_TRACE << conn->localAddress().toIpPort() << " -> "
@@ -42,6 +65,7 @@ TcpConnection::TcpConnection(EventLoop* loop,
                              const InetAddress& localAddr,
                              const InetAddress& peerAddr)
   : loop_(CHECK_NOTNULL(loop)),
+    moving_(false),
     name_(nameArg),
     state_(kConnecting),
     socket_(new Socket(sockfd)), //fd的真正析构是跟随TcpConnection的。只有TcpConnection析构了才会析构Socket。
@@ -49,6 +73,14 @@ TcpConnection::TcpConnection(EventLoop* loop,
     localAddr_(localAddr),
     peerAddr_(peerAddr),
     highWaterMark_(64*1024*1024)
+{
+  setChannelCallbacks();
+  LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this
+            << " fd=" << sockfd;
+  socket_->setKeepAlive(true);
+}
+
+void TcpConnection::setChannelCallbacks()
 {
   channel_->setReadCallback(
       boost::bind(&TcpConnection::handleRead, this, _1));
@@ -59,9 +91,6 @@ TcpConnection::TcpConnection(EventLoop* loop,
       boost::bind(&TcpConnection::handleClose, this));
   channel_->setErrorCallback(
       boost::bind(&TcpConnection::handleError, this));
-  LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this
-            << " fd=" << sockfd;
-  socket_->setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection()
@@ -74,13 +103,16 @@ void TcpConnection::send(const void* data, size_t len)
 {
   if (state_ == kConnected)
   {
-    if (loop_->isInLoopThread())
+    // loop_ is switched by moveToLoop() in its own thread, so it can't
+    // change under us if we are in it
+    if (getLoop()->isInLoopThread())
     {
       sendInLoop(data, len);
     }
     else
     {
       string message(static_cast<const char*>(data), len);
+      MutexLockGuard lock(mutex_);
       loop_->runInLoop(
           boost::bind(&TcpConnection::sendInLoop,
                       this,     // FIXME
@@ -93,12 +125,13 @@ void TcpConnection::send(const StringPiece& message)
 {
   if (state_ == kConnected)
   {
-    if (loop_->isInLoopThread())
+    if (getLoop()->isInLoopThread())
     {
       sendInLoop(message);
     }
     else
     {
+      MutexLockGuard lock(mutex_);
       loop_->runInLoop(
           boost::bind(&TcpConnection::sendInLoop,
                       this,     // FIXME
@@ -113,13 +146,14 @@ void TcpConnection::send(Buffer* buf)
 {
   if (state_ == kConnected)
   {
-    if (loop_->isInLoopThread())
+    if (getLoop()->isInLoopThread())
     {
       sendInLoop(buf->peek(), buf->readableBytes());
       buf->retrieveAll();//清理的是传入的buf，TcpConnection自己维护了outputBuffer
     }
     else
     {
+      MutexLockGuard lock(mutex_);
       loop_->runInLoop(
           boost::bind(&TcpConnection::sendInLoop,
                       this,     // FIXME
@@ -129,6 +163,26 @@ void TcpConnection::send(Buffer* buf)
   }
 }
 
+void TcpConnection::sendFile(int fd, off_t offset, size_t count,
+                             const boost::shared_ptr<void>& owner)
+{
+  if (state_ == kConnected)
+  {
+    if (getLoop()->isInLoopThread())
+    {
+      sendFileInLoop(fd, offset, count, owner);
+    }
+    else
+    {
+      MutexLockGuard lock(mutex_);
+      loop_->runInLoop(
+          boost::bind(&TcpConnection::sendFileInLoop,
+                      this,     // FIXME
+                      fd, offset, count, owner));
+    }
+  }
+}
+
 void TcpConnection::sendInLoop(const StringPiece& message)
 {
   sendInLoop(message.data(), message.size());
@@ -136,9 +190,29 @@ void TcpConnection::sendInLoop(const StringPiece& message)
 
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
+  if (moving_)
+  {
+    // Nobody is writing to the socket, see moveToLoopInLoop().
+    // Sends queued in the old loop go before those queued in the new one.
+    Buffer* buf = loop_->isInLoopThread() ? &movingOutputBuffer_ : outputTail();
+    buf->append(data, len);
+    return;
+  }
   loop_->assertInLoopThread();
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  if (!outputFiles_.empty())
+  {
+    // goes after the files, handleWrite() is on it
+    appendOutput(&outputFiles_.back().trailer, static_cast<const char*>(data), len);
+    return;
+  }
   ssize_t nwrote = 0;
   size_t remaining = len;
+  bool faultError = false;
   // if no thing in output queue, try writing directly
   //如果outbuffer里没数据了，并且channel不处于可写状态，进入发送逻辑。channel iswriting证明channel正在等待fd什么时候变得可写。
   //这里可以看出，如果我们用的是poll进行发送，那么pollfd结构体的events是否为POLLOUT，只会影响事件监听，用户想要发送数据直接调用fd发送即可。
@@ -162,26 +236,21 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
       if (errno != EWOULDBLOCK)
       {
         LOG_SYSERR << "TcpConnection::sendInLoop";
+        if (errno == EPIPE || errno == ECONNRESET)
+        {
+          faultError = true;
+        }
       }
     }
   }
 
   assert(remaining <= len);
   //假如buffer里有剩余数据，则直接不发送进入此逻辑
-  if (remaining > 0)
+  if (!faultError && remaining > 0)
   {
     //比如写100kb，最后剩下20kb
     LOG_TRACE << "I am going to write more data";
-    size_t oldLen = outputBuffer_.readableBytes();
-    //剩余的字符加上outputBuffer剩余的字符超过了64*1024kb
-    if (oldLen + remaining >= highWaterMark_
-        && oldLen < highWaterMark_
-        && highWaterMarkCallback_)//如果高水位函数存在
-    {
-      //执行高水位的处理函数
-      loop_->queueInLoop(boost::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
-    }
-    outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining); //第一个参数把指针移动到没来得及写进socket的字符处，第二个参数传长度
+    appendOutput(&outputBuffer_, static_cast<const char*>(data)+nwrote, remaining); //第一个参数把指针移动到没来得及写进socket的字符处，第二个参数传长度
     if (!channel_->isWriting())
     {
       //总之，由于网络的缓慢，导致了数据没有全部在socket处发出，events加入可写进行监听，fd什么时候变得可写了，触发写事件。
@@ -190,6 +259,161 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   }
 }
 
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t count,
+                                   const boost::shared_ptr<void>& owner)
+{
+  if (moving_ && loop_->isInLoopThread())
+  {
+    // rare, copy it instead of keeping a file queue for the new loop
+    readFile(fd, offset, count, &movingOutputBuffer_);
+    return;
+  }
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up sending file";
+    return;
+  }
+  if (count == 0)
+  {
+    return;
+  }
+  outputFiles_.push_back(OutputFile());
+  OutputFile& file = outputFiles_.back();
+  file.fd = fd;
+  file.offset = offset;
+  file.count = count;
+  file.owner = owner;
+  if (moving_)
+  {
+    // attachInLoop() starts writing
+    return;
+  }
+
+  loop_->assertInLoopThread();
+  if (!channel_->isWriting())
+  {
+    // nothing else queued, try sending directly
+    if (!writeOutput())
+    {
+      return;
+    }
+    if (outputBuffer_.readableBytes() > 0 || !outputFiles_.empty())
+    {
+      channel_->enableWriting();
+    }
+    else if (writeCompleteCallback_)
+    {
+      loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
+    }
+  }
+}
+
+// where data sent now goes in the output queue
+Buffer* TcpConnection::outputTail()
+{
+  return outputFiles_.empty() ? &outputBuffer_ : &outputFiles_.back().trailer;
+}
+
+// Bytes in the output queue, the files not counted.
+size_t TcpConnection::outputBytes() const
+{
+  size_t bytes = outputBuffer_.readableBytes();
+  for (std::deque<OutputFile>::const_iterator it = outputFiles_.begin();
+      it != outputFiles_.end(); ++it)
+  {
+    bytes += it->trailer.readableBytes();
+  }
+  return bytes;
+}
+
+// Appends to buf of the output queue, calls highWaterMarkCallback_ when
+// the queue grows past highWaterMark_.
+void TcpConnection::appendOutput(Buffer* buf, const char* data, size_t len)
+{
+  size_t oldLen = outputBytes();
+  if (oldLen + len >= highWaterMark_
+      && oldLen < highWaterMark_
+      && highWaterMarkCallback_)
+  {
+    loop_->queueInLoop(boost::bind(highWaterMarkCallback_, shared_from_this(), oldLen + len));
+  }
+  buf->append(data, len);
+}
+
+// Writes outputBuffer_ and the queued files in order, until the socket is full.
+// Returns false if the peer is gone, the output is dropped then.
+bool TcpConnection::writeOutput()
+{
+  while (true)
+  {
+    if (outputBuffer_.readableBytes() > 0)
+    {
+      ssize_t n = sockets::write(channel_->fd(),
+                                 outputBuffer_.peek(),
+                                 outputBuffer_.readableBytes());
+      if (n < 0)
+      {
+        return errno == EWOULDBLOCK || !dropOutput("TcpConnection::handleWrite");
+      }
+      //outputBuffer的指针移动
+      outputBuffer_.retrieve(n);
+      if (outputBuffer_.readableBytes() > 0)
+      {
+        return true;
+      }
+    }
+    if (outputFiles_.empty())
+    {
+      return true;
+    }
+
+    OutputFile& file = outputFiles_.front();
+    while (file.count > 0)
+    {
+      ssize_t n = sockets::sendfile(channel_->fd(), file.fd, &file.offset, file.count);
+      if (n > 0)
+      {
+        file.count -= n;
+      }
+      else if (n == 0)
+      {
+        LOG_ERROR << "TcpConnection::sendFile [" << name_ << "] - file shrunk by "
+                  << file.count << " bytes";
+        file.count = 0;
+      }
+      else if (errno == EWOULDBLOCK)
+      {
+        return true;
+      }
+      else if (dropOutput("TcpConnection::sendFile"))
+      {
+        return false;
+      }
+      else
+      {
+        // reading the file failed, the rest of it is skipped
+        file.count = 0;
+      }
+    }
+    outputBuffer_.swap(file.trailer);
+    outputFiles_.pop_front();
+  }
+}
+
+// Logs errno of a failed write, drops the output queue if it's because
+// the peer is gone.  handleRead() sees the close.
+bool TcpConnection::dropOutput(const char* what)
+{
+  LOG_SYSERR << what << " [" << name_ << "]";
+  if (errno == EPIPE || errno == ECONNRESET)
+  {
+    outputBuffer_.retrieveAll();
+    outputFiles_.clear();
+    return true;
+  }
+  return false;
+}
+
 void TcpConnection::shutdown()
 {
   // FIXME: use compare and swap
@@ -197,6 +421,7 @@ void TcpConnection::shutdown()
   {
     setState(kDisconnecting);
     // FIXME: shared_from_this()?
+    MutexLockGuard lock(mutex_);
     loop_->runInLoop(boost::bind(&TcpConnection::shutdownInLoop, this));
   }
 }
@@ -205,6 +430,11 @@ void TcpConnection::shutdown()
 //可以看出主动关闭并不是真正的close fd，只是关闭了写
 void TcpConnection::shutdownInLoop()
 {
+  if (moving_)
+  {
+    // attachInLoop() shuts down once the output is flushed.
+    return;
+  }
   loop_->assertInLoopThread();
   if (!channel_->isWriting())//正在写就不关
   {
@@ -218,6 +448,75 @@ void TcpConnection::setTcpNoDelay(bool on)
   socket_->setTcpNoDelay(on);
 }
 
+void TcpConnection::moveToLoop(EventLoop* newLoop)
+{
+  // always queue, so that the channel isn't removed inside its handleEvent()
+  MutexLockGuard lock(mutex_);
+  loop_->queueInLoop(
+      boost::bind(&TcpConnection::moveToLoopInLoop, shared_from_this(), newLoop));
+}
+
+// Moving takes three steps:
+// 1. in the old loop, remove the channel and switch loop_ under mutex_,
+//    sends from other threads are queued to the new loop from now on;
+// 2. in the old loop, after the sends queued to it before the switch have
+//    been appended to outputBuffer_, hand the connection over;
+// 3. in the new loop, register a new channel and append what was sent to
+//    movingOutputBuffer_ meanwhile.
+void TcpConnection::moveToLoopInLoop(EventLoop* newLoop)
+{
+  if (moving_)
+  {
+    LOG_WARN << "TcpConnection::moveToLoop [" << name_ << "] - already moving";
+    return;
+  }
+  loop_->assertInLoopThread();
+  if (newLoop == loop_ || (state_ != kConnected && state_ != kDisconnecting))
+  {
+    return;
+  }
+  LOG_DEBUG << "TcpConnection::moveToLoop [" << name_ << "] from "
+            << loop_ << " to " << newLoop;
+  EventLoop* oldLoop = loop_;
+  channel_->disableAll();
+  channel_->remove();
+  {
+  MutexLockGuard lock(mutex_);
+  moving_ = true;
+  loop_ = newLoop;
+  }
+  oldLoop->queueInLoop(
+      boost::bind(&TcpConnection::handOverInLoop, shared_from_this(), newLoop));
+}
+
+void TcpConnection::handOverInLoop(EventLoop* newLoop)
+{
+  newLoop->runInLoop(
+      boost::bind(&TcpConnection::attachInLoop, shared_from_this()));
+}
+
+void TcpConnection::attachInLoop()
+{
+  loop_->assertInLoopThread();
+  assert(moving_);
+  moving_ = false;
+  outputTail()->append(movingOutputBuffer_.peek(), movingOutputBuffer_.readableBytes());
+  movingOutputBuffer_.retrieveAll();
+
+  channel_.reset(new Channel(loop_, socket_->fd()));
+  setChannelCallbacks();
+  channel_->tie(shared_from_this());
+  channel_->enableReading();
+  if (outputBuffer_.readableBytes() > 0 || !outputFiles_.empty())
+  {
+    channel_->enableWriting();
+  }
+  else if (state_ == kDisconnecting)
+  {
+    shutdownInLoop();
+  }
+}
+
 void TcpConnection::connectEstablished()
 {
   loop_->assertInLoopThread();
@@ -232,7 +531,13 @@ void TcpConnection::connectEstablished()
 //收到fin后的最后执行的一步
 void TcpConnection::connectDestroyed()
 {
-  loop_->assertInLoopThread();
+  EventLoop* loop = getLoop();
+  if (!loop->isInLoopThread() || moving_)
+  {
+    // queued to the loop it was moving from, or it hasn't arrived yet
+    loop->queueInLoop(boost::bind(&TcpConnection::connectDestroyed, shared_from_this()));
+    return;
+  }
   if (state_ == kConnected)
   {
     setState(kDisconnected);
@@ -270,39 +575,28 @@ void TcpConnection::handleWrite()
   loop_->assertInLoopThread();
   if (channel_->isWriting())
   {
-    ssize_t n = sockets::write(channel_->fd(),
-                               outputBuffer_.peek(),
-                               outputBuffer_.readableBytes());
-    if (n > 0)
+    if (!writeOutput())
     {
-      //outputBuffer的指针移动
-      outputBuffer_.retrieve(n);
-      if (outputBuffer_.readableBytes() == 0)
+      channel_->disableWriting();
+      return;
+    }
+    if (outputBuffer_.readableBytes() == 0 && outputFiles_.empty())
+    {
+      //如果全部顺利写完了，则不进行写事件监听。因为都写完了。
+      channel_->disableWriting();
+      if (writeCompleteCallback_)
       {
-        //如果全部顺利写完了，则不进行写事件监听。因为都写完了。
-        channel_->disableWriting();
-        if (writeCompleteCallback_)
-        {
-          loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
-        }
-        if (state_ == kDisconnecting)
-        {
-          shutdownInLoop();
-        }
+        loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
       }
-      else
+      if (state_ == kDisconnecting)
       {
-        //否则不改变继续监听写事件的事实，下一次再次变得可写的时候继续写。
-        LOG_TRACE << "I am going to write more data";
+        shutdownInLoop();
       }
     }
     else
     {
-      LOG_SYSERR << "TcpConnection::handleWrite";
-      // if (state_ == kDisconnecting)
-      // {
-      //   shutdownInLoop();
-      // }
+      //否则不改变继续监听写事件的事实，下一次再次变得可写的时候继续写。
+      LOG_TRACE << "I am going to write more data";
     }
   }
   else
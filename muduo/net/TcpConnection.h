@@ -18,12 +18,16 @@
 #include <muduo/net/Buffer.h>
 #include <muduo/net/InetAddress.h>
 
+#include <deque>
+
 #include <boost/any.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <sys/types.h>  // off_t
+
 namespace muduo
 {
 namespace net
@@ -51,7 +55,13 @@ class TcpConnection : boost::noncopyable,
                 const InetAddress& peerAddr);
   ~TcpConnection();
 
-  EventLoop* getLoop() const { return loop_; }
+  /// The loop this connection currently runs in, changes after moveToLoop().
+  /// Thread safe.
+  EventLoop* getLoop() const
+  {
+    MutexLockGuard lock(mutex_);
+    return loop_;
+  }
   const string& name() const { return name_; }
   const InetAddress& localAddress() { return localAddr_; }
   const InetAddress& peerAddress() { return peerAddr_; }
@@ -62,9 +72,24 @@ class TcpConnection : boost::noncopyable,
   void send(const StringPiece& message);
   // void send(Buffer&& message); // C++11
   void send(Buffer* message);  // this one will swap data
+  /// Sends @c count bytes of file @c fd from @c offset with sendfile(2),
+  /// in order with data sent before and after.
+  /// @c owner keeps @c fd open until it's sent.
+  /// Thread safe.
+  void sendFile(int fd, off_t offset, size_t count,
+                const boost::shared_ptr<void>& owner);
   void shutdown(); // NOT thread safe, no simultaneous calling
   void setTcpNoDelay(bool on);
 
+  /// Moves this connection to @c newLoop.
+  ///
+  /// The channel is removed from the current loop and registered with
+  /// @c newLoop, buffers and callbacks go along with the connection.
+  /// Data sent before, during and after the move is written in order.
+  /// It's ignored if the connection is already being moved.
+  /// Thread safe.
+  void moveToLoop(EventLoop* newLoop);
+
   void setContext(const boost::any& context)
   { context_ = context; }
 
@@ -107,10 +132,23 @@ class TcpConnection : boost::noncopyable,
   //void sendInLoop(string&& message);
   void sendInLoop(const StringPiece& message);
   void sendInLoop(const void* message, size_t len);
+  void sendFileInLoop(int fd, off_t offset, size_t count,
+                      const boost::shared_ptr<void>& owner);
+  bool writeOutput();
+  bool dropOutput(const char* what);
+  size_t outputBytes() const;
+  void appendOutput(Buffer* buf, const char* data, size_t len);
+  Buffer* outputTail();
   void shutdownInLoop();
+  void moveToLoopInLoop(EventLoop* newLoop);
+  void handOverInLoop(EventLoop* newLoop);
+  void attachInLoop();
+  void setChannelCallbacks();
   void setState(StateE s) { state_ = s; }
 
   EventLoop* loop_;
+  mutable MutexLock mutex_; // guards loop_, which moveToLoop() changes
+  bool moving_;
   string name_;
   StateE state_;  // FIXME: use atomic variable
   // we don't expose those classes to client.
@@ -126,6 +164,18 @@ class TcpConnection : boost::noncopyable,
   size_t highWaterMark_;
   Buffer inputBuffer_;
   Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
+  Buffer movingOutputBuffer_; // sent in new loop before it takes over
+
+  // file regions to be sent after outputBuffer_
+  struct OutputFile
+  {
+    int fd;
+    off_t offset;
+    size_t count;
+    boost::shared_ptr<void> owner;
+    Buffer trailer;  // data sent after this file
+  };
+  std::deque<OutputFile> outputFiles_;
   boost::any context_;
   // FIXME: creationTime_, lastReceiveTime_
   //        bytesReceived_, bytesSent_
@@ -80,15 +80,16 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
 {
   loop_->assertInLoopThread();
   EventLoop* ioLoop = threadPool_->getNextLoop(); //从线程池拿出一个loop来处理
+  // a unix domain path may be longer than any fixed buffer
   char buf[32];
-  snprintf(buf, sizeof buf, ":%s#%d", hostport_.c_str(), nextConnId_);
+  snprintf(buf, sizeof buf, "#%d", nextConnId_);
   ++nextConnId_;
-  string connName = name_ + buf;
+  string connName = name_ + ":" + hostport_ + buf;
 
   LOG_INFO << "TcpServer::newConnection [" << name_
            << "] - new connection [" << connName
            << "] from " << peerAddr.toIpPort();
-  InetAddress localAddr(sockets::getLocalAddr(sockfd));
+  InetAddress localAddr(InetAddress::localAddressOf(sockfd));
   // FIXME poll with zero timeout to double confirm the new connection
   // FIXME use make_shared if necessary
   TcpConnectionPtr conn(new TcpConnection(ioLoop,
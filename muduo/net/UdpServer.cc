@@ -0,0 +1,99 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/UdpServer.h>
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+#include <stdio.h>  // snprintf
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// in the loop of socket, so stop() is done on return
+void stopSocket(const UdpSocketPtr& socket, CountDownLatch* latch)
+{
+  socket->stop();
+  latch->countDown();
+}
+
+}
+
+UdpServer::UdpServer(EventLoop* loop,
+                     const InetAddress& listenAddr,
+                     const string& nameArg)
+  : loop_(CHECK_NOTNULL(loop)),
+    listenAddr_(listenAddr),
+    hostport_(listenAddr.toIpPort()),
+    name_(nameArg),
+    threadPool_(new EventLoopThreadPool(loop)),
+    reusePort_(false),
+    maxDatagramSize_(UdpSocket::kDefaultMaxDatagramSize),
+    started_(false),
+    numThreads_(0)
+{
+}
+
+UdpServer::~UdpServer()
+{
+  loop_->assertInLoopThread();
+  LOG_TRACE << "UdpServer::~UdpServer [" << name_ << "] destructing";
+
+  // before threadPool_ quits the loops, a stop() queued to them might not run
+  CountDownLatch latch(static_cast<int>(sockets_.size()));
+  for (size_t i = 0; i < sockets_.size(); ++i)
+  {
+    sockets_[i]->getLoop()->runInLoop(boost::bind(stopSocket, sockets_[i], &latch));
+  }
+  latch.wait();
+}
+
+void UdpServer::setThreadNum(int numThreads)
+{
+  assert(0 <= numThreads);
+  numThreads_ = numThreads;
+  threadPool_->setThreadNum(numThreads);
+}
+
+void UdpServer::start()
+{
+  loop_->assertInLoopThread();
+  if (started_)
+  {
+    return;
+  }
+  started_ = true;
+  threadPool_->start(threadInitCallback_);
+
+  int numSockets = reusePort_ ? std::max(numThreads_, 1) : 1;
+  for (int i = 0; i < numSockets; ++i)
+  {
+    char buf[32];
+    snprintf(buf, sizeof buf, ":%s#%d", hostport_.c_str(), i);
+    UdpSocketPtr socket(new UdpSocket(threadPool_->getNextLoop(),
+                                      listenAddr_,
+                                      name_ + buf,
+                                      reusePort_,
+                                      maxDatagramSize_));
+    LOG_INFO << "UdpServer::start [" << name_ << "] - socket "
+             << socket->name() << " on " << socket->localAddress().toIpPort();
+    socket->setDatagramCallback(datagramCallback_);
+    sockets_.push_back(socket);
+    socket->start();
+  }
+}
@@ -0,0 +1,90 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_UDPSERVER_H
+#define MUDUO_NET_UDPSERVER_H
+
+#include <muduo/base/Types.h>
+#include <muduo/net/UdpSocket.h>
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class EventLoopThreadPool;
+
+///
+/// UDP server, supports single-threaded and thread-pool models.
+///
+/// With SO_REUSEPORT every IO thread binds its own UdpSocket to the
+/// listen address, and the kernel shards datagrams among them by flow.
+/// Otherwise one UdpSocket serves in one IO thread.
+///
+/// This is an interface class, so don't expose too much details.
+class UdpServer : boost::noncopyable
+{
+ public:
+  typedef boost::function<void(EventLoop*)> ThreadInitCallback;
+
+  UdpServer(EventLoop* loop,
+            const InetAddress& listenAddr,
+            const string& nameArg);
+  ~UdpServer();  // force out-line dtor, for scoped_ptr members.
+
+  const string& hostport() const { return hostport_; }
+  const string& name() const { return name_; }
+
+  /// Set the number of threads for handling datagrams,
+  /// see TcpServer::setThreadNum().
+  /// Must be called before @c start
+  void setThreadNum(int numThreads);
+  void setThreadInitCallback(const ThreadInitCallback& cb)
+  { threadInitCallback_ = cb; }
+
+  /// One socket per IO thread, the listen port must not be 0.
+  /// Must be called before @c start
+  void setReusePort(bool on) { reusePort_ = on; }
+
+  /// Must be called before @c start
+  void setMaxDatagramSize(size_t size) { maxDatagramSize_ = size; }
+
+  /// Starts the server, must be called in loop thread.
+  void start();
+
+  /// Set datagram callback, replies go through UdpSocket::sendTo().
+  /// Not thread safe.
+  void setDatagramCallback(const DatagramCallback& cb)
+  { datagramCallback_ = cb; }
+
+ private:
+  EventLoop* loop_;  // the base loop
+  const InetAddress listenAddr_;
+  const string hostport_;
+  const string name_;
+  boost::scoped_ptr<EventLoopThreadPool> threadPool_;
+  DatagramCallback datagramCallback_;
+  ThreadInitCallback threadInitCallback_;
+  bool reusePort_;
+  size_t maxDatagramSize_;
+  bool started_;
+  int numThreads_;
+  std::vector<UdpSocketPtr> sockets_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_UDPSERVER_H
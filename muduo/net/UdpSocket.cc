@@ -0,0 +1,288 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/UdpSocket.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Channel.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/Socket.h>
+#include <muduo/net/SocketsOps.h>
+
+#include <boost/bind.hpp>
+
+#include <errno.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int UdpSocket::kBatchSize;
+const size_t UdpSocket::kDefaultMaxDatagramSize;
+const size_t UdpSocket::kMaxPendingSends;
+
+UdpSocket::UdpSocket(EventLoop* loop,
+                     const InetAddress& bindAddr,
+                     const string& nameArg,
+                     bool reusePort,
+                     size_t maxDatagramSize)
+  : loop_(CHECK_NOTNULL(loop)),
+    name_(nameArg),
+    maxDatagramSize_(maxDatagramSize),
+    socket_(new Socket(sockets::createNonblockingUdpOrDie())),
+    channel_(new Channel(loop, socket_->fd())),
+    localAddr_(bindAddr),
+    flushQueued_(false),
+    stopped_(false),
+    dropped_(0),
+    recvStorage_(kBatchSize * maxDatagramSize),
+    recvAddrs_(kBatchSize),
+    recvIovecs_(kBatchSize),
+    recvMsgs_(kBatchSize),
+    sendIovecs_(kBatchSize),
+    sendMsgs_(kBatchSize)
+{
+  if (reusePort)
+  {
+    socket_->setReusePort(true);
+  }
+  socket_->bindAddress(bindAddr);
+  localAddr_ = InetAddress(sockets::getLocalAddr(socket_->fd()));
+
+  for (int i = 0; i < kBatchSize; ++i)
+  {
+    recvIovecs_[i].iov_base = &recvStorage_[i * maxDatagramSize_];
+    recvIovecs_[i].iov_len = maxDatagramSize_;
+    struct msghdr& hdr = recvMsgs_[i].msg_hdr;
+    hdr.msg_name = &recvAddrs_[i];
+    hdr.msg_namelen = sizeof recvAddrs_[i];
+    hdr.msg_iov = &recvIovecs_[i];
+    hdr.msg_iovlen = 1;
+  }
+
+  channel_->setReadCallback(
+      boost::bind(&UdpSocket::handleRead, this, _1));
+  channel_->setWriteCallback(
+      boost::bind(&UdpSocket::handleWrite, this));
+  LOG_DEBUG << "UdpSocket::ctor[" <<  name_ << "] at " << this
+            << " fd=" << socket_->fd() << " " << localAddr_.toIpPort();
+}
+
+UdpSocket::~UdpSocket()
+{
+  LOG_DEBUG << "UdpSocket::dtor[" <<  name_ << "] at " << this
+            << " fd=" << socket_->fd();
+  assert(channel_->isNoneEvent());
+}
+
+void UdpSocket::start()
+{
+  loop_->runInLoop(boost::bind(&UdpSocket::startInLoop, shared_from_this()));
+}
+
+void UdpSocket::startInLoop()
+{
+  loop_->assertInLoopThread();
+  if (!stopped_ && channel_->isNoneEvent())
+  {
+    channel_->tie(shared_from_this());
+    channel_->enableReading();
+  }
+}
+
+void UdpSocket::stop()
+{
+  loop_->runInLoop(boost::bind(&UdpSocket::stopInLoop, shared_from_this()));
+}
+
+void UdpSocket::stopInLoop()
+{
+  loop_->assertInLoopThread();
+  stopped_ = true;
+  if (!channel_->isNoneEvent())
+  {
+    channel_->disableAll();
+    channel_->remove();
+  }
+  dropped_ += static_cast<int64_t>(pendingPackets_.size());
+  freePackets_.insert(freePackets_.end(),
+                      pendingPackets_.begin(), pendingPackets_.end());
+  pendingPackets_.clear();
+}
+
+void UdpSocket::sendTo(const InetAddress& peerAddr, const StringPiece& message)
+{
+  sendTo(peerAddr, message.data(), message.size());
+}
+
+void UdpSocket::sendTo(const InetAddress& peerAddr, const void* data, size_t len)
+{
+  if (loop_->isInLoopThread())
+  {
+    appendPacket(peerAddr.getSockAddrInet(), data, len);
+  }
+  else
+  {
+    string message(static_cast<const char*>(data), len);
+    loop_->runInLoop(
+        boost::bind(&UdpSocket::sendToInLoop, shared_from_this(), peerAddr, message));
+  }
+}
+
+void UdpSocket::sendToInLoop(const InetAddress& peerAddr, const string& message)
+{
+  appendPacket(peerAddr.getSockAddrInet(), message.data(), message.size());
+}
+
+void UdpSocket::appendPacket(const struct sockaddr_in& peer, const void* data, size_t len)
+{
+  loop_->assertInLoopThread();
+  if (len > maxDatagramSize_)
+  {
+    LOG_ERROR << "UdpSocket::sendTo [" << name_ << "] - datagram of "
+              << len << " bytes is too large";
+    ++dropped_;
+    return;
+  }
+  if (stopped_ || pendingPackets_.size() >= kMaxPendingSends)
+  {
+    ++dropped_;
+    return;
+  }
+
+  Packet* packet = NULL;
+  if (freePackets_.empty())
+  {
+    packet = new Packet;
+    packets_.push_back(packet);
+    packet->data.resize(maxDatagramSize_);
+  }
+  else
+  {
+    packet = freePackets_.back();
+    freePackets_.pop_back();
+  }
+  packet->peer = peer;
+  packet->len = len;
+  ::memcpy(&packet->data[0], data, len);
+  pendingPackets_.push_back(packet);
+
+  if (channel_->isWriting())
+  {
+    // handleWrite() sends it
+  }
+  else if (loop_->eventHandling() || loop_->callingPendingFunctors())
+  {
+    // collects datagrams sent in this loop iteration
+    if (!flushQueued_)
+    {
+      flushQueued_ = true;
+      loop_->queueInLoop(boost::bind(&UdpSocket::flushSends, shared_from_this()));
+    }
+  }
+  else
+  {
+    flushSends();
+  }
+}
+
+void UdpSocket::handleRead(Timestamp receiveTime)
+{
+  loop_->assertInLoopThread();
+  int n = sockets::recvmmsg(socket_->fd(), &recvMsgs_[0], kBatchSize);
+  if (n < 0)
+  {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+    {
+      LOG_SYSERR << "UdpSocket::handleRead [" << name_ << "]";
+    }
+    return;
+  }
+
+  UdpSocketPtr guardThis(shared_from_this());
+  for (int i = 0; i < n; ++i)
+  {
+    struct mmsghdr& msg = recvMsgs_[i];
+    if (msg.msg_hdr.msg_flags & MSG_TRUNC)
+    {
+      LOG_WARN << "UdpSocket::handleRead [" << name_ << "] - datagram truncated to "
+               << maxDatagramSize_ << " bytes";
+    }
+    if (datagramCallback_)
+    {
+      datagramCallback_(guardThis,
+                        InetAddress(recvAddrs_[i]),
+                        &recvStorage_[i * maxDatagramSize_],
+                        msg.msg_len,
+                        receiveTime);
+    }
+    msg.msg_hdr.msg_namelen = sizeof recvAddrs_[i];
+  }
+
+  // replies of this batch go out in one sendmmsg
+  if (!pendingPackets_.empty() && !channel_->isWriting())
+  {
+    flushSends();
+  }
+}
+
+void UdpSocket::handleWrite()
+{
+  loop_->assertInLoopThread();
+  if (channel_->isWriting())
+  {
+    flushSends();
+  }
+}
+
+void UdpSocket::flushSends()
+{
+  loop_->assertInLoopThread();
+  flushQueued_ = false;
+  while (!pendingPackets_.empty())
+  {
+    size_t count = std::min(pendingPackets_.size(), implicit_cast<size_t>(kBatchSize));
+    for (size_t i = 0; i < count; ++i)
+    {
+      Packet* packet = pendingPackets_[i];
+      sendIovecs_[i].iov_base = &packet->data[0];
+      sendIovecs_[i].iov_len = packet->len;
+      struct msghdr& hdr = sendMsgs_[i].msg_hdr;
+      hdr.msg_name = &packet->peer;
+      hdr.msg_namelen = sizeof packet->peer;
+      hdr.msg_iov = &sendIovecs_[i];
+      hdr.msg_iovlen = 1;
+    }
+
+    int n = sockets::sendmmsg(socket_->fd(), &sendMsgs_[0], static_cast<unsigned int>(count));
+    if (n < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        if (!channel_->isWriting() && !channel_->isNoneEvent())
+        {
+          channel_->enableWriting();
+        }
+        return;
+      }
+      // drop the first datagram, sendmmsg failed on it
+      LOG_SYSERR << "UdpSocket::flushSends [" << name_ << "]";
+      ++dropped_;
+      n = 1;
+    }
+
+    freePackets_.insert(freePackets_.end(),
+                        pendingPackets_.begin(), pendingPackets_.begin() + n);
+    pendingPackets_.erase(pendingPackets_.begin(), pendingPackets_.begin() + n);
+  }
+
+  if (channel_->isWriting())
+  {
+    channel_->disableWriting();
+  }
+}
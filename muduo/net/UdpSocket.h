@@ -0,0 +1,147 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_UDPSOCKET_H
+#define MUDUO_NET_UDPSOCKET_H
+
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/InetAddress.h>
+
+#include <deque>
+#include <vector>
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <sys/socket.h>  // mmsghdr
+#include <sys/uio.h>  // iovec
+
+namespace muduo
+{
+namespace net
+{
+
+class Channel;
+class EventLoop;
+class Socket;
+class UdpSocket;
+
+typedef boost::shared_ptr<UdpSocket> UdpSocketPtr;
+
+// the datagram is at (data, len), valid during the callback only.
+typedef boost::function<void (const UdpSocketPtr&,
+                              const InetAddress& peerAddr,
+                              const char* data,
+                              size_t len,
+                              Timestamp)> DatagramCallback;
+
+///
+/// Non-blocking UDP socket in an EventLoop, for both client and server usage.
+///
+/// Datagrams are received and sent in batches with recvmmsg(2) and
+/// sendmmsg(2).  Receive buffers are allocated once, outgoing datagrams
+/// are copied into recycled fixed-size packets, so there is no allocation
+/// per datagram in the loop thread.
+///
+/// This is an interface class, so don't expose too much details.
+class UdpSocket : boost::noncopyable,
+                  public boost::enable_shared_from_this<UdpSocket>
+{
+ public:
+  static const int kBatchSize = 64;
+  static const size_t kDefaultMaxDatagramSize = 2048;
+  static const size_t kMaxPendingSends = 8192;
+
+  /// Binds to @c bindAddr, use port 0 for a client socket.
+  /// Longer datagrams are truncated to @c maxDatagramSize on receiving
+  /// and rejected on sending.
+  UdpSocket(EventLoop* loop,
+            const InetAddress& bindAddr,
+            const string& name,
+            bool reusePort = false,
+            size_t maxDatagramSize = kDefaultMaxDatagramSize);
+  ~UdpSocket();
+
+  EventLoop* getLoop() const { return loop_; }
+  const string& name() const { return name_; }
+  const InetAddress& localAddress() const { return localAddr_; }
+
+  void setDatagramCallback(const DatagramCallback& cb)
+  { datagramCallback_ = cb; }
+
+  /// Starts receiving.
+  /// Thread safe.
+  void start();
+  /// Stops receiving and sending for good, pending datagrams are dropped,
+  /// so are ones sent later.  The socket is closed in dtor.
+  /// Thread safe.
+  void stop();
+
+  /// Queues a datagram to @c peerAddr, it's sent with other datagrams
+  /// queued in the same loop iteration.  Datagrams are dropped when more
+  /// than kMaxPendingSends are waiting for the socket to be writable.
+  /// Thread safe.
+  void sendTo(const InetAddress& peerAddr, const void* data, size_t len);
+  void sendTo(const InetAddress& peerAddr, const StringPiece& message);
+
+  /// Datagrams dropped since creation, in loop thread.
+  int64_t droppedCount() const { return dropped_; }
+
+ private:
+  struct Packet
+  {
+    struct sockaddr_in peer;
+    size_t len;
+    std::vector<char> data;  // maxDatagramSize_ bytes
+  };
+
+  void startInLoop();
+  void stopInLoop();
+  void sendToInLoop(const InetAddress& peerAddr, const string& message);
+  void appendPacket(const struct sockaddr_in& peer, const void* data, size_t len);
+  void handleRead(Timestamp receiveTime);
+  void handleWrite();
+  void flushSends();
+
+  EventLoop* loop_;
+  const string name_;
+  const size_t maxDatagramSize_;
+  boost::scoped_ptr<Socket> socket_;
+  boost::scoped_ptr<Channel> channel_;
+  InetAddress localAddr_;
+  DatagramCallback datagramCallback_;
+  bool flushQueued_;
+  bool stopped_;
+  int64_t dropped_;
+
+  // receiving, kBatchSize slots of maxDatagramSize_ bytes
+  std::vector<char> recvStorage_;
+  std::vector<struct sockaddr_in> recvAddrs_;
+  std::vector<struct iovec> recvIovecs_;
+  std::vector<struct mmsghdr> recvMsgs_;
+
+  // sending, packets are recycled through freePackets_
+  boost::ptr_vector<Packet> packets_;
+  std::vector<Packet*> freePackets_;
+  std::deque<Packet*> pendingPackets_;
+  std::vector<struct iovec> sendIovecs_;
+  std::vector<struct mmsghdr> sendMsgs_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_UDPSOCKET_H
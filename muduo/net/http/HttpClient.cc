@@ -0,0 +1,796 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpClient.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include <ctype.h>
+#include <stdio.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t HttpClient::kDefaultMaxConnectionsPerHost;
+const size_t HttpClient::kDefaultMaxBodySize;
+
+namespace
+{
+
+const size_t kMaxHeadLine = 64 * 1024;
+const size_t kMaxChunkLine = 1024;
+
+const char* methodName(HttpRequest::Method method)
+{
+  switch (method)
+  {
+    case HttpRequest::kPost:
+      return "POST";
+    case HttpRequest::kHead:
+      return "HEAD";
+    case HttpRequest::kPut:
+      return "PUT";
+    case HttpRequest::kDelete:
+      return "DELETE";
+    default:
+      return "GET";
+  }
+}
+
+void serialize(const HttpClientRequest& request, const string& host, string* output)
+{
+  const string& body = request.body();
+  output->reserve(request.path().size() + request.headers().size() + body.size() + 128);
+  *output += methodName(request.method());
+  *output += ' ';
+  *output += request.path();
+  *output += " HTTP/1.1\r\nHost: ";
+  *output += request.host().empty() ? host : request.host();
+  *output += "\r\n";
+  *output += request.headers();
+  if (!body.empty()
+      || request.method() == HttpRequest::kPost
+      || request.method() == HttpRequest::kPut)
+  {
+    char buf[64];
+    snprintf(buf, sizeof buf, "Content-Length: %zu\r\n", body.size());
+    *output += buf;
+  }
+  *output += "\r\n";
+  *output += body;
+}
+
+int hexValue(char c)
+{
+  if (isdigit(c))
+    return c - '0';
+  else if ('a' <= c && c <= 'f')
+    return c - 'a' + 10;
+  else if ('A' <= c && c <= 'F')
+    return c - 'A' + 10;
+  else
+    return -1;
+}
+
+void releaseLater(const boost::shared_ptr<void>&)
+{
+}
+
+// Parses the responses of one connection, one after another.
+class ResponseParser
+{
+ public:
+  ResponseParser()
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    state_ = kExpectStatusLine;
+    bodyEncoding_ = kNoBody;
+    chunkState_ = kChunkSize;
+    bodyRemaining_ = 0;
+    keepAlive_ = true;
+  }
+
+  bool gotAll() const
+  { return state_ == kGotAll; }
+
+  // the body ends where the connection closes
+  bool untilClose() const
+  { return state_ == kExpectBody && bodyEncoding_ == kUntilClose; }
+
+  bool keepAlive() const
+  { return keepAlive_; }
+
+  // return false if any error, which is set in response
+  bool parse(Buffer* buf,
+             bool head,
+             size_t maxBodySize,
+             const HttpClient::BodyCallback& bodyCallback,
+             HttpClientResponse* response);
+
+ private:
+  enum State { kExpectStatusLine, kExpectHeaders, kExpectBody, kGotAll };
+  enum BodyEncoding { kNoBody, kContentLength, kChunked, kUntilClose };
+  enum ChunkState { kChunkSize, kChunkData, kChunkDataEnd, kChunkTrailer };
+
+  static bool fail(HttpClientResponse* response, HttpClientResponse::Error error)
+  {
+    response->setError(error);
+    return false;
+  }
+
+  bool processStatusLine(const char* begin, const char* end, HttpClientResponse* response);
+  bool startBody(bool head, size_t maxBodySize, bool streaming, HttpClientResponse* response);
+  bool processBody(Buffer* buf,
+                   size_t maxBodySize,
+                   const HttpClient::BodyCallback& bodyCallback,
+                   HttpClientResponse* response);
+
+  State state_;
+  BodyEncoding bodyEncoding_;
+  ChunkState chunkState_;
+  size_t bodyRemaining_;  // of Content-Length, or of current chunk
+  bool keepAlive_;
+};
+
+bool ResponseParser::parse(Buffer* buf,
+                           bool head,
+                           size_t maxBodySize,
+                           const HttpClient::BodyCallback& bodyCallback,
+                           HttpClientResponse* response)
+{
+  while (state_ == kExpectStatusLine || state_ == kExpectHeaders)
+  {
+    const char* crlf = buf->findCRLF();
+    if (crlf == NULL)
+    {
+      return buf->readableBytes() <= kMaxHeadLine
+          || fail(response, HttpClientResponse::kBadResponse);
+    }
+    if (state_ == kExpectStatusLine)
+    {
+      if (!processStatusLine(buf->peek(), crlf, response))
+      {
+        return fail(response, HttpClientResponse::kBadResponse);
+      }
+      state_ = kExpectHeaders;
+    }
+    else if (crlf != buf->peek())
+    {
+      const char* colon = std::find(buf->peek(), crlf, ':');
+      if (colon == crlf)
+      {
+        return fail(response, HttpClientResponse::kBadResponse);
+      }
+      const char* value = colon + 1;
+      while (value < crlf && isspace(*value))
+        ++value;
+      const char* valueEnd = crlf;
+      while (valueEnd > value && isspace(valueEnd[-1]))
+        --valueEnd;
+      response->addHeader(string(buf->peek(), colon), string(value, valueEnd));
+    }
+    else if (response->statusCode() < 200 && response->statusCode() != 101)
+    {
+      // interim response, such as 100 Continue, the real one follows
+      *response = HttpClientResponse();
+      state_ = kExpectStatusLine;
+    }
+    else if (!startBody(head, maxBodySize, !bodyCallback.empty(), response))
+    {
+      return false;
+    }
+    buf->retrieveUntil(crlf + 2);
+  }
+
+  return state_ != kExpectBody || processBody(buf, maxBodySize, bodyCallback, response);
+}
+
+// "HTTP/1.1 200 OK"
+bool ResponseParser::processStatusLine(const char* begin, const char* end,
+                                       HttpClientResponse* response)
+{
+  if (end - begin < 12 || !std::equal(begin, begin + 7, "HTTP/1.") || begin[8] != ' ')
+  {
+    return false;
+  }
+  if (begin[7] == '1')
+    response->setVersion(HttpRequest::kHttp11);
+  else if (begin[7] == '0')
+    response->setVersion(HttpRequest::kHttp10);
+  else
+    return false;
+
+  int code = 0;
+  for (const char* p = begin + 9; p < begin + 12; ++p)
+  {
+    if (!isdigit(*p))
+    {
+      return false;
+    }
+    code = code * 10 + (*p - '0');
+  }
+  response->setStatusCode(code);
+  if (end - begin > 13)
+  {
+    response->setStatusMessage(string(begin + 13, end));
+  }
+  return true;
+}
+
+// Decides the body length from headers of a complete response head.
+bool ResponseParser::startBody(bool head, size_t maxBodySize, bool streaming,
+                               HttpClientResponse* response)
+{
+  string connection = response->getHeader("Connection");
+  if (response->version() == HttpRequest::kHttp11)
+    keepAlive_ = ::strcasecmp(connection.c_str(), "close") != 0;
+  else
+    keepAlive_ = ::strcasecmp(connection.c_str(), "keep-alive") == 0;
+
+  int code = response->statusCode();
+  string transferEncoding = response->getHeader("Transfer-Encoding");
+  string contentLength = response->getHeader("Content-Length");
+  if (head || code == 204 || code == 304)
+  {
+    state_ = kGotAll;
+  }
+  else if (!transferEncoding.empty())
+  {
+    // no other transfer coding is supported
+    if (::strcasecmp(transferEncoding.c_str(), "chunked") != 0)
+    {
+      return fail(response, HttpClientResponse::kBadResponse);
+    }
+    bodyEncoding_ = kChunked;
+    state_ = kExpectBody;
+  }
+  else if (!contentLength.empty())
+  {
+    size_t length = 0;
+    for (size_t i = 0; i < contentLength.size(); ++i)
+    {
+      if (!isdigit(contentLength[i]) || i >= 15)
+      {
+        return fail(response, HttpClientResponse::kBadResponse);
+      }
+      length = length * 10 + (contentLength[i] - '0');
+    }
+    if (!streaming && length > maxBodySize)
+    {
+      return fail(response, HttpClientResponse::kBodyTooLarge);
+    }
+    bodyEncoding_ = kContentLength;
+    bodyRemaining_ = length;
+    state_ = length > 0 ? kExpectBody : kGotAll;
+  }
+  else
+  {
+    bodyEncoding_ = kUntilClose;
+    keepAlive_ = false;
+    state_ = kExpectBody;
+  }
+  return true;
+}
+
+bool ResponseParser::processBody(Buffer* buf,
+                                 size_t maxBodySize,
+                                 const HttpClient::BodyCallback& bodyCallback,
+                                 HttpClientResponse* response)
+{
+  Buffer* body = response->body();
+  while (state_ == kExpectBody && buf->readableBytes() > 0)
+  {
+    if (bodyEncoding_ != kChunked || chunkState_ == kChunkData)
+    {
+      size_t n = buf->readableBytes();
+      if (bodyEncoding_ != kUntilClose)
+      {
+        n = std::min(n, bodyRemaining_);
+        bodyRemaining_ -= n;
+        if (bodyRemaining_ == 0)
+        {
+          if (bodyEncoding_ == kContentLength)
+            state_ = kGotAll;
+          else
+            chunkState_ = kChunkDataEnd;
+        }
+      }
+      body->append(buf->peek(), n);
+      buf->retrieve(n);
+      if (bodyCallback)
+      {
+        bodyCallback(*response, body);
+      }
+      if (body->readableBytes() > maxBodySize)
+      {
+        return fail(response, HttpClientResponse::kBodyTooLarge);
+      }
+    }
+    else if (chunkState_ == kChunkDataEnd)
+    {
+      if (buf->readableBytes() < 2)
+      {
+        break;
+      }
+      if (buf->peek()[0] != '\r' || buf->peek()[1] != '\n')
+      {
+        return fail(response, HttpClientResponse::kBadResponse);
+      }
+      buf->retrieve(2);
+      chunkState_ = kChunkSize;
+    }
+    else
+    {
+      // chunk-size line or trailer line
+      const char* crlf = buf->findCRLF();
+      if (crlf == NULL)
+      {
+        if (buf->readableBytes() > kMaxChunkLine)
+        {
+          return fail(response, HttpClientResponse::kBadResponse);
+        }
+        break;
+      }
+      if (chunkState_ == kChunkSize)
+      {
+        const char* p = buf->peek();
+        size_t size = 0;
+        const char* q = p;
+        for (; q < crlf && hexValue(*q) >= 0; ++q)
+        {
+          if (q - p >= 15)
+          {
+            return fail(response, HttpClientResponse::kBadResponse);
+          }
+          size = size * 16 + hexValue(*q);
+        }
+        // chunk extensions are ignored
+        if (q == p || (q < crlf && *q != ';' && *q != ' ' && *q != '\t'))
+        {
+          return fail(response, HttpClientResponse::kBadResponse);
+        }
+        bodyRemaining_ = size;
+        chunkState_ = size > 0 ? kChunkData : kChunkTrailer;
+      }
+      else if (crlf == buf->peek())
+      {
+        // empty line after trailers, end of body
+        state_ = kGotAll;
+      }
+      buf->retrieveUntil(crlf + 2);
+    }
+  }
+  return true;
+}
+
+}
+
+struct HttpClient::Call : boost::noncopyable
+{
+  Call(const InetAddress& addr, const HttpClientRequest& request)
+    : server(addr),
+      key(addr.toIpPort()),
+      head(request.method() == HttpRequest::kHead),
+      idempotent(request.method() != HttpRequest::kPost),
+      retried(false),
+      started(false),
+      connection(NULL)
+  {
+    serialize(request, key, &data);
+  }
+
+  const InetAddress server;
+  const string key;
+  string data;        // serialized request
+  const bool head;
+  const bool idempotent;
+  bool retried;
+  bool started;       // some response is received
+  ResponseCallback responseCallback;
+  BodyCallback bodyCallback;
+  TimerId timer;
+  Connection* connection;  // NULL while waiting
+  HttpClientResponse response;
+};
+
+struct HttpClient::Pool : boost::noncopyable
+{
+  explicit Pool(const InetAddress& addr)
+    : server(addr)
+  {
+  }
+
+  const InetAddress server;
+  std::deque<CallPtr> waiting;
+  std::vector<ConnectionPtr> connections;
+};
+
+// A keep-alive connection of a pool.
+class HttpClient::Connection : boost::noncopyable
+{
+ public:
+  Connection(HttpClient* owner, Pool* pool)
+    : owner_(owner),
+      pool_(pool),
+      loop_(owner->loop_),
+      client_(loop_, pool->server, owner->name_)
+  {
+    client_.setConnectionCallback(
+        boost::bind(&Connection::onConnection, this, _1));
+    client_.setMessageCallback(
+        boost::bind(&Connection::onMessage, this, _1, _2, _3));
+  }
+
+  void connect()
+  { client_.connect(); }
+
+  bool connected() const
+  { return conn_ && conn_->connected(); }
+
+  Pool* pool() const
+  { return pool_; }
+
+  // sent, but not answered yet
+  std::deque<CallPtr>& inflight()
+  { return inflight_; }
+
+  void send(const CallPtr& call)
+  {
+    call->connection = this;
+    inflight_.push_back(call);
+    conn_->send(call->data);
+  }
+
+  // Takes no more requests and outlives its owner, until the server
+  // closes the connection.
+  void detach(const ConnectionPtr& self)
+  {
+    assert(self.get() == this);
+    assert(inflight_.empty());
+    owner_ = NULL;
+    pool_ = NULL;
+    self_ = self;
+    conn_->shutdown();
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn_ = conn;
+      conn->setTcpNoDelay(true);
+      if (owner_)
+      {
+        owner_->dispatch(pool_);
+      }
+    }
+    else
+    {
+      conn_.reset();
+      if (owner_)
+      {
+        if (!inflight_.empty() && parser_.untilClose())
+        {
+          CallPtr call = inflight_.front();
+          inflight_.pop_front();
+          owner_->complete(call, HttpClientResponse::kOk);
+        }
+        owner_->removeConnection(this);
+      }
+      else
+      {
+        loop_->queueInLoop(boost::bind(releaseLater, self_));
+        self_.reset();
+      }
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+  {
+    while (owner_ && !inflight_.empty() && buf->readableBytes() > 0)
+    {
+      CallPtr call = inflight_.front();
+      call->started = true;
+      if (!parser_.parse(buf, call->head, owner_->maxBodySize_,
+                         call->bodyCallback, &call->response))
+      {
+        inflight_.pop_front();
+        owner_->complete(call, call->response.error());
+        owner_->removeConnection(this);
+        break;
+      }
+      if (!parser_.gotAll())
+      {
+        break;
+      }
+      inflight_.pop_front();
+      bool keepAlive = parser_.keepAlive();
+      parser_.reset();
+      owner_->complete(call, HttpClientResponse::kOk);
+      if (!keepAlive)
+      {
+        owner_->removeConnection(this);
+      }
+    }
+
+    if (owner_ == NULL)
+    {
+      buf->retrieveAll();
+    }
+    else if (buf->readableBytes() > 0 && inflight_.empty())
+    {
+      LOG_ERROR << "HttpClient - unexpected data from " << conn_->name();
+      buf->retrieveAll();
+      owner_->removeConnection(this);
+    }
+    else
+    {
+      owner_->dispatch(pool_);
+    }
+  }
+
+  HttpClient* owner_;  // NULL once detached
+  Pool* pool_;
+  EventLoop* loop_;
+  TcpClient client_;
+  TcpConnectionPtr conn_;
+  std::deque<CallPtr> inflight_;
+  ResponseParser parser_;
+  ConnectionPtr self_;  // while detached
+};
+
+HttpClient::HttpClient(EventLoop* loop, const string& name)
+  : loop_(CHECK_NOTNULL(loop)),
+    name_(name),
+    maxConnectionsPerHost_(kDefaultMaxConnectionsPerHost),
+    maxPipeline_(1),
+    timeout_(10.0),
+    maxBodySize_(kDefaultMaxBodySize)
+{
+}
+
+HttpClient::~HttpClient()
+{
+  loop_->assertInLoopThread();
+  for (std::map<string, boost::shared_ptr<Pool> >::iterator it = pools_.begin();
+       it != pools_.end();
+       ++it)
+  {
+    Pool* pool = get_pointer(it->second);
+    for (size_t i = 0; i < pool->waiting.size(); ++i)
+    {
+      loop_->cancel(pool->waiting[i]->timer);
+    }
+    for (size_t i = 0; i < pool->connections.size(); ++i)
+    {
+      const ConnectionPtr& connection = pool->connections[i];
+      std::deque<CallPtr>& inflight = connection->inflight();
+      for (size_t j = 0; j < inflight.size(); ++j)
+      {
+        loop_->cancel(inflight[j]->timer);
+      }
+      inflight.clear();
+      if (connection->connected())
+      {
+        connection->detach(connection);
+      }
+      // otherwise TcpClient stops connecting as it's destroyed
+    }
+  }
+}
+
+void HttpClient::request(const InetAddress& server,
+                         const HttpClientRequest& request,
+                         const ResponseCallback& cb,
+                         const BodyCallback& bodyCb)
+{
+  // serialized in the caller's thread
+  CallPtr call(new Call(server, request));
+  call->responseCallback = cb;
+  call->bodyCallback = bodyCb;
+  loop_->runInLoop(boost::bind(&HttpClient::requestInLoop, this, call));
+}
+
+size_t HttpClient::numConnections() const
+{
+  loop_->assertInLoopThread();
+  size_t n = 0;
+  for (std::map<string, boost::shared_ptr<Pool> >::const_iterator it = pools_.begin();
+       it != pools_.end();
+       ++it)
+  {
+    const std::vector<ConnectionPtr>& connections = it->second->connections;
+    for (size_t i = 0; i < connections.size(); ++i)
+    {
+      if (connections[i]->connected())
+      {
+        ++n;
+      }
+    }
+  }
+  return n;
+}
+
+void HttpClient::requestInLoop(const CallPtr& call)
+{
+  loop_->assertInLoopThread();
+  call->timer = loop_->runAfter(timeout_,
+      boost::bind(&HttpClient::onTimeout, this, boost::weak_ptr<Call>(call)));
+  boost::shared_ptr<Pool>& pool = pools_[call->key];
+  if (!pool)
+  {
+    pool.reset(new Pool(call->server));
+  }
+  pool->waiting.push_back(call);
+  dispatch(get_pointer(pool));
+}
+
+// Sends waiting requests on idle connections, opening new ones as
+// needed, then pipelines the rest if allowed.
+void HttpClient::dispatch(Pool* pool)
+{
+  while (!pool->waiting.empty())
+  {
+    Connection* idle = NULL;
+    Connection* leastBusy = NULL;
+    size_t connecting = 0;
+    for (size_t i = 0; i < pool->connections.size() && idle == NULL; ++i)
+    {
+      Connection* connection = get_pointer(pool->connections[i]);
+      size_t inflight = connection->inflight().size();
+      if (!connection->connected())
+        ++connecting;
+      else if (inflight == 0)
+        idle = connection;
+      else if (inflight < maxPipeline_
+               && (leastBusy == NULL || inflight < leastBusy->inflight().size()))
+        leastBusy = connection;
+    }
+
+    Connection* target = idle;
+    if (target == NULL)
+    {
+      if (pool->connections.size() < maxConnectionsPerHost_
+          && connecting < pool->waiting.size())
+      {
+        ConnectionPtr connection(new Connection(this, pool));
+        pool->connections.push_back(connection);
+        connection->connect();
+        continue;
+      }
+      if (connecting < pool->waiting.size())
+      {
+        target = leastBusy;
+      }
+    }
+    if (target == NULL)
+    {
+      break;
+    }
+    CallPtr call = pool->waiting.front();
+    pool->waiting.pop_front();
+    target->send(call);
+  }
+}
+
+void HttpClient::onTimeout(const boost::weak_ptr<Call>& wkCall)
+{
+  CallPtr call = wkCall.lock();
+  if (!call)
+  {
+    return;
+  }
+  call->timer = TimerId();
+
+  Connection* connection = call->connection;
+  if (connection == NULL)
+  {
+    std::deque<CallPtr>& waiting = pools_[call->key]->waiting;
+    std::deque<CallPtr>::iterator it = std::find(waiting.begin(), waiting.end(), call);
+    if (it != waiting.end())
+    {
+      waiting.erase(it);
+    }
+    complete(call, HttpClientResponse::kTimeout);
+  }
+  else
+  {
+    std::deque<CallPtr>& inflight = connection->inflight();
+    std::deque<CallPtr>::iterator it = std::find(inflight.begin(), inflight.end(), call);
+    bool sent = it != inflight.end();
+    if (sent)
+    {
+      inflight.erase(it);
+    }
+    complete(call, HttpClientResponse::kTimeout);
+    if (sent)
+    {
+      // later responses on it are out of step
+      removeConnection(connection);
+    }
+  }
+}
+
+void HttpClient::complete(const CallPtr& call, HttpClientResponse::Error error)
+{
+  loop_->cancel(call->timer);
+  call->timer = TimerId();
+  call->connection = NULL;
+  call->response.setError(error);
+  ResponseCallback cb;
+  cb.swap(call->responseCallback);
+  cb(call->response);
+}
+
+// Requests sent but not answered on connection are sent again if they
+// are idempotent and have not been retried, such as one that raced with
+// the server closing an idle connection.
+void HttpClient::requeueOrFail(Connection* connection, HttpClientResponse::Error error)
+{
+  std::deque<CallPtr> inflight;
+  inflight.swap(connection->inflight());
+  std::deque<CallPtr>& waiting = connection->pool()->waiting;
+  for (std::deque<CallPtr>::reverse_iterator it = inflight.rbegin();
+       it != inflight.rend();
+       ++it)
+  {
+    const CallPtr& call = *it;
+    if (call->idempotent && !call->retried && !call->started)
+    {
+      call->retried = true;
+      call->connection = NULL;
+      waiting.push_front(call);
+    }
+    else
+    {
+      complete(call, error);
+    }
+  }
+}
+
+void HttpClient::removeConnection(Connection* connection)
+{
+  Pool* pool = connection->pool();
+  std::vector<ConnectionPtr>::iterator it = pool->connections.begin();
+  while (get_pointer(*it) != connection)
+  {
+    ++it;
+  }
+  ConnectionPtr guard(*it);
+  pool->connections.erase(it);
+
+  if (!connection->inflight().empty())
+  {
+    requeueOrFail(connection, HttpClientResponse::kConnectionClosed);
+  }
+  if (connection->connected())
+  {
+    connection->detach(guard);
+  }
+  else
+  {
+    // not in its own callbacks
+    loop_->queueInLoop(boost::bind(releaseLater, guard));
+  }
+  dispatch(pool);
+}
@@ -0,0 +1,112 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPCLIENT_H
+#define MUDUO_NET_HTTP_HTTPCLIENT_H
+
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/http/HttpClientRequest.h>
+#include <muduo/net/http/HttpClientResponse.h>
+
+#include <map>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class Buffer;
+class EventLoop;
+
+///
+/// An asynchronous HTTP/1.1 client.
+///
+/// Keeps up to maxConnectionsPerHost keep-alive connections to each
+/// server, made with TcpClient and reused by later requests.  Requests
+/// wait in a queue when all of them are busy, or are pipelined when
+/// maxPipeline is more than one.  Every request has a deadline, its
+/// callback gets HttpClientResponse::kTimeout when it passes.
+///
+/// Lives in one loop, callbacks are called in that loop.
+class HttpClient : boost::noncopyable
+{
+ public:
+  /// Called once per request, response.ok() tells whether it succeeded.
+  typedef boost::function<void (const HttpClientResponse&)> ResponseCallback;
+  /// Streaming mode, called whenever body data arrive, after headers.
+  /// It may retrieve what it consumes from the body.
+  typedef boost::function<void (const HttpClientResponse&, Buffer* body)> BodyCallback;
+
+  static const size_t kDefaultMaxConnectionsPerHost = 4;
+  static const size_t kDefaultMaxBodySize = 16 * 1024 * 1024;
+
+  HttpClient(EventLoop* loop, const string& name);
+  /// Must be destroyed in the loop thread.  Outstanding requests are
+  /// dropped without their callbacks, idle connections are shut down.
+  ~HttpClient();
+
+  /// Not thread safe, call them before the first request.
+  void setMaxConnectionsPerHost(size_t n)
+  { maxConnectionsPerHost_ = n; }
+
+  /// Requests sent on a connection before its first response, 1 by default.
+  void setMaxPipeline(size_t n)
+  { maxPipeline_ = n; }
+
+  /// From the call of request() to the last byte of the response, 10s by default.
+  void setTimeout(double seconds)
+  { timeout_ = seconds; }
+
+  /// Buffered body, not counting what BodyCallback retrieves.
+  void setMaxBodySize(size_t n)
+  { maxBodySize_ = n; }
+
+  /// Thread safe.
+  void request(const InetAddress& server,
+               const HttpClientRequest& request,
+               const ResponseCallback& cb,
+               const BodyCallback& bodyCb = BodyCallback());
+
+  /// Open connections to all servers.
+  /// Not thread safe, but in loop.
+  size_t numConnections() const;
+
+ private:
+  struct Call;
+  struct Pool;
+  class Connection;
+  typedef boost::shared_ptr<Call> CallPtr;
+  typedef boost::shared_ptr<Connection> ConnectionPtr;
+
+  void requestInLoop(const CallPtr& call);
+  void dispatch(Pool* pool);
+  void onTimeout(const boost::weak_ptr<Call>& wkCall);
+  void complete(const CallPtr& call, HttpClientResponse::Error error);
+  void requeueOrFail(Connection* connection, HttpClientResponse::Error error);
+  void removeConnection(Connection* connection);
+
+  EventLoop* loop_;
+  const string name_;
+  size_t maxConnectionsPerHost_;
+  size_t maxPipeline_;
+  double timeout_;
+  size_t maxBodySize_;
+  std::map<string, boost::shared_ptr<Pool> > pools_;  // by ip:port
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPCLIENT_H
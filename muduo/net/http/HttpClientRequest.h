@@ -0,0 +1,85 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPCLIENTREQUEST_H
+#define MUDUO_NET_HTTP_HTTPCLIENTREQUEST_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/http/HttpRequest.h>
+
+namespace muduo
+{
+namespace net
+{
+
+/// A request sent by HttpClient.
+class HttpClientRequest : public muduo::copyable
+{
+ public:
+  explicit HttpClientRequest(HttpRequest::Method method = HttpRequest::kGet,
+                             const string& path = "/")
+    : method_(method),
+      path_(path)
+  {
+  }
+
+  void setMethod(HttpRequest::Method method)
+  { method_ = method; }
+
+  HttpRequest::Method method() const
+  { return method_; }
+
+  /// Path and query, "/index.html?a=b".
+  void setPath(const string& path)
+  { path_ = path; }
+
+  const string& path() const
+  { return path_; }
+
+  /// Defaults to the address of the server.
+  void setHost(const string& host)
+  { host_ = host; }
+
+  const string& host() const
+  { return host_; }
+
+  /// Host, Content-Length and Connection are added by HttpClient.
+  void addHeader(const StringPiece& field, const StringPiece& value)
+  {
+    headers_.append(field.data(), field.size());
+    headers_ += ": ";
+    headers_.append(value.data(), value.size());
+    headers_ += "\r\n";
+  }
+
+  /// Serialized, each line ends with CRLF.
+  const string& headers() const
+  { return headers_; }
+
+  void setBody(const string& body)
+  { body_ = body; }
+
+  const string& body() const
+  { return body_; }
+
+ private:
+  HttpRequest::Method method_;
+  string path_;
+  string host_;
+  string headers_;
+  string body_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPCLIENTREQUEST_H
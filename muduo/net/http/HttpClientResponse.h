@@ -0,0 +1,116 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPCLIENTRESPONSE_H
+#define MUDUO_NET_HTTP_HTTPCLIENTRESPONSE_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/http/HttpRequest.h>
+
+#include <utility>
+#include <vector>
+
+#include <strings.h>
+
+namespace muduo
+{
+namespace net
+{
+
+/// A response received by HttpClient.
+class HttpClientResponse : public muduo::copyable
+{
+ public:
+  enum Error
+  {
+    kOk,
+    kTimeout,           // no complete response in time
+    kConnectionClosed,  // closed before the response completed
+    kBadResponse,       // malformed response
+    kBodyTooLarge,      // longer than HttpClient::setMaxBodySize()
+  };
+
+  HttpClientResponse()
+    : error_(kOk),
+      version_(HttpRequest::kUnknown),
+      statusCode_(0)
+  {
+  }
+
+  /// Whether a complete response is received, whatever its status code.
+  bool ok() const
+  { return error_ == kOk; }
+
+  void setError(Error error)
+  { error_ = error; }
+
+  Error error() const
+  { return error_; }
+
+  void setVersion(HttpRequest::Version version)
+  { version_ = version; }
+
+  HttpRequest::Version version() const
+  { return version_; }
+
+  void setStatusCode(int code)
+  { statusCode_ = code; }
+
+  int statusCode() const
+  { return statusCode_; }
+
+  void setStatusMessage(const string& message)
+  { statusMessage_ = message; }
+
+  const string& statusMessage() const
+  { return statusMessage_; }
+
+  void addHeader(const string& field, const string& value)
+  { headers_.push_back(std::make_pair(field, value)); }
+
+  /// Field names are case insensitive, empty if not found.
+  string getHeader(const char* field) const
+  {
+    for (size_t i = 0; i < headers_.size(); ++i)
+    {
+      if (::strcasecmp(headers_[i].first.c_str(), field) == 0)
+      {
+        return headers_[i].second;
+      }
+    }
+    return string();
+  }
+
+  /// In the order received.
+  const std::vector<std::pair<string, string> >& headers() const
+  { return headers_; }
+
+  /// Body received so far, less what HttpClient::BodyCallback retrieved.
+  const Buffer& body() const
+  { return body_; }
+
+  Buffer* body()
+  { return &body_; }
+
+ private:
+  Error error_;
+  HttpRequest::Version version_;
+  int statusCode_;
+  string statusMessage_;
+  std::vector<std::pair<string, string> > headers_;
+  Buffer body_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPCLIENTRESPONSE_H
@@ -0,0 +1,298 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpCompressor.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <zlib.h>
+
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t HttpCompressor::kDefaultMinSize;
+const size_t HttpCompressor::kDefaultMaxCacheBytes;
+
+namespace
+{
+
+const int kCachedLevel = 9;
+
+bool startsWith(const StringPiece& str, const char* prefix)
+{
+  size_t len = strlen(prefix);
+  return static_cast<size_t>(str.size()) >= len
+      && ::strncasecmp(str.data(), prefix, len) == 0;
+}
+
+bool contains(const StringPiece& str, const char* word)
+{
+  size_t len = strlen(word);
+  for (size_t i = 0; i + len <= static_cast<size_t>(str.size()); ++i)
+  {
+    if (::strncasecmp(str.data() + i, word, len) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// images, archives and the like are compressed already
+bool compressible(const StringPiece& contentType)
+{
+  return contentType.empty()
+      || startsWith(contentType, "text/")
+      || contains(contentType, "json")
+      || contains(contentType, "javascript")
+      || contains(contentType, "xml");
+}
+
+StringPiece trim(const char* begin, const char* end)
+{
+  while (begin < end && (*begin == ' ' || *begin == '\t'))
+    ++begin;
+  while (end > begin && (end[-1] == ' ' || end[-1] == '\t'))
+    --end;
+  return StringPiece(begin, static_cast<int>(end - begin));
+}
+
+// "q=0.5" of a coding, 1 if it's absent
+double qvalue(const StringPiece& params)
+{
+  const char* p = params.data();
+  const char* end = p + params.size();
+  const char* q = NULL;
+  for (; p + 1 < end; ++p)
+  {
+    if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=')
+    {
+      q = p + 2;
+      break;
+    }
+  }
+  if (q == NULL)
+  {
+    return 1.0;
+  }
+  double value = 0;
+  double scale = 1;
+  bool fraction = false;
+  for (; q < end; ++q)
+  {
+    if (*q == '.')
+    {
+      fraction = true;
+    }
+    else if ('0' <= *q && *q <= '9')
+    {
+      if (fraction)
+      {
+        scale /= 10;
+        value += (*q - '0') * scale;
+      }
+      else
+      {
+        value = value * 10 + (*q - '0');
+      }
+    }
+    else
+    {
+      break;
+    }
+  }
+  return value;
+}
+
+// FNV-1a
+uint64_t hashBody(const string& body)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < body.size(); ++i)
+  {
+    hash ^= static_cast<unsigned char>(body[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool deflateBody(const string& body, HttpCompressor::Encoding encoding,
+                 int level, string* out)
+{
+  z_stream zs;
+  ::bzero(&zs, sizeof zs);
+  // 16 for a gzip wrapper, otherwise it's zlib, which is what HTTP calls deflate
+  int windowBits = encoding == HttpCompressor::kGzip ? 15 + 16 : 15;
+  if (::deflateInit2(&zs, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    LOG_ERROR << "deflateInit2 " << zs.msg;
+    return false;
+  }
+  out->resize(::deflateBound(&zs, static_cast<uLong>(body.size())));
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+  zs.avail_in = static_cast<uInt>(body.size());
+  zs.next_out = reinterpret_cast<Bytef*>(&*out->begin());
+  zs.avail_out = static_cast<uInt>(out->size());
+  int result = ::deflate(&zs, Z_FINISH);
+  out->resize(zs.total_out);
+  ::deflateEnd(&zs);
+  return result == Z_STREAM_END;
+}
+
+}
+
+HttpCompressor::HttpCompressor(size_t minSize, size_t maxCacheBytes)
+  : minSize_(minSize),
+    maxCacheBytes_(maxCacheBytes),
+    level_(Z_DEFAULT_COMPRESSION),
+    cacheBytes_(0)
+{
+}
+
+HttpCompressor::~HttpCompressor()
+{
+}
+
+size_t HttpCompressor::cacheBytes() const
+{
+  MutexLockGuard lock(mutex_);
+  return cacheBytes_;
+}
+
+HttpCompressor::Encoding HttpCompressor::chooseEncoding(const StringPiece& acceptEncoding)
+{
+  double gzip = -1;
+  double deflate = -1;
+  double any = -1;
+  const char* p = acceptEncoding.data();
+  const char* end = p + acceptEncoding.size();
+  while (p < end)
+  {
+    const char* comma = static_cast<const char*>(memchr(p, ',', end - p));
+    if (comma == NULL)
+    {
+      comma = end;
+    }
+    const char* semicolon = static_cast<const char*>(memchr(p, ';', comma - p));
+    StringPiece coding = trim(p, semicolon ? semicolon : comma);
+    double q = semicolon ? qvalue(StringPiece(semicolon, static_cast<int>(comma - semicolon))) : 1.0;
+    if (coding.size() == 4 && ::strncasecmp(coding.data(), "gzip", 4) == 0)
+      gzip = q;
+    else if (coding.size() == 7 && ::strncasecmp(coding.data(), "deflate", 7) == 0)
+      deflate = q;
+    else if (coding == "*")
+      any = q;
+    p = comma + 1;
+  }
+  if (gzip < 0)
+    gzip = any;
+  if (deflate < 0)
+    deflate = any;
+
+  if (gzip > 0 && gzip >= deflate)
+    return kGzip;
+  else if (deflate > 0)
+    return kDeflate;
+  else
+    return kIdentity;
+}
+
+bool HttpCompressor::compress(const StringPiece& acceptEncoding, HttpResponse* response)
+{
+  if (response->hasBodyFile()
+      || response->body().size() < minSize_
+      || !response->getHeader("Content-Encoding").empty()
+      || !compressible(response->getHeader("Content-Type")))
+  {
+    return false;
+  }
+
+  response->addHeader("Vary", "Accept-Encoding");
+  Encoding encoding = chooseEncoding(acceptEncoding);
+  if (encoding == kIdentity)
+  {
+    return false;
+  }
+
+  if (response->isStatic())
+  {
+    EntryPtr entry = getCached(response->body(), encoding);
+    if (!entry)
+    {
+      return false;
+    }
+    response->setBody(entry->compressed);
+  }
+  else
+  {
+    string compressed;
+    if (!deflateBody(response->body(), encoding, level_, &compressed)
+        || compressed.size() >= response->body().size())
+    {
+      return false;
+    }
+    response->swapBody(&compressed);
+  }
+  response->addHeader("Content-Encoding", encoding == kGzip ? "gzip" : "deflate");
+  return true;
+}
+
+// Returns NULL if body doesn't shrink.
+HttpCompressor::EntryPtr HttpCompressor::getCached(const string& body, Encoding encoding)
+{
+  Key key(hashBody(body), encoding);
+  {
+  MutexLockGuard lock(mutex_);
+  std::map<Key, EntryList::iterator>::iterator it = entries_.find(key);
+  if (it != entries_.end() && it->second->second->body == body)
+  {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+  }
+
+  // compress without holding the lock
+  boost::shared_ptr<Entry> entry(new Entry);
+  entry->body = body;
+  if (!deflateBody(body, encoding, kCachedLevel, &entry->compressed)
+      || entry->compressed.size() >= body.size())
+  {
+    return EntryPtr();
+  }
+  size_t bytes = entry->body.size() + entry->compressed.size();
+  if (bytes > maxCacheBytes_)
+  {
+    return entry;
+  }
+
+  MutexLockGuard lock(mutex_);
+  std::map<Key, EntryList::iterator>::iterator it = entries_.find(key);
+  if (it != entries_.end())
+  {
+    // a collision, or another thread compressed it meanwhile
+    cacheBytes_ -= it->second->second->body.size() + it->second->second->compressed.size();
+    lru_.erase(it->second);
+    entries_.erase(it);
+  }
+  lru_.push_front(std::make_pair(key, EntryPtr(entry)));
+  entries_[key] = lru_.begin();
+  cacheBytes_ += bytes;
+  while (cacheBytes_ > maxCacheBytes_)
+  {
+    const EntryPtr& last = lru_.back().second;
+    cacheBytes_ -= last->body.size() + last->compressed.size();
+    entries_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  return entry;
+}
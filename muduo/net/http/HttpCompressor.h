@@ -0,0 +1,94 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPCOMPRESSOR_H
+#define MUDUO_NET_HTTP_HTTPCOMPRESSOR_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+
+#include <list>
+#include <map>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <stdint.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpResponse;
+
+///
+/// Compresses response bodies with gzip or deflate, as Accept-Encoding
+/// of the request allows.
+///
+/// Bodies shorter than minSize, file bodies and bodies of types that are
+/// compressed already are sent as they are.  Compressed bodies of static
+/// responses, see HttpResponse::setStatic(), are cached in LRU order.
+///
+/// Thread safe.
+class HttpCompressor : boost::noncopyable
+{
+ public:
+  enum Encoding
+  {
+    kIdentity, kGzip, kDeflate,
+  };
+
+  static const size_t kDefaultMinSize = 1024;
+  static const size_t kDefaultMaxCacheBytes = 16*1024*1024;
+
+  explicit HttpCompressor(size_t minSize = kDefaultMinSize,
+                          size_t maxCacheBytes = kDefaultMaxCacheBytes);
+  ~HttpCompressor();
+
+  /// zlib level of bodies not cached, default 6.  Cached ones use 9.
+  /// Not thread safe, call it before use.
+  void setLevel(int level)
+  { level_ = level; }
+
+  /// The preferred encoding acceptable by @c acceptEncoding.
+  static Encoding chooseEncoding(const StringPiece& acceptEncoding);
+
+  /// Compresses the body of @c response, returns false if it's unchanged.
+  bool compress(const StringPiece& acceptEncoding, HttpResponse* response);
+
+  size_t cacheBytes() const;
+
+ private:
+  struct Entry
+  {
+    string body;
+    string compressed;
+  };
+  typedef boost::shared_ptr<const Entry> EntryPtr;
+  typedef std::pair<uint64_t, Encoding> Key;
+  typedef std::list<std::pair<Key, EntryPtr> > EntryList;
+
+  EntryPtr getCached(const string& body, Encoding encoding);
+
+  const size_t minSize_;
+  const size_t maxCacheBytes_;
+  int level_;
+  mutable MutexLock mutex_;
+  EntryList lru_;  // most recently used first
+  std::map<Key, EntryList::iterator> entries_;
+  size_t cacheBytes_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPCOMPRESSOR_H
@@ -0,0 +1,419 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/Buffer.h>
+#include <muduo/net/http/HttpContext.h>
+
+#include <algorithm>
+
+#include <ctype.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t HttpContext::kMaxRequestHeadSize;
+const size_t HttpContext::kDefaultMaxBodySize;
+
+namespace
+{
+const char kCRLF[] = "\r\n";
+const char kCRLFCRLF[] = "\r\n\r\n";
+const ptrdiff_t kMaxChunkLine = 1024;
+
+// works for both HttpRequest and HttpRequestView
+template<typename REQUEST>
+bool processRequestLine(const char* begin, const char* end, REQUEST* request)
+{
+  bool succeed = false;
+  const char* start = begin;
+  const char* space = std::find(start, end, ' ');
+  if (space != end && request->setMethod(start, space))
+  {
+    start = space+1;
+    space = std::find(start, end, ' ');
+    if (space != end)
+    {
+      request->setPath(start, space);
+      start = space+1;
+      succeed = end-start == 8 && std::equal(start, end-1, "HTTP/1.");
+      if (succeed)
+      {
+        if (*(end-1) == '1')
+        {
+          request->setVersion(HttpRequest::kHttp11);
+        }
+        else if (*(end-1) == '0')
+        {
+          request->setVersion(HttpRequest::kHttp10);
+        }
+        else
+        {
+          succeed = false;
+        }
+      }
+    }
+  }
+  return succeed;
+}
+
+StringPiece headerOf(const HttpRequest& request, const char* field)
+{
+  const std::map<string, string>& headers = request.headers();
+  for (std::map<string, string>::const_iterator it = headers.begin();
+       it != headers.end();
+       ++it)
+  {
+    if (::strcasecmp(it->first.c_str(), field) == 0)
+    {
+      return it->second;
+    }
+  }
+  return StringPiece();
+}
+
+StringPiece headerOf(const HttpRequestView& request, const char* field)
+{
+  return request.getHeader(field);
+}
+
+bool equalsIgnoreCase(const StringPiece& str, const char* lower)
+{
+  return str.size() == static_cast<int>(strlen(lower))
+      && ::strncasecmp(str.data(), lower, str.size()) == 0;
+}
+
+int hexValue(char c)
+{
+  if (isdigit(c))
+    return c - '0';
+  else if ('a' <= c && c <= 'f')
+    return c - 'a' + 10;
+  else if ('A' <= c && c <= 'F')
+    return c - 'A' + 10;
+  else
+    return -1;
+}
+
+}
+
+// return false if any error
+bool HttpContext::parseRequest(Buffer* buf, Timestamp receiveTime,
+                               const BodyCallback* bodyCallback)
+{
+  bool ok = true;
+  bool hasMore = true;
+  bodyCallback_ = bodyCallback;
+  while (hasMore)
+  {
+    if (expectRequestLine())
+    {
+      const char* crlf = buf->findCRLF();
+      if (crlf)
+      {
+        ok = processRequestLine(buf->peek(), crlf, &request_);
+        if (ok)
+        {
+          request_.setReceiveTime(receiveTime);
+          buf->retrieveUntil(crlf + 2);
+          receiveRequestLine();
+        }
+        else
+        {
+          hasMore = false;
+        }
+      }
+      else
+      {
+        hasMore = false;
+      }
+    }
+    else if (expectHeaders())
+    {
+      const char* crlf = buf->findCRLF();
+      if (crlf)
+      {
+        const char* colon = std::find(buf->peek(), crlf, ':');
+        if (colon != crlf)
+        {
+          request_.addHeader(buf->peek(), colon, crlf);
+        }
+        else
+        {
+          // empty line, end of header
+          ok = startBody(request_);
+          hasMore = ok && !gotAll();
+        }
+        buf->retrieveUntil(crlf + 2);
+      }
+      else
+      {
+        hasMore = false;
+      }
+    }
+    else if (expectBody())
+    {
+      const char* next = processBody(buf->peek(), buf->beginWrite(), false);
+      if (next)
+      {
+        buf->retrieveUntil(next);
+      }
+      else
+      {
+        ok = false;
+      }
+      hasMore = false;
+    }
+    else
+    {
+      hasMore = false;
+    }
+  }
+  bodyCallback_ = NULL;
+  return ok;
+}
+
+bool HttpContext::parseRequestView(const Buffer* buf, Timestamp receiveTime)
+{
+  const char* begin = buf->peek();
+  const char* end = buf->beginWrite();
+  bool headParsed = false;
+  if (expectRequestLine())
+  {
+    // don't search again what has been searched, but "\r\n\r\n" may straddle
+    const char* start = begin + (scanned_ > 3 ? scanned_ - 3 : 0);
+    const char* headEnd = std::search(start, end, kCRLFCRLF, kCRLFCRLF+4);
+    if (headEnd == end)
+    {
+      scanned_ = buf->readableBytes();
+      return scanned_ <= kMaxRequestHeadSize;
+    }
+
+    headLength_ = headEnd + 4 - begin;
+    requestLength_ = headLength_;
+    if (!parseHeadView(begin, begin + headLength_))
+    {
+      return false;
+    }
+    view_.setReceiveTime(receiveTime);
+    headParsed = true;
+    if (!startBody(view_) || gotAll())
+    {
+      return gotAll();
+    }
+  }
+
+  assert(expectBody());
+  const char* next = processBody(begin + requestLength_, end, true);
+  if (next == NULL)
+  {
+    return false;
+  }
+  requestLength_ = next - begin;
+  if (gotAll())
+  {
+    if (!headParsed)
+    {
+      // buf may have moved since the head was parsed, parse it again
+      Timestamp firstReceiveTime = view_.receiveTime();
+      view_ = HttpRequestView();
+      parseHeadView(begin, begin + headLength_);
+      view_.setReceiveTime(firstReceiveTime);
+    }
+    if (bodyEncoding_ == kChunked)
+    {
+      view_.setBody(viewBody_);
+    }
+    else
+    {
+      view_.setBody(StringPiece(begin + headLength_,
+                                static_cast<int>(requestLength_ - headLength_)));
+    }
+  }
+  return true;
+}
+
+// [begin, headEnd) is the head, including the ending empty line
+bool HttpContext::parseHeadView(const char* begin, const char* headEnd)
+{
+  // every line of head ends with CRLF, including the last one
+  const char* linesEnd = headEnd - 2;
+  const char* crlf = std::search(begin, linesEnd, kCRLF, kCRLF+2);
+  if (!processRequestLine(begin, crlf, &view_))
+  {
+    return false;
+  }
+  for (const char* line = crlf + 2; line != linesEnd; line = crlf + 2)
+  {
+    crlf = std::search(line, linesEnd, kCRLF, kCRLF+2);
+    const char* colon = std::find(line, crlf, ':');
+    if (colon == crlf || !view_.addHeader(line, colon, crlf))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Decides the body length from headers of a complete request head.
+template<typename REQUEST>
+bool HttpContext::startBody(const REQUEST& request)
+{
+  StringPiece transferEncoding = headerOf(request, "Transfer-Encoding");
+  StringPiece contentLength = headerOf(request, "Content-Length");
+  if (!transferEncoding.empty())
+  {
+    // no other transfer coding is supported
+    if (!equalsIgnoreCase(transferEncoding, "chunked"))
+    {
+      return false;
+    }
+    bodyEncoding_ = kChunked;
+  }
+  else if (!contentLength.empty())
+  {
+    size_t length = 0;
+    for (int i = 0; i < contentLength.size(); ++i)
+    {
+      if (!isdigit(contentLength[i]) || i >= 15)
+      {
+        return false;
+      }
+      length = length * 10 + (contentLength[i] - '0');
+    }
+    if (length == 0)
+    {
+      state_ = kGotAll;
+      return true;
+    }
+    if (bodyCallback_ == NULL && length > maxBodySize_)
+    {
+      bodyTooLarge_ = true;
+      return false;
+    }
+    bodyEncoding_ = kContentLength;
+    bodyRemaining_ = length;
+  }
+  else
+  {
+    state_ = kGotAll;
+    return true;
+  }
+
+  needContinue_ = equalsIgnoreCase(headerOf(request, "Expect"), "100-continue");
+  state_ = kExpectBody;
+  return true;
+}
+
+// Returns where it stops in [begin, end), NULL if any error.
+const char* HttpContext::processBody(const char* begin, const char* end, bool inPlace)
+{
+  const char* p = begin;
+  while (expectBody() && p < end)
+  {
+    if (bodyEncoding_ == kContentLength || chunkState_ == kChunkData)
+    {
+      size_t n = std::min(bodyRemaining_, implicit_cast<size_t>(end - p));
+      if (!appendBody(p, n, inPlace))
+      {
+        return NULL;
+      }
+      p += n;
+      bodyRemaining_ -= n;
+      if (bodyRemaining_ == 0)
+      {
+        if (bodyEncoding_ == kContentLength)
+          state_ = kGotAll;
+        else
+          chunkState_ = kChunkDataEnd;
+      }
+    }
+    else if (chunkState_ == kChunkDataEnd)
+    {
+      if (end - p < 2)
+      {
+        break;
+      }
+      if (p[0] != '\r' || p[1] != '\n')
+      {
+        return NULL;
+      }
+      p += 2;
+      chunkState_ = kChunkSize;
+    }
+    else
+    {
+      // chunk-size line or trailer line
+      const char* crlf = std::search(p, end, kCRLF, kCRLF+2);
+      if (crlf == end)
+      {
+        if (end - p > kMaxChunkLine)
+        {
+          return NULL;
+        }
+        break;
+      }
+      if (chunkState_ == kChunkSize)
+      {
+        size_t size = 0;
+        const char* q = p;
+        for (; q < crlf && hexValue(*q) >= 0; ++q)
+        {
+          if (q - p >= 15)
+          {
+            return NULL;
+          }
+          size = size * 16 + hexValue(*q);
+        }
+        // chunk extensions are ignored
+        if (q == p || (q < crlf && *q != ';' && *q != ' ' && *q != '\t'))
+        {
+          return NULL;
+        }
+        bodyRemaining_ = size;
+        chunkState_ = size > 0 ? kChunkData : kChunkTrailer;
+      }
+      else if (crlf == p)
+      {
+        // empty line after trailers, end of body
+        state_ = kGotAll;
+      }
+      p = crlf + 2;
+    }
+  }
+  return p;
+}
+
+bool HttpContext::appendBody(const char* data, size_t len, bool inPlace)
+{
+  bodySize_ += len;
+  if (bodyCallback_)
+  {
+    if (len > 0)
+    {
+      (*bodyCallback_)(&request_, StringPiece(data, static_cast<int>(len)));
+    }
+    return true;
+  }
+  if (bodySize_ > maxBodySize_)
+  {
+    bodyTooLarge_ = true;
+    return false;
+  }
+  if (!inPlace)
+  {
+    request_.appendBody(data, len);
+  }
+  else if (bodyEncoding_ == kChunked)
+  {
+    viewBody_.append(data, len);
+  }
+  // else it stays in the input Buffer
+  return true;
+}
@@ -12,14 +12,23 @@
 #define MUDUO_NET_HTTP_HTTPCONTEXT_H
 
 #include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/net/Buffer.h>
 
 #include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpRequestView.h>
+#include <muduo/net/http/HttpResponder.h>
+
+#include <deque>
+
+#include <boost/function.hpp>
 
 namespace muduo
 {
 namespace net
 {
 
+
 class HttpContext : public muduo::copyable
 {
  public:
@@ -31,9 +40,23 @@ class HttpContext : public muduo::copyable
     kGotAll,
   };
 
-  HttpContext()
-    : state_(kExpectRequestLine)
+  // streaming mode, body pieces go here instead of HttpRequest::body()
+  typedef boost::function<void (HttpRequest*, const StringPiece&)> BodyCallback;
+
+  // requests with a longer head are rejected in zero-copy mode
+  static const size_t kMaxRequestHeadSize = 64 * 1024;
+  static const size_t kDefaultMaxBodySize = 1024 * 1024;
+
+  explicit HttpContext(size_t maxBodySize = kDefaultMaxBodySize)
+    : state_(kExpectRequestLine),
+      maxBodySize_(maxBodySize),
+      bodyCallback_(NULL),
+      scanned_(0),
+      headLength_(0),
+      requestLength_(0),
+      closing_(false)
   {
+    resetBody();
   }
 
   // default copy-ctor, dtor and assignment are fine
@@ -53,14 +76,46 @@ class HttpContext : public muduo::copyable
   void receiveRequestLine()
   { state_ = kExpectHeaders; }
 
-  void receiveHeaders()
-  { state_ = kGotAll; }  // FIXME
+  // return false if any error
+  // Body is buffered in request().body() up to maxBodySize, or passed
+  // to bodyCallback piece by piece if it's not NULL.
+  bool parseRequest(Buffer* buf, Timestamp receiveTime,
+                    const BodyCallback* bodyCallback = NULL);
+
+  // Zero-copy mode, parses a complete request in place and leaves
+  // buf untouched.  After gotAll(), use requestView() then retrieve
+  // requestLength() bytes from buf.
+  // return false if any error
+  bool parseRequestView(const Buffer* buf, Timestamp receiveTime);
+
+  // error is due to a body longer than maxBodySize
+  bool bodyTooLarge() const
+  { return bodyTooLarge_; }
+
+  // client sent "Expect: 100-continue" and waits for an interim response
+  bool needContinue() const
+  { return needContinue_; }
+
+  void clearNeedContinue()
+  { needContinue_ = false; }
 
   void reset()
   {
     state_ = kExpectRequestLine;
     HttpRequest dummy;
     request_.swap(dummy);
+    resetBody();
+  }
+
+  void resetView()
+  {
+    state_ = kExpectRequestLine;
+    view_ = HttpRequestView();
+    scanned_ = 0;
+    headLength_ = 0;
+    requestLength_ = 0;
+    viewBody_.clear();
+    resetBody();
   }
 
   const HttpRequest& request() const
@@ -69,9 +124,70 @@ class HttpContext : public muduo::copyable
   HttpRequest& request()
   { return request_; }
 
+  const HttpRequestView& requestView() const
+  { return view_; }
+
+  size_t requestLength() const
+  { return requestLength_; }
+
+  // async mode, in request order
+  std::deque<HttpResponderPtr>& pendingResponses()
+  { return pendingResponses_; }
+
+  // no more requests are read from the connection
+  void setClosing()
+  { closing_ = true; }
+
+  bool closing() const
+  { return closing_; }
+
+  // responses are serialized here, its memory is reused
+  Buffer& outputBuffer()
+  { return output_; }
+
  private:
+  enum BodyEncoding { kNoBody, kContentLength, kChunked };
+  enum ChunkState { kChunkSize, kChunkData, kChunkDataEnd, kChunkTrailer };
+
+  void resetBody()
+  {
+    bodyEncoding_ = kNoBody;
+    chunkState_ = kChunkSize;
+    bodyRemaining_ = 0;
+    bodySize_ = 0;
+    bodyTooLarge_ = false;
+    needContinue_ = false;
+  }
+
+  template<typename REQUEST>
+  bool startBody(const REQUEST& request);
+  const char* processBody(const char* begin, const char* end, bool inPlace);
+  bool appendBody(const char* data, size_t len, bool inPlace);
+  bool parseHeadView(const char* begin, const char* headEnd);
+
   HttpRequestParseState state_;
   HttpRequest request_;
+  size_t maxBodySize_;
+  const BodyCallback* bodyCallback_;  // during parseRequest() only
+
+  // body
+  BodyEncoding bodyEncoding_;
+  ChunkState chunkState_;
+  size_t bodyRemaining_;  // of Content-Length, or of current chunk
+  size_t bodySize_;
+  bool bodyTooLarge_;
+  bool needContinue_;
+
+  // zero-copy mode
+  HttpRequestView view_;
+  size_t scanned_;  // bytes searched for the end of head
+  size_t headLength_;
+  size_t requestLength_;  // head and body parsed so far
+  string viewBody_;  // decoded chunked body
+
+  std::deque<HttpResponderPtr> pendingResponses_;
+  bool closing_;
+  Buffer output_;
 };
 
 }
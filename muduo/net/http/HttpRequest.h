@@ -19,6 +19,8 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <boost/any.hpp>
+
 namespace muduo
 {
 namespace net
@@ -154,12 +156,32 @@ class HttpRequest : public muduo::copyable
   const std::map<string, string>& headers() const
   { return headers_; }
 
+  void appendBody(const char* data, size_t len)
+  { body_.append(data, len); }
+
+  /// Empty if the body is streamed to HttpServer::HttpBodyCallback.
+  const string& body() const
+  { return body_; }
+
+  /// Per-request state of HttpServer::HttpBodyCallback.
+  void setContext(const boost::any& context)
+  { context_ = context; }
+
+  const boost::any& getContext() const
+  { return context_; }
+
+  boost::any* getMutableContext()
+  { return &context_; }
+
   void swap(HttpRequest& that)
   {
     std::swap(method_, that.method_);
+    std::swap(version_, that.version_);
     path_.swap(that.path_);
     receiveTime_.swap(that.receiveTime_);
     headers_.swap(that.headers_);
+    body_.swap(that.body_);
+    context_.swap(that.context_);
   }
 
  private:
@@ -168,6 +190,8 @@ class HttpRequest : public muduo::copyable
   string path_;
   Timestamp receiveTime_;
   std::map<string, string> headers_;
+  string body_;
+  boost::any context_;
 };
 
 }
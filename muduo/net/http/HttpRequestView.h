@@ -0,0 +1,185 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPREQUESTVIEW_H
+#define MUDUO_NET_HTTP_HTTPREQUESTVIEW_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/http/HttpRequest.h>
+
+#include <algorithm>
+
+#include <ctype.h>
+#include <strings.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// HTTP request parsed in place, every field points into the input Buffer.
+///
+/// Nothing is allocated while parsing, headers are kept in an inline array.
+/// A view is valid until the request is retrieved from the Buffer,
+/// that is, during the HttpServer callback only.
+class HttpRequestView : public muduo::copyable
+{
+ public:
+  struct Header
+  {
+    StringPiece field;
+    StringPiece value;
+  };
+
+  static const int kMaxHeaders = 32;
+
+  HttpRequestView()
+    : method_(HttpRequest::kInvalid),
+      version_(HttpRequest::kUnknown),
+      numHeaders_(0)
+  {
+  }
+
+  bool setMethod(const char* start, const char* end)
+  {
+    assert(method_ == HttpRequest::kInvalid);
+    StringPiece m(start, static_cast<int>(end - start));
+    if (m == "GET")
+    {
+      method_ = HttpRequest::kGet;
+    }
+    else if (m == "POST")
+    {
+      method_ = HttpRequest::kPost;
+    }
+    else if (m == "HEAD")
+    {
+      method_ = HttpRequest::kHead;
+    }
+    else if (m == "PUT")
+    {
+      method_ = HttpRequest::kPut;
+    }
+    else if (m == "DELETE")
+    {
+      method_ = HttpRequest::kDelete;
+    }
+    methodString_ = m;
+    return method_ != HttpRequest::kInvalid;
+  }
+
+  HttpRequest::Method method() const
+  { return method_; }
+
+  StringPiece methodString() const
+  { return methodString_; }
+
+  void setVersion(HttpRequest::Version v)
+  { version_ = v; }
+
+  HttpRequest::Version getVersion() const
+  { return version_; }
+
+  /// Splits the request target at '?'.
+  void setPath(const char* start, const char* end)
+  {
+    const char* question = std::find(start, end, '?');
+    path_.set(start, static_cast<int>(question - start));
+    if (question != end)
+    {
+      query_.set(question + 1, static_cast<int>(end - question - 1));
+    }
+  }
+
+  StringPiece path() const
+  { return path_; }
+
+  /// Without the leading '?', empty if there's none.
+  StringPiece query() const
+  { return query_; }
+
+  void setReceiveTime(Timestamp t)
+  { receiveTime_ = t; }
+
+  Timestamp receiveTime() const
+  { return receiveTime_; }
+
+  /// Returns false if there are more than kMaxHeaders headers.
+  bool addHeader(const char* start, const char* colon, const char* end)
+  {
+    if (numHeaders_ >= kMaxHeaders)
+    {
+      return false;
+    }
+    Header& header = headers_[numHeaders_++];
+    header.field.set(start, static_cast<int>(colon - start));
+    ++colon;
+    while (colon < end && isspace(*colon))
+    {
+      ++colon;
+    }
+    while (end > colon && isspace(*(end-1)))
+    {
+      --end;
+    }
+    header.value.set(colon, static_cast<int>(end - colon));
+    return true;
+  }
+
+  /// Case-insensitive, returns an empty piece if @c field is absent.
+  StringPiece getHeader(const StringPiece& field) const
+  {
+    for (int i = 0; i < numHeaders_; ++i)
+    {
+      const StringPiece& f = headers_[i].field;
+      if (f.size() == field.size()
+          && ::strncasecmp(f.data(), field.data(), f.size()) == 0)
+      {
+        return headers_[i].value;
+      }
+    }
+    return StringPiece();
+  }
+
+  int numHeaders() const
+  { return numHeaders_; }
+
+  void setBody(const StringPiece& body)
+  { body_ = body; }
+
+  /// Into the input Buffer, or into the decoded chunked body.
+  StringPiece body() const
+  { return body_; }
+
+  const Header& header(int i) const
+  {
+    assert(0 <= i && i < numHeaders_);
+    return headers_[i];
+  }
+
+ private:
+  HttpRequest::Method method_;
+  HttpRequest::Version version_;
+  StringPiece methodString_;
+  StringPiece path_;
+  StringPiece query_;
+  StringPiece body_;
+  Timestamp receiveTime_;
+  int numHeaders_;
+  Header headers_[kMaxHeaders];
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPREQUESTVIEW_H
@@ -0,0 +1,27 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpResponder.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void HttpResponder::done()
+{
+  if (done_.getAndSet(1) != 0)
+  {
+    LOG_ERROR << "HttpResponder::done() called twice for " << request_.path();
+    return;
+  }
+  // queued even in loop thread, so responses of one batch go out together
+  loop_->queueInLoop(doneCallback_);
+}
@@ -0,0 +1,80 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPRESPONDER_H
+#define MUDUO_NET_HTTP_HTTPRESPONDER_H
+
+#include <muduo/base/Atomic.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+
+///
+/// Handle of a request being served asynchronously.
+///
+/// The handler fills response() in any thread and calls done() once,
+/// then the response is written in the IO thread, after the responses
+/// to earlier requests on the same connection.
+///
+class HttpResponder : boost::noncopyable
+{
+ public:
+  typedef boost::function<void()> DoneCallback;
+
+  /// User should not create this object.
+  HttpResponder(EventLoop* loop, bool close, const DoneCallback& cb)
+    : response_(close),
+      loop_(loop),
+      doneCallback_(cb)
+  {
+  }
+
+  /// Valid as long as this responder.
+  const HttpRequest& request() const
+  { return request_; }
+
+  HttpRequest& request()
+  { return request_; }
+
+  /// Not thread safe, only one thread may fill it.
+  HttpResponse* response()
+  { return &response_; }
+
+  /// Sends the response.  Call it exactly once.
+  /// Thread safe.
+  void done();
+
+  bool isDone()
+  { return done_.get() != 0; }
+
+ private:
+  HttpRequest request_;
+  HttpResponse response_;
+  EventLoop* loop_;
+  DoneCallback doneCallback_;
+  AtomicInt32 done_;
+};
+
+typedef boost::shared_ptr<HttpResponder> HttpResponderPtr;
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPRESPONDER_H
@@ -10,16 +10,122 @@
 #include <muduo/net/http/HttpResponse.h>
 #include <muduo/net/Buffer.h>
 
-#include <stdio.h>
+#include <algorithm>
+
+#include <string.h>
+#include <strings.h>
+#include <time.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+// one per IO thread, that is, per loop
+__thread time_t t_lastSecond;
+__thread char t_date[64];
+__thread int t_dateLength;
+
+StringPiece dateHeader()
+{
+  time_t now = ::time(NULL);
+  if (now != t_lastSecond)
+  {
+    t_lastSecond = now;
+    struct tm tm;
+    ::gmtime_r(&now, &tm);
+    t_dateLength = static_cast<int>(::strftime(t_date, sizeof t_date,
+        "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm));
+  }
+  return StringPiece(t_date, t_dateLength);
+}
+
+const char* endOfLine(const char* line, const char* end)
+{
+  const char* crlf = static_cast<const char*>(memchr(line, '\r', end - line));
+  return crlf == NULL ? end : crlf;
+}
+
+// the line of field, NULL if it's absent
+const char* findLine(const StringPiece& lines, const StringPiece& field)
+{
+  const char* line = lines.data();
+  const char* end = lines.data() + lines.size();
+  while (line < end)
+  {
+    const char* crlf = endOfLine(line, end);
+    if (crlf - line > field.size() && line[field.size()] == ':'
+        && ::strncasecmp(line, field.data(), field.size()) == 0)
+    {
+      return line;
+    }
+    line = crlf + 2;
+  }
+  return NULL;
+}
+
+StringPiece findHeader(const StringPiece& lines, const StringPiece& field)
+{
+  const char* line = findLine(lines, field);
+  if (line == NULL)
+  {
+    return StringPiece();
+  }
+  const char* crlf = endOfLine(line, lines.data() + lines.size());
+  const char* value = line + field.size() + 1;
+  while (value < crlf && *value == ' ')
+  {
+    ++value;
+  }
+  return StringPiece(value, static_cast<int>(crlf - value));
+}
+
+// returns the length, without the terminating null
+size_t formatSize(char buf[], size_t value)
+{
+  char* p = buf;
+  do
+  {
+    *p++ = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  *p = '\0';
+  std::reverse(buf, p);
+  return p - buf;
+}
+
+}
+
+void HttpResponse::addHeader(const StringPiece& key, const StringPiece& value)
+{
+  const char* line = findLine(headers_, key);
+  if (line == NULL)
+  {
+    appendHeader(key, value);
+    return;
+  }
+  // the value only, the line keeps its field
+  const char* begin = line + key.size() + 1;
+  const char* crlf = endOfLine(line, headers_.data() + headers_.size());
+  string replacement(" ");
+  replacement.append(value.data(), value.size());
+  headers_.replace(begin - headers_.data(), crlf - begin, replacement);
+}
+
+StringPiece HttpResponse::getHeader(const StringPiece& field) const
+{
+  StringPiece value = findHeader(cachedHeaders_, field);
+  return value.empty() ? findHeader(headers_, field) : value;
+}
+
 void HttpResponse::appendToBuffer(Buffer* output) const
 {
-  char buf[32];
-  snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
-  output->append(buf);
+  char buf[32] = "HTTP/1.1 ";
+  const size_t kPrefix = sizeof "HTTP/1.1 " - 1;
+  size_t len = kPrefix + formatSize(buf + kPrefix, statusCode_);
+  buf[len++] = ' ';
+  output->append(buf, len);
   output->append(statusMessage_);
   output->append("\r\n");
 
@@ -29,21 +135,18 @@ void HttpResponse::appendToBuffer(Buffer* output) const
   }
   else
   {
-    snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());
-    output->append(buf);
-    output->append("Connection: Keep-Alive\r\n");
+    output->append("Content-Length: ");
+    len = formatSize(buf, hasBodyFile() ? fileLength_ : body_.size());
+    output->append(buf, len);
+    output->append("\r\nConnection: Keep-Alive\r\n");
   }
+  output->append(dateHeader());
+  output->append(cachedHeaders_);
+  output->append(headers_);
 
-  for (std::map<string, string>::const_iterator it = headers_.begin();
-       it != headers_.end();
-       ++it)
+  output->append("\r\n");
+  if (!headOnly_)
   {
-    output->append(it->first);
-    output->append(": ");
-    output->append(it->second);
-    output->append("\r\n");
+    output->append(body_);
   }
-
-  output->append("\r\n");
-  output->append(body_);
 }
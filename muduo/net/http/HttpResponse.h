@@ -12,9 +12,12 @@
 #define MUDUO_NET_HTTP_HTTPRESPONSE_H
 
 #include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 
-#include <map>
+#include <boost/shared_ptr.hpp>
+
+#include <sys/types.h>  // off_t
 
 namespace muduo
 {
@@ -22,6 +25,16 @@ namespace net
 {
 
 class Buffer;
+
+///
+/// HTTP response, serialized by appendToBuffer().
+///
+/// Header lines are kept serialized, in the order they are added.
+/// addHeader() replaces an earlier line of the same field,
+/// appendHeader() doesn't look, e.g. for Set-Cookie.
+/// Lines that are the same for many responses can be formatted once
+/// and given to setCachedHeaders(), without copying.
+/// A Date header is added, formatted once per second per thread.
 class HttpResponse : public muduo::copyable
 {
  public:
@@ -29,21 +42,32 @@ class HttpResponse : public muduo::copyable
   {
     kUnknown,
     k200Ok = 200,
+    k206PartialContent = 206,
     k301MovedPermanently = 301,
+    k304NotModified = 304,
     k400BadRequest = 400,
     k404NotFound = 404,
+    k413PayloadTooLarge = 413,
+    k416RangeNotSatisfiable = 416,
   };
 
   explicit HttpResponse(bool close)
     : statusCode_(kUnknown),
-      closeConnection_(close)
+      statusMessage_(""),
+      closeConnection_(close),
+      headOnly_(false),
+      static_(false),
+      fileFd_(-1),
+      fileOffset_(0),
+      fileLength_(0)
   {
   }
 
   void setStatusCode(HttpStatusCode code)
   { statusCode_ = code; }
 
-  void setStatusMessage(const string& message)
+  /// Not copied, @c message must be a static string, e.g. "OK".
+  void setStatusMessage(const char* message)
   { statusMessage_ = message; }
 
   void setCloseConnection(bool on)
@@ -52,25 +76,107 @@ class HttpResponse : public muduo::copyable
   bool closeConnection() const
   { return closeConnection_; }
 
-  void setContentType(const string& contentType)
+  void setContentType(const StringPiece& contentType)
   { addHeader("Content-Type", contentType); }
 
-  // FIXME: replace string with StringPiece
-  void addHeader(const string& key, const string& value)
-  { headers_[key] = value; }
+  /// Sets a header, replacing the line of @c key if there is one,
+  /// case-insensitive.
+  void addHeader(const StringPiece& key, const StringPiece& value);
+
+  /// Appends a header line, a header appended twice is sent twice.
+  void appendHeader(const StringPiece& key, const StringPiece& value)
+  {
+    headers_.append(key.data(), key.size());
+    headers_.append(": ");
+    headers_.append(value.data(), value.size());
+    headers_.append("\r\n");
+  }
+
+  /// Appends preformatted header lines, each ends with CRLF.
+  void addRawHeaders(const StringPiece& lines)
+  { headers_.append(lines.data(), lines.size()); }
+
+  /// Preformatted header lines, each ends with CRLF, sent before those
+  /// added by addHeader(), which doesn't replace them.  Not copied, @c lines must outlive this
+  /// response, e.g. a static string of a response template.
+  void setCachedHeaders(const StringPiece& lines)
+  { cachedHeaders_ = lines; }
+
+  /// Lines added by addHeader(), appendHeader() and addRawHeaders(),
+  /// to be cached.
+  const string& headers() const
+  { return headers_; }
+
+  /// Case-insensitive, empty if @c field is absent.
+  StringPiece getHeader(const StringPiece& field) const;
 
   void setBody(const string& body)
   { body_ = body; }
 
+  void swapBody(string* body)
+  { body_.swap(*body); }
+
+  const string& body() const
+  { return body_; }
+
+  /// The body is the same every time, e.g. a generated page that is
+  /// rarely updated, so its compressed form is cached by HttpServer.
+  void setStatic(bool on)
+  { static_ = on; }
+
+  bool isStatic() const
+  { return static_; }
+
+  /// The body is @c length bytes of file @c fd from @c offset, sent with
+  /// sendfile(2) after the head.  @c owner keeps @c fd open until then.
+  void setBodyFile(int fd, off_t offset, size_t length,
+                   const boost::shared_ptr<void>& owner)
+  {
+    fileFd_ = fd;
+    fileOffset_ = offset;
+    fileLength_ = length;
+    fileOwner_ = owner;
+  }
+
+  bool hasBodyFile() const
+  { return fileFd_ >= 0; }
+
+  int bodyFileFd() const
+  { return fileFd_; }
+
+  off_t bodyFileOffset() const
+  { return fileOffset_; }
+
+  size_t bodyFileLength() const
+  { return fileLength_; }
+
+  const boost::shared_ptr<void>& bodyFileOwner() const
+  { return fileOwner_; }
+
+  /// For HEAD, Content-Length is of the body, but the body is not sent.
+  void setHeadOnly(bool on)
+  { headOnly_ = on; }
+
+  bool headOnly() const
+  { return headOnly_; }
+
+  /// Appends the head, and the body unless it's a file.
   void appendToBuffer(Buffer* output) const;
 
  private:
-  std::map<string, string> headers_;
   HttpStatusCode statusCode_;
   // FIXME: add http version
-  string statusMessage_;
+  const char* statusMessage_;
   bool closeConnection_;
+  bool headOnly_;
+  bool static_;
+  StringPiece cachedHeaders_;
+  string headers_;
   string body_;
+  int fileFd_;
+  off_t fileOffset_;
+  size_t fileLength_;
+  boost::shared_ptr<void> fileOwner_;
 };
 
 }
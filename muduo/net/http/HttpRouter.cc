@@ -0,0 +1,260 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpRouter.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int HttpRouter::kMaxParams;
+
+// A node of the radix tree, reached by prefix from its parent.
+struct HttpRouter::Node : boost::noncopyable
+{
+  static const int kNumMethods = HttpRequest::kDelete + 1;
+
+  string prefix;                     // static characters
+  string indices;                    // first characters of children
+  boost::ptr_vector<Node> children;  // static children
+  boost::scoped_ptr<Node> param;     // ":name", up to the next '/'
+  string paramName;
+  boost::scoped_ptr<Node> wildcard;  // "*name", the rest of the path
+  string wildcardName;
+  Handler handlers[kNumMethods];     // kInvalid for any method
+
+  const Handler* handler(HttpRequest::Method method) const
+  {
+    if (handlers[method])
+    {
+      return &handlers[method];
+    }
+    return handlers[HttpRequest::kInvalid] ? &handlers[HttpRequest::kInvalid] : NULL;
+  }
+
+  Node* insert(StringPiece pattern);
+  const Handler* match(HttpRequest::Method method,
+                       StringPiece path,
+                       HttpRouter::Params* params) const;
+};
+
+namespace
+{
+
+int commonPrefix(const StringPiece& a, const StringPiece& b)
+{
+  int n = 0;
+  while (n < a.size() && n < b.size() && a[n] == b[n])
+  {
+    ++n;
+  }
+  return n;
+}
+
+StringPiece segment(const StringPiece& path)
+{
+  const char* slash = static_cast<const char*>(memchr(path.data(), '/', path.size()));
+  return StringPiece(path.data(), slash ? static_cast<int>(slash - path.data()) : path.size());
+}
+
+}
+
+// Returns the node at the end of pattern, NULL if pattern conflicts.
+HttpRouter::Node* HttpRouter::Node::insert(StringPiece pattern)
+{
+  Node* node = this;
+  while (!pattern.empty())
+  {
+    if (pattern[0] == ':')
+    {
+      StringPiece name = segment(pattern);
+      name.remove_prefix(1);
+      if (name.empty() || (node->param && node->paramName != name.as_string()))
+      {
+        return NULL;
+      }
+      if (!node->param)
+      {
+        node->param.reset(new Node);
+        node->paramName = name.as_string();
+      }
+      pattern.remove_prefix(name.size() + 1);
+      node = node->param.get();
+    }
+    else if (pattern[0] == '*')
+    {
+      StringPiece name(pattern.data() + 1, pattern.size() - 1);
+      if (name.empty() || memchr(name.data(), '/', name.size()) != NULL
+          || (node->wildcard && node->wildcardName != name.as_string()))
+      {
+        return NULL;
+      }
+      if (!node->wildcard)
+      {
+        node->wildcard.reset(new Node);
+        node->wildcardName = name.as_string();
+      }
+      return node->wildcard.get();
+    }
+    else
+    {
+      // static characters, up to the next parameter
+      int len = 0;
+      while (len < pattern.size() && pattern[len] != ':' && pattern[len] != '*')
+      {
+        ++len;
+      }
+      if (len < pattern.size() && pattern[len-1] != '/')
+      {
+        // parameters must be whole segments
+        return NULL;
+      }
+      StringPiece run(pattern.data(), len);
+      size_t i = node->indices.find(run[0]);
+      if (i == string::npos)
+      {
+        node->indices.push_back(run[0]);
+        node->children.push_back(new Node);
+        node->children.back().prefix = run.as_string();
+        node = &node->children.back();
+        pattern.remove_prefix(len);
+        continue;
+      }
+
+      Node* child = &node->children[i];
+      int common = commonPrefix(child->prefix, run);
+      if (common < static_cast<int>(child->prefix.size()))
+      {
+        // split child, the common part becomes its parent
+        Node* split = new Node;
+        split->prefix = child->prefix.substr(0, common);
+        child->prefix.erase(0, common);
+        split->indices.push_back(child->prefix[0]);
+        split->children.push_back(node->children.replace(i, split).release());
+        child = split;
+      }
+      pattern.remove_prefix(common);
+      node = child;
+    }
+  }
+  return node;
+}
+
+// Static children first, then ":name", then "*name", backtracking.
+const HttpRouter::Handler* HttpRouter::Node::match(HttpRequest::Method method,
+                                                   StringPiece path,
+                                                   HttpRouter::Params* params) const
+{
+  if (path.empty() && handler(method))
+  {
+    return handler(method);
+  }
+
+  const char* index = path.empty() ? NULL :
+      static_cast<const char*>(memchr(indices.data(), path[0], indices.size()));
+  if (index)
+  {
+    const Node& child = children[index - indices.data()];
+    StringPiece childPrefix(child.prefix);
+    if (path.starts_with(childPrefix))
+    {
+      const Handler* found = child.match(
+          method,
+          StringPiece(path.data() + childPrefix.size(), path.size() - childPrefix.size()),
+          params);
+      if (found)
+      {
+        return found;
+      }
+    }
+  }
+
+  if (param)
+  {
+    StringPiece value = segment(path);
+    if (!value.empty() && params->push(paramName, value))
+    {
+      const Handler* found = param->match(
+          method, StringPiece(path.data() + value.size(), path.size() - value.size()), params);
+      if (found)
+      {
+        return found;
+      }
+      params->pop();
+    }
+  }
+
+  if (wildcard && wildcard->handler(method) && params->push(wildcardName, path))
+  {
+    return wildcard->handler(method);
+  }
+  return NULL;
+}
+
+HttpRouter::HttpRouter()
+  : root_(new Node)
+{
+}
+
+HttpRouter::~HttpRouter()
+{
+}
+
+bool HttpRouter::add(HttpRequest::Method method,
+                     const StringPiece& pattern,
+                     const Handler& handler,
+                     bool replace)
+{
+  Node* node = pattern.starts_with("/") ? root_->insert(pattern) : NULL;
+  if (node == NULL || (node->handlers[method] && !replace))
+  {
+    LOG_ERROR << "HttpRouter::add - bad or conflicting pattern " << pattern;
+    return false;
+  }
+  node->handlers[method] = handler;
+  return true;
+}
+
+const HttpRouter::Handler* HttpRouter::match(HttpRequest::Method method,
+                                             const StringPiece& path,
+                                             Params* params) const
+{
+  params->clear();
+  const Handler* handler = root_->match(method, path, params);
+  if (handler == NULL)
+  {
+    params->clear();
+  }
+  return handler;
+}
+
+void HttpRouter::onRequest(const HttpRequest& req, HttpResponse* resp) const
+{
+  const string& target = req.path();
+  size_t question = target.find('?');
+  StringPiece path(target.data(),
+                   static_cast<int>(question == string::npos ? target.size() : question));
+  Params params;
+  const Handler* handler = match(req.method(), path, &params);
+  if (handler)
+  {
+    (*handler)(req, params, resp);
+  }
+  else
+  {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setStatusMessage("Not Found");
+  }
+}
@@ -0,0 +1,141 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPROUTER_H
+#define MUDUO_NET_HTTP_HTTPROUTER_H
+
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/http/HttpRequest.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpResponse;
+
+///
+/// Dispatches HTTP requests by method and path.
+///
+/// Patterns are compiled into a radix tree, a segment ":name" captures
+/// one path segment, a trailing "*name" captures the rest of the path.
+/// Static segments are preferred over ":name", which is preferred over
+/// "*name".  For example
+/// @code
+///   router.add(HttpRequest::kGet, "/users/:id", onUser);
+///   router.add(HttpRequest::kInvalid, "/static/*file", onStatic);  // any method
+/// @endcode
+///
+/// Matching allocates nothing, captures point into the path.
+/// Registering is not thread safe, matching is.
+class HttpRouter : boost::noncopyable
+{
+ public:
+  static const int kMaxParams = 8;
+
+  /// Captures of a match, valid while the path and the router are.
+  class Params
+  {
+   public:
+    Params()
+      : size_(0)
+    {
+    }
+
+    int size() const
+    { return size_; }
+
+    StringPiece name(int i) const
+    { return params_[i].name; }
+
+    StringPiece value(int i) const
+    { return params_[i].value; }
+
+    /// Empty if there's no @c name.
+    StringPiece get(const StringPiece& name) const
+    {
+      for (int i = 0; i < size_; ++i)
+      {
+        if (params_[i].name == name)
+        {
+          return params_[i].value;
+        }
+      }
+      return StringPiece();
+    }
+
+    // internal
+    bool push(const StringPiece& name, const StringPiece& value)
+    {
+      if (size_ >= kMaxParams)
+      {
+        return false;
+      }
+      params_[size_].name = name;
+      params_[size_].value = value;
+      ++size_;
+      return true;
+    }
+
+    void pop()
+    { --size_; }
+
+    void clear()
+    { size_ = 0; }
+
+   private:
+    struct Param
+    {
+      StringPiece name;
+      StringPiece value;
+    };
+
+    Param params_[kMaxParams];
+    int size_;
+  };
+
+  typedef boost::function<void (const HttpRequest&,
+                                const Params&,
+                                HttpResponse*)> Handler;
+
+  HttpRouter();
+  ~HttpRouter();  // force out-line dtor, for scoped_ptr members.
+
+  /// @c method HttpRequest::kInvalid matches any method.
+  /// Returns false if @c pattern is malformed or conflicts with
+  /// a registered one, unless @c replace is set and only the handler
+  /// of the same pattern and method differs, which is then replaced.
+  bool add(HttpRequest::Method method,
+           const StringPiece& pattern,
+           const Handler& handler,
+           bool replace = false);
+
+  /// Returns NULL if no route matches, the query string must be removed.
+  const Handler* match(HttpRequest::Method method,
+                       const StringPiece& path,
+                       Params* params) const;
+
+  /// For HttpServer::setHttpCallback(), responds 404 if no route matches.
+  void onRequest(const HttpRequest& req, HttpResponse* resp) const;
+
+ private:
+  struct Node;
+  boost::scoped_ptr<Node> root_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPROUTER_H
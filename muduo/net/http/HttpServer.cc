@@ -12,115 +12,152 @@
 #include <muduo/base/Logging.h>
 #include <muduo/net/http/HttpContext.h>
 #include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpRequestView.h>
+#include <muduo/net/http/HttpResponder.h>
 #include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/http/WebSocketContext.h>
 
 #include <boost/bind.hpp>
 
+#include <strings.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
 namespace
 {
-bool processRequestLine(const char* begin, const char* end, HttpContext* context)
+void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
+{
+  resp->setStatusCode(HttpResponse::k404NotFound);
+  resp->setStatusMessage("Not Found");
+  resp->setCloseConnection(true);
+}
+
+StringPiece headerOf(const HttpRequest& request, const char* field)
 {
-  bool succeed = false;
-  const char* start = begin;
-  const char* space = std::find(start, end, ' ');
-  HttpRequest& request = context->request();
-  if (space != end && request.setMethod(start, space))
+  const std::map<string, string>& headers = request.headers();
+  for (std::map<string, string>::const_iterator it = headers.begin();
+       it != headers.end();
+       ++it)
   {
-    start = space+1;
-    space = std::find(start, end, ' ');
-    if (space != end)
+    if (::strcasecmp(it->first.c_str(), field) == 0)
     {
-      request.setPath(start, space);
-      start = space+1;
-      succeed = end-start == 8 && std::equal(start, end-1, "HTTP/1.");
-      if (succeed)
-      {
-        if (*(end-1) == '1')
-        {
-          request.setVersion(HttpRequest::kHttp11);
-        }
-        else if (*(end-1) == '0')
-        {
-          request.setVersion(HttpRequest::kHttp10);
-        }
-        else
-        {
-          succeed = false;
-        }
-      }
+      return it->second;
     }
   }
-  return succeed;
+  return StringPiece();
 }
 
-// return false if any error
-bool parseRequest(Buffer* buf, HttpContext* context, Timestamp receiveTime)
+bool closeAfter(const HttpRequest& req)
 {
-  bool ok = true;
-  bool hasMore = true;
-  while (hasMore)
+  StringPiece connection = headerOf(req, "Connection");
+  return connection == "close" ||
+    (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive");
+}
+
+bool closeAfter(const HttpRequestView& req)
+{
+  StringPiece connection = req.getHeader("Connection");
+  return connection == "close" ||
+    (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive");
+}
+
+void appendError(const HttpContext& context, Buffer* output)
+{
+  if (context.bodyTooLarge())
   {
-    if (context->expectRequestLine())
-    {
-      const char* crlf = buf->findCRLF();
-      if (crlf)
-      {
-        ok = processRequestLine(buf->peek(), crlf, context);
-        if (ok)
-        {
-          context->request().setReceiveTime(receiveTime);
-          buf->retrieveUntil(crlf + 2);
-          context->receiveRequestLine();
-        }
-        else
-        {
-          hasMore = false;
-        }
-      }
-      else
-      {
-        hasMore = false;
-      }
-    }
-    else if (context->expectHeaders())
-    {
-      const char* crlf = buf->findCRLF();
-      if (crlf)
-      {
-        const char* colon = std::find(buf->peek(), crlf, ':');
-        if (colon != crlf)
-        {
-          context->request().addHeader(buf->peek(), colon, crlf);
-        }
-        else
-        {
-          // empty line, end of header
-          context->receiveHeaders();
-          hasMore = !context->gotAll();
-        }
-        buf->retrieveUntil(crlf + 2);
-      }
-      else
-      {
-        hasMore = false;
-      }
-    }
-    else if (context->expectBody())
+    output->append("HTTP/1.1 413 Payload Too Large\r\n\r\n");
+  }
+  else
+  {
+    output->append("HTTP/1.1 400 Bad Request\r\n\r\n");
+  }
+}
+
+// A file body is sent after the head, output is flushed before it.
+void appendResponse(const TcpConnectionPtr& conn,
+                    const HttpResponse& response,
+                    Buffer* output)
+{
+  response.appendToBuffer(output);
+  if (response.hasBodyFile() && !response.headOnly())
+  {
+    conn->send(output);
+    output->retrieveAll();
+    conn->sendFile(response.bodyFileFd(),
+                   response.bodyFileOffset(),
+                   response.bodyFileLength(),
+                   response.bodyFileOwner());
+  }
+}
+
+void setErrorResponse(const HttpContext& context, HttpResponse* response)
+{
+  if (context.bodyTooLarge())
+  {
+    response->setStatusCode(HttpResponse::k413PayloadTooLarge);
+    response->setStatusMessage("Payload Too Large");
+  }
+  else
+  {
+    response->setStatusCode(HttpResponse::k400BadRequest);
+    response->setStatusMessage("Bad Request");
+  }
+  response->setCloseConnection(true);
+}
+
+void appendContinue(HttpContext* context, Buffer* output)
+{
+  if (context->needContinue())
+  {
+    output->append("HTTP/1.1 100 Continue\r\n\r\n");
+    context->clearNeedContinue();
+  }
+}
+
+// "keep-alive, Upgrade" has token "upgrade"
+bool hasToken(const StringPiece& value, const char* token)
+{
+  size_t len = strlen(token);
+  const char* p = value.data();
+  const char* end = p + value.size();
+  while (p < end)
+  {
+    while (p < end && (*p == ' ' || *p == ','))
+      ++p;
+    const char* tokenEnd = p;
+    while (tokenEnd < end && *tokenEnd != ',' && *tokenEnd != ' ')
+      ++tokenEnd;
+    if (static_cast<size_t>(tokenEnd - p) == len && ::strncasecmp(p, token, len) == 0)
     {
-      // FIXME:
+      return true;
     }
+    p = tokenEnd;
   }
-  return ok;
+  return false;
 }
 
-void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
+// only for the rare upgrade request, so that both modes share one callback
+void copyRequest(const HttpRequestView& view, HttpRequest* request)
 {
-  resp->setStatusCode(HttpResponse::k404NotFound);
-  resp->setStatusMessage("Not Found");
-  resp->setCloseConnection(true);
+  StringPiece method = view.methodString();
+  request->setMethod(method.data(), method.data() + method.size());
+  string path = view.path().as_string();
+  if (!view.query().empty())
+  {
+    path += '?';
+    path.append(view.query().data(), view.query().size());
+  }
+  request->setPath(path.data(), path.data() + path.size());
+  request->setVersion(view.getVersion());
+  request->setReceiveTime(view.receiveTime());
+  for (int i = 0; i < view.numHeaders(); ++i)
+  {
+    const HttpRequestView::Header& header = view.header(i);
+    // field and value are still in the input Buffer, with ':' between them
+    const char* colon = header.field.data() + header.field.size();
+    request->addHeader(header.field.data(), colon, header.value.data() + header.value.size());
+  }
 }
 
 }
@@ -129,7 +166,9 @@ HttpServer::HttpServer(EventLoop* loop,
                        const InetAddress& listenAddr,
                        const string& name)
   : server_(loop, listenAddr, name),
-    httpCallback_(defaultHttpCallback)
+    httpCallback_(defaultHttpCallback),
+    maxBodySize_(HttpContext::kDefaultMaxBodySize),
+    maxInFlight_(16)
 {
   server_.setConnectionCallback(
       boost::bind(&HttpServer::onConnection, this, _1));
@@ -152,7 +191,14 @@ void HttpServer::onConnection(const TcpConnectionPtr& conn)
 {
   if (conn->connected())
   {
-    conn->setContext(HttpContext());
+    conn->setContext(HttpContext(maxBodySize_));
+  }
+  else if (WebSocketContext* ws = boost::any_cast<WebSocketContext>(conn->getMutableContext()))
+  {
+    if (webSocketCloseCallback_)
+    {
+      webSocketCloseCallback_(ws->socket());
+    }
   }
 }
 
@@ -160,34 +206,288 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
                            Buffer* buf,
                            Timestamp receiveTime)
 {
+  if (boost::any_cast<WebSocketContext>(conn->getMutableContext()))
+  {
+    onWebSocketMessage(conn, buf);
+    return;
+  }
+
   HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+  if (context->closing())
+  {
+    buf->retrieveAll();
+    return;
+  }
+
+  // responses to all complete requests go out in one write, in order,
+  // from a buffer kept by the connection
+  Buffer& output = context->outputBuffer();
+  bool close = false;
+  bool ok = true;
+  const bool async = !httpViewCallback_ && httpAsyncCallback_;
+  WebSocketPtr socket;
+  while (ok && !close && !context->closing() && buf->readableBytes() > 0)
+  {
+    if (async && context->pendingResponses().size() >= maxInFlight_)
+    {
+      // resumed by onResponseDone()
+      break;
+    }
 
-  if (!parseRequest(buf, context, receiveTime))
+    if (httpViewCallback_)
+    {
+      ok = context->parseRequestView(buf, receiveTime);
+    }
+    else
+    {
+      ok = context->parseRequest(buf, receiveTime,
+                                 httpBodyCallback_ ? &httpBodyCallback_ : NULL);
+    }
+    if (!ok || !context->gotAll())
+    {
+      break;
+    }
+
+    if (webSocketMessageCallback_ && context->pendingResponses().empty())
+    {
+      bool upgraded = false;
+      if (httpViewCallback_)
+      {
+        const HttpRequestView& view = context->requestView();
+        if (hasToken(view.getHeader("Upgrade"), "websocket"))
+        {
+          HttpRequest req;
+          copyRequest(view, &req);
+          upgraded = upgrade(conn, req, &output, &socket);
+          buf->retrieve(context->requestLength());
+          context->resetView();
+        }
+      }
+      else if (upgrade(conn, context->request(), &output, &socket))
+      {
+        upgraded = true;
+        context->reset();
+      }
+      if (upgraded)
+      {
+        // no more HTTP on this connection
+        close = !socket;
+        break;
+      }
+    }
+
+    if (httpViewCallback_)
+    {
+      close = onRequestView(conn, context->requestView(), &output);
+      // the view points into buf, retrieve it only now
+      buf->retrieve(context->requestLength());
+      context->resetView();
+    }
+    else if (async)
+    {
+      onRequestAsync(conn, context);
+    }
+    else
+    {
+      close = onRequest(conn, context->request(), &output);
+      context->reset();
+    }
+  }
+
+  if (!ok)
+  {
+    buf->retrieveAll();
+    if (async)
+    {
+      // after the responses in flight
+      HttpResponderPtr responder(newResponder(conn, true));
+      setErrorResponse(*context, responder->response());
+      context->pendingResponses().push_back(responder);
+      context->setClosing();
+      responder->done();
+    }
+    else
+    {
+      appendError(*context, &output);
+      close = true;
+    }
+  }
+  else if (context->pendingResponses().empty())
+  {
+    appendContinue(context, &output);
+  }
+  if (output.readableBytes() > 0)
+  {
+    conn->send(&output);
+    output.retrieveAll();
+  }
+  if (close)
   {
-    conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
     conn->shutdown();
   }
+  else if (socket)
+  {
+    // context is gone after this
+    conn->setContext(WebSocketContext(socket, maxBodySize_));
+    if (buf->readableBytes() > 0)
+    {
+      onWebSocketMessage(conn, buf);
+    }
+  }
+}
 
-  if (context->gotAll())
+bool HttpServer::upgrade(const TcpConnectionPtr& conn,
+                         const HttpRequest& req,
+                         Buffer* output,
+                         WebSocketPtr* socket)
+{
+  if (!hasToken(headerOf(req, "Upgrade"), "websocket"))
   {
-    onRequest(conn, context->request());
-    context->reset();
+    return false;
   }
+
+  StringPiece key = headerOf(req, "Sec-WebSocket-Key");
+  if (req.method() != HttpRequest::kGet
+      || !hasToken(headerOf(req, "Connection"), "upgrade")
+      || headerOf(req, "Sec-WebSocket-Version") != "13"
+      || key.empty())
+  {
+    output->append("HTTP/1.1 400 Bad Request\r\n"
+                   "Sec-WebSocket-Version: 13\r\n"
+                   "Content-Length: 0\r\n"
+                   "Connection: close\r\n\r\n");
+    return true;
+  }
+
+  WebSocketPtr candidate(new WebSocket(conn, req.path()));
+  if (webSocketOpenCallback_ && !webSocketOpenCallback_(req, candidate))
+  {
+    output->append("HTTP/1.1 403 Forbidden\r\n"
+                   "Content-Length: 0\r\n"
+                   "Connection: close\r\n\r\n");
+    return true;
+  }
+
+  output->append("HTTP/1.1 101 Switching Protocols\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Connection: Upgrade\r\n"
+                 "Sec-WebSocket-Accept: ");
+  output->append(WebSocket::acceptKey(key));
+  output->append("\r\n\r\n");
+  socket->swap(candidate);
+  return true;
 }
 
-void HttpServer::onRequest(const TcpConnectionPtr& conn, const HttpRequest& req)
+void HttpServer::onWebSocketMessage(const TcpConnectionPtr& conn, Buffer* buf)
 {
-  const string& connection = req.getHeader("Connection");
-  bool close = connection == "close" ||
-    (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive");
-  HttpResponse response(close);
+  WebSocketContext* context = boost::any_cast<WebSocketContext>(conn->getMutableContext());
+  if (context->closing())
+  {
+    buf->retrieveAll();
+  }
+  else if (!context->parse(buf, webSocketMessageCallback_))
+  {
+    buf->retrieveAll();
+    context->setClosing();
+    context->socket()->close(context->closeCode());
+  }
+}
+
+bool HttpServer::onRequest(const TcpConnectionPtr& conn,
+                           const HttpRequest& req,
+                           Buffer* output)
+{
+  HttpResponse response(closeAfter(req));
   httpCallback_(req, &response);
-  Buffer buf;
-  response.appendToBuffer(&buf);
-  conn->send(&buf);
-  if (response.closeConnection())
+  if (compressor_)
   {
-    conn->shutdown();
+    compressor_->compress(headerOf(req, "Accept-Encoding"), &response);
   }
+  appendResponse(conn, response, output);
+  return response.closeConnection();
 }
 
+bool HttpServer::onRequestView(const TcpConnectionPtr& conn,
+                               const HttpRequestView& req,
+                               Buffer* output)
+{
+  HttpResponse response(closeAfter(req));
+  httpViewCallback_(req, &response);
+  if (compressor_)
+  {
+    compressor_->compress(req.getHeader("Accept-Encoding"), &response);
+  }
+  appendResponse(conn, response, output);
+  return response.closeConnection();
+}
+
+HttpResponderPtr HttpServer::newResponder(const TcpConnectionPtr& conn, bool close)
+{
+  return HttpResponderPtr(new HttpResponder(
+      conn->getLoop(),
+      close,
+      boost::bind(&HttpServer::onResponseDone, this, boost::weak_ptr<TcpConnection>(conn))));
+}
+
+void HttpServer::onRequestAsync(const TcpConnectionPtr& conn, HttpContext* context)
+{
+  HttpResponderPtr responder(newResponder(conn, closeAfter(context->request())));
+  responder->request().swap(context->request());
+  context->reset();
+  context->pendingResponses().push_back(responder);
+  if (responder->response()->closeConnection())
+  {
+    // no more requests on this connection
+    context->setClosing();
+  }
+  httpAsyncCallback_(responder->request(), responder);
+}
+
+void HttpServer::onResponseDone(const boost::weak_ptr<TcpConnection>& weakConn)
+{
+  TcpConnectionPtr conn(weakConn.lock());
+  if (!conn || !conn->connected())
+  {
+    return;
+  }
+
+  HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+  std::deque<HttpResponderPtr>& pending = context->pendingResponses();
+  Buffer& output = context->outputBuffer();
+  bool close = false;
+  while (!close && !pending.empty() && pending.front()->isDone())
+  {
+    HttpResponse* response = pending.front()->response();
+    if (compressor_)
+    {
+      compressor_->compress(headerOf(pending.front()->request(), "Accept-Encoding"),
+                            response);
+    }
+    appendResponse(conn, *response, &output);
+    close = response->closeConnection();
+    pending.pop_front();
+  }
+  if (!close && pending.empty())
+  {
+    // a request behind the drained ones may wait for it, with its
+    // headers parsed and nothing left in the input buffer
+    appendContinue(context, &output);
+  }
+  if (output.readableBytes() > 0)
+  {
+    conn->send(&output);
+    output.retrieveAll();
+  }
+
+  if (close)
+  {
+    pending.clear();
+    context->setClosing();
+    conn->shutdown();
+  }
+  else if (conn->inputBuffer()->readableBytes() > 0 && pending.size() < maxInFlight_)
+  {
+    // parsing might have been paused by maxInFlight_
+    onMessage(conn, conn->inputBuffer(), Timestamp::now());
+  }
+}
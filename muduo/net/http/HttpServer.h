@@ -12,25 +12,47 @@
 #define MUDUO_NET_HTTP_HTTPSERVER_H
 
 #include <muduo/net/TcpServer.h>
+#include <muduo/net/http/HttpCompressor.h>
+#include <muduo/net/http/HttpResponder.h>
+#include <muduo/net/http/WebSocket.h>
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace muduo
 {
 namespace net
 {
 
+class HttpContext;
 class HttpRequest;
+class HttpRequestView;
 class HttpResponse;
 
 /// A simple embeddable HTTP server designed for report status of a program.
 /// It is not a fully HTTP 1.1 compliant server, but provides minimum features
 /// that can communicate with HttpClient and Web browser.
-/// It is synchronous, just like Java Servlet.
+/// HttpCallback is synchronous, just like Java Servlet, HttpAsyncCallback
+/// answers later.  Pipelined requests of a connection are answered in order.
 class HttpServer : boost::noncopyable
 {
  public:
   typedef boost::function<void (const HttpRequest&,
                                 HttpResponse*)> HttpCallback;
+  typedef boost::function<void (const HttpRequestView&,
+                                HttpResponse*)> HttpViewCallback;
+  /// A piece of request body, the request has all headers.
+  typedef boost::function<void (HttpRequest*,
+                                const StringPiece&)> HttpBodyCallback;
+  typedef boost::function<void (const HttpRequest&,
+                                const HttpResponderPtr&)> HttpAsyncCallback;
+  /// Returns false to refuse the upgrade with 403.
+  typedef boost::function<bool (const HttpRequest&,
+                                const WebSocketPtr&)> WebSocketOpenCallback;
+  /// A whole message, kText or kBinary.  It's valid during the callback only.
+  typedef boost::function<void (const WebSocketPtr&,
+                                const StringPiece&,
+                                WebSocket::Opcode)> WebSocketMessageCallback;
+  typedef boost::function<void (const WebSocketPtr&)> WebSocketCloseCallback;
 
   HttpServer(EventLoop* loop,
              const InetAddress& listenAddr,
@@ -44,6 +66,84 @@ class HttpServer : boost::noncopyable
     httpCallback_ = cb;
   }
 
+  /// Zero-copy parsing, requests are parsed in place without allocation
+  /// and passed as HttpRequestView, which is valid during the callback only.
+  /// Request body is always buffered in this mode.
+  /// Takes precedence over HttpCallback.
+  /// Not thread safe, callback be registered before calling start().
+  void setHttpViewCallback(const HttpViewCallback& cb)
+  {
+    httpViewCallback_ = cb;
+  }
+
+  /// Asynchronous handler, it fills the response of @c responder and
+  /// calls HttpResponder::done() later, in any thread.  Responses are
+  /// written in request order.  The request is owned by the responder.
+  /// Takes precedence over HttpCallback, not used with HttpViewCallback.
+  /// Not thread safe, callback be registered before calling start().
+  void setHttpAsyncCallback(const HttpAsyncCallback& cb)
+  {
+    httpAsyncCallback_ = cb;
+  }
+
+  /// At most @c maxInFlight async requests per connection, later
+  /// requests wait in the input buffer.  Default 16.
+  /// Must be called before @c start
+  void setMaxInFlight(size_t maxInFlight)
+  {
+    maxInFlight_ = maxInFlight;
+  }
+
+  /// Compresses response bodies of at least @c minSize bytes with gzip
+  /// or deflate, as requests accept.  Compressed bodies of static
+  /// responses are cached, up to @c maxCacheBytes.
+  /// Must be called before @c start
+  void enableCompression(size_t minSize = HttpCompressor::kDefaultMinSize,
+                         size_t maxCacheBytes = HttpCompressor::kDefaultMaxCacheBytes)
+  {
+    compressor_.reset(new HttpCompressor(minSize, maxCacheBytes));
+  }
+
+  /// Streaming mode, request body is passed to @c cb piece by piece as it
+  /// arrives, instead of being buffered in HttpRequest::body().
+  /// HttpCallback is called after the last piece.  It's the same
+  /// HttpRequest object all along, keep per-request state with
+  /// HttpRequest::setContext().
+  /// Not thread safe, callback be registered before calling start().
+  void setHttpBodyCallback(const HttpBodyCallback& cb)
+  {
+    httpBodyCallback_ = cb;
+  }
+
+  /// Upgrades requests with "Upgrade: websocket" once it's set.
+  /// Not thread safe, callback be registered before calling start().
+  void setWebSocketMessageCallback(const WebSocketMessageCallback& cb)
+  {
+    webSocketMessageCallback_ = cb;
+  }
+
+  /// Not thread safe, callback be registered before calling start().
+  void setWebSocketOpenCallback(const WebSocketOpenCallback& cb)
+  {
+    webSocketOpenCallback_ = cb;
+  }
+
+  /// Called once the connection of an upgraded WebSocket is gone.
+  /// Not thread safe, callback be registered before calling start().
+  void setWebSocketCloseCallback(const WebSocketCloseCallback& cb)
+  {
+    webSocketCloseCallback_ = cb;
+  }
+
+  /// Buffered request body longer than this is rejected with 413,
+  /// default 1 MiB.  Doesn't apply to streaming mode.
+  /// Also limits WebSocket messages.
+  /// Must be called before @c start
+  void setMaxBodySize(size_t maxBodySize)
+  {
+    maxBodySize_ = maxBodySize;
+  }
+
   void setThreadNum(int numThreads)
   {
     server_.setThreadNum(numThreads);
@@ -56,10 +156,30 @@ class HttpServer : boost::noncopyable
   void onMessage(const TcpConnectionPtr& conn,
                  Buffer* buf,
                  Timestamp receiveTime);
-  void onRequest(const TcpConnectionPtr&, const HttpRequest&);
+  // return true if the connection is to be closed
+  bool onRequest(const TcpConnectionPtr&, const HttpRequest&, Buffer* output);
+  bool onRequestView(const TcpConnectionPtr&, const HttpRequestView&, Buffer* output);
+  void onRequestAsync(const TcpConnectionPtr& conn, HttpContext* context);
+  void onResponseDone(const boost::weak_ptr<TcpConnection>& weakConn);
+  HttpResponderPtr newResponder(const TcpConnectionPtr& conn, bool close);
+  // return true if req asks for WebSocket, socket is set if it's accepted
+  bool upgrade(const TcpConnectionPtr& conn,
+               const HttpRequest& req,
+               Buffer* output,
+               WebSocketPtr* socket);
+  void onWebSocketMessage(const TcpConnectionPtr& conn, Buffer* buf);
 
   TcpServer server_;
   HttpCallback httpCallback_;
+  HttpViewCallback httpViewCallback_;
+  HttpBodyCallback httpBodyCallback_;
+  HttpAsyncCallback httpAsyncCallback_;
+  WebSocketOpenCallback webSocketOpenCallback_;
+  WebSocketMessageCallback webSocketMessageCallback_;
+  WebSocketCloseCallback webSocketCloseCallback_;
+  size_t maxBodySize_;
+  size_t maxInFlight_;
+  boost::scoped_ptr<HttpCompressor> compressor_;
 };
 
 }
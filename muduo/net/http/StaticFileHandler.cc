@@ -0,0 +1,415 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/StaticFileHandler.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t StaticFileHandler::kDefaultMaxOpenFiles;
+
+struct StaticFileHandler::File : boost::noncopyable
+{
+  File(int fdArg, const struct stat& st)
+    : fd(fdArg),
+      size(st.st_size),
+      mtime(st.st_mtime),
+      dev(st.st_dev),
+      ino(st.st_ino)
+  {
+  }
+
+  ~File()
+  {
+    ::close(fd);
+  }
+
+  bool sameAs(const struct stat& st) const
+  {
+    return size == st.st_size && mtime == st.st_mtime
+        && dev == st.st_dev && ino == st.st_ino;
+  }
+
+  const int fd;
+  const off_t size;
+  const time_t mtime;
+  const dev_t dev;
+  const ino_t ino;
+  Timestamp checked;  // guarded by mutex_
+  string lastModified;
+  string headers;  // Content-Type, Last-Modified and Accept-Ranges
+};
+
+namespace
+{
+
+struct ContentType
+{
+  const char* extension;
+  const char* type;
+};
+
+const ContentType kContentTypes[] =
+{
+  { ".html", "text/html" },
+  { ".htm", "text/html" },
+  { ".css", "text/css" },
+  { ".js", "application/javascript" },
+  { ".json", "application/json" },
+  { ".txt", "text/plain" },
+  { ".xml", "text/xml" },
+  { ".png", "image/png" },
+  { ".jpg", "image/jpeg" },
+  { ".jpeg", "image/jpeg" },
+  { ".gif", "image/gif" },
+  { ".svg", "image/svg+xml" },
+  { ".ico", "image/x-icon" },
+  { ".pdf", "application/pdf" },
+  { ".zip", "application/zip" },
+  { ".gz", "application/gzip" },
+  { ".tar", "application/x-tar" },
+};
+
+const char* contentType(const string& path)
+{
+  size_t dot = path.rfind('.');
+  if (dot != string::npos && path.find('/', dot) == string::npos)
+  {
+    for (size_t i = 0; i < sizeof kContentTypes / sizeof kContentTypes[0]; ++i)
+    {
+      if (::strcasecmp(path.c_str() + dot, kContentTypes[i].extension) == 0)
+      {
+        return kContentTypes[i].type;
+      }
+    }
+  }
+  return "application/octet-stream";
+}
+
+const char kHttpDateFormat[] = "%a, %d %b %Y %H:%M:%S GMT";
+
+string httpDate(time_t t)
+{
+  struct tm tm;
+  ::gmtime_r(&t, &tm);
+  char buf[64];
+  ::strftime(buf, sizeof buf, kHttpDateFormat, &tm);
+  return buf;
+}
+
+// returns -1 if invalid
+time_t parseHttpDate(const string& date)
+{
+  struct tm tm;
+  ::bzero(&tm, sizeof tm);
+  const char* end = ::strptime(date.c_str(), kHttpDateFormat, &tm);
+  return end != NULL && *end == '\0' ? ::timegm(&tm) : -1;
+}
+
+int hexValue(char c)
+{
+  if ('0' <= c && c <= '9')
+    return c - '0';
+  else if ('a' <= c && c <= 'f')
+    return c - 'a' + 10;
+  else if ('A' <= c && c <= 'F')
+    return c - 'A' + 10;
+  else
+    return -1;
+}
+
+// Decodes %XX, returns false if the path could escape the root.
+bool decodePath(const string& target, string* path)
+{
+  size_t end = target.find('?');
+  if (end == string::npos)
+  {
+    end = target.size();
+  }
+  if (end == 0 || target[0] != '/')
+  {
+    return false;
+  }
+  path->reserve(end);
+  for (size_t i = 0; i < end; ++i)
+  {
+    char c = target[i];
+    if (c == '%')
+    {
+      int hi = i + 2 < end ? hexValue(target[i+1]) : -1;
+      int lo = i + 2 < end ? hexValue(target[i+2]) : -1;
+      if (hi < 0 || lo < 0)
+      {
+        return false;
+      }
+      c = static_cast<char>(hi * 16 + lo);
+      i += 2;
+    }
+    if (c == '\0')
+    {
+      return false;
+    }
+    path->push_back(c);
+  }
+  // no "." or ".." segment
+  return path->find("/./") == string::npos
+      && path->find("/../") == string::npos
+      && !(path->size() >= 2 && path->compare(path->size() - 2, 2, "/.") == 0)
+      && !(path->size() >= 3 && path->compare(path->size() - 3, 3, "/..") == 0);
+}
+
+// Parses a single "bytes=first-last", "bytes=first-" or "bytes=-suffix".
+// Returns 1 if it's satisfiable, -1 if not, 0 if it's to be ignored.
+int parseRange(const string& range, off_t size, off_t* first, off_t* last)
+{
+  const char kBytes[] = "bytes=";
+  if (range.compare(0, sizeof kBytes - 1, kBytes) != 0
+      || range.find(',') != string::npos)
+  {
+    // multiple ranges are not supported, send the whole file
+    return 0;
+  }
+  const char* start = range.c_str() + sizeof kBytes - 1;
+  const char* dash = ::strchr(start, '-');
+  if (dash == NULL)
+  {
+    return 0;
+  }
+
+  char* end = NULL;
+  if (dash == start)
+  {
+    long long suffix = ::strtoll(dash + 1, &end, 10);
+    if (end == dash + 1 || *end != '\0' || suffix < 0)
+    {
+      return 0;
+    }
+    if (suffix == 0 || size == 0)
+    {
+      return -1;
+    }
+    *first = suffix < size ? size - suffix : 0;
+    *last = size - 1;
+    return 1;
+  }
+
+  if (!isdigit(*start))
+  {
+    return 0;
+  }
+  long long from = ::strtoll(start, &end, 10);
+  if (end != dash)
+  {
+    return 0;
+  }
+  long long to = size - 1;
+  if (dash[1] != '\0')
+  {
+    to = ::strtoll(dash + 1, &end, 10);
+    if (!isdigit(dash[1]) || *end != '\0' || to < from)
+    {
+      return 0;
+    }
+  }
+  if (from >= size)
+  {
+    return -1;
+  }
+  *first = from;
+  *last = to < size ? to : size - 1;
+  return 1;
+}
+
+}
+
+StaticFileHandler::StaticFileHandler(const string& root, size_t maxOpenFiles)
+  : root_(root),
+    maxOpenFiles_(maxOpenFiles),
+    revalidateInterval_(1.0)
+{
+}
+
+StaticFileHandler::~StaticFileHandler()
+{
+}
+
+size_t StaticFileHandler::numOpenFiles() const
+{
+  MutexLockGuard lock(mutex_);
+  return files_.size();
+}
+
+bool StaticFileHandler::handle(const HttpRequest& req, HttpResponse* response)
+{
+  string path;
+  if ((req.method() != HttpRequest::kGet && req.method() != HttpRequest::kHead)
+      || !decodePath(req.path(), &path))
+  {
+    return false;
+  }
+  if (path[path.size()-1] == '/')
+  {
+    path += "index.html";
+  }
+
+  FilePtr file = getFile(path);
+  if (!file)
+  {
+    return false;
+  }
+
+  response->setHeadOnly(req.method() == HttpRequest::kHead);
+  string ims = req.getHeader("If-Modified-Since");
+  if (!ims.empty() && (ims == file->lastModified || parseHttpDate(ims) >= file->mtime))
+  {
+    response->setStatusCode(HttpResponse::k304NotModified);
+    response->setStatusMessage("Not Modified");
+    response->setCachedHeaders(file->headers);
+    // Content-Length of the file, no body
+    response->setBodyFile(file->fd, 0, file->size, file);
+    response->setHeadOnly(true);
+    return true;
+  }
+
+  off_t first = 0;
+  off_t last = file->size - 1;
+  string range = req.getHeader("Range");
+  int ranged = range.empty() ? 0 : parseRange(range, file->size, &first, &last);
+  char buf[96];
+  if (ranged < 0)
+  {
+    response->setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+    response->setStatusMessage("Range Not Satisfiable");
+    snprintf(buf, sizeof buf, "Content-Range: bytes */%lld\r\n",
+             static_cast<long long>(file->size));
+    // no body keeps the file
+    response->addRawHeaders(file->headers);
+    response->addRawHeaders(buf);
+  }
+  else if (ranged > 0)
+  {
+    response->setStatusCode(HttpResponse::k206PartialContent);
+    response->setStatusMessage("Partial Content");
+    snprintf(buf, sizeof buf, "Content-Range: bytes %lld-%lld/%lld\r\n",
+             static_cast<long long>(first),
+             static_cast<long long>(last),
+             static_cast<long long>(file->size));
+    response->setCachedHeaders(file->headers);
+    response->addRawHeaders(buf);
+    response->setBodyFile(file->fd, first, last - first + 1, file);
+  }
+  else
+  {
+    response->setStatusCode(HttpResponse::k200Ok);
+    response->setStatusMessage("OK");
+    response->setCachedHeaders(file->headers);
+    response->setBodyFile(file->fd, 0, file->size, file);
+  }
+  return true;
+}
+
+// Returns NULL if path is not a regular file.
+StaticFileHandler::FilePtr StaticFileHandler::getFile(const string& path)
+{
+  Timestamp now = Timestamp::now();
+  FilePtr cached;
+  {
+  MutexLockGuard lock(mutex_);
+  std::map<string, FileList::iterator>::iterator it = files_.find(path);
+  if (it != files_.end())
+  {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    cached = it->second->second;
+    if (timeDifference(now, cached->checked) < revalidateInterval_)
+    {
+      return cached;
+    }
+  }
+  }
+
+  // stat and open without holding the lock
+  string fullPath = root_ + path;
+  struct stat st;
+  if (::stat(fullPath.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    if (cached)
+    {
+      removeFile(path);
+    }
+    return FilePtr();
+  }
+  if (cached && cached->sameAs(st))
+  {
+    MutexLockGuard lock(mutex_);
+    cached->checked = now;
+    return cached;
+  }
+
+  int fd = ::open(fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    LOG_SYSERR << "StaticFileHandler - open " << fullPath;
+    return FilePtr();
+  }
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    ::close(fd);
+    return FilePtr();
+  }
+
+  FilePtr file(new File(fd, st));
+  file->checked = now;
+  file->lastModified = httpDate(file->mtime);
+  file->headers.append("Content-Type: ").append(contentType(path)).append("\r\n");
+  file->headers.append("Last-Modified: ").append(file->lastModified).append("\r\n");
+  file->headers.append("Accept-Ranges: bytes\r\n");
+
+  MutexLockGuard lock(mutex_);
+  std::map<string, FileList::iterator>::iterator it = files_.find(path);
+  if (it != files_.end())
+  {
+    lru_.erase(it->second);
+    files_.erase(it);
+  }
+  lru_.push_front(std::make_pair(path, file));
+  files_[path] = lru_.begin();
+  while (files_.size() > maxOpenFiles_)
+  {
+    // closed when the last response using it is sent
+    files_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  return file;
+}
+
+void StaticFileHandler::removeFile(const string& path)
+{
+  MutexLockGuard lock(mutex_);
+  std::map<string, FileList::iterator>::iterator it = files_.find(path);
+  if (it != files_.end())
+  {
+    lru_.erase(it->second);
+    files_.erase(it);
+  }
+}
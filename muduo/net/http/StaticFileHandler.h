@@ -0,0 +1,78 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_STATICFILEHANDLER_H
+#define MUDUO_NET_HTTP_STATICFILEHANDLER_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Types.h>
+
+#include <list>
+#include <map>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpRequest;
+class HttpResponse;
+
+///
+/// Serves files under a directory, to be called from an HttpCallback.
+///
+/// Keeps an LRU cache of open files, with their stat results and
+/// preformatted headers, bodies are sent with sendfile(2).
+/// Supports GET and HEAD, a single byte Range, and If-Modified-Since.
+///
+/// Thread safe.
+class StaticFileHandler : boost::noncopyable
+{
+ public:
+  static const size_t kDefaultMaxOpenFiles = 1024;
+
+  explicit StaticFileHandler(const string& root,
+                             size_t maxOpenFiles = kDefaultMaxOpenFiles);
+  ~StaticFileHandler();
+
+  /// A cached stat result is trusted for @c seconds, default 1.
+  /// Not thread safe, call it before serving.
+  void setRevalidateInterval(double seconds)
+  { revalidateInterval_ = seconds; }
+
+  /// Fills @c response if @c req is a GET or HEAD of a regular file
+  /// under root, returns false and leaves @c response untouched otherwise.
+  bool handle(const HttpRequest& req, HttpResponse* response);
+
+  size_t numOpenFiles() const;
+
+ private:
+  struct File;
+  typedef boost::shared_ptr<File> FilePtr;
+  typedef std::list<std::pair<string, FilePtr> > FileList;
+
+  FilePtr getFile(const string& path);
+  void removeFile(const string& path);
+
+  const string root_;
+  const size_t maxOpenFiles_;
+  double revalidateInterval_;
+  mutable MutexLock mutex_;
+  FileList lru_;  // most recently used first
+  std::map<string, FileList::iterator> files_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_STATICFILEHANDLER_H
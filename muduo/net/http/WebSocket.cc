@@ -0,0 +1,281 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/WebSocket.h>
+
+#include <muduo/net/Buffer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const char kAcceptGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+uint32_t rotl(uint32_t x, int n)
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+// only for the handshake, speed doesn't matter
+void sha1(const string& message, unsigned char digest[20])
+{
+  uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+  string data(message);
+  data += '\x80';
+  while (data.size() % 64 != 56)
+  {
+    data += '\0';
+  }
+  uint64_t bits = static_cast<uint64_t>(message.size()) * 8;
+  for (int i = 7; i >= 0; --i)
+  {
+    data += static_cast<char>(bits >> (i * 8));
+  }
+
+  for (size_t chunk = 0; chunk < data.size(); chunk += 64)
+  {
+    uint32_t w[80];
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data() + chunk);
+    for (int i = 0; i < 16; ++i)
+    {
+      w[i] = (p[4*i] << 24) | (p[4*i+1] << 16) | (p[4*i+2] << 8) | p[4*i+3];
+    }
+    for (int i = 16; i < 80; ++i)
+    {
+      w[i] = rotl(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; ++i)
+    {
+      uint32_t f, k;
+      if (i < 20)
+      {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      }
+      else if (i < 40)
+      {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      }
+      else if (i < 60)
+      {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      }
+      else
+      {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotl(b, 30);
+      b = a;
+      a = temp;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+
+  for (int i = 0; i < 20; ++i)
+  {
+    digest[i] = static_cast<unsigned char>(h[i/4] >> (24 - (i % 4) * 8));
+  }
+}
+
+string base64(const unsigned char* data, size_t len)
+{
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  string result;
+  for (size_t i = 0; i < len; i += 3)
+  {
+    uint32_t n = data[i] << 16;
+    if (i + 1 < len)
+      n |= data[i+1] << 8;
+    if (i + 2 < len)
+      n |= data[i+2];
+    result += kAlphabet[(n >> 18) & 63];
+    result += kAlphabet[(n >> 12) & 63];
+    result += i + 1 < len ? kAlphabet[(n >> 6) & 63] : '=';
+    result += i + 2 < len ? kAlphabet[n & 63] : '=';
+  }
+  return result;
+}
+
+void sendFrameInLoop(const boost::weak_ptr<TcpConnection>& weakConn,
+                     const WebSocket::FramePtr& frame)
+{
+  TcpConnectionPtr conn(weakConn.lock());
+  if (conn)
+  {
+    conn->send(*frame);
+  }
+}
+
+}
+
+WebSocket::WebSocket(const TcpConnectionPtr& conn, const string& path)
+  : conn_(conn),
+    loop_(conn->getLoop()),
+    path_(path)
+{
+}
+
+void WebSocket::send(const StringPiece& message, Opcode opcode)
+{
+  TcpConnectionPtr conn(conn_.lock());
+  if (conn)
+  {
+    Buffer frame;
+    appendFrame(&frame, message, opcode);
+    conn->send(&frame);
+  }
+}
+
+void WebSocket::send(const FramePtr& frame)
+{
+  if (loop_->isInLoopThread())
+  {
+    sendFrameInLoop(conn_, frame);
+  }
+  else
+  {
+    // TcpConnection::send() would copy the frame for every connection
+    loop_->queueInLoop(boost::bind(sendFrameInLoop, conn_, frame));
+  }
+}
+
+void WebSocket::close(CloseCode code, const StringPiece& reason)
+{
+  TcpConnectionPtr conn(conn_.lock());
+  if (conn)
+  {
+    char payload[125];
+    payload[0] = static_cast<char>(code >> 8);
+    payload[1] = static_cast<char>(code & 0xFF);
+    int len = std::min(reason.size(), static_cast<int>(sizeof payload) - 2);
+    memcpy(payload + 2, reason.data(), len);
+    send(StringPiece(payload, len + 2), kClose);
+    conn->shutdown();
+  }
+}
+
+WebSocket::FramePtr WebSocket::makeFrame(const StringPiece& payload, Opcode opcode)
+{
+  Buffer frame;
+  appendFrame(&frame, payload, opcode);
+  return FramePtr(new string(frame.peek(), frame.readableBytes()));
+}
+
+void WebSocket::appendFrame(Buffer* output,
+                            const StringPiece& payload,
+                            Opcode opcode,
+                            bool fin)
+{
+  char head[10];
+  head[0] = static_cast<char>((fin ? 0x80 : 0) | opcode);
+  size_t headLen = 2;
+  uint64_t len = payload.size();
+  if (len < 126)
+  {
+    head[1] = static_cast<char>(len);
+  }
+  else if (len <= 0xFFFF)
+  {
+    head[1] = 126;
+    head[2] = static_cast<char>(len >> 8);
+    head[3] = static_cast<char>(len & 0xFF);
+    headLen = 4;
+  }
+  else
+  {
+    head[1] = 127;
+    for (int i = 0; i < 8; ++i)
+    {
+      head[2 + i] = static_cast<char>(len >> ((7 - i) * 8));
+    }
+    headLen = 10;
+  }
+  output->ensureWritableBytes(headLen + payload.size());
+  output->append(head, headLen);
+  output->append(payload.data(), payload.size());
+}
+
+void WebSocket::mask(char* data, size_t len, const char key[4])
+{
+  size_t i = 0;
+#ifdef __SSE2__
+  if (len >= 16)
+  {
+    char pattern[16];
+    for (int j = 0; j < 16; ++j)
+    {
+      pattern[j] = key[j % 4];
+    }
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+    for (; i + 16 <= len; i += 16)
+    {
+      __m128i* p = reinterpret_cast<__m128i*>(data + i);
+      _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), m));
+    }
+  }
+#else
+  if (len >= 8)
+  {
+    char pattern[8];
+    for (int j = 0; j < 8; ++j)
+    {
+      pattern[j] = key[j % 4];
+    }
+    uint64_t m;
+    memcpy(&m, pattern, sizeof m);
+    for (; i + 8 <= len; i += 8)
+    {
+      uint64_t word;
+      memcpy(&word, data + i, sizeof word);
+      word ^= m;
+      memcpy(data + i, &word, sizeof word);
+    }
+  }
+#endif
+  // i is a multiple of 4, the key starts over
+  for (; i < len; ++i)
+  {
+    data[i] = static_cast<char>(data[i] ^ key[i % 4]);
+  }
+}
+
+string WebSocket::acceptKey(const StringPiece& key)
+{
+  unsigned char digest[20];
+  sha1(key.as_string() + kAcceptGuid, digest);
+  return base64(digest, sizeof digest);
+}
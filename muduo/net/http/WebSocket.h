@@ -0,0 +1,123 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_WEBSOCKET_H
+#define MUDUO_NET_HTTP_WEBSOCKET_H
+
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/Callbacks.h>
+
+#include <boost/any.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <stdint.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class Buffer;
+class EventLoop;
+
+///
+/// A connection upgraded to WebSocket (RFC 6455) by HttpServer.
+///
+/// It doesn't own the TcpConnection, sending after the connection is
+/// gone does nothing.
+///
+class WebSocket : boost::noncopyable
+{
+ public:
+  enum Opcode
+  {
+    kContinuation = 0x0,
+    kText = 0x1,
+    kBinary = 0x2,
+    kClose = 0x8,
+    kPing = 0x9,
+    kPong = 0xA,
+  };
+
+  enum CloseCode
+  {
+    kNormalClosure = 1000,
+    kGoingAway = 1001,
+    kProtocolError = 1002,
+    kInvalidPayload = 1007,  // e.g. kText that is not UTF-8
+    kMessageTooBig = 1009,
+  };
+
+  /// An encoded frame, see makeFrame().
+  typedef boost::shared_ptr<const string> FramePtr;
+
+  /// User should not create this object.
+  WebSocket(const TcpConnectionPtr& conn, const string& path);
+
+  /// Path of the upgrade request, with query.
+  const string& path() const
+  { return path_; }
+
+  /// NULL if the connection is gone.
+  TcpConnectionPtr connection() const
+  { return conn_.lock(); }
+
+  /// Sends a whole message in one frame.
+  /// Thread safe.
+  void send(const StringPiece& message, Opcode opcode = kText);
+
+  /// Sends a frame made by makeFrame().  The frame is shared, not copied,
+  /// so broadcasting it to many WebSockets encodes it only once.
+  /// Thread safe.
+  void send(const FramePtr& frame);
+
+  /// Sends a close frame, then shuts down writing.
+  /// Thread safe.
+  void close(CloseCode code = kNormalClosure, const StringPiece& reason = StringPiece());
+
+  /// Not thread safe, for the IO thread or with user's own locking.
+  void setContext(const boost::any& context)
+  { context_ = context; }
+
+  const boost::any& getContext() const
+  { return context_; }
+
+  boost::any* getMutableContext()
+  { return &context_; }
+
+  /// Encodes a server frame, which is never masked.
+  static FramePtr makeFrame(const StringPiece& payload, Opcode opcode = kText);
+  static void appendFrame(Buffer* output,
+                          const StringPiece& payload,
+                          Opcode opcode,
+                          bool fin = true);
+
+  /// XORs data with the 4-byte masking key, 16 bytes at a time.
+  static void mask(char* data, size_t len, const char key[4]);
+
+  /// Sec-WebSocket-Accept for Sec-WebSocket-Key.
+  static string acceptKey(const StringPiece& key);
+
+ private:
+  boost::weak_ptr<TcpConnection> conn_;
+  EventLoop* loop_;
+  const string path_;
+  boost::any context_;
+};
+
+typedef boost::shared_ptr<WebSocket> WebSocketPtr;
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_WEBSOCKET_H
@@ -0,0 +1,215 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/WebSocketContext.h>
+
+#include <muduo/net/Buffer.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// RFC 3629, no overlong forms, surrogates or code points past U+10FFFF
+bool isValidUtf8(const StringPiece& str)
+{
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(str.data());
+  const unsigned char* end = p + str.size();
+  while (p < end)
+  {
+    unsigned char c = *p++;
+    if (c < 0x80)
+    {
+      continue;
+    }
+    int trailing = 0;
+    unsigned char low = 0x80, high = 0xBF;  // of the second byte
+    if (c >= 0xC2 && c <= 0xDF)
+    {
+      trailing = 1;
+    }
+    else if (c >= 0xE0 && c <= 0xEF)
+    {
+      trailing = 2;
+      if (c == 0xE0)
+        low = 0xA0;
+      else if (c == 0xED)
+        high = 0x9F;
+    }
+    else if (c >= 0xF0 && c <= 0xF4)
+    {
+      trailing = 3;
+      if (c == 0xF0)
+        low = 0x90;
+      else if (c == 0xF4)
+        high = 0x8F;
+    }
+    else
+    {
+      return false;
+    }
+    if (end - p < trailing || *p < low || *p > high)
+    {
+      return false;
+    }
+    for (int i = 1; i < trailing; ++i)
+    {
+      if ((p[i] & 0xC0) != 0x80)
+      {
+        return false;
+      }
+    }
+    p += trailing;
+  }
+  return true;
+}
+
+// RFC 6455 7.4, 1005 and 1006 are never sent, 1015 is for TLS
+bool isValidCloseCode(int code)
+{
+  return (code >= 1000 && code <= 1003)
+      || (code >= 1007 && code <= 1014)
+      || (code >= 3000 && code <= 4999);
+}
+
+}
+
+bool WebSocketContext::parse(Buffer* buf, const MessageCallback& cb)
+{
+  while (!closing_ && buf->readableBytes() >= 2)
+  {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(buf->peek());
+    const bool fin = (p[0] & 0x80) != 0;
+    const int opcode = p[0] & 0x0F;
+    const bool control = (opcode & 0x08) != 0;
+    // no extension is negotiated, and clients must mask
+    if ((p[0] & 0x70) != 0 || (p[1] & 0x80) == 0)
+    {
+      return fail(WebSocket::kProtocolError);
+    }
+
+    uint64_t len = p[1] & 0x7F;
+    size_t headLen = 2;
+    if (len == 126)
+    {
+      if (buf->readableBytes() < 4)
+        break;
+      len = (p[2] << 8) | p[3];
+      headLen = 4;
+    }
+    else if (len == 127)
+    {
+      if (buf->readableBytes() < 10)
+        break;
+      len = 0;
+      for (int i = 2; i < 10; ++i)
+      {
+        len = (len << 8) | p[i];
+      }
+      headLen = 10;
+    }
+    if (control && (!fin || len > 125))
+    {
+      return fail(WebSocket::kProtocolError);
+    }
+    if (len > maxMessageSize_ - message_.size())
+    {
+      return fail(WebSocket::kMessageTooBig);
+    }
+    const char* key = buf->peek() + headLen;
+    headLen += 4;
+    if (buf->readableBytes() < headLen + len)
+    {
+      break;
+    }
+
+    // buf is ours, unmask in place
+    char* payload = const_cast<char*>(buf->peek()) + headLen;
+    WebSocket::mask(payload, len, key);
+    StringPiece data(payload, static_cast<int>(len));
+
+    switch (opcode)
+    {
+      case WebSocket::kContinuation:
+        if (messageOpcode_ == WebSocket::kContinuation)
+        {
+          return fail(WebSocket::kProtocolError);
+        }
+        message_.append(data.data(), data.size());
+        if (fin)
+        {
+          WebSocket::Opcode messageOpcode = messageOpcode_;
+          messageOpcode_ = WebSocket::kContinuation;
+          if (messageOpcode == WebSocket::kText && !isValidUtf8(message_))
+          {
+            return fail(WebSocket::kInvalidPayload);
+          }
+          cb(socket_, message_, messageOpcode);
+          message_.clear();
+        }
+        break;
+      case WebSocket::kText:
+      case WebSocket::kBinary:
+        if (messageOpcode_ != WebSocket::kContinuation)
+        {
+          return fail(WebSocket::kProtocolError);
+        }
+        if (fin)
+        {
+          if (opcode == WebSocket::kText && !isValidUtf8(data))
+          {
+            return fail(WebSocket::kInvalidPayload);
+          }
+          cb(socket_, data, static_cast<WebSocket::Opcode>(opcode));
+        }
+        else
+        {
+          messageOpcode_ = static_cast<WebSocket::Opcode>(opcode);
+          message_.assign(data.data(), data.size());
+        }
+        break;
+      case WebSocket::kPing:
+        socket_->send(data, WebSocket::kPong);
+        break;
+      case WebSocket::kPong:
+        break;
+      case WebSocket::kClose:
+        {
+        // echoes a valid status code, 1000 if there is none, then it's done
+        WebSocket::CloseCode code = WebSocket::kNormalClosure;
+        if (data.size() == 1)
+        {
+          return fail(WebSocket::kProtocolError);
+        }
+        else if (data.size() >= 2)
+        {
+          int received = (static_cast<unsigned char>(data[0]) << 8)
+                       | static_cast<unsigned char>(data[1]);
+          if (!isValidCloseCode(received))
+          {
+            return fail(WebSocket::kProtocolError);
+          }
+          if (!isValidUtf8(StringPiece(data.data() + 2, data.size() - 2)))
+          {
+            return fail(WebSocket::kInvalidPayload);
+          }
+          code = static_cast<WebSocket::CloseCode>(received);
+        }
+        closing_ = true;
+        socket_->close(code);
+        }
+        break;
+      default:
+        return fail(WebSocket::kProtocolError);
+    }
+    buf->retrieve(headLen + len);
+  }
+  return true;
+}
@@ -0,0 +1,83 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_HTTP_WEBSOCKETCONTEXT_H
+#define MUDUO_NET_HTTP_WEBSOCKETCONTEXT_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/net/http/WebSocket.h>
+
+#include <boost/function.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class Buffer;
+
+// Frame decoder of a WebSocket connection, kept as its context.
+class WebSocketContext : public muduo::copyable
+{
+ public:
+  // a whole message, kText or kBinary
+  typedef boost::function<void (const WebSocketPtr&,
+                                const StringPiece&,
+                                WebSocket::Opcode)> MessageCallback;
+
+  WebSocketContext(const WebSocketPtr& socket, size_t maxMessageSize)
+    : socket_(socket),
+      maxMessageSize_(maxMessageSize),
+      messageOpcode_(WebSocket::kContinuation),
+      closing_(false),
+      closeCode_(WebSocket::kNormalClosure)
+  {
+  }
+
+  // default copy-ctor, dtor and assignment are fine
+
+  // Decodes complete frames in buf, unmasking them in place.  Messages
+  // in one frame are passed without copying.  Answers ping and close.
+  // return false if any error, see closeCode()
+  bool parse(Buffer* buf, const MessageCallback& cb);
+
+  const WebSocketPtr& socket() const
+  { return socket_; }
+
+  // a close frame is received or sent
+  bool closing() const
+  { return closing_; }
+
+  void setClosing()
+  { closing_ = true; }
+
+  WebSocket::CloseCode closeCode() const
+  { return closeCode_; }
+
+ private:
+  bool fail(WebSocket::CloseCode code)
+  {
+    closeCode_ = code;
+    return false;
+  }
+
+  WebSocketPtr socket_;
+  size_t maxMessageSize_;
+  string message_;  // of fragments so far
+  WebSocket::Opcode messageOpcode_;  // kContinuation if not fragmented
+  bool closing_;
+  WebSocket::CloseCode closeCode_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_WEBSOCKETCONTEXT_H
@@ -0,0 +1,197 @@
+#include <muduo/net/http/HttpClient.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/http/HttpServer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpServer.h>
+
+//#define BOOST_TEST_MODULE HttpClientTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+
+#include <set>
+
+#include <stdio.h>
+#include <string.h>
+
+using muduo::string;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::EventLoop;
+using muduo::net::HttpClient;
+using muduo::net::HttpClientRequest;
+using muduo::net::HttpClientResponse;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponse;
+using muduo::net::HttpServer;
+using muduo::net::InetAddress;
+using muduo::net::TcpConnectionPtr;
+using muduo::net::TcpServer;
+
+namespace
+{
+
+// replies with the method, path and body of the request
+void onEcho(const HttpRequest& req, HttpResponse* resp)
+{
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setStatusMessage("OK");
+  resp->setBody(string(req.methodString()) + " " + req.path() + " " + req.body());
+}
+
+// canned responses, "/slow" gets none
+void onRawMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  const char* end;
+  while ((end = static_cast<const char*>(memmem(buf->peek(), buf->readableBytes(), "\r\n\r\n", 4))) != NULL)
+  {
+    string head(buf->peek(), end);
+    buf->retrieveUntil(end + 4);
+    if (head.find("/chunked") != string::npos)
+    {
+      conn->send("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\nX-Trailer: 1\r\n\r\n");
+    }
+    else if (head.find("/close") != string::npos)
+    {
+      conn->send("HTTP/1.0 200 OK\r\n\r\nuntil close");
+      conn->shutdown();
+    }
+  }
+}
+
+struct Fixture
+{
+  Fixture()
+    : server(&loop, InetAddress(18021), "HttpClientTest"),
+      raw(&loop, InetAddress(18022), "HttpClientTestRaw"),
+      client(&loop, "HttpClientTest"),
+      remaining(0)
+  {
+    server.setHttpCallback(onEcho);
+    server.start();
+    raw.setMessageCallback(onRawMessage);
+    raw.start();
+    loop.runAfter(5.0, boost::bind(&EventLoop::quit, &loop));
+  }
+
+  void get(uint16_t port, const char* path)
+  {
+    ++remaining;
+    client.request(InetAddress("127.0.0.1", port),
+                   HttpClientRequest(HttpRequest::kGet, path),
+                   boost::bind(&Fixture::onResponse, this, _1));
+  }
+
+  void onResponse(const HttpClientResponse& response)
+  {
+    responses.push_back(response);
+    if (--remaining == 0)
+    {
+      loop.quit();
+    }
+  }
+
+  EventLoop loop;
+  HttpServer server;
+  TcpServer raw;
+  HttpClient client;
+  int remaining;
+  std::vector<HttpClientResponse> responses;
+};
+
+string bodyOf(const HttpClientResponse& response)
+{
+  return string(response.body().peek(), response.body().readableBytes());
+}
+
+void onBody(string* received, const HttpClientResponse&, Buffer* body)
+{
+  received->append(body->peek(), body->readableBytes());
+  body->retrieveAll();
+}
+
+}
+
+BOOST_FIXTURE_TEST_CASE(testKeepAlive, Fixture)
+{
+  get(18021, "/a");
+  loop.loop();
+  get(18021, "/b");
+  loop.loop();
+
+  ++remaining;
+  HttpClientRequest post(HttpRequest::kPost, "/c");
+  post.setBody("data");
+  client.request(InetAddress("127.0.0.1", 18021), post,
+                 boost::bind(&Fixture::onResponse, this, _1));
+  loop.loop();
+
+  BOOST_REQUIRE_EQUAL(responses.size(), 3u);
+  BOOST_CHECK(responses[0].ok());
+  BOOST_CHECK_EQUAL(responses[0].statusCode(), 200);
+  BOOST_CHECK_EQUAL(responses[0].getHeader("content-length"), string("7"));
+  BOOST_CHECK_EQUAL(bodyOf(responses[0]), string("GET /a "));
+  BOOST_CHECK_EQUAL(bodyOf(responses[1]), string("GET /b "));
+  BOOST_CHECK_EQUAL(bodyOf(responses[2]), string("POST /c data"));
+  BOOST_CHECK_EQUAL(client.numConnections(), 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE(testPipeline, Fixture)
+{
+  client.setMaxConnectionsPerHost(1);
+  client.setMaxPipeline(8);
+  for (int i = 0; i < 20; ++i)
+  {
+    char path[32];
+    snprintf(path, sizeof path, "/%d", i);
+    get(18021, path);
+  }
+  loop.loop();
+
+  BOOST_REQUIRE_EQUAL(responses.size(), 20u);
+  for (int i = 0; i < 20; ++i)
+  {
+    char body[32];
+    snprintf(body, sizeof body, "GET /%d ", i);
+    BOOST_CHECK(responses[i].ok());
+    BOOST_CHECK_EQUAL(bodyOf(responses[i]), string(body));
+  }
+  BOOST_CHECK_EQUAL(client.numConnections(), 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE(testBodiesAndTimeout, Fixture)
+{
+  client.setTimeout(0.2);
+  get(18022, "/chunked");
+  get(18022, "/slow");
+  get(18022, "/close");
+
+  string streamed;
+  ++remaining;
+  client.request(InetAddress("127.0.0.1", 18022),
+                 HttpClientRequest(HttpRequest::kGet, "/chunked"),
+                 boost::bind(&Fixture::onResponse, this, _1),
+                 boost::bind(onBody, &streamed, _1, _2));
+  loop.loop();
+
+  BOOST_REQUIRE_EQUAL(responses.size(), 4u);
+  // the order of completion varies, four connections are used
+  std::multiset<string> bodies;
+  int timeouts = 0;
+  for (size_t i = 0; i < responses.size(); ++i)
+  {
+    if (responses[i].ok())
+      bodies.insert(bodyOf(responses[i]));
+    else if (responses[i].error() == HttpClientResponse::kTimeout)
+      ++timeouts;
+  }
+  BOOST_CHECK_EQUAL(timeouts, 1);
+  BOOST_CHECK_EQUAL(bodies.count("hello world"), 1u);
+  BOOST_CHECK_EQUAL(bodies.count("until close"), 1u);
+  BOOST_CHECK_EQUAL(bodies.count(""), 1u);
+  BOOST_CHECK_EQUAL(streamed, string("hello world"));
+}
@@ -0,0 +1,149 @@
+#include <muduo/net/http/HttpCompressor.h>
+#include <muduo/net/http/HttpResponse.h>
+
+//#define BOOST_TEST_MODULE HttpCompressorTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <zlib.h>
+
+#include <string.h>
+
+using muduo::string;
+using muduo::net::HttpCompressor;
+using muduo::net::HttpResponse;
+
+namespace
+{
+
+string inflateBody(const string& compressed, bool gzip)
+{
+  z_stream zs;
+  ::bzero(&zs, sizeof zs);
+  BOOST_REQUIRE(::inflateInit2(&zs, gzip ? 15 + 16 : 15) == Z_OK);
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  zs.avail_in = static_cast<uInt>(compressed.size());
+  string result;
+  char buf[4096];
+  int ret = Z_OK;
+  while (ret == Z_OK)
+  {
+    zs.next_out = reinterpret_cast<Bytef*>(buf);
+    zs.avail_out = sizeof buf;
+    ret = ::inflate(&zs, Z_NO_FLUSH);
+    result.append(buf, sizeof buf - zs.avail_out);
+  }
+  ::inflateEnd(&zs);
+  BOOST_CHECK_EQUAL(ret, Z_STREAM_END);
+  return result;
+}
+
+string makeBody(size_t size)
+{
+  string body;
+  while (body.size() < size)
+  {
+    body += "<p>Hello, muduo.  Hello, compression.</p>\n";
+  }
+  body.resize(size);
+  return body;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testChooseEncoding)
+{
+  BOOST_CHECK_EQUAL(HttpCompressor::chooseEncoding(""), HttpCompressor::kIdentity);
+  BOOST_CHECK_EQUAL(HttpCompressor::chooseEncoding("gzip, deflate, br"), HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(HttpCompressor::chooseEncoding("deflate"), HttpCompressor::kDeflate);
+  BOOST_CHECK_EQUAL(HttpCompressor::chooseEncoding("GZIP;q=0.5, deflate"), HttpCompressor::kDeflate);
+  BOOST_CHECK_EQUAL(HttpCompressor::chooseEncoding("gzip;q=0, deflate;q=0"), HttpCompressor::kIdentity);
+  BOOST_CHECK_EQUAL(HttpCompressor::chooseEncoding("*"), HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(HttpCompressor::chooseEncoding("gzip;q=0, *"), HttpCompressor::kDeflate);
+  BOOST_CHECK_EQUAL(HttpCompressor::chooseEncoding("br, identity"), HttpCompressor::kIdentity);
+}
+
+BOOST_AUTO_TEST_CASE(testRoundTrip)
+{
+  HttpCompressor compressor;
+  string body = makeBody(10000);
+
+  HttpResponse gzip(false);
+  gzip.setContentType("text/html");
+  gzip.setBody(body);
+  BOOST_REQUIRE(compressor.compress("gzip", &gzip));
+  BOOST_CHECK_EQUAL(gzip.getHeader("Content-Encoding").as_string(), string("gzip"));
+  BOOST_CHECK_EQUAL(gzip.getHeader("Vary").as_string(), string("Accept-Encoding"));
+  BOOST_CHECK_LT(gzip.body().size(), body.size());
+  BOOST_CHECK(inflateBody(gzip.body(), true) == body);
+
+  HttpResponse deflate(false);
+  deflate.setBody(body);
+  BOOST_REQUIRE(compressor.compress("deflate", &deflate));
+  BOOST_CHECK_EQUAL(deflate.getHeader("Content-Encoding").as_string(), string("deflate"));
+  BOOST_CHECK(inflateBody(deflate.body(), false) == body);
+}
+
+BOOST_AUTO_TEST_CASE(testSkipped)
+{
+  HttpCompressor compressor(1024);
+
+  HttpResponse small(false);
+  small.setContentType("text/plain");
+  small.setBody(makeBody(1000));
+  BOOST_CHECK(!compressor.compress("gzip", &small));
+  BOOST_CHECK_EQUAL(small.body().size(), 1000u);
+  BOOST_CHECK(small.getHeader("Content-Encoding").empty());
+
+  HttpResponse image(false);
+  image.setContentType("image/png");
+  image.setBody(makeBody(5000));
+  BOOST_CHECK(!compressor.compress("gzip", &image));
+
+  HttpResponse json(false);
+  json.setContentType("application/json");
+  json.setBody(makeBody(5000));
+  BOOST_CHECK(compressor.compress("gzip", &json));
+
+  HttpResponse identity(false);
+  identity.setContentType("text/plain");
+  identity.setBody(makeBody(5000));
+  BOOST_CHECK(!compressor.compress("identity", &identity));
+  BOOST_CHECK_EQUAL(identity.getHeader("Vary").as_string(), string("Accept-Encoding"));
+}
+
+BOOST_AUTO_TEST_CASE(testStaticCache)
+{
+  HttpCompressor compressor;
+  string body = makeBody(20000);
+
+  HttpResponse first(false);
+  first.setStatic(true);
+  first.setBody(body);
+  BOOST_REQUIRE(compressor.compress("gzip", &first));
+  size_t cached = compressor.cacheBytes();
+  BOOST_CHECK_GT(cached, body.size());
+
+  HttpResponse second(false);
+  second.setStatic(true);
+  second.setBody(body);
+  BOOST_REQUIRE(compressor.compress("gzip", &second));
+  BOOST_CHECK_EQUAL(compressor.cacheBytes(), cached);
+  BOOST_CHECK(second.body() == first.body());
+
+  HttpResponse deflate(false);
+  deflate.setStatic(true);
+  deflate.setBody(body);
+  BOOST_REQUIRE(compressor.compress("deflate", &deflate));
+  BOOST_CHECK_GT(compressor.cacheBytes(), cached);
+  BOOST_CHECK(inflateBody(deflate.body(), false) == body);
+
+  // too big to cache, compressed all the same
+  HttpCompressor tiny(1024, 1000);
+  HttpResponse big(false);
+  big.setStatic(true);
+  big.setBody(body);
+  BOOST_CHECK(tiny.compress("gzip", &big));
+  BOOST_CHECK_EQUAL(tiny.cacheBytes(), 0u);
+}
@@ -0,0 +1,272 @@
+#include <muduo/net/http/HttpContext.h>
+#include <muduo/net/Buffer.h>
+
+//#define BOOST_TEST_MODULE HttpContextTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+
+using muduo::string;
+using muduo::StringPiece;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::HttpContext;
+using muduo::net::HttpRequest;
+using muduo::net::HttpRequestView;
+
+BOOST_AUTO_TEST_CASE(testParseRequestAllInOne)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("GET /index.html HTTP/1.1\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "\r\n");
+
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  const HttpRequest& request = context.request();
+  BOOST_CHECK_EQUAL(request.method(), HttpRequest::kGet);
+  BOOST_CHECK_EQUAL(request.path(), string("/index.html"));
+  BOOST_CHECK_EQUAL(request.getVersion(), HttpRequest::kHttp11);
+  BOOST_CHECK_EQUAL(request.getHeader("Host"), string("www.chenshuo.com"));
+  BOOST_CHECK_EQUAL(input.readableBytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestViewAllInOne)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("GET /search?q=muduo&n=10 HTTP/1.0\r\n"
+       "Host:   www.chenshuo.com  \r\n"
+       "Connection: Keep-Alive\r\n"
+       "\r\n"
+       "GET /next");
+
+  BOOST_CHECK(context.parseRequestView(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  const HttpRequestView& request = context.requestView();
+  BOOST_CHECK_EQUAL(request.method(), HttpRequest::kGet);
+  BOOST_CHECK_EQUAL(request.methodString().as_string(), string("GET"));
+  BOOST_CHECK_EQUAL(request.path().as_string(), string("/search"));
+  BOOST_CHECK_EQUAL(request.query().as_string(), string("q=muduo&n=10"));
+  BOOST_CHECK_EQUAL(request.getVersion(), HttpRequest::kHttp10);
+  BOOST_CHECK_EQUAL(request.numHeaders(), 2);
+  BOOST_CHECK_EQUAL(request.getHeader("host").as_string(), string("www.chenshuo.com"));
+  BOOST_CHECK_EQUAL(request.getHeader("CONNECTION").as_string(), string("Keep-Alive"));
+  BOOST_CHECK(request.getHeader("Accept").empty());
+
+  // nothing retrieved, and the view points into the buffer
+  BOOST_CHECK(request.path().data() > input.peek());
+  BOOST_CHECK(request.path().data() < input.beginWrite());
+  input.retrieve(context.requestLength());
+  BOOST_CHECK_EQUAL(input.retrieveAllAsString(), string("GET /next"));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestViewInPieces)
+{
+  string all("POST /api HTTP/1.1\r\n"
+             "Host: www.chenshuo.com\r\n"
+             "User-Agent: test\r\n"
+             "\r\n");
+
+  for (size_t i = 0; i < all.size(); ++i)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(all.c_str(), i);
+    BOOST_CHECK(context.parseRequestView(&input, Timestamp::now()));
+    BOOST_CHECK(!context.gotAll());
+
+    input.append(all.c_str() + i, all.size() - i);
+    BOOST_CHECK(context.parseRequestView(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    const HttpRequestView& request = context.requestView();
+    BOOST_CHECK_EQUAL(request.method(), HttpRequest::kPost);
+    BOOST_CHECK_EQUAL(request.path().as_string(), string("/api"));
+    BOOST_CHECK(request.query().empty());
+    BOOST_CHECK_EQUAL(request.getHeader("User-Agent").as_string(), string("test"));
+    BOOST_CHECK_EQUAL(context.requestLength(), all.size());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestViewBad)
+{
+  {
+  HttpContext context;
+  Buffer input;
+  input.append("GET / HTTP/1.1\r\nNoColon\r\n\r\n");
+  BOOST_CHECK(!context.parseRequestView(&input, Timestamp::now()));
+  }
+
+  {
+  HttpContext context;
+  Buffer input;
+  input.append("FETCH / HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(!context.parseRequestView(&input, Timestamp::now()));
+  }
+
+  {
+  HttpContext context;
+  Buffer input;
+  input.append("GET / HTTP/1.1\r\n");
+  for (int i = 0; i <= HttpRequestView::kMaxHeaders; ++i)
+  {
+    char header[32];
+    snprintf(header, sizeof header, "X-%d: %d\r\n", i, i);
+    input.append(header);
+  }
+  input.append("\r\n");
+  BOOST_CHECK(!context.parseRequestView(&input, Timestamp::now()));
+  }
+
+  {
+  HttpContext context;
+  Buffer input;
+  input.append("GET / HTTP/1.1\r\n");
+  input.append(string(HttpContext::kMaxRequestHeadSize, 'x'));
+  BOOST_CHECK(!context.parseRequestView(&input, Timestamp::now()));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestBody)
+{
+  string all("POST /upload HTTP/1.1\r\n"
+             "Content-Length: 11\r\n"
+             "\r\n"
+             "hello world");
+
+  for (size_t i = 0; i < all.size(); ++i)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(all.c_str(), i);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(!context.gotAll());
+    input.append(all.c_str() + i, all.size() - i);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.request().body(), string("hello world"));
+    BOOST_CHECK_EQUAL(input.readableBytes(), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestChunked)
+{
+  string all("POST /upload HTTP/1.1\r\n"
+             "Transfer-Encoding: chunked\r\n"
+             "Expect: 100-continue\r\n"
+             "\r\n"
+             "5\r\nhello\r\n"
+             "6;ext=1\r\n world\r\n"
+             "0\r\n"
+             "X-Trailer: yes\r\n"
+             "\r\n"
+             "GET /next");
+
+  for (size_t i = 0; i < all.size(); ++i)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(all.c_str(), i);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    input.append(all.c_str() + i, all.size() - i);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.request().body(), string("hello world"));
+    BOOST_CHECK_EQUAL(input.retrieveAllAsString(), string("GET /next"));
+  }
+
+  HttpContext context;
+  Buffer input;
+  input.append(all);
+  BOOST_CHECK(context.parseRequestView(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK(context.needContinue());
+  BOOST_CHECK_EQUAL(context.requestView().body().as_string(), string("hello world"));
+  BOOST_CHECK_EQUAL(context.requestView().path().as_string(), string("/upload"));
+  input.retrieve(context.requestLength());
+  BOOST_CHECK_EQUAL(input.retrieveAllAsString(), string("GET /next"));
+}
+
+void onBody(string* received, muduo::net::HttpRequest* request, const StringPiece& piece)
+{
+  BOOST_CHECK_EQUAL(request->path(), string("/upload"));
+  received->append(piece.data(), piece.size());
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestStreaming)
+{
+  string received;
+  HttpContext::BodyCallback cb = boost::bind(onBody, &received, _1, _2);
+  HttpContext context(16);
+  Buffer input;
+  input.append("PUT /upload HTTP/1.1\r\n"
+               "Content-Length: 64\r\n"
+               "\r\n");
+  for (int i = 0; i < 8; ++i)
+  {
+    input.append("01234567");
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now(), &cb));
+    BOOST_CHECK_EQUAL(input.readableBytes(), 0);
+    BOOST_CHECK_EQUAL(received.size(), (i + 1) * 8);
+  }
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK(context.request().body().empty());
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestViewBody)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("POST /upload HTTP/1.1\r\n"
+               "Content-Length: 100000\r\n"
+               "\r\n");
+  BOOST_CHECK(context.parseRequestView(&input, Timestamp::now()));
+  BOOST_CHECK(!context.gotAll());
+  // Buffer grows and moves
+  for (int i = 0; i < 10; ++i)
+  {
+    input.append(string(10000, static_cast<char>('a' + i)));
+    BOOST_CHECK(context.parseRequestView(&input, Timestamp::now()));
+    BOOST_CHECK_EQUAL(context.gotAll(), i == 9);
+  }
+  const HttpRequestView& request = context.requestView();
+  BOOST_CHECK_EQUAL(request.path().as_string(), string("/upload"));
+  BOOST_CHECK_EQUAL(request.getHeader("Content-Length").as_string(), string("100000"));
+  BOOST_CHECK_EQUAL(request.body().size(), 100000);
+  BOOST_CHECK_EQUAL(request.body()[99999], 'j');
+  BOOST_CHECK_EQUAL(context.requestLength(), input.readableBytes());
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestBodyTooLarge)
+{
+  {
+  HttpContext context(10);
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.bodyTooLarge());
+  }
+
+  {
+  HttpContext context(10);
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+               "6\r\nhello \r\n6\r\nworld!\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.bodyTooLarge());
+  }
+
+  {
+  HttpContext context;
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+               "zz\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(!context.bodyTooLarge());
+  }
+}
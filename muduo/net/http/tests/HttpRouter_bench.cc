@@ -0,0 +1,157 @@
+#include <muduo/net/http/HttpRouter.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kLookups = 1000000;
+
+int g_hits = 0;
+
+void onRoute(const HttpRequest&, const HttpRouter::Params&, HttpResponse*)
+{
+  ++g_hits;
+}
+
+std::vector<string> split(const string& path)
+{
+  std::vector<string> result;
+  size_t start = 1;
+  size_t pos;
+  while ((pos = path.find('/', start)) != string::npos)
+  {
+    result.push_back(path.substr(start, pos - start));
+    start = pos + 1;
+  }
+  result.push_back(path.substr(start));
+  return result;
+}
+
+// what one HttpCallback would do by hand: split the path,
+// then compare it with every route
+struct LinearRouter
+{
+  std::vector<std::vector<string> > routes;
+
+  void add(const string& pattern)
+  {
+    routes.push_back(split(pattern));
+  }
+
+  int match(const string& path) const
+  {
+    std::vector<string> segments = split(path);
+    for (size_t i = 0; i < routes.size(); ++i)
+    {
+      const std::vector<string>& route = routes[i];
+      bool wildcard = !route.empty() && route.back()[0] == '*';
+      if (wildcard ? segments.size() < route.size() : segments.size() != route.size())
+      {
+        continue;
+      }
+      size_t j = 0;
+      for (; j < route.size(); ++j)
+      {
+        if (route[j][0] == '*')
+        {
+          j = route.size();
+          break;
+        }
+        if (route[j][0] != ':' && route[j] != segments[j])
+        {
+          break;
+        }
+      }
+      if (j == route.size())
+      {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+};
+
+int main()
+{
+  const char* resources[] = {
+    "users", "groups", "orders", "items", "carts", "payments", "invoices",
+    "shipments", "reviews", "products", "categories", "tags", "comments",
+    "sessions", "tokens", "devices", "alerts", "metrics", "jobs", "tasks",
+    "files", "folders", "teams", "projects", "builds", "releases", "issues",
+    "events", "webhooks", "settings",
+  };
+  const char* actions[] = { "history", "members", "status", "export", "audit" };
+  const int nres = sizeof resources / sizeof resources[0];
+  const int nact = sizeof actions / sizeof actions[0];
+
+  std::vector<string> patterns;
+  std::vector<string> paths;
+  for (int i = 0; i < nres; ++i)
+  {
+    string base = string("/api/v1/") + resources[i];
+    patterns.push_back(base);
+    patterns.push_back(base + "/:id");
+    for (int j = 0; j < nact; ++j)
+    {
+      patterns.push_back(base + "/:id/" + actions[j]);
+      paths.push_back(base + "/12345/" + actions[j]);
+    }
+    patterns.push_back(string("/api/v2/") + resources[i] + "/*rest");
+    paths.push_back(base);
+    paths.push_back(base + "/67890");
+    paths.push_back(string("/api/v2/") + resources[i] + "/a/b/c");
+  }
+  for (int i = 0; i < 60; ++i)
+  {
+    char page[64];
+    snprintf(page, sizeof page, "/static/page%d.html", i);
+    patterns.push_back(page);
+    paths.push_back(page);
+  }
+  paths.push_back("/not/found");
+
+  HttpRouter router;
+  LinearRouter linear;
+  for (size_t i = 0; i < patterns.size(); ++i)
+  {
+    router.add(HttpRequest::kGet, patterns[i], onRoute);
+    linear.add(patterns[i]);
+  }
+  printf("%zd routes, %zd paths\n", patterns.size(), paths.size());
+
+  {
+  const HttpRequest request;
+  Timestamp start(Timestamp::now());
+  HttpRouter::Params params;
+  for (int i = 0; i < kLookups; ++i)
+  {
+    const HttpRouter::Handler* handler =
+        router.match(HttpRequest::kGet, paths[i % paths.size()], &params);
+    if (handler)
+    {
+      (*handler)(request, params, NULL);
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("HttpRouter   %6.1f ns/match, %d hits\n", seconds * 1e9 / kLookups, g_hits);
+  }
+
+  {
+  int hits = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kLookups; ++i)
+  {
+    if (linear.match(paths[i % paths.size()]) >= 0)
+    {
+      ++hits;
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("linear scan  %6.1f ns/match, %d hits\n", seconds * 1e9 / kLookups, hits);
+  }
+}
@@ -0,0 +1,162 @@
+#include <muduo/net/http/HttpRouter.h>
+#include <muduo/net/http/HttpResponse.h>
+
+//#define BOOST_TEST_MODULE HttpRouterTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+
+#include <list>
+
+using muduo::string;
+using muduo::StringPiece;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponse;
+using muduo::net::HttpRouter;
+
+namespace
+{
+
+void setName(string* name,
+             const char* value,
+             const HttpRequest&,
+             const HttpRouter::Params&,
+             HttpResponse*)
+{
+  *name = value;
+}
+
+struct Fixture
+{
+  Fixture()
+  {
+    add(HttpRequest::kGet, "/");
+    add(HttpRequest::kGet, "/users");
+    add(HttpRequest::kGet, "/users/new");
+    add(HttpRequest::kGet, "/users/:id");
+    add(HttpRequest::kPost, "/users/:id");
+    add(HttpRequest::kGet, "/users/:id/posts/:post");
+    add(HttpRequest::kGet, "/usage");
+    add(HttpRequest::kInvalid, "/static/*file");
+    add(HttpRequest::kGet, "/static/index.html");
+  }
+
+  void add(HttpRequest::Method method, const char* pattern)
+  {
+    names.push_back(string(HttpRequest::kGet == method ? "GET " :
+                           HttpRequest::kPost == method ? "POST " : "ANY ") + pattern);
+    BOOST_REQUIRE(router.add(method, pattern,
+        boost::bind(setName, &matched, names.back().c_str(), _1, _2, _3)));
+  }
+
+  // returns the name of the matching route, and its params as "k=v;"
+  string match(HttpRequest::Method method, const char* path, string* params = NULL)
+  {
+    matched = "none";
+    HttpRouter::Params captures;
+    const HttpRouter::Handler* handler = router.match(method, path, &captures);
+    if (handler)
+    {
+      (*handler)(HttpRequest(), captures, NULL);
+    }
+    if (params)
+    {
+      params->clear();
+      for (int i = 0; i < captures.size(); ++i)
+      {
+        *params += captures.name(i).as_string() + "=" + captures.value(i).as_string() + ";";
+      }
+    }
+    return matched;
+  }
+
+  HttpRouter router;
+  std::list<string> names;
+  string matched;
+};
+
+}
+
+BOOST_FIXTURE_TEST_CASE(testStatic, Fixture)
+{
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/"), string("GET /"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/users"), string("GET /users"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/usage"), string("GET /usage"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/users/new"), string("GET /users/new"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/use"), string("none"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/users/"), string("none"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kPut, "/users"), string("none"));
+}
+
+BOOST_FIXTURE_TEST_CASE(testParams, Fixture)
+{
+  string params;
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/users/42", &params), string("GET /users/:id"));
+  BOOST_CHECK_EQUAL(params, string("id=42;"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kPost, "/users/42", &params), string("POST /users/:id"));
+  // backtracks from the static "new"
+  BOOST_CHECK_EQUAL(match(HttpRequest::kPost, "/users/new", &params), string("POST /users/:id"));
+  BOOST_CHECK_EQUAL(params, string("id=new;"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/users/7/posts/hello", &params),
+                    string("GET /users/:id/posts/:post"));
+  BOOST_CHECK_EQUAL(params, string("id=7;post=hello;"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/users/7/posts"), string("none"));
+
+  HttpRouter::Params captures;
+  BOOST_CHECK(router.match(HttpRequest::kGet, "/users/7/posts/x", &captures));
+  BOOST_CHECK_EQUAL(captures.get("post").as_string(), string("x"));
+  BOOST_CHECK(captures.get("nope").empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(testWildcard, Fixture)
+{
+  string params;
+  BOOST_CHECK_EQUAL(match(HttpRequest::kHead, "/static/css/a.css", &params),
+                    string("ANY /static/*file"));
+  BOOST_CHECK_EQUAL(params, string("file=css/a.css;"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/static/", &params), string("ANY /static/*file"));
+  BOOST_CHECK_EQUAL(params, string("file=;"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kGet, "/static/index.html"),
+                    string("GET /static/index.html"));
+  BOOST_CHECK_EQUAL(match(HttpRequest::kPost, "/static/index.html"),
+                    string("ANY /static/*file"));
+}
+
+BOOST_AUTO_TEST_CASE(testBadPatterns)
+{
+  HttpRouter router;
+  string name;
+  HttpRouter::Handler handler = boost::bind(setName, &name, "", _1, _2, _3);
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/a/:id", handler));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/:id", handler));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/:name/x", handler));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "noslash", handler));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a:id", handler));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/*rest/more", handler));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/:", handler));
+}
+
+BOOST_AUTO_TEST_CASE(testReplace)
+{
+  HttpRouter router;
+  string name;
+  HttpRouter::Params params;
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/a/:id",
+                         boost::bind(setName, &name, "old", _1, _2, _3)));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/:id",
+                          boost::bind(setName, &name, "kept", _1, _2, _3)));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/a/:id",
+                         boost::bind(setName, &name, "new", _1, _2, _3), true));
+  // a different parameter name is still a conflict
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/:name",
+                          boost::bind(setName, &name, "bad", _1, _2, _3), true));
+
+  const HttpRouter::Handler* handler = router.match(HttpRequest::kGet, "/a/1", &params);
+  BOOST_REQUIRE(handler != NULL);
+  HttpResponse resp(false);
+  (*handler)(HttpRequest(), params, &resp);
+  BOOST_CHECK_EQUAL(name, string("new"));
+  BOOST_CHECK_EQUAL(params.get("id").as_string(), string("1"));
+}
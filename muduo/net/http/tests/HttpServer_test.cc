@@ -47,10 +47,12 @@ void onRequest(const HttpRequest& req, HttpResponse* resp)
   }
   else if (req.path() == "/hello")
   {
+    // formatted once, not copied
+    static const char kHelloHeaders[] = "Content-Type: text/plain\r\n"
+                                        "Server: Muduo\r\n";
     resp->setStatusCode(HttpResponse::k200Ok);
     resp->setStatusMessage("OK");
-    resp->setContentType("text/plain");
-    resp->addHeader("Server", "Muduo");
+    resp->setCachedHeaders(kHelloHeaders);
     resp->setBody("hello, world!\n");
   }
   else
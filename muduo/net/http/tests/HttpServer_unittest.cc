@@ -0,0 +1,299 @@
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponder.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/http/HttpServer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+
+//#define BOOST_TEST_MODULE HttpServerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using muduo::string;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::EventLoop;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponderPtr;
+using muduo::net::HttpResponse;
+using muduo::net::HttpServer;
+using muduo::net::InetAddress;
+using muduo::net::TcpClient;
+using muduo::net::TcpConnectionPtr;
+
+namespace
+{
+
+// replies with the path and body of the request
+void onEcho(const HttpRequest& req, HttpResponse* resp)
+{
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setStatusMessage("OK");
+  resp->setBody(req.path() + req.body());
+}
+
+// a compressible page
+void onText(const HttpRequest&, HttpResponse* resp)
+{
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setStatusMessage("OK");
+  resp->setContentType("text/plain");
+  resp->setBody(string(1000, 'a'));
+}
+
+// keeps the responder, the test calls done()
+void onAsync(std::vector<HttpResponderPtr>* responders,
+             std::vector<HttpRequest::Version>* versions,
+             const HttpRequest& req,
+             const HttpResponderPtr& responder)
+{
+  versions->push_back(req.getVersion());
+  responder->response()->setStatusCode(HttpResponse::k200Ok);
+  responder->response()->setStatusMessage("OK");
+  responder->response()->setBody(req.path() + req.body());
+  responders->push_back(responder);
+}
+
+string get(const char* path)
+{
+  return string("GET ") + path + " HTTP/1.1\r\nHost: test\r\n\r\n";
+}
+
+// A raw client, so that requests can be written in any pieces.
+struct Fixture
+{
+  Fixture()
+    : server(&loop, InetAddress(18031), "HttpServerTest"),
+      client(&loop, InetAddress("127.0.0.1", 18031), "HttpServerTestClient"),
+      expected(0)
+  {
+    server.setHttpCallback(onEcho);
+    client.setConnectionCallback(boost::bind(&Fixture::onConnection, this, _1));
+    client.setMessageCallback(boost::bind(&Fixture::onMessage, this, _1, _2, _3));
+    loop.runAfter(5.0, boost::bind(&EventLoop::quit, &loop));
+  }
+
+  void useAsync()
+  {
+    server.setHttpAsyncCallback(boost::bind(onAsync, &responders, &versions, _1, _2));
+  }
+
+  // sends initial once connected, returns when expected responses arrived
+  void run(const string& initial, int numResponses)
+  {
+    toSend = initial;
+    expected = numResponses;
+    server.start();
+    client.connect();
+    loop.loop();
+  }
+
+  void send(const string& data)
+  {
+    client.connection()->send(data);
+  }
+
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->send(toSend);
+    }
+  }
+
+  // "status body" of each complete response, bodies by Content-Length
+  void onMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+  {
+    const char* end;
+    while ((end = static_cast<const char*>(
+                memmem(buf->peek(), buf->readableBytes(), "\r\n\r\n", 4))) != NULL)
+    {
+      string head(buf->peek(), end);
+      size_t length = 0;
+      size_t pos = head.find("Content-Length: ");
+      if (pos != string::npos)
+      {
+        length = atoi(head.c_str() + pos + strlen("Content-Length: "));
+      }
+      const char* body = end + 4;
+      if (static_cast<size_t>(buf->peek() + buf->readableBytes() - body) < length)
+      {
+        break;
+      }
+      responses.push_back(head.substr(9, 3) + " " + string(body, length));
+      buf->retrieveUntil(body + length);
+      if (onResponse)
+      {
+        onResponse();
+      }
+    }
+    if (static_cast<int>(responses.size()) >= expected)
+    {
+      loop.quit();
+    }
+  }
+
+  EventLoop loop;
+  HttpServer server;
+  TcpClient client;
+  string toSend;
+  int expected;
+  std::vector<string> responses;
+  boost::function<void ()> onResponse;
+  std::vector<HttpResponderPtr> responders;
+  std::vector<HttpRequest::Version> versions;
+};
+
+}
+
+BOOST_FIXTURE_TEST_CASE(testPipelined, Fixture)
+{
+  // three whole requests and half of the fourth in one write
+  string fourth = "POST /d HTTP/1.1\r\nContent-Length: 4\r\n\r\nbody";
+  string initial = get("/a") + get("/b") + get("/c") + fourth.substr(0, 20);
+  loop.runAfter(0.1, boost::bind(&Fixture::send, this, fourth.substr(20)));
+  run(initial, 4);
+
+  BOOST_REQUIRE_EQUAL(responses.size(), 4u);
+  BOOST_CHECK_EQUAL(responses[0], "200 /a");
+  BOOST_CHECK_EQUAL(responses[1], "200 /b");
+  BOOST_CHECK_EQUAL(responses[2], "200 /c");
+  BOOST_CHECK_EQUAL(responses[3], "200 /dbody");
+}
+
+BOOST_FIXTURE_TEST_CASE(testCompressLowerCase, Fixture)
+{
+  server.setHttpCallback(onText);
+  server.enableCompression(1);
+  // header fields are case-insensitive
+  run("GET /a HTTP/1.1\r\naccept-encoding: gzip\r\n\r\n", 1);
+
+  BOOST_REQUIRE_EQUAL(responses.size(), 1u);
+  BOOST_CHECK(responses[0].size() < 100);
+  BOOST_CHECK_EQUAL(responses[0].substr(4, 2), string("\x1f\x8b"));
+}
+
+void finishInReverse(Fixture* f, size_t numRequests)
+{
+  BOOST_REQUIRE_EQUAL(f->responders.size(), numRequests);
+  for (size_t i = numRequests; i > 0; --i)
+  {
+    f->responders[i-1]->done();
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(testAsyncOrder, Fixture)
+{
+  useAsync();
+  // finished last to first, written first to last
+  loop.runAfter(0.1, boost::bind(finishInReverse, this, 3));
+  run(get("/a") + get("/b") + get("/c"), 3);
+
+  BOOST_REQUIRE_EQUAL(responses.size(), 3u);
+  BOOST_CHECK_EQUAL(responses[0], "200 /a");
+  BOOST_CHECK_EQUAL(responses[1], "200 /b");
+  BOOST_CHECK_EQUAL(responses[2], "200 /c");
+}
+
+BOOST_FIXTURE_TEST_CASE(testAsyncVersion, Fixture)
+{
+  useAsync();
+  // the request handed over to the responder keeps its version
+  loop.runAfter(0.1, boost::bind(finishInReverse, this, 2));
+  run("GET /a HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n" + get("/b"), 2);
+
+  BOOST_REQUIRE_EQUAL(responses.size(), 2u);
+  BOOST_REQUIRE_EQUAL(versions.size(), 2u);
+  BOOST_CHECK_EQUAL(versions[0], HttpRequest::kHttp10);
+  BOOST_CHECK_EQUAL(versions[1], HttpRequest::kHttp11);
+}
+
+void finishFirst(Fixture* f, size_t expectedStarted, std::vector<size_t>* started)
+{
+  if (started)
+  {
+    started->push_back(f->responders.size());
+  }
+  BOOST_CHECK_EQUAL(f->responders.size(), expectedStarted);
+  // the oldest unfinished one
+  for (size_t i = 0; i < f->responders.size(); ++i)
+  {
+    if (!f->responders[i]->isDone())
+    {
+      f->responders[i]->done();
+      break;
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(testMaxInFlight, Fixture)
+{
+  useAsync();
+  server.setMaxInFlight(2);
+  std::vector<size_t> started;
+  // each finished request lets one more start
+  loop.runAfter(0.1, boost::bind(finishFirst, this, 2, &started));
+  loop.runAfter(0.2, boost::bind(finishFirst, this, 3, &started));
+  loop.runAfter(0.3, boost::bind(finishFirst, this, 4, &started));
+  loop.runAfter(0.4, boost::bind(finishFirst, this, 4, &started));
+  run(get("/a") + get("/b") + get("/c") + get("/d"), 4);
+
+  BOOST_CHECK_EQUAL(started.size(), 4u);
+  BOOST_REQUIRE_EQUAL(responses.size(), 4u);
+  BOOST_CHECK_EQUAL(responses[0], "200 /a");
+  BOOST_CHECK_EQUAL(responses[3], "200 /d");
+}
+
+void sendBodyAfterContinue(Fixture* f)
+{
+  if (f->responses.back() == "100 ")
+  {
+    f->send("body");
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(testContinueAfterPending, Fixture)
+{
+  useAsync();
+  onResponse = boost::bind(sendBodyAfterContinue, this);
+  // the second request waits for 100 Continue behind the first response,
+  // which is finished after its headers were parsed
+  string expecting = "POST /b HTTP/1.1\r\nExpect: 100-continue\r\n"
+                     "Content-Length: 4\r\n\r\n";
+  std::vector<size_t>* noStarted = NULL;
+  loop.runAfter(0.1, boost::bind(finishFirst, this, 1, noStarted));
+  loop.runAfter(0.3, boost::bind(finishFirst, this, 2, noStarted));
+  run(get("/a") + expecting, 3);
+
+  BOOST_REQUIRE_EQUAL(responses.size(), 3u);
+  BOOST_CHECK_EQUAL(responses[0], "200 /a");
+  BOOST_CHECK_EQUAL(responses[1], "100 ");
+  BOOST_CHECK_EQUAL(responses[2], "200 /bbody");
+}
+
+BOOST_AUTO_TEST_CASE(testResponseHeaders)
+{
+  HttpResponse resp(true);
+  resp.setStatusCode(HttpResponse::k200Ok);
+  resp.setStatusMessage("OK");
+  resp.setContentType("text/plain");
+  resp.appendHeader("Set-Cookie", "a=1");
+  resp.appendHeader("Set-Cookie", "b=2");
+  // set twice, sent once with the last value, in its first place
+  resp.setContentType("text/html");
+  resp.addHeader("content-type", "image/png");
+  BOOST_CHECK_EQUAL(resp.headers(),
+                    "Content-Type: image/png\r\nSet-Cookie: a=1\r\nSet-Cookie: b=2\r\n");
+  BOOST_CHECK_EQUAL(resp.getHeader("Content-Type").as_string(), string("image/png"));
+
+  Buffer output;
+  resp.appendToBuffer(&output);
+  BOOST_CHECK(output.retrieveAllAsString().find("HTTP/1.1 200 OK\r\n") == 0);
+}
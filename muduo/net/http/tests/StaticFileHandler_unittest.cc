@@ -0,0 +1,190 @@
+#include <muduo/net/http/StaticFileHandler.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/Buffer.h>
+
+//#define BOOST_TEST_MODULE StaticFileHandlerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponse;
+using muduo::net::StaticFileHandler;
+
+namespace
+{
+
+struct Fixture
+{
+  Fixture()
+  {
+    char dir[] = "/tmp/staticfileXXXXXX";
+    BOOST_REQUIRE(::mkdtemp(dir) != NULL);
+    root = dir;
+    FILE* fp = ::fopen((root + "/hello.txt").c_str(), "w");
+    BOOST_REQUIRE(fp != NULL);
+    ::fputs("hello, world!\n", fp);
+    ::fclose(fp);
+  }
+
+  ~Fixture()
+  {
+    ::unlink((root + "/hello.txt").c_str());
+    ::rmdir(root.c_str());
+  }
+
+  string root;
+};
+
+HttpRequest makeRequest(const char* method, const char* path)
+{
+  HttpRequest req;
+  req.setMethod(method, method + strlen(method));
+  req.setPath(path, path + strlen(path));
+  return req;
+}
+
+void addHeader(HttpRequest* req, const char* line)
+{
+  req->addHeader(line, strchr(line, ':'), line + strlen(line));
+}
+
+string head(const HttpResponse& response)
+{
+  Buffer output;
+  response.appendToBuffer(&output);
+  return output.retrieveAllAsString();
+}
+
+}
+
+BOOST_FIXTURE_TEST_CASE(testGet, Fixture)
+{
+  StaticFileHandler handler(root);
+  HttpResponse response(false);
+  BOOST_CHECK(handler.handle(makeRequest("GET", "/hello.txt?x=1"), &response));
+  BOOST_CHECK(response.hasBodyFile());
+  BOOST_CHECK_EQUAL(response.bodyFileOffset(), 0);
+  BOOST_CHECK_EQUAL(response.bodyFileLength(), 14);
+
+  string h = head(response);
+  BOOST_CHECK_EQUAL(h.find("HTTP/1.1 200 OK\r\n"), 0);
+  BOOST_CHECK(h.find("Content-Length: 14\r\n") != string::npos);
+  BOOST_CHECK(h.find("Content-Type: text/plain\r\n") != string::npos);
+  BOOST_CHECK(h.find("Last-Modified: ") != string::npos);
+
+  char buf[32] = "";
+  BOOST_CHECK_EQUAL(::pread(response.bodyFileFd(), buf, sizeof buf, 0), 14);
+  BOOST_CHECK_EQUAL(string(buf), string("hello, world!\n"));
+
+  // cached
+  HttpResponse again(false);
+  BOOST_CHECK(handler.handle(makeRequest("HEAD", "/hello%2etxt"), &again));
+  BOOST_CHECK_EQUAL(again.bodyFileFd(), response.bodyFileFd());
+  BOOST_CHECK(again.headOnly());
+  BOOST_CHECK_EQUAL(handler.numOpenFiles(), 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(testNotHandled, Fixture)
+{
+  StaticFileHandler handler(root);
+  HttpResponse response(false);
+  BOOST_CHECK(!handler.handle(makeRequest("GET", "/nosuchfile"), &response));
+  BOOST_CHECK(!handler.handle(makeRequest("GET", "/"), &response));
+  BOOST_CHECK(!handler.handle(makeRequest("POST", "/hello.txt"), &response));
+  BOOST_CHECK(!handler.handle(makeRequest("GET", "/../etc/passwd"), &response));
+  BOOST_CHECK(!handler.handle(makeRequest("GET", "/%2e%2e/etc/passwd"), &response));
+  BOOST_CHECK(!response.hasBodyFile());
+}
+
+BOOST_FIXTURE_TEST_CASE(testRange, Fixture)
+{
+  StaticFileHandler handler(root);
+  {
+  HttpRequest req(makeRequest("GET", "/hello.txt"));
+  addHeader(&req, "Range: bytes=7-11");
+  HttpResponse response(false);
+  BOOST_CHECK(handler.handle(req, &response));
+  string h = head(response);
+  BOOST_CHECK_EQUAL(h.find("HTTP/1.1 206 Partial Content\r\n"), 0);
+  BOOST_CHECK(h.find("Content-Range: bytes 7-11/14\r\n") != string::npos);
+  BOOST_CHECK_EQUAL(response.bodyFileOffset(), 7);
+  BOOST_CHECK_EQUAL(response.bodyFileLength(), 5);
+  }
+
+  {
+  HttpRequest req(makeRequest("GET", "/hello.txt"));
+  addHeader(&req, "Range: bytes=-6");
+  HttpResponse response(false);
+  BOOST_CHECK(handler.handle(req, &response));
+  BOOST_CHECK_EQUAL(response.bodyFileOffset(), 8);
+  BOOST_CHECK_EQUAL(response.bodyFileLength(), 6);
+  }
+
+  {
+  HttpRequest req(makeRequest("GET", "/hello.txt"));
+  addHeader(&req, "Range: bytes=10-");
+  HttpResponse response(false);
+  BOOST_CHECK(handler.handle(req, &response));
+  BOOST_CHECK_EQUAL(response.bodyFileOffset(), 10);
+  BOOST_CHECK_EQUAL(response.bodyFileLength(), 4);
+  }
+
+  {
+  HttpRequest req(makeRequest("GET", "/hello.txt"));
+  addHeader(&req, "Range: bytes=14-");
+  HttpResponse response(false);
+  BOOST_CHECK(handler.handle(req, &response));
+  BOOST_CHECK(!response.hasBodyFile());
+  string h = head(response);
+  BOOST_CHECK_EQUAL(h.find("HTTP/1.1 416 "), 0);
+  BOOST_CHECK(h.find("Content-Range: bytes */14\r\n") != string::npos);
+  }
+
+  {
+  // multiple ranges are not supported
+  HttpRequest req(makeRequest("GET", "/hello.txt"));
+  addHeader(&req, "Range: bytes=0-1,3-4");
+  HttpResponse response(false);
+  BOOST_CHECK(handler.handle(req, &response));
+  BOOST_CHECK_EQUAL(head(response).find("HTTP/1.1 200 OK\r\n"), 0);
+  BOOST_CHECK_EQUAL(response.bodyFileLength(), 14);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(testIfModifiedSince, Fixture)
+{
+  StaticFileHandler handler(root);
+  HttpResponse response(false);
+  BOOST_CHECK(handler.handle(makeRequest("GET", "/hello.txt"), &response));
+  string h = head(response);
+  size_t start = h.find("Last-Modified: ") + 15;
+  string lastModified = h.substr(start, h.find("\r\n", start) - start);
+
+  {
+  HttpRequest req(makeRequest("GET", "/hello.txt"));
+  string line = "If-Modified-Since: " + lastModified;
+  addHeader(&req, line.c_str());
+  HttpResponse notModified(false);
+  BOOST_CHECK(handler.handle(req, &notModified));
+  BOOST_CHECK(notModified.headOnly());
+  BOOST_CHECK_EQUAL(head(notModified).find("HTTP/1.1 304 Not Modified\r\n"), 0);
+  }
+
+  {
+  HttpRequest req(makeRequest("GET", "/hello.txt"));
+  addHeader(&req, "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT");
+  HttpResponse modified(false);
+  BOOST_CHECK(handler.handle(req, &modified));
+  BOOST_CHECK(!modified.headOnly());
+  BOOST_CHECK_EQUAL(head(modified).find("HTTP/1.1 200 OK\r\n"), 0);
+  }
+}
@@ -0,0 +1,289 @@
+#include <muduo/net/http/WebSocket.h>
+#include <muduo/net/http/HttpServer.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+
+//#define BOOST_TEST_MODULE WebSocketTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+
+#include <string.h>
+
+using muduo::string;
+using muduo::StringPiece;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::EventLoop;
+using muduo::net::HttpServer;
+using muduo::net::InetAddress;
+using muduo::net::TcpClient;
+using muduo::net::TcpConnectionPtr;
+using muduo::net::WebSocket;
+using muduo::net::WebSocketPtr;
+
+namespace
+{
+
+const char kKey[4] = { 0x12, 0x34, 0x56, 0x78 };
+
+// what a browser sends, masked
+void appendClientFrame(Buffer* output, const string& payload, int opcode, bool fin = true)
+{
+  Buffer frame;
+  WebSocket::appendFrame(&frame, payload, static_cast<WebSocket::Opcode>(opcode), fin);
+  const char* p = frame.peek();
+  size_t headLen = frame.readableBytes() - payload.size();
+  char head[10];
+  memcpy(head, p, headLen);
+  head[1] = static_cast<char>(head[1] | 0x80);
+  output->append(head, headLen);
+  output->append(kKey, 4);
+  string masked(payload);
+  for (size_t i = 0; i < masked.size(); ++i)
+  {
+    masked[i] = static_cast<char>(masked[i] ^ kKey[i % 4]);
+  }
+  output->append(masked);
+}
+
+// returns false if buf has no whole frame
+bool takeServerFrame(Buffer* buf, int* opcode, string* payload)
+{
+  if (buf->readableBytes() < 2)
+    return false;
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(buf->peek());
+  size_t len = p[1] & 0x7F;
+  size_t headLen = 2;
+  if (len == 126)
+  {
+    len = (p[2] << 8) | p[3];
+    headLen = 4;
+  }
+  else if (len == 127)
+  {
+    len = 0;
+    for (int i = 2; i < 10; ++i)
+      len = (len << 8) | p[i];
+    headLen = 10;
+  }
+  if (buf->readableBytes() < headLen + len)
+    return false;
+  *opcode = p[0] & 0x0F;
+  payload->assign(buf->peek() + headLen, len);
+  buf->retrieve(headLen + len);
+  return true;
+}
+
+void onEcho(const WebSocketPtr& socket, const StringPiece& message, WebSocket::Opcode opcode)
+{
+  socket->send(message, opcode);
+}
+
+struct Fixture
+{
+  Fixture()
+    : server(&loop, InetAddress(18031), "WebSocketTest"),
+      client(&loop, InetAddress("127.0.0.1", 18031), "WebSocketTestClient"),
+      upgraded(false),
+      closed(0)
+  {
+    server.setWebSocketMessageCallback(onEcho);
+    server.setWebSocketCloseCallback(boost::bind(&Fixture::onClose, this, _1));
+    server.start();
+    client.setConnectionCallback(boost::bind(&Fixture::onConnection, this, _1));
+    client.setMessageCallback(boost::bind(&Fixture::onMessage, this, _1, _2, _3));
+    loop.runAfter(5.0, boost::bind(&EventLoop::quit, &loop));
+  }
+
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->send("GET /chat?room=1 HTTP/1.1\r\n"
+                 "Host: localhost\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Connection: keep-alive, Upgrade\r\n"
+                 "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                 "Sec-WebSocket-Version: 13\r\n\r\n");
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    if (!upgraded)
+    {
+      const char* end = static_cast<const char*>(memmem(buf->peek(), buf->readableBytes(), "\r\n\r\n", 4));
+      if (end == NULL)
+        return;
+      head.assign(buf->peek(), end + 4);
+      buf->retrieveUntil(end + 4);
+      upgraded = true;
+      conn->send(&frames);
+    }
+    int opcode = 0;
+    string payload;
+    while (takeServerFrame(buf, &opcode, &payload))
+    {
+      received.push_back(std::make_pair(opcode, payload));
+    }
+  }
+
+  // sends frames once upgraded, returns when the server is done
+  void run()
+  {
+    client.connect();
+    loop.loop();
+  }
+
+  void onClose(const WebSocketPtr& socket)
+  {
+    closedPath = socket->path();
+    ++closed;
+    // after the client has closed its end
+    loop.quit();
+  }
+
+  EventLoop loop;
+  HttpServer server;
+  TcpClient client;
+  Buffer frames;  // of the client
+  bool upgraded;
+  string head;
+  std::vector<std::pair<int, string> > received;
+  int closed;
+  string closedPath;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(testAcceptKey)
+{
+  // RFC 6455 section 1.3
+  BOOST_CHECK_EQUAL(WebSocket::acceptKey("dGhlIHNhbXBsZSBub25jZQ=="),
+                    string("s3pPLMBiTxaQ9kYGzzhZRbK+xOo="));
+}
+
+BOOST_AUTO_TEST_CASE(testMask)
+{
+  for (size_t len = 0; len < 100; ++len)
+  {
+    string data;
+    for (size_t i = 0; i < len; ++i)
+    {
+      data += static_cast<char>(i * 7);
+    }
+    string masked(data);
+    WebSocket::mask(&*masked.begin(), len, kKey);
+    bool same = true;
+    for (size_t i = 0; i < len; ++i)
+    {
+      same = same && masked[i] == static_cast<char>(data[i] ^ kKey[i % 4]);
+    }
+    BOOST_CHECK(same);
+    WebSocket::mask(&*masked.begin(), len, kKey);
+    BOOST_CHECK(masked == data);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testFrame)
+{
+  BOOST_CHECK_EQUAL(WebSocket::makeFrame(string(5, 'a'))->size(), 2u + 5);
+  BOOST_CHECK_EQUAL(WebSocket::makeFrame(string(200, 'a'))->size(), 4u + 200);
+  BOOST_CHECK_EQUAL(WebSocket::makeFrame(string(70000, 'a'))->size(), 10u + 70000);
+
+  WebSocket::FramePtr frame(WebSocket::makeFrame("hi", WebSocket::kBinary));
+  BOOST_CHECK_EQUAL(*frame, string("\x82\x02hi", 4));
+}
+
+BOOST_FIXTURE_TEST_CASE(testEcho, Fixture)
+{
+  appendClientFrame(&frames, "hello", WebSocket::kText);
+  appendClientFrame(&frames, "frag", WebSocket::kText, false);
+  appendClientFrame(&frames, "ping", WebSocket::kPing);
+  appendClientFrame(&frames, "mented", WebSocket::kContinuation);
+  appendClientFrame(&frames, string(70000, 'x'), WebSocket::kBinary);
+  appendClientFrame(&frames, string("\x03\xe8", 2), WebSocket::kClose);
+  run();
+
+  BOOST_CHECK(head.find("HTTP/1.1 101 ") == 0);
+  BOOST_CHECK(head.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != string::npos);
+  BOOST_REQUIRE_EQUAL(received.size(), 5u);
+  BOOST_CHECK_EQUAL(received[0].first, WebSocket::kText);
+  BOOST_CHECK_EQUAL(received[0].second, string("hello"));
+  // the ping is answered in the middle of the fragmented message
+  BOOST_CHECK_EQUAL(received[1].first, WebSocket::kPong);
+  BOOST_CHECK_EQUAL(received[1].second, string("ping"));
+  BOOST_CHECK_EQUAL(received[2].first, WebSocket::kText);
+  BOOST_CHECK_EQUAL(received[2].second, string("fragmented"));
+  BOOST_CHECK_EQUAL(received[3].first, WebSocket::kBinary);
+  BOOST_CHECK(received[3].second == string(70000, 'x'));
+  BOOST_CHECK_EQUAL(received[4].first, WebSocket::kClose);
+  BOOST_CHECK_EQUAL(received[4].second, string("\x03\xe8", 2));
+  BOOST_CHECK_EQUAL(closed, 1);
+  BOOST_CHECK_EQUAL(closedPath, string("/chat?room=1"));
+}
+
+BOOST_FIXTURE_TEST_CASE(testUtf8, Fixture)
+{
+  // "κόσμε" split in the middle of a character is fine as a whole
+  appendClientFrame(&frames, "\xce\xba\xe1\xbd", WebSocket::kText, false);
+  appendClientFrame(&frames, "\xb9\xcf\x83\xce\xbc\xce\xb5", WebSocket::kContinuation);
+  // a surrogate
+  appendClientFrame(&frames, "\xed\xa0\x80", WebSocket::kText);
+  run();
+
+  BOOST_REQUIRE_EQUAL(received.size(), 2u);
+  BOOST_CHECK_EQUAL(received[0].second, string("\xce\xba\xe1\xbd\xb9\xcf\x83\xce\xbc\xce\xb5"));
+  BOOST_CHECK_EQUAL(received[1].first, WebSocket::kClose);
+  BOOST_CHECK_EQUAL(received[1].second, string("\x03\xef", 2));  // 1007
+  BOOST_CHECK_EQUAL(closed, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(testInvalidUtf8Fragments, Fixture)
+{
+  // an overlong '/', found once the message is whole
+  appendClientFrame(&frames, "ab\xc0", WebSocket::kText, false);
+  appendClientFrame(&frames, "\xaf", WebSocket::kContinuation);
+  run();
+
+  BOOST_REQUIRE_EQUAL(received.size(), 1u);
+  BOOST_CHECK_EQUAL(received[0].first, WebSocket::kClose);
+  BOOST_CHECK_EQUAL(received[0].second, string("\x03\xef", 2));
+}
+
+namespace
+{
+
+// the status code the server answers a close frame of payload with
+string closeReply(const string& payload)
+{
+  Fixture f;
+  appendClientFrame(&f.frames, payload, WebSocket::kClose);
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.received.size(), 1u);
+  BOOST_CHECK_EQUAL(f.received[0].first, WebSocket::kClose);
+  BOOST_CHECK_EQUAL(f.closed, 1);
+  return f.received[0].second;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testCloseCodes)
+{
+  const string kNormal("\x03\xe8", 2);  // 1000
+  const string kProtocolError("\x03\xea", 2);  // 1002
+  BOOST_CHECK_EQUAL(closeReply(""), kNormal);
+  BOOST_CHECK_EQUAL(closeReply("\x03"), kProtocolError);
+  BOOST_CHECK_EQUAL(closeReply("\x0b\xb8" "bye"), string("\x0b\xb8", 2));  // 3000
+  BOOST_CHECK_EQUAL(closeReply(string("\x03\xe8\xff", 3)), string("\x03\xef", 2));
+  const char* invalid[] = { "\x03\xe7", "\x03\xec", "\x03\xed", "\x03\xee", "\x03\xf7",
+                            "\x07\xd0", "\x13\x88" };  // 999 1004 1005 1006 1015 2000 5000
+  for (size_t i = 0; i < sizeof invalid / sizeof invalid[0]; ++i)
+  {
+    BOOST_CHECK_EQUAL(closeReply(invalid[i]), kProtocolError);
+  }
+}
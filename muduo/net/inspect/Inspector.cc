@@ -9,6 +9,7 @@
 
 #include <muduo/net/inspect/Inspector.h>
 
+#include <muduo/base/Logging.h>
 #include <muduo/base/Thread.h>
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/http/HttpRequest.h>
@@ -53,6 +54,25 @@ std::vector<string> split(const string& str)
   return result;
 }
 
+void runCommand(const Inspector::Callback& cb,
+                const HttpRequest& req,
+                const HttpRouter::Params& params,
+                HttpResponse* resp)
+{
+  if (cb)
+  {
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setStatusMessage("OK");
+    resp->setContentType("text/plain");
+    resp->setBody(cb(req.method(), split(params.get("args").as_string())));
+  }
+  else
+  {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setStatusMessage("Not Found");
+  }
+}
+
 }
 
 Inspector::Inspector(EventLoop* loop,
@@ -65,6 +85,7 @@ Inspector::Inspector(EventLoop* loop,
   assert(g_globalInspector == 0);
   g_globalInspector = this;
   server_.setHttpCallback(boost::bind(&Inspector::onRequest, this, _1, _2));
+  commands_.add(HttpRequest::kInvalid, "/", boost::bind(&Inspector::onHelp, this, _1, _2, _3));
   processInspector_->registerCommands(this);
   loop->runAfter(0, boost::bind(&Inspector::start, this)); // little race condition
 }
@@ -80,8 +101,19 @@ void Inspector::add(const string& module,
                     const Callback& cb,
                     const string& help)
 {
+  // would be taken as route parameters
+  if (module.find_first_of(":*") != string::npos
+      || command.find_first_of(":*") != string::npos)
+  {
+    LOG_ERROR << "Inspector::add - bad name /" << module << "/" << command;
+    return;
+  }
   MutexLockGuard lock(mutex_);
-  commands_[module][command] = cb;
+  string path = "/" + module + "/" + command;
+  HttpRouter::Handler handler = boost::bind(runCommand, cb, _1, _2, _3);
+  // adding a command again replaces it
+  commands_.add(HttpRequest::kInvalid, path, handler, true);
+  commands_.add(HttpRequest::kInvalid, path + "/*args", handler, true);
   helps_[module][command] = help;
 }
 
@@ -92,79 +124,57 @@ void Inspector::start()
 
 void Inspector::onRequest(const HttpRequest& req, HttpResponse* resp)
 {
-  if (req.path() == "/")
+  const string& target = req.path();
+  size_t question = target.find('?');
+  StringPiece path(target.data(),
+                   static_cast<int>(question == string::npos ? target.size() : question));
+  HttpRouter::Params params;
+  HttpRouter::Handler handler;
   {
-    string result;
-    MutexLockGuard lock(mutex_);
-    for (std::map<string, HelpList>::const_iterator helpListI = helps_.begin();
-         helpListI != helps_.end();
-         ++helpListI)
-    {
-      const HelpList& list = helpListI->second;
-      for (HelpList::const_iterator it = list.begin();
-           it != list.end();
-           ++it)
-      {
-        result += "/";
-        result += helpListI->first;
-        result += "/";
-        result += it->first;
-        result += "\t";
-        result += it->second;
-        result += "\n";
-      }
-    }
-    resp->setStatusCode(HttpResponse::k200Ok);
-    resp->setStatusMessage("OK");
-    resp->setContentType("text/plain");
-    resp->setBody(result);
+  MutexLockGuard lock(mutex_);
+  const HttpRouter::Handler* found = commands_.match(req.method(), path, &params);
+  if (found)
+  {
+    handler = *found;
+  }
+  }
+
+  if (handler)
+  {
+    handler(req, params, resp);
   }
   else
   {
-    std::vector<string> result = split(req.path());
-    // boost::split(result, req.path(), boost::is_any_of("/"));
-    //std::copy(result.begin(), result.end(), std::ostream_iterator<string>(std::cout, ", "));
-    //std::cout << "\n";
-    bool ok = false;
-    if (result.size() == 0)
-    {
-    }
-    else if (result.size() == 1)
-    {
-      string module = result[0];
-    }
-    else
-    {
-      string module = result[0];
-      std::map<string, CommandList>::const_iterator commListI = commands_.find(module);
-      if (commListI != commands_.end())
-      {
-        string command = result[1];
-        const CommandList& commList = commListI->second;
-        CommandList::const_iterator it = commList.find(command);
-        if (it != commList.end())
-        {
-          ArgList args(result.begin()+2, result.end());
-          if (it->second)
-          {
-            resp->setStatusCode(HttpResponse::k200Ok);
-            resp->setStatusMessage("OK");
-            resp->setContentType("text/plain");
-            const Callback& cb = it->second;
-            resp->setBody(cb(req.method(), args));
-            ok = true;
-          }
-        }
-      }
-
-    }
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setStatusMessage("Not Found");
+  }
+  //resp->setCloseConnection(true);
+}
 
-    if (!ok)
+void Inspector::onHelp(const HttpRequest&, const HttpRouter::Params&, HttpResponse* resp)
+{
+  string result;
+  MutexLockGuard lock(mutex_);
+  for (std::map<string, HelpList>::const_iterator helpListI = helps_.begin();
+       helpListI != helps_.end();
+       ++helpListI)
+  {
+    const HelpList& list = helpListI->second;
+    for (HelpList::const_iterator it = list.begin();
+         it != list.end();
+         ++it)
     {
-      resp->setStatusCode(HttpResponse::k404NotFound);
-      resp->setStatusMessage("Not Found");
+      result += "/";
+      result += helpListI->first;
+      result += "/";
+      result += it->first;
+      result += "\t";
+      result += it->second;
+      result += "\n";
     }
-    //resp->setCloseConnection(true);
   }
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setStatusMessage("OK");
+  resp->setContentType("text/plain");
+  resp->setBody(result);
 }
-
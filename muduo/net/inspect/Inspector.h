@@ -13,6 +13,7 @@
 
 #include <muduo/base/Mutex.h>
 #include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpRouter.h>
 #include <muduo/net/http/HttpServer.h>
 
 #include <map>
@@ -44,16 +45,16 @@ class Inspector : boost::noncopyable
            const string& help);
 
  private:
-  typedef std::map<string, Callback> CommandList;
   typedef std::map<string, string> HelpList;
 
   void start();
   void onRequest(const HttpRequest& req, HttpResponse* resp);
+  void onHelp(const HttpRequest& req, const HttpRouter::Params&, HttpResponse* resp);
 
   HttpServer server_;
   boost::scoped_ptr<ProcessInspector> processInspector_;
   MutexLock mutex_;
-  std::map<string, CommandList> commands_;
+  HttpRouter commands_;
   std::map<string, HelpList> helps_;
 };
 
@@ -0,0 +1,358 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/protorpc/BalancedRpcChannel.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/protorpc/RpcChannel.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+class BalancedRpcChannel::Endpoint : boost::noncopyable
+{
+ public:
+  Endpoint(EventLoop* loop, const InetAddress& serverAddr, const string& name)
+    : serverAddr_(serverAddr),
+      channel_(new muduo::net::RpcChannel),
+      client_(loop, serverAddr, name),
+      calls_(0),
+      failures_(0),
+      totalLatency_(0),
+      maxLatency_(0)
+  {
+    client_.setConnectionCallback(
+        boost::bind(&Endpoint::onConnection, this, _1));
+    client_.setMessageCallback(
+        boost::bind(&muduo::net::RpcChannel::onMessage, get_pointer(channel_), _1, _2, _3));
+    client_.enableRetry();
+  }
+
+  muduo::net::RpcChannel* channel() { return get_pointer(channel_); }
+  TcpClient* client() { return &client_; }
+
+  bool connected() const { return connected_.get() != 0; }
+  int outstandingCalls() const { return outstandingCalls_.get(); }
+
+  void beginCall() { outstandingCalls_.increment(); }
+
+  void endCall(double latency, bool failed)
+  {
+    outstandingCalls_.decrement();
+    MutexLockGuard lock(mutex_);
+    ++calls_;
+    if (failed)
+    {
+      ++failures_;
+    }
+    totalLatency_ += latency;
+    if (latency > maxLatency_)
+    {
+      maxLatency_ = latency;
+    }
+  }
+
+  EndpointStats stats() const
+  {
+    EndpointStats s = { serverAddr_, connected(), outstandingCalls(), 0, 0, 0, 0 };
+    MutexLockGuard lock(mutex_);
+    s.calls = calls_;
+    s.failures = failures_;
+    s.meanLatency = calls_ > 0 ? totalLatency_ / static_cast<double>(calls_) : 0;
+    s.maxLatency = maxLatency_;
+    return s;
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    LOG_INFO << "BalancedRpcChannel - " << serverAddr_.toIpPort() << " is "
+             << (conn->connected() ? "UP" : "DOWN");
+    if (conn->connected())
+    {
+      conn->setTcpNoDelay(true);
+      channel_->setConnection(conn);
+      connected_.getAndSet(1);
+    }
+    else
+    {
+      connected_.getAndSet(0);
+      channel_->failOutstandingCalls();
+    }
+  }
+
+  const InetAddress serverAddr_;
+  // outlives client_, which calls into it
+  RpcChannelPtr channel_;
+  TcpClient client_;
+  mutable AtomicInt32 connected_;
+  mutable AtomicInt32 outstandingCalls_;
+
+  mutable MutexLock mutex_;
+  int64_t calls_;
+  int64_t failures_;
+  double totalLatency_;
+  double maxLatency_;
+};
+
+// One call to BalancedRpcChannel, the done closure of each attempt.
+class BalancedRpcChannel::Call : public ::google::protobuf::Closure
+{
+ public:
+  Call(BalancedRpcChannel* owner,
+       const ::google::protobuf::MethodDescriptor* method,
+       ::google::protobuf::RpcController* controller,
+       const ::google::protobuf::Message* request,
+       ::google::protobuf::Message* response,
+       ::google::protobuf::Closure* done,
+       bool idempotent)
+    : owner_(owner),
+      method_(method),
+      userController_(controller),
+      request_(request),
+      response_(response),
+      done_(done),
+      retriable_(idempotent),
+      endpoint_(NULL),
+      attemptResponse_(NULL)
+  {
+    RpcController* userController = dynamic_cast<RpcController*>(controller);
+    if (userController && userController->streamCallback())
+    {
+      // responses may have been delivered before the connection is lost
+      retriable_ = false;
+    }
+    if (retriable_)
+    {
+      // callers may free request once CallMethod() returns
+      requestCopy_.reset(request->New());
+      requestCopy_->CopyFrom(*request);
+      request_ = get_pointer(requestCopy_);
+    }
+  }
+
+  // called by RpcChannel, which deletes the response of the attempt after
+  virtual void Run()
+  {
+    owner_->onCallDone(this);
+  }
+
+  void start(Endpoint* endpoint)
+  {
+    endpoint_ = endpoint;
+    controller_.Reset();
+    RpcController* userController = dynamic_cast<RpcController*>(userController_);
+    if (userController)
+    {
+      controller_.setTimeout(userController->timeout());
+      controller_.setStreamCallback(userController->streamCallback());
+      controller_.setStreamWindow(userController->streamWindow());
+    }
+    attemptResponse_ = response_->New();
+    startTime_ = Timestamp::now();
+    endpoint->beginCall();
+    endpoint->channel()->CallMethod(method_, &controller_, request_, attemptResponse_, this);
+  }
+
+  // runs user's done, then deletes this
+  void finish()
+  {
+    if (controller_.Failed())
+    {
+      if (userController_)
+      {
+        RpcController* userController = dynamic_cast<RpcController*>(userController_);
+        if (userController)
+        {
+          userController->setErrorCode(controller_.errorCode());
+        }
+        userController_->SetFailed(controller_.ErrorText());
+      }
+    }
+    else
+    {
+      // takes the result, RpcChannel deletes the empty one
+      response_->GetReflection()->Swap(response_, attemptResponse_);
+    }
+    if (done_)
+    {
+      done_->Run();
+    }
+    delete response_;
+    delete this;
+  }
+
+  Endpoint* endpoint() const { return endpoint_; }
+  Timestamp startTime() const { return startTime_; }
+  const RpcController& controller() const { return controller_; }
+
+  // only once
+  bool takeRetry()
+  {
+    bool retriable = retriable_;
+    retriable_ = false;
+    return retriable;
+  }
+
+ private:
+  BalancedRpcChannel* owner_;
+  const ::google::protobuf::MethodDescriptor* method_;
+  ::google::protobuf::RpcController* userController_;
+  const ::google::protobuf::Message* request_;
+  boost::scoped_ptr< ::google::protobuf::Message> requestCopy_;
+  ::google::protobuf::Message* response_;
+  ::google::protobuf::Closure* done_;
+  bool retriable_;
+
+  // of the current attempt
+  Endpoint* endpoint_;
+  RpcController controller_;
+  ::google::protobuf::Message* attemptResponse_;
+  Timestamp startTime_;
+};
+
+BalancedRpcChannel::BalancedRpcChannel(EventLoop* loop,
+                                       const std::vector<InetAddress>& servers,
+                                       const string& name)
+{
+  assert(!servers.empty());
+  for (size_t i = 0; i < servers.size(); ++i)
+  {
+    char buf[32];
+    snprintf(buf, sizeof buf, "#%zu", i);
+    endpoints_.push_back(new Endpoint(loop, servers[i], name + buf));
+  }
+}
+
+BalancedRpcChannel::~BalancedRpcChannel()
+{
+}
+
+void BalancedRpcChannel::connect()
+{
+  for (size_t i = 0; i < endpoints_.size(); ++i)
+  {
+    endpoints_[i].client()->connect();
+  }
+}
+
+void BalancedRpcChannel::disconnect()
+{
+  for (size_t i = 0; i < endpoints_.size(); ++i)
+  {
+    endpoints_[i].client()->disconnect();
+  }
+}
+
+void BalancedRpcChannel::setTimeout(double seconds)
+{
+  for (size_t i = 0; i < endpoints_.size(); ++i)
+  {
+    endpoints_[i].channel()->setTimeout(seconds);
+  }
+}
+
+void BalancedRpcChannel::setChecksum(RpcCodec::Checksum checksum)
+{
+  for (size_t i = 0; i < endpoints_.size(); ++i)
+  {
+    endpoints_[i].channel()->setChecksum(checksum);
+  }
+}
+
+void BalancedRpcChannel::setStats(RpcStats* stats)
+{
+  for (size_t i = 0; i < endpoints_.size(); ++i)
+  {
+    endpoints_[i].channel()->setStats(stats);
+  }
+}
+
+std::vector<BalancedRpcChannel::EndpointStats> BalancedRpcChannel::stats() const
+{
+  std::vector<EndpointStats> result;
+  for (size_t i = 0; i < endpoints_.size(); ++i)
+  {
+    result.push_back(endpoints_[i].stats());
+  }
+  return result;
+}
+
+void BalancedRpcChannel::CallMethod(const ::google::protobuf::MethodDescriptor* method,
+                                    ::google::protobuf::RpcController* controller,
+                                    const ::google::protobuf::Message* request,
+                                    ::google::protobuf::Message* response,
+                                    ::google::protobuf::Closure* done)
+{
+  bool idempotent = idempotentMethods_.count(method->full_name()) > 0;
+  Call* call = new Call(this, method, controller, request, response, done, idempotent);
+  Endpoint* endpoint = pick(NULL);
+  if (endpoint == NULL)
+  {
+    // none connected, the first one fails it the same way RpcChannel does
+    endpoint = &endpoints_[0];
+  }
+  call->start(endpoint);
+}
+
+BalancedRpcChannel::Endpoint* BalancedRpcChannel::pick(const Endpoint* excluded)
+{
+  // least outstanding calls, starting from a different one each time
+  size_t n = endpoints_.size();
+  size_t first = static_cast<uint32_t>(next_.getAndAdd(1)) % n;
+  Endpoint* best = NULL;
+  int bestCalls = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    Endpoint* endpoint = &endpoints_[(first + i) % n];
+    if (endpoint != excluded && endpoint->connected())
+    {
+      int calls = endpoint->outstandingCalls();
+      if (best == NULL || calls < bestCalls)
+      {
+        best = endpoint;
+        bestCalls = calls;
+      }
+    }
+  }
+  return best;
+}
+
+void BalancedRpcChannel::onCallDone(Call* call)
+{
+  Endpoint* endpoint = call->endpoint();
+  const RpcController& controller = call->controller();
+  endpoint->endCall(timeDifference(Timestamp::now(), call->startTime()), controller.Failed());
+
+  if (controller.Failed() && controller.errorCode() == NOT_CONNECTED)
+  {
+    // the request may not have been processed, safe to send again if idempotent
+    Endpoint* other = pick(endpoint);
+    if (other && call->takeRetry())
+    {
+      LOG_DEBUG << "BalancedRpcChannel::onCallDone - retry on another server";
+      call->start(other);
+      return;
+    }
+  }
+  call->finish();
+}
@@ -0,0 +1,116 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PROTORPC_BALANCEDRPCCHANNEL_H
+#define MUDUO_NET_PROTORPC_BALANCEDRPCCHANNEL_H
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/protorpc/RpcCodec.h>
+
+#include <google/protobuf/service.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class RpcStats;
+
+///
+/// RpcChannel to a set of servers of the same services.
+///
+/// Each call goes to the connected server with the fewest calls in
+/// flight.  Idempotent methods are retried once on another server if the
+/// connection fails, their requests are copied for that.  Streamed calls
+/// are not retried.  Works with generated Service_Stub classes.
+///
+/// Like RpcChannel, it deletes the response after running done.  Pass a
+/// muduo::net::RpcController to see errors, and to set a deadline.
+///
+/// All connections are in one loop, which must outlive this object.
+///
+class BalancedRpcChannel : public ::google::protobuf::RpcChannel,
+                           boost::noncopyable
+{
+ public:
+  struct EndpointStats
+  {
+    InetAddress address;
+    bool connected;
+    int outstandingCalls;
+    int64_t calls;
+    int64_t failures;
+    double meanLatency;  // in seconds, of completed calls
+    double maxLatency;
+  };
+
+  BalancedRpcChannel(EventLoop* loop,
+                     const std::vector<InetAddress>& servers,
+                     const string& name);
+  ~BalancedRpcChannel();
+
+  /// Connects to all servers, reconnecting when a connection is lost.
+  void connect();
+  void disconnect();
+
+  /// Deadline of each call, see RpcChannel::setTimeout().
+  /// Must be called before connect().
+  void setTimeout(double seconds);
+
+  /// Checksum of requests, see RpcChannel::setChecksum().
+  /// Must be called before connect().
+  void setChecksum(RpcCodec::Checksum checksum);
+
+  /// Records calls into stats, see RpcChannel::setStats().
+  /// Must be called before connect().
+  void setStats(RpcStats* stats);
+
+  /// Marks a method safe to retry, by its full name such as
+  /// "sudoku.SudokuService.Solve".  Not thread safe, call before any call.
+  void addIdempotentMethod(const std::string& fullName)
+  { idempotentMethods_.insert(fullName); }
+
+  /// Thread safe.
+  std::vector<EndpointStats> stats() const;
+
+  /// Thread safe.
+  virtual void CallMethod(const ::google::protobuf::MethodDescriptor* method,
+                          ::google::protobuf::RpcController* controller,
+                          const ::google::protobuf::Message* request,
+                          ::google::protobuf::Message* response,
+                          ::google::protobuf::Closure* done);
+
+ private:
+  class Endpoint;
+  class Call;
+
+  // NULL if none is connected
+  Endpoint* pick(const Endpoint* excluded);
+  void onCallDone(Call* call);
+
+  boost::ptr_vector<Endpoint> endpoints_;
+  std::set<std::string> idempotentMethods_;
+  AtomicInt32 next_;  // breaks ties between endpoints
+};
+
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_BALANCEDRPCCHANNEL_H
@@ -0,0 +1,71 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PROTORPC_BUFFERSTREAM_H
+#define MUDUO_NET_PROTORPC_BUFFERSTREAM_H
+
+#include <muduo/net/Buffer.h>
+
+#include <google/protobuf/io/zero_copy_stream.h>
+
+#include <stdint.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Serializes protobuf messages straight into the writable space of a
+/// Buffer, growing it as needed.  Call ensureWritableBytes() with the
+/// known size beforehand, and it's written in one piece.
+///
+class BufferOutputStream : public ::google::protobuf::io::ZeroCopyOutputStream
+{
+ public:
+  explicit BufferOutputStream(Buffer* buf)
+    : buffer_(buf),
+      originalSize_(buf->readableBytes())
+  {
+  }
+
+  virtual bool Next(void** data, int* size)
+  {
+    if (buffer_->writableBytes() == 0)
+    {
+      buffer_->ensureWritableBytes(kMinBlockSize);
+    }
+    *data = buffer_->beginWrite();
+    *size = static_cast<int>(buffer_->writableBytes());
+    buffer_->hasWritten(*size);
+    return true;
+  }
+
+  virtual void BackUp(int count)
+  {
+    buffer_->unwrite(static_cast<size_t>(count));
+  }
+
+  virtual int64_t ByteCount() const
+  {
+    return static_cast<int64_t>(buffer_->readableBytes() - originalSize_);
+  }
+
+ private:
+  static const size_t kMinBlockSize = 4096;
+
+  Buffer* buffer_;
+  size_t originalSize_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_BUFFERSTREAM_H
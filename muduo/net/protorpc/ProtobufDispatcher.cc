@@ -0,0 +1,63 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/protorpc/ProtobufDispatcher.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+  const size_t kInitialSize = 16;
+}
+
+ProtobufDispatcher::ProtobufDispatcher(const ProtobufMessageCallback& defaultCb)
+  : table_(kInitialSize),
+    size_(0),
+    defaultCallback_(defaultCb)
+{
+}
+
+ProtobufDispatcher::~ProtobufDispatcher()
+{
+}
+
+void ProtobufDispatcher::add(const ::google::protobuf::Descriptor* descriptor,
+                             Invoker invoker,
+                             const boost::shared_ptr<void>& callback)
+{
+  assert(descriptor != NULL);
+  if (2 * (size_ + 1) > table_.size())
+  {
+    std::vector<Entry> old(2 * table_.size());
+    old.swap(table_);
+    size_ = 0;
+    for (size_t i = 0; i < old.size(); ++i)
+    {
+      if (old[i].descriptor)
+      {
+        add(old[i].descriptor, old[i].invoke, old[i].callback);
+      }
+    }
+  }
+
+  size_t mask = table_.size() - 1;
+  size_t i = hash(descriptor) & mask;
+  while (table_[i].descriptor != NULL && table_[i].descriptor != descriptor)
+  {
+    i = (i + 1) & mask;
+  }
+  Entry& entry = table_[i];
+  if (entry.descriptor == NULL)
+  {
+    ++size_;
+  }
+  entry.descriptor = descriptor;
+  entry.invoke = invoker;
+  entry.callback = callback;
+}
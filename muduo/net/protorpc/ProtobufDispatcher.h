@@ -0,0 +1,156 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PROTORPC_PROTOBUFDISPATCHER_H
+#define MUDUO_NET_PROTORPC_PROTOBUFDISPATCHER_H
+
+#include <muduo/net/Callbacks.h>
+
+#include <google/protobuf/message.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_base_of.hpp>
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Calls the callback registered for the type of each message,
+/// or the default callback.
+///
+/// Callbacks are kept in an open addressing table keyed by descriptor,
+/// a lookup is usually one probe.  Register them all before dispatching,
+/// after that it is read only and may be shared by threads.
+///
+class ProtobufDispatcher : boost::noncopyable
+{
+ public:
+  typedef boost::shared_ptr< ::google::protobuf::Message> MessagePtr;
+
+  typedef boost::function<void (const TcpConnectionPtr&,
+                                const MessagePtr& message,
+                                Timestamp)> ProtobufMessageCallback;
+
+  template<typename T>
+  struct MessageCallback
+  {
+    typedef boost::function<void (const TcpConnectionPtr&,
+                                  const boost::shared_ptr<T>& message,
+                                  Timestamp)> type;
+  };
+
+  explicit ProtobufDispatcher(const ProtobufMessageCallback& defaultCb);
+  ~ProtobufDispatcher();
+
+  void onProtobufMessage(const TcpConnectionPtr& conn,
+                         const MessagePtr& message,
+                         Timestamp receiveTime) const
+  {
+    const Entry* entry = find(message->GetDescriptor());
+    if (entry)
+    {
+      entry->invoke(entry->callback.get(), conn, message, receiveTime);
+    }
+    else
+    {
+      defaultCallback_(conn, message, receiveTime);
+    }
+  }
+
+  /// Replaces the one of T, if any.  Not thread safe.
+  template<typename T>
+  void registerMessageCallback(const typename MessageCallback<T>::type& callback)
+  {
+    BOOST_STATIC_ASSERT((boost::is_base_of< ::google::protobuf::Message, T>::value));
+    add(T::descriptor(), &invoke<T>, boost::shared_ptr<void>(
+        new typename MessageCallback<T>::type(callback)));
+  }
+
+  size_t numCallbacks() const
+  { return size_; }
+
+ private:
+  typedef void (*Invoker)(const void* callback,
+                          const TcpConnectionPtr&,
+                          const MessagePtr&,
+                          Timestamp);
+
+  struct Entry
+  {
+    Entry()
+      : descriptor(NULL),
+        invoke(NULL)
+    {
+    }
+
+    const ::google::protobuf::Descriptor* descriptor;  // NULL if empty
+    Invoker invoke;
+    boost::shared_ptr<void> callback;  // MessageCallback<T>::type
+  };
+
+  // the table only holds T of the descriptor, no dynamic_cast needed
+  template<typename T>
+  static void invoke(const void* callback,
+                     const TcpConnectionPtr& conn,
+                     const MessagePtr& message,
+                     Timestamp receiveTime)
+  {
+    assert(dynamic_cast<T*>(get_pointer(message)) != NULL);
+    (*static_cast<const typename MessageCallback<T>::type*>(callback))(
+        conn, boost::static_pointer_cast<T>(message), receiveTime);
+  }
+
+  static size_t hash(const ::google::protobuf::Descriptor* descriptor)
+  {
+    // descriptors are allocated together, mix the bits before masking
+    uint64_t h = reinterpret_cast<uintptr_t>(descriptor);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+
+  const Entry* find(const ::google::protobuf::Descriptor* descriptor) const
+  {
+    size_t mask = table_.size() - 1;
+    for (size_t i = hash(descriptor) & mask; ; i = (i + 1) & mask)
+    {
+      const Entry& entry = table_[i];
+      if (entry.descriptor == descriptor)
+      {
+        return &entry;
+      }
+      else if (entry.descriptor == NULL)
+      {
+        return NULL;
+      }
+    }
+  }
+
+  void add(const ::google::protobuf::Descriptor* descriptor,
+           Invoker invoker,
+           const boost::shared_ptr<void>& callback);
+
+  std::vector<Entry> table_;  // size is a power of 2, at most half full
+  size_t size_;
+  ProtobufMessageCallback defaultCallback_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_PROTOBUFDISPATCHER_H
@@ -9,24 +9,369 @@
 #include <muduo/net/protorpc/RpcChannel.h>
 
 #include <muduo/base/Logging.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/RpcStats.h>
 #include <muduo/net/protorpc/rpc.pb.h>
 
 #include <google/protobuf/descriptor.h>
 
 #include <boost/bind.hpp>
 
+#include <algorithm>
+#include <vector>
+
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+int64_t microSecondsSince(Timestamp start)
+{
+  return Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch();
+}
+
+}
+
+// Outstanding calls by id.  The table is split into shards, each with
+// its own lock, so callers in other threads rarely contend with the IO
+// thread.  A shard is an open addressing table with linear probing,
+// ids are sequential so (id / kShards) spreads evenly without hashing.
+class RpcChannel::CallTable : boost::noncopyable
+{
+ public:
+  void insert(int64_t id, const OutstandingCall& call)
+  {
+    Shard& shard = shardOf(id);
+    MutexLockGuard lock(shard.mutex);
+    if ((shard.count + 1) * 2 > shard.slots.size())
+    {
+      shard.rehash(shard.slots.empty() ? kMinSlots : shard.slots.size() * 2);
+    }
+    size_t i = shard.find(id);
+    assert(shard.slots[i].id == 0);
+    shard.slots[i].id = id;
+    shard.slots[i].call = call;
+    ++shard.count;
+  }
+
+  // return false if it's done or expired
+  bool take(int64_t id, OutstandingCall* call)
+  {
+    Shard& shard = shardOf(id);
+    MutexLockGuard lock(shard.mutex);
+    if (shard.slots.empty())
+    {
+      return false;
+    }
+    size_t i = shard.find(id);
+    if (shard.slots[i].id != id)
+    {
+      return false;
+    }
+    *call = shard.slots[i].call;
+    shard.erase(i);
+    // gives back memory after a burst
+    if (shard.slots.size() > kMinSlots && shard.count * 8 < shard.slots.size())
+    {
+      shard.rehash(shard.slots.size() / 2);
+    }
+    return true;
+  }
+
+  bool setTimer(int64_t id, const TimerId& timer)
+  {
+    Shard& shard = shardOf(id);
+    MutexLockGuard lock(shard.mutex);
+    if (shard.slots.empty())
+    {
+      return false;
+    }
+    size_t i = shard.find(id);
+    if (shard.slots[i].id != id)
+    {
+      return false;
+    }
+    shard.slots[i].call.timer = timer;
+    shard.slots[i].call.hasTimer = true;
+    return true;
+  }
+
+  // counts a streamed response, return false if it's done or expired
+  bool next(int64_t id, size_t bytes, OutstandingCall* call)
+  {
+    Shard& shard = shardOf(id);
+    MutexLockGuard lock(shard.mutex);
+    if (shard.slots.empty())
+    {
+      return false;
+    }
+    size_t i = shard.find(id);
+    if (shard.slots[i].id != id)
+    {
+      return false;
+    }
+    ++shard.slots[i].call.received;
+    shard.slots[i].call.receivedBytes += bytes;
+    *call = shard.slots[i].call;
+    return true;
+  }
+
+  // ids[i] is of calls[i]
+  void takeAll(std::vector<OutstandingCall>* calls, std::vector<int64_t>* ids)
+  {
+    for (int i = 0; i < kShards; ++i)
+    {
+      Shard& shard = shards_[i];
+      MutexLockGuard lock(shard.mutex);
+      for (size_t j = 0; j < shard.slots.size(); ++j)
+      {
+        if (shard.slots[j].id != 0)
+        {
+          calls->push_back(shard.slots[j].call);
+          ids->push_back(shard.slots[j].id);
+        }
+      }
+      std::vector<Slot>().swap(shard.slots);
+      shard.count = 0;
+    }
+  }
+
+  size_t size() const
+  {
+    size_t n = 0;
+    for (int i = 0; i < kShards; ++i)
+    {
+      MutexLockGuard lock(shards_[i].mutex);
+      n += shards_[i].count;
+    }
+    return n;
+  }
+
+ private:
+  static const int kShards = 16;
+  static const size_t kMinSlots = 16;
+
+  struct Slot
+  {
+    int64_t id;  // 0 if empty, ids start from 1
+    OutstandingCall call;
+  };
+
+  struct Shard
+  {
+    Shard() : count(0) { }
+
+    size_t home(int64_t id) const
+    {
+      return static_cast<size_t>(id / kShards) & (slots.size() - 1);
+    }
+
+    // slot of id, or the empty slot where it would go
+    size_t find(int64_t id) const
+    {
+      size_t mask = slots.size() - 1;
+      size_t i = home(id);
+      while (slots[i].id != 0 && slots[i].id != id)
+      {
+        i = (i + 1) & mask;
+      }
+      return i;
+    }
+
+    // backward shift, so lookups need no tombstones
+    void erase(size_t i)
+    {
+      size_t mask = slots.size() - 1;
+      size_t j = i;
+      while (true)
+      {
+        j = (j + 1) & mask;
+        if (slots[j].id == 0)
+        {
+          break;
+        }
+        size_t k = home(slots[j].id);
+        // moves j to the hole unless its home lies cyclically in (i, j]
+        bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays)
+        {
+          slots[i] = slots[j];
+          i = j;
+        }
+      }
+      slots[i].id = 0;
+      --count;
+    }
+
+    void rehash(size_t n)
+    {
+      std::vector<Slot> old;
+      old.swap(slots);
+      Slot empty = { 0, { NULL, NULL, NULL, TimerId(), false, 0, 0, 0, NULL, NULL, Timestamp() } };
+      slots.assign(n, empty);
+      for (size_t i = 0; i < old.size(); ++i)
+      {
+        if (old[i].id != 0)
+        {
+          slots[find(old[i].id)] = old[i];
+        }
+      }
+    }
+
+    mutable MutexLock mutex;
+    std::vector<Slot> slots;  // size is a power of 2
+    size_t count;
+  };
+
+  Shard& shardOf(int64_t id)
+  {
+    return shards_[id % kShards];
+  }
+
+  Shard shards_[kShards];
+};
+
+class RpcChannel::DoneClosure : public ::google::protobuf::Closure
+{
+ public:
+  // guard keeps the channel for methods in other threads, may be empty
+  DoneClosure(RpcChannel* channel,
+              const RpcChannelPtr& guard,
+              const RpcDispatchTable::Method* method,
+              RpcController* controller,
+              ::google::protobuf::Message* response,
+              int64_t id,
+              Timestamp receiveTime)
+    : channel_(channel),
+      guard_(guard),
+      method_(method),
+      controller_(controller),
+      response_(response),
+      id_(id),
+      receiveTime_(receiveTime)
+  {
+  }
+
+  virtual void Run()
+  {
+    channel_->doneCallback(method_, controller_, response_, id_, receiveTime_);
+    delete this;
+  }
+
+ private:
+  RpcChannel* channel_;
+  RpcChannelPtr guard_;
+  const RpcDispatchTable::Method* method_;
+  RpcController* controller_;
+  ::google::protobuf::Message* response_;
+  int64_t id_;
+  Timestamp receiveTime_;
+};
+
+class RpcChannel::ServerStream : boost::noncopyable
+{
+ public:
+  ServerStream(RpcDispatchTable* services,
+               RpcStats* stats,
+               const RpcDispatchTable::Method* method,
+               RpcController* controller,
+               ::google::protobuf::Message* last,
+               int64_t id,
+               Timestamp receiveTime)
+    : services_(services),
+      stats_(stats),
+      method_(method),
+      controller_(controller),
+      last_(last),
+      next_(services->newResponse(*method)),
+      id_(id),
+      receiveTime_(receiveTime),
+      credit_(controller->streamWindow()),
+      bytes_(0),
+      ended_(false)
+  {
+  }
+
+  ~ServerStream()
+  {
+    if (!ended_)
+    {
+      // the connection is gone
+      end(NOT_CONNECTED);
+    }
+    services_->releaseResponse(*method_, next_);
+    services_->releaseResponse(*method_, last_);
+    delete controller_;
+  }
+
+  int64_t id() const { return id_; }
+  int credit() const { return credit_; }
+  void addCredit(int credit) { credit_ += credit; }
+
+  // NULL at the end, then last() is sent
+  ::google::protobuf::Message* produce()
+  {
+    assert(credit_ > 0);
+    next_->Clear();
+    if (controller_->producer()(next_))
+    {
+      --credit_;
+      bytes_ += next_->ByteSize();
+      return next_;
+    }
+    return NULL;
+  }
+
+  const ::google::protobuf::Message& last() const { return *last_; }
+
+  // after last() is sent
+  void end(int error)
+  {
+    ended_ = true;
+    if (stats_)
+    {
+      size_t bytes = bytes_ + (error == NO_ERROR ? last_->GetCachedSize() : 0);
+      stats_->end(method_->descriptor, error, bytes, microSecondsSince(receiveTime_));
+    }
+  }
+
+ private:
+  RpcDispatchTable* services_;
+  RpcStats* stats_;
+  const RpcDispatchTable::Method* method_;
+  RpcController* controller_;
+  ::google::protobuf::Message* last_;
+  ::google::protobuf::Message* next_;  // reused for every response
+  int64_t id_;
+  Timestamp receiveTime_;
+  int credit_;
+  size_t bytes_;  // of responses produced so far
+  bool ended_;
+};
+
 RpcChannel::RpcChannel()
-  : codec_(boost::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3))
+  : codec_(boost::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3, _4)),
+    timeout_(0),
+    outstandings_(new CallTable),
+    services_(NULL),
+    stats_(NULL),
+    paused_(false)
 {
   LOG_INFO << "RpcChannel::ctor - " << this;
 }
 
 RpcChannel::RpcChannel(const TcpConnectionPtr& conn)
-  : codec_(boost::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3)),
-    conn_(conn)
+  : codec_(boost::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3, _4)),
+    conn_(conn),
+    timeout_(0),
+    outstandings_(new CallTable),
+    services_(NULL),
+    stats_(NULL),
+    paused_(false)
 {
   LOG_INFO << "RpcChannel::ctor - " << this;
 }
@@ -53,12 +398,157 @@ void RpcChannel::CallMethod(const ::google::protobuf::MethodDescriptor* method,
   message.set_id(id);
   message.set_service(method->service()->full_name());
   message.set_method(method->name());
-  message.set_request(request->SerializeAsString()); // FIXME: error check
-  RpcCodec::send(conn_, message);
 
-  OutstandingCall out = { response, done };
-  MutexLockGuard lock(mutex_);
-  outstandings_[id] = out;
+  RpcController* rpcController = dynamic_cast<RpcController*>(controller);
+  int window = 0;
+  if (rpcController && rpcController->streamCallback())
+  {
+    window = rpcController->streamWindow() > 0 ? rpcController->streamWindow()
+                                               : RpcController::kDefaultStreamWindow;
+    message.set_window(window);
+  }
+
+  OutstandingCall out = { response, done, controller, TimerId(), false, window, 0,
+                          0, stats_, method, Timestamp() };
+  if (stats_)
+  {
+    out.sendTime = Timestamp::now();
+  }
+  TcpConnectionPtr conn(connection());
+  if (!conn || !conn->connected())
+  {
+    if (stats_)
+    {
+      stats_->begin(method, 0);
+    }
+    fail(out, NOT_CONNECTED);
+    return;
+  }
+
+  double timeout = timeout_;
+  if (rpcController && rpcController->timeout() > 0)
+  {
+    timeout = rpcController->timeout();
+  }
+
+  // before sending, the response may come back in the IO thread first
+  outstandings_->insert(id, out);
+  if (!conn->connected())
+  {
+    // went down after the check above, failOutstandingCalls() in the
+    // connection callback may have missed this call.  The shard lock
+    // taken by both makes the state change visible here.
+    if (outstandings_->take(id, &out))
+    {
+      if (stats_)
+      {
+        stats_->begin(method, 0);
+      }
+      fail(out, NOT_CONNECTED);
+    }
+    return;
+  }
+  if (timeout > 0)
+  {
+    EventLoop* loop = conn->getLoop();
+    TimerId timer = loop->runAfter(timeout,
+        boost::bind(&RpcChannel::onTimeout, boost::weak_ptr<CallTable>(outstandings_),
+                    boost::weak_ptr<TcpConnection>(conn), codec_.checksum(), id));
+    if (!outstandings_->setTimer(id, timer))
+    {
+      loop->cancel(timer);
+    }
+  }
+  RpcCodec::send(conn, message, *request, codec_.checksum());
+  if (stats_)
+  {
+    // may come after the response in the IO thread, in-flight calls lag
+    stats_->begin(method, request->GetCachedSize());
+  }
+}
+
+size_t RpcChannel::numOutstandingCalls() const
+{
+  return outstandings_->size();
+}
+
+void RpcChannel::onTimeout(const boost::weak_ptr<CallTable>& weakTable,
+                           const boost::weak_ptr<TcpConnection>& weakConn,
+                           RpcCodec::Checksum checksum,
+                           int64_t id)
+{
+  CallTablePtr table(weakTable.lock());
+  OutstandingCall out;
+  if (table && table->take(id, &out))
+  {
+    LOG_WARN << "RpcChannel::onTimeout - call " << id << " timed out";
+    if (out.window > 0)
+    {
+      // the server would wait for credit forever
+      sendCancel(weakConn.lock(), id, checksum);
+    }
+    fail(out, TIMEOUT);
+  }
+}
+
+void RpcChannel::sendCancel(const TcpConnectionPtr& conn, int64_t id, RpcCodec::Checksum checksum)
+{
+  if (conn && conn->connected())
+  {
+    RpcMessage message;
+    message.set_type(CANCEL);
+    message.set_id(id);
+    RpcCodec::send(conn, message, checksum);
+  }
+}
+
+void RpcChannel::failOutstandingCalls()
+{
+  std::vector<OutstandingCall> calls;
+  std::vector<int64_t> ids;
+  outstandings_->takeAll(&calls, &ids);
+  TcpConnectionPtr conn(connection());
+  for (size_t i = 0; i < calls.size(); ++i)
+  {
+    if (calls[i].hasTimer)
+    {
+      assert(conn);
+      conn->getLoop()->cancel(calls[i].timer);
+    }
+    if (calls[i].window > 0)
+    {
+      sendCancel(conn, ids[i], codec_.checksum());
+    }
+    fail(calls[i], NOT_CONNECTED);
+  }
+}
+
+void RpcChannel::record(const OutstandingCall& call, int error, size_t responseBytes)
+{
+  if (call.stats)
+  {
+    call.stats->end(call.method, error, call.receivedBytes + responseBytes,
+                    microSecondsSince(call.sendTime));
+  }
+}
+
+void RpcChannel::fail(const OutstandingCall& call, int error)
+{
+  record(call, error, 0);
+  if (call.controller)
+  {
+    RpcController* rpcController = dynamic_cast<RpcController*>(call.controller);
+    if (rpcController)
+    {
+      rpcController->setErrorCode(error);
+    }
+    call.controller->SetFailed(ErrorCode_Name(static_cast<ErrorCode>(error)));
+  }
+  if (call.done)
+  {
+    call.done->Run();
+  }
+  delete call.response;
 }
 
 void RpcChannel::onMessage(const TcpConnectionPtr& conn,
@@ -71,30 +561,31 @@ void RpcChannel::onMessage(const TcpConnectionPtr& conn,
 //codec解完RpcMessage后回调该函数。
 void RpcChannel::onRpcMessage(const TcpConnectionPtr& conn,
                               const RpcMessage& message,
+                              const StringPiece& payload,
                               Timestamp receiveTime)
 {
-  assert(conn == conn_);
+  assert(conn == connection());
   //printf("%s\n", message.DebugString().c_str());
-  if (message.type() == RESPONSE)
+  if (message.type() == RESPONSE && message.more())
+  {
+    onStreamResponse(conn, message.id(), payload);
+  }
+  else if (message.type() == RESPONSE)
   {
     int64_t id = message.id();
-    assert(message.has_response());
-
-    OutstandingCall out = { NULL, NULL };
 
+    OutstandingCall out;
+    if (outstandings_->take(id, &out))
     {
-      MutexLockGuard lock(mutex_);
-      std::map<int64_t, OutstandingCall>::iterator it = outstandings_.find(id);
-      if (it != outstandings_.end())
+      if (out.hasTimer)
       {
-        out = it->second;
-        outstandings_.erase(it);
+        conn->getLoop()->cancel(out.timer);
+      }
+      record(out, NO_ERROR, payload.size());
+      if (out.response)
+      {
+        out.response->ParseFromArray(payload.data(), payload.size());
       }
-    }
-
-    if (out.response)
-    {
-      out.response->ParseFromString(message.response());
       if (out.done)
       {
         out.done->Run();
@@ -104,56 +595,274 @@ void RpcChannel::onRpcMessage(const TcpConnectionPtr& conn,
   }
   else if (message.type() == REQUEST) //如果rpc消息是请求
   {
-    // FIXME: extract to a function
-    if (services_)
+    const RpcDispatchTable::Method* method =
+        services_ ? services_->find(message.service(), message.method()) : NULL;
+    if (method && stats_)
+    {
+      stats_->begin(method->descriptor, payload.size());
+    }
+    if (method == NULL)
+    {
+      bool hasService = services_ && services_->hasService(message.service());
+      LOG_WARN << "RpcChannel::onRpcMessage - no " << (hasService ? "method " : "service ")
+               << message.service() << "." << message.method();
+      sendError(message.id(), hasService ? NO_METHOD : NO_SERVICE);
+    }
+    else if (method->executor == NULL)
     {
-      std::map<std::string, google::protobuf::Service*>::const_iterator it = services_->find(message.service());
-      if (it != services_->end())
+      if (message.window() > 0)
       {
-        google::protobuf::Service* service = it->second;
-        assert(service != NULL);
-        const google::protobuf::ServiceDescriptor* desc = service->GetDescriptor();
-        const google::protobuf::MethodDescriptor* method
-          = desc->FindMethodByName(message.method());
-        if (method)
-        {
-          //找到方法后进入该逻辑
-          google::protobuf::Message* request = service->GetRequestPrototype(method).New();
-          request->ParseFromString(message.request());
-          google::protobuf::Message* response = service->GetResponsePrototype(method).New();
-          int64_t id = message.id();
-          service->CallMethod(method, NULL, request, response,
-              NewCallback(this, &RpcChannel::doneCallback, response, id));
-          delete request;
-        }
-        else
+        pendingStreams_.insert(message.id());
+      }
+      //找到方法后进入该逻辑
+      google::protobuf::Message* request = services_->newRequest(*method);
+      request->ParseFromArray(payload.data(), payload.size());
+      google::protobuf::Message* response = services_->newResponse(*method);
+      int64_t id = message.id();
+      RpcController* controller = NULL;
+      if (message.window() > 0)
+      {
+        controller = new RpcController;
+        controller->setStreamWindow(message.window());
+      }
+      method->service->CallMethod(method->descriptor, controller, request, response,
+          new DoneClosure(this, RpcChannelPtr(), method, controller, response, id, receiveTime));
+      services_->releaseRequest(*method, request);
+    }
+    else
+    {
+      // payload is in the input buffer, copied for the pool
+      RpcDispatchTable::Executor* executor = method->executor;
+      if (message.window() > 0)
+      {
+        // before the method may run done in the pool
+        pendingStreams_.insert(message.id());
+      }
+      int calls = executor->concurrentCalls.incrementAndGet();
+      if ((executor->maxConcurrentCalls > 0 && calls > executor->maxConcurrentCalls)
+          || !executor->pool->tryRun(boost::bind(&RpcChannel::runMethod,
+                                                 shared_from_this(),
+                                                 method,
+                                                 message.id(),
+                                                 message.window(),
+                                                 std::string(payload.data(), payload.size()),
+                                                 receiveTime)))
+      {
+        executor->concurrentCalls.decrement();
+        pendingStreams_.erase(message.id());
+        sendError(message.id(), OVERLOADED);
+        if (stats_)
         {
-          // FIXME:
+          stats_->end(method->descriptor, OVERLOADED, 0, microSecondsSince(receiveTime));
         }
       }
-      else
+    }
+  }
+  else if (message.type() == ERROR)
+  {
+    OutstandingCall out;
+    if (outstandings_->take(message.id(), &out))
+    {
+      if (out.hasTimer)
       {
-        // FIXME:
+        conn->getLoop()->cancel(out.timer);
       }
+      fail(out, message.error());
+    }
+  }
+  else if (message.type() == CREDIT)
+  {
+    std::map<int64_t, ServerStreamPtr>::iterator it = streams_.find(message.id());
+    if (it != streams_.end() && message.credit() > 0)
+    {
+      ServerStreamPtr stream(it->second);
+      stream->addCredit(message.credit());
+      pumpStream(conn, get_pointer(stream));
+    }
+  }
+  else if (message.type() == CANCEL)
+  {
+    std::map<int64_t, ServerStreamPtr>::iterator it = streams_.find(message.id());
+    if (it != streams_.end())
+    {
+      it->second->end(CANCELED);
+      streams_.erase(it);
     }
     else
     {
-      // FIXME:
+      // done is yet to run, startStream() drops it
+      pendingStreams_.erase(message.id());
     }
   }
-  else if (message.type() == ERROR)
+}
+
+void RpcChannel::onStreamResponse(const TcpConnectionPtr& conn,
+                                  int64_t id,
+                                  const StringPiece& payload)
+{
+  OutstandingCall out;
+  if (outstandings_->next(id, payload.size(), &out) && out.window > 0 && out.response)
+  {
+    RpcController* controller = static_cast<RpcController*>(out.controller);
+    out.response->ParseFromArray(payload.data(), payload.size());
+    controller->streamCallback()(*out.response);
+    out.response->Clear();
+
+    // gives back credit in batches, the server keeps sending meanwhile
+    int batch = std::max(out.window / 2, 1);
+    if (out.received % batch == 0)
+    {
+      RpcMessage message;
+      message.set_type(CREDIT);
+      message.set_id(id);
+      message.set_credit(batch);
+      RpcCodec::send(conn, message, codec_.checksum());
+    }
+  }
+}
+
+void RpcChannel::onHighWaterMark(const TcpConnectionPtr& conn, size_t len)
+{
+  LOG_DEBUG << "RpcChannel::onHighWaterMark - " << len << " bytes to send, "
+            << streams_.size() << " streams paused";
+  paused_ = true;
+}
+
+void RpcChannel::onWriteComplete(const TcpConnectionPtr& conn)
+{
+  paused_ = false;
+  std::map<int64_t, ServerStreamPtr>::iterator it = streams_.begin();
+  while (it != streams_.end() && !paused_)
+  {
+    // pumpStream() may erase it
+    ServerStreamPtr stream(it->second);
+    ++it;
+    pumpStream(conn, get_pointer(stream));
+  }
+}
+
+void RpcChannel::startStream(const ServerStreamPtr& stream)
+{
+  if (pendingStreams_.erase(stream->id()) == 0)
+  {
+    stream->end(CANCELED);
+    return;
+  }
+  TcpConnectionPtr conn(connection());
+  if (conn && conn->connected())
+  {
+    streams_[stream->id()] = stream;
+    pumpStream(conn, get_pointer(stream));
+  }
+}
+
+void RpcChannel::forgetStream(int64_t id)
+{
+  pendingStreams_.erase(id);
+}
+
+void RpcChannel::pumpStream(const TcpConnectionPtr& conn, ServerStream* stream)
+{
+  RpcMessage message;
+  message.set_type(RESPONSE);
+  message.set_id(stream->id());
+  message.set_more(true);
+  // the high-water mark callback is queued, so the connection may take up
+  // to one window more than the mark
+  while (!paused_ && stream->credit() > 0)
   {
+    ::google::protobuf::Message* response = stream->produce();
+    if (response == NULL)
+    {
+      message.clear_more();
+      RpcCodec::send(conn, message, stream->last(), codec_.checksum());
+      stream->end(NO_ERROR);
+      streams_.erase(stream->id());
+      return;
+    }
+    RpcCodec::send(conn, message, *response, codec_.checksum());
   }
 }
 
-void RpcChannel::doneCallback(::google::protobuf::Message* response, int64_t id)
+void RpcChannel::runMethod(const RpcDispatchTable::Method* method,
+                           int64_t id,
+                           int window,
+                           const std::string& payload,
+                           Timestamp receiveTime)
 {
+  google::protobuf::Message* request = services_->newRequest(*method);
+  request->ParseFromString(payload);
+  google::protobuf::Message* response = services_->newResponse(*method);
+  RpcController* controller = NULL;
+  if (window > 0)
+  {
+    controller = new RpcController;
+    controller->setStreamWindow(window);
+  }
+  method->service->CallMethod(method->descriptor, controller, request, response,
+      new DoneClosure(this, shared_from_this(), method, controller, response, id, receiveTime));
+  services_->releaseRequest(*method, request);
+}
+
+void RpcChannel::doneCallback(const RpcDispatchTable::Method* method,
+                              RpcController* controller,
+                              ::google::protobuf::Message* response,
+                              int64_t id,
+                              Timestamp receiveTime)
+{
+  if (controller && controller->producer())
+  {
+    // responses are produced in the IO thread, as credit and the output buffer allow
+    ServerStreamPtr stream(new ServerStream(services_, stats_, method, controller, response,
+                                            id, receiveTime));
+    TcpConnectionPtr conn(connection());
+    if (conn)
+    {
+      conn->getLoop()->runInLoop(
+          boost::bind(&RpcChannel::startStream, shared_from_this(), stream));
+    }
+    if (method->executor)
+    {
+      method->executor->concurrentCalls.decrement();
+    }
+    return;
+  }
+  if (controller)
+  {
+    // the client asked for a stream, which the method didn't produce
+    TcpConnectionPtr conn(connection());
+    if (conn)
+    {
+      conn->getLoop()->runInLoop(
+          boost::bind(&RpcChannel::forgetStream, shared_from_this(), id));
+    }
+  }
+  delete controller;
+
   RpcMessage message;
   //远程调用后发送响应
   message.set_type(RESPONSE);
   message.set_id(id);
-  message.set_response(response->SerializeAsString()); // FIXME: error check
-  RpcCodec::send(conn_, message);
-  delete response;
+  // serialized in this thread, TcpConnection::send() passes it to the IO thread
+  RpcCodec::send(connection(), message, *response, codec_.checksum());
+  if (stats_)
+  {
+    stats_->end(method->descriptor, NO_ERROR, response->GetCachedSize(),
+                microSecondsSince(receiveTime));
+  }
+  services_->releaseResponse(*method, response);
+  if (method->executor)
+  {
+    method->executor->concurrentCalls.decrement();
+  }
+}
+
+void RpcChannel::sendError(int64_t id, int error)
+{
+  RpcMessage message;
+  message.set_type(ERROR);
+  message.set_id(id);
+  message.set_error(static_cast<ErrorCode>(error));
+  RpcCodec::send(connection(), message, codec_.checksum());
 }
 
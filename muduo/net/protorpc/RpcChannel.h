@@ -13,13 +13,18 @@
 
 #include <muduo/base/Atomic.h>
 #include <muduo/base/Mutex.h>
+#include <muduo/net/TimerId.h>
 #include <muduo/net/protorpc/RpcCodec.h>
+#include <muduo/net/protorpc/RpcDispatchTable.h>
 
 #include <google/protobuf/service.h>
 
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
 
 #include <map>
+#include <set>
 
 // Service and RpcChannel classes are incorporated from
 // google/protobuf/service.h
@@ -81,6 +86,9 @@ namespace muduo
 namespace net
 {
 
+class RpcController;
+class RpcStats;
+
 // Abstract interface for an RPC channel.  An RpcChannel represents a
 // communication line to a Service which can be used to call that Service's
 // methods.  The Service may be running on another machine.  Normally, you
@@ -90,7 +98,8 @@ namespace net
 //   RpcChannel* channel = new MyRpcChannel("remotehost.example.com:1234");
 //   MyService* service = new MyService::Stub(channel);
 //   service->MyMethod(request, &response, callback);
-class RpcChannel : public ::google::protobuf::RpcChannel
+class RpcChannel : public ::google::protobuf::RpcChannel,
+                   public boost::enable_shared_from_this<RpcChannel>
 {
  public:
   RpcChannel();
@@ -99,16 +108,55 @@ class RpcChannel : public ::google::protobuf::RpcChannel
 
   ~RpcChannel();
 
+  /// Thread safe.
   void setConnection(const TcpConnectionPtr& conn)
   {
+    MutexLockGuard lock(mutex_);
     conn_ = conn;
   }
 
-  void setServices(const std::map<std::string, ::google::protobuf::Service*>* services)
+  void setServices(RpcDispatchTable* services)
   {
     services_ = services;
   }
 
+  /// See RpcCodec::setChecksum(), a client picks the checksum of a
+  /// connection, the server follows.
+  void setChecksum(RpcCodec::Checksum checksum)
+  {
+    codec_.setChecksum(checksum);
+  }
+
+  void setAcceptedChecksums(int mask)
+  {
+    codec_.setAcceptedChecksums(mask);
+  }
+
+  /// Records calls made and served through this channel, NULL for none,
+  /// the default.  stats must outlive the channel and its calls.
+  void setStats(RpcStats* stats)
+  {
+    stats_ = stats;
+  }
+
+  /// Deadline of each call in seconds, 0 for none, the default.
+  /// A muduo::net::RpcController passed to CallMethod() overrides it.
+  /// On expiry, the controller (if any) is failed and done is run
+  /// with an empty response.
+  void setTimeout(double seconds)
+  {
+    timeout_ = seconds;
+  }
+
+  /// Number of calls waiting for responses.
+  size_t numOutstandingCalls() const;
+
+  /// Fails calls waiting for responses with NOT_CONNECTED, call it when
+  /// the connection is down, in its connection callback.  Calls made while
+  /// not connected fail at once, also those racing with this.  Streamed
+  /// ones are canceled on the server if still connected.
+  void failOutstandingCalls();
+
   // Call the given method of the remote service.  The signature of this
   // procedure looks the same as Service::CallMethod(), but the requirements
   // are less strict in one important way:  the request and response objects
@@ -124,27 +172,99 @@ class RpcChannel : public ::google::protobuf::RpcChannel
                  Buffer* buf,
                  Timestamp receiveTime);
 
+  /// Server side, set them as callbacks of the connection to pause
+  /// streamed responses while its output buffer is above the high-water mark.
+  void onHighWaterMark(const TcpConnectionPtr& conn, size_t len);
+  void onWriteComplete(const TcpConnectionPtr& conn);
+
  private:
   void onRpcMessage(const TcpConnectionPtr& conn,
                     const RpcMessage& message,
+                    const StringPiece& payload,
+                    Timestamp receiveTime);
+
+  // in the executor's pool
+  void runMethod(const RpcDispatchTable::Method* method,
+                 int64_t id,
+                 int window,
+                 const std::string& payload,
+                 Timestamp receiveTime);
+
+  // controller is NULL unless the client takes a stream
+  void doneCallback(const RpcDispatchTable::Method* method,
+                    RpcController* controller,
+                    ::google::protobuf::Message* response,
+                    int64_t id,
                     Timestamp receiveTime);
 
-  void doneCallback(::google::protobuf::Message* response, int64_t id);
+  void onStreamResponse(const TcpConnectionPtr& conn,
+                        int64_t id,
+                        const StringPiece& payload);
+
+  // error is one of ErrorCode in rpc.proto
+  void sendError(int64_t id, int error);
+
+  // runs doneCallback(), instead of NewCallback() which takes two args
+  class DoneClosure;
 
   struct OutstandingCall
   {
     ::google::protobuf::Message* response;
     ::google::protobuf::Closure* done;
+    ::google::protobuf::RpcController* controller;
+    TimerId timer;
+    bool hasTimer;
+    int window;  // 0 unless streamed, controller is a muduo one then
+    int received;  // streamed responses
+    size_t receivedBytes;  // of streamed responses
+    RpcStats* stats;  // may be NULL
+    const ::google::protobuf::MethodDescriptor* method;
+    Timestamp sendTime;
   };
 
+  class CallTable;
+  typedef boost::shared_ptr<CallTable> CallTablePtr;
+
+  // a streamed response being sent, in the IO thread
+  class ServerStream;
+  typedef boost::shared_ptr<ServerStream> ServerStreamPtr;
+
+  void startStream(const ServerStreamPtr& stream);
+  void forgetStream(int64_t id);
+  void pumpStream(const TcpConnectionPtr& conn, ServerStream* stream);
+
+  static void onTimeout(const boost::weak_ptr<CallTable>& weakTable,
+                        const boost::weak_ptr<TcpConnection>& weakConn,
+                        RpcCodec::Checksum checksum,
+                        int64_t id);
+  // tells the server to drop the stream of a call failed early
+  static void sendCancel(const TcpConnectionPtr& conn, int64_t id, RpcCodec::Checksum checksum);
+  // error is one of ErrorCode in rpc.proto
+  static void fail(const OutstandingCall& call, int error);
+  static void record(const OutstandingCall& call, int error, size_t responseBytes);
+
+  TcpConnectionPtr connection() const
+  {
+    MutexLockGuard lock(mutex_);
+    return conn_;
+  }
+
   RpcCodec codec_;
-  TcpConnectionPtr conn_;
+  mutable MutexLock mutex_;
+  TcpConnectionPtr conn_;  // @GuardedBy mutex_
   AtomicInt64 id_;
+  double timeout_;
+
+  // shared with timers, which may outlive the channel
+  CallTablePtr outstandings_;
 
-  MutexLock mutex_;
-  std::map<int64_t, OutstandingCall> outstandings_;
+  RpcDispatchTable* services_;
+  RpcStats* stats_;
 
-  const std::map<std::string, ::google::protobuf::Service*>* services_;
+  // in the IO thread
+  std::map<int64_t, ServerStreamPtr> streams_;
+  std::set<int64_t> pendingStreams_;  // of requests whose done is yet to run
+  bool paused_;  // output buffer above the high-water mark
 };
 typedef boost::shared_ptr<RpcChannel> RpcChannelPtr;
 
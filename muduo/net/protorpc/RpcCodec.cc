@@ -8,18 +8,27 @@
 
 #include <muduo/net/protorpc/RpcCodec.h>
 
+#include <muduo/base/Crc32c.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/Endian.h>
 #include <muduo/net/TcpConnection.h>
 
+#include <muduo/net/protorpc/BufferStream.h>
 #include <muduo/net/protorpc/rpc.pb.h>
 #include <muduo/net/protorpc/google-inl.h>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
 #include <zlib.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+using ::google::protobuf::io::CodedInputStream;
+using ::google::protobuf::io::CodedOutputStream;
+using ::google::protobuf::internal::WireFormatLite;
+
 namespace
 {
   int ProtobufVersionCheck()
@@ -28,39 +37,154 @@ namespace
     return 0;
   }
   int dummy = ProtobufVersionCheck();
+
+  // by RpcCodec::Checksum
+  const char* const kTags[] = { "RPC0", "RPCC", "RPCN" };
+  const int kNumChecksums = 3;
+
+  int32_t checksumOf(RpcCodec::Checksum checksum, const char* data, size_t len)
+  {
+    switch (checksum)
+    {
+     case RpcCodec::kAdler32:
+       return static_cast<int32_t>(
+           ::adler32(1, reinterpret_cast<const Bytef*>(data), static_cast<int>(len)));
+     case RpcCodec::kCrc32c:
+       return static_cast<int32_t>(Crc32c::value(data, len));
+     default:
+       return 0;
+    }
+  }
+
+  // Parses all but the request or response field, which is returned as
+  // payload pointing into data, so it's parsed only once, in place.
+  // A second payload field is an error, protobuf would take the last one,
+  // no encoder sends two.
+  bool parseEnvelope(const char* data, int len, RpcMessage* message, StringPiece* payload)
+  {
+    const uint8_t* begin = reinterpret_cast<const uint8_t*>(data);
+    CodedInputStream input(begin, len);
+    int payloadBegin = len;
+    int payloadEnd = len;
+    while (true)
+    {
+      int tagBegin = input.CurrentPosition();
+      uint32_t tag = input.ReadTag();
+      if (tag == 0)
+      {
+        break;
+      }
+      int field = WireFormatLite::GetTagFieldNumber(tag);
+      if ((field == RpcMessage::kRequestFieldNumber || field == RpcMessage::kResponseFieldNumber)
+          && WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+      {
+        uint32_t size = 0;
+        if (payloadBegin != len || !input.ReadVarint32(&size))
+        {
+          return false;
+        }
+        int start = input.CurrentPosition();
+        if (!input.Skip(static_cast<int>(size)))
+        {
+          return false;
+        }
+        payload->set(data + start, static_cast<int>(size));
+        payloadBegin = tagBegin;
+        payloadEnd = input.CurrentPosition();
+      }
+      else if (!WireFormatLite::SkipField(&input, tag))
+      {
+        return false;
+      }
+    }
+    if (!input.ConsumedEntireMessage())
+    {
+      return false;
+    }
+
+    // fields before and after the payload
+    if (!message->ParsePartialFromArray(data, payloadBegin))
+    {
+      return false;
+    }
+    CodedInputStream rest(begin + payloadEnd, len - payloadEnd);
+    return message->MergePartialFromCodedStream(&rest)
+        && message->IsInitialized();
+  }
 }
 
 void RpcCodec::send(const TcpConnectionPtr& conn,
-                    const RpcMessage& message)
+                    const RpcMessage& message,
+                    Checksum checksum)
 {
   // FIXME: can we move serialization & checksum to other thread?
   Buffer buf;
-  buf.append("RPC0", 4);
+  encode(&buf, message, NULL, checksum);
+  conn->send(&buf);
+}
+
+void RpcCodec::send(const TcpConnectionPtr& conn,
+                    const RpcMessage& message,
+                    const ::google::protobuf::Message& payload,
+                    Checksum checksum)
+{
+  Buffer buf;
+  encode(&buf, message, &payload, checksum);
+  conn->send(&buf);
+}
+
+void RpcCodec::encode(Buffer* buf,
+                      const RpcMessage& message,
+                      const ::google::protobuf::Message* payload,
+                      Checksum checksum)
+{
+  assert(buf->readableBytes() == 0);
+  assert(checksum >= 0 && checksum < kNumChecksums);
+  buf->append(kTags[checksum], kHeaderLen);
 
   // code copied from MessageLite::SerializeToArray() and MessageLite::SerializePartialToArray().
   GOOGLE_DCHECK(message.IsInitialized()) << InitializationErrorMessage("serialize", message);
 
+  // payload goes as a bytes field after the others, same on the wire
+  // as if it were set in message, but without serializing it twice
   int byte_size = message.ByteSize();
-  buf.ensureWritableBytes(byte_size + kHeaderLen);
-
-  uint8_t* start = reinterpret_cast<uint8_t*>(buf.beginWrite());
-  uint8_t* end = message.SerializeWithCachedSizesToArray(start);
-  if (end - start != byte_size)
+  uint32_t payloadTag = 0;
+  int payloadSize = 0;
+  if (payload)
   {
-    ByteSizeConsistencyError(byte_size, message.ByteSize(), static_cast<int>(end - start));
+    int field = message.type() == REQUEST ? RpcMessage::kRequestFieldNumber
+                                          : RpcMessage::kResponseFieldNumber;
+    assert(!message.has_request() && !message.has_response());
+    payloadTag = WireFormatLite::MakeTag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+    payloadSize = payload->ByteSize();
+    byte_size += static_cast<int>(CodedOutputStream::VarintSize32(payloadTag)
+                                  + CodedOutputStream::VarintSize32(payloadSize))
+               + payloadSize;
   }
-  buf.hasWritten(byte_size);
+  buf->ensureWritableBytes(byte_size + kHeaderLen);
 
-  int32_t checkSum = static_cast<int32_t>(
-      ::adler32(1,
-        reinterpret_cast<const Bytef*>(buf.peek()),
-        static_cast<int>(buf.readableBytes())));
-  buf.appendInt32(checkSum);
-  assert(buf.readableBytes() == implicit_cast<size_t>(kHeaderLen + byte_size + kHeaderLen));
-  int32_t len = sockets::hostToNetwork32(static_cast<int32_t>(buf.readableBytes()));
-  buf.prepend(&len, sizeof len);
+  {
+  BufferOutputStream stream(buf);
+  CodedOutputStream output(&stream);
+  message.SerializeWithCachedSizes(&output);
+  if (payload)
+  {
+    output.WriteTag(payloadTag);
+    output.WriteVarint32(payloadSize);
+    payload->SerializeWithCachedSizes(&output);
+  }
+  }
+  if (buf->readableBytes() != implicit_cast<size_t>(kHeaderLen + byte_size))
+  {
+    ByteSizeConsistencyError(byte_size, message.ByteSize(),
+                             static_cast<int>(buf->readableBytes() - kHeaderLen));
+  }
 
-  conn->send(&buf);
+  int32_t checkSum = checksumOf(checksum, buf->peek(), buf->readableBytes());
+  buf->appendInt32(checkSum);
+  assert(buf->readableBytes() == implicit_cast<size_t>(kHeaderLen + byte_size + kHeaderLen));
+  int32_t len = sockets::hostToNetwork32(static_cast<int32_t>(buf->readableBytes()));
+  buf->prepend(&len, sizeof len);
 }
 
 void RpcCodec::onMessage(const TcpConnectionPtr& conn,
@@ -74,21 +198,32 @@ void RpcCodec::onMessage(const TcpConnectionPtr& conn,
     if (len > kMaxMessageLen || len < kMinMessageLen)
     {
       errorCallback_(conn, buf, receiveTime, kInvalidLength);
+      break;
     }
     else if (buf->readableBytes() >= implicit_cast<size_t>(len + kHeaderLen))
     {
       RpcMessage message;//解出该消息结构后进行回调
+      StringPiece payload;
+      Checksum checksum = kAdler32;
       // FIXME: can we move deserialization & callback to other thread?
-      ErrorCode errorCode = parse(buf->peek()+kHeaderLen, len, &message);
+      ErrorCode errorCode = parse(buf->peek()+kHeaderLen, len,
+                                  acceptedChecksums_ | (1 << this->checksum()),
+                                  &message, &payload, &checksum);
       if (errorCode == kNoError)
       {
+        if (checksum != this->checksum())
+        {
+          // answers in kind
+          checksum_.getAndSet(checksum);
+        }
         // FIXME: try { } catch (...) { }
-        messageCallback_(conn, message, receiveTime);
+        messageCallback_(conn, message, payload, receiveTime);
         buf->retrieve(kHeaderLen+len);
       }
       else
       {
         errorCallback_(conn, buf, receiveTime, errorCode);
+        break;
       }
     }
     else
@@ -149,36 +284,42 @@ int32_t RpcCodec::asInt32(const char* buf)
   return sockets::networkToHost32(be32);
 }
 
-RpcCodec::ErrorCode RpcCodec::parse(const char* buf, int len, RpcMessage* message)
+RpcCodec::ErrorCode RpcCodec::parse(const char* buf,
+                                    int len,
+                                    int acceptedChecksums,
+                                    RpcMessage* message,
+                                    StringPiece* payload,
+                                    Checksum* checksum)
 {
   ErrorCode error = kNoError;
 
+  int kind = 0;
+  while (kind < kNumChecksums && memcmp(buf, kTags[kind], kHeaderLen) != 0)
+  {
+    ++kind;
+  }
+  if (kind == kNumChecksums || (acceptedChecksums & (1 << kind)) == 0)
+  {
+    return kUnknownMessageType;
+  }
+  *checksum = static_cast<Checksum>(kind);
+
   // check sum
   int32_t expectedCheckSum = asInt32(buf + len - kHeaderLen);
-  int32_t checkSum = static_cast<int32_t>(
-      ::adler32(1,
-                reinterpret_cast<const Bytef*>(buf),
-                static_cast<int>(len - kHeaderLen)));
+  int32_t checkSum = checksumOf(*checksum, buf, static_cast<size_t>(len - kHeaderLen));
 
   if (checkSum == expectedCheckSum)
   {
-    if (memcmp(buf, "RPC0", kHeaderLen) == 0)
+    // parse from buffer
+    const char* data = buf + kHeaderLen;
+    int32_t dataLen = len - 2*kHeaderLen;
+    if (parseEnvelope(data, dataLen, message, payload))
     {
-      // parse from buffer
-      const char* data = buf + kHeaderLen;
-      int32_t dataLen = len - 2*kHeaderLen;
-      if (message->ParseFromArray(data, dataLen))
-      {
-        error = kNoError;
-      }
-      else
-      {
-        error = kParseError;
-      }
+      error = kNoError;
     }
     else
     {
-      error = kUnknownMessageType;
+      error = kParseError;
     }
   }
   else
@@ -11,11 +11,21 @@
 #ifndef MUDUO_NET_PROTORPC_RPCCODEC_H
 #define MUDUO_NET_PROTORPC_RPCCODEC_H
 
+#include <muduo/base/Atomic.h>
+#include <muduo/base/StringPiece.h>
 #include <muduo/base/Timestamp.h>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 
+namespace google
+{
+namespace protobuf
+{
+class Message;
+}
+}
+
 namespace muduo
 {
 namespace net
@@ -27,6 +37,14 @@ typedef boost::shared_ptr<TcpConnection> TcpConnectionPtr;
 
 class RpcMessage;
 
+// struct RpcTransportFormat __attribute__ ((__packed__))
+// {
+//   int32_t  len;
+//   char     tag[4];  // "RPC0" adler32, "RPCC" crc32c, "RPCN" no checksum
+//   char     rpcMessage[len-8];
+//   int32_t  checkSum; // of tag and rpcMessage, 0 for "RPCN"
+// }
+
 class RpcCodec
 {
  public:
@@ -40,8 +58,18 @@ class RpcCodec
     kParseError,
   };
 
+  enum Checksum
+  {
+    kAdler32 = 0,  // understood by all versions
+    kCrc32c = 1,
+    kNoChecksum = 2,  // for trusted links only
+  };
+
+  // The request or response is left out of RpcMessage, it's passed as
+  // payload pointing into the input buffer, valid during the callback.
   typedef boost::function<void (const TcpConnectionPtr&,
                                 const RpcMessage&,
+                                const StringPiece& payload,
                                 Timestamp)> ProtobufMessageCallback;
 
   typedef boost::function<void (const TcpConnectionPtr&,
@@ -49,27 +77,61 @@ class RpcCodec
                                 Timestamp,
                                 ErrorCode)> ErrorCallback;
 
+  static const int kDefaultAcceptedChecksums = (1 << kAdler32) | (1 << kCrc32c);
+
   explicit RpcCodec(const ProtobufMessageCallback& messageCb)
     : messageCallback_(messageCb),
-      errorCallback_(defaultErrorCallback)
+      errorCallback_(defaultErrorCallback),
+      acceptedChecksums_(kDefaultAcceptedChecksums)
   {
   }
 
   RpcCodec(const ProtobufMessageCallback& messageCb, const ErrorCallback& errorCb)
     : messageCallback_(messageCb),
-      errorCallback_(errorCb)
+      errorCallback_(errorCb),
+      acceptedChecksums_(kDefaultAcceptedChecksums)
   {
   }
 
+  /// Checksum of frames to send, kAdler32 by default.  It follows the
+  /// checksum of frames received, so a server answers each client with
+  /// the one the client picked.  Thread safe.
+  void setChecksum(Checksum checksum)
+  { checksum_.getAndSet(checksum); }
+
+  Checksum checksum() const
+  { return static_cast<Checksum>(checksum_.get()); }
+
+  /// Bit mask of (1 << Checksum) taken from the peer, besides the one sent,
+  /// frames with others are errors.  kAdler32 and kCrc32c by default.
+  void setAcceptedChecksums(int mask)
+  { acceptedChecksums_ = mask; }
+
+  static void send(const TcpConnectionPtr& conn,
+                   const RpcMessage& message,
+                   Checksum checksum = kAdler32);
+
+  // Sends payload as the request or response of message, by its type.
   static void send(const TcpConnectionPtr& conn,
-                   const RpcMessage& message);
+                   const RpcMessage& message,
+                   const ::google::protobuf::Message& payload,
+                   Checksum checksum = kAdler32);
+
+  // Serializes message and payload (may be NULL) into buf, in one frame
+  // without intermediate copies.
+  static void encode(Buffer* buf,
+                     const RpcMessage& message,
+                     const ::google::protobuf::Message* payload,
+                     Checksum checksum = kAdler32);
 
   void onMessage(const TcpConnectionPtr& conn,
                  Buffer* buf,
                  Timestamp receiveTime);
 
   static const string& errorCodeToString(ErrorCode errorCode);
-  static ErrorCode parse(const char* buf, int len, RpcMessage* message);
+  // checksum is set to the one of the frame
+  static ErrorCode parse(const char* buf, int len, int acceptedChecksums,
+                         RpcMessage* message, StringPiece* payload, Checksum* checksum);
   static int32_t asInt32(const char* buf);
 
   static void defaultErrorCallback(const TcpConnectionPtr&,
@@ -80,6 +142,8 @@ class RpcCodec
  private:
   ProtobufMessageCallback messageCallback_;
   ErrorCallback errorCallback_;
+  mutable AtomicInt32 checksum_;
+  int acceptedChecksums_;
 
   const static int kHeaderLen = sizeof(int32_t);
   const static int kMinMessageLen = 2*kHeaderLen; // RPC0 + checkSum
@@ -0,0 +1,151 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PROTORPC_RPCCONTROLLER_H
+#define MUDUO_NET_PROTORPC_RPCCONTROLLER_H
+
+#include <google/protobuf/service.h>
+
+#include <boost/function.hpp>
+
+#include <string>
+
+namespace google {
+namespace protobuf {
+
+class Message;
+
+}  // namespace protobuf
+}  // namespace google
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Per-call state for RpcChannel: an optional deadline, the error of a
+/// failed call, and streamed responses.  Canceling is not supported.
+///
+/// Check Failed() in the done closure, the response is empty then.
+///
+class RpcController : public ::google::protobuf::RpcController
+{
+ public:
+  typedef boost::function<void (const ::google::protobuf::Message&)> StreamCallback;
+  typedef boost::function<bool (::google::protobuf::Message*)> Producer;
+
+  static const int kDefaultStreamWindow = 16;
+
+  RpcController()
+    : timeout_(0),
+      failed_(false),
+      errorCode_(0),
+      streamWindow_(0)
+  {
+  }
+
+  /// Deadline of the call in seconds, overrides RpcChannel::setTimeout().
+  /// 0 for the channel's.  A streamed call must end by then, it's not
+  /// renewed by each response, the server is told to stop on expiry.
+  void setTimeout(double seconds)
+  { timeout_ = seconds; }
+
+  double timeout() const
+  { return timeout_; }
+
+  /// ErrorCode in rpc.proto, set by RpcChannel along with ErrorText().
+  int errorCode() const
+  { return errorCode_; }
+
+  void setErrorCode(int code)
+  { errorCode_ = code; }
+
+  /// Streams the response: cb gets each response but the last one, which
+  /// goes to done as usual.  cb runs in the IO thread, the message is
+  /// cleared after it returns.  Servers which don't stream send the last
+  /// one only.
+  void setStreamCallback(const StreamCallback& cb)
+  { streamCallback_ = cb; }
+
+  const StreamCallback& streamCallback() const
+  { return streamCallback_; }
+
+  /// Responses the server may send ahead of the client, which gives back
+  /// credit as cb consumes them.  0 for kDefaultStreamWindow.
+  void setStreamWindow(int responses)
+  { streamWindow_ = responses; }
+
+  int streamWindow() const
+  { return streamWindow_; }
+
+  /// Server side, true if the client takes a stream, set by RpcChannel.
+  bool streaming() const
+  { return streamWindow_ > 0; }
+
+  /// Server side, a streaming method sets it before running done.
+  /// producer fills each response but the last, which is the one passed to
+  /// done, and returns false when there is no more.  It's called in the IO
+  /// thread as the client's credit and the connection's output buffer
+  /// allow, so the server keeps one response of the stream in memory.
+  void setProducer(const Producer& producer)
+  { producer_ = producer; }
+
+  const Producer& producer() const
+  { return producer_; }
+
+  // client side
+
+  virtual void Reset()
+  {
+    failed_ = false;
+    errorCode_ = 0;
+    errorText_.clear();
+  }
+
+  virtual bool Failed() const
+  { return failed_; }
+
+  virtual std::string ErrorText() const
+  { return errorText_; }
+
+  virtual void StartCancel()
+  {
+  }
+
+  // server side
+
+  virtual void SetFailed(const std::string& reason)
+  {
+    failed_ = true;
+    errorText_ = reason;
+  }
+
+  virtual bool IsCanceled() const
+  { return false; }
+
+  virtual void NotifyOnCancel(::google::protobuf::Closure* /* callback */)
+  {
+  }
+
+ private:
+  double timeout_;
+  bool failed_;
+  int errorCode_;
+  std::string errorText_;
+  int streamWindow_;
+  StreamCallback streamCallback_;
+  Producer producer_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_RPCCONTROLLER_H
@@ -0,0 +1,184 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/protorpc/RpcDispatchTable.h>
+
+#include <muduo/base/Logging.h>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/service.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+class RpcDispatchTable::FreeLists : boost::noncopyable
+{
+ public:
+  ~FreeLists()
+  {
+    for (size_t i = 0; i < lists_.size(); ++i)
+    {
+      for (size_t j = 0; j < lists_[i].size(); ++j)
+      {
+        delete lists_[i][j];
+      }
+    }
+  }
+
+  ::google::protobuf::Message* take(int slot)
+  {
+    if (static_cast<size_t>(slot) < lists_.size() && !lists_[slot].empty())
+    {
+      ::google::protobuf::Message* message = lists_[slot].back();
+      lists_[slot].pop_back();
+      return message;
+    }
+    return NULL;
+  }
+
+  // return false if the list is full
+  bool give(int slot, ::google::protobuf::Message* message)
+  {
+    if (static_cast<size_t>(slot) >= lists_.size())
+    {
+      lists_.resize(slot + 1);
+    }
+    if (lists_[slot].size() < kMaxFreeMessages)
+    {
+      lists_[slot].push_back(message);
+      return true;
+    }
+    return false;
+  }
+
+ private:
+  // enough for a burst of calls in one loop iteration
+  static const size_t kMaxFreeMessages = 64;
+
+  std::vector<std::vector< ::google::protobuf::Message*> > lists_;
+};
+
+RpcDispatchTable::RpcDispatchTable()
+{
+}
+
+RpcDispatchTable::~RpcDispatchTable()
+{
+}
+
+void RpcDispatchTable::registerService(::google::protobuf::Service* service)
+{
+  const ::google::protobuf::ServiceDescriptor* desc = service->GetDescriptor();
+  std::vector<int>& ids = services_[desc->full_name()];
+  if (!ids.empty())
+  {
+    // re-registered, points old ids to the new service
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+      methods_[ids[i]].service = service;
+    }
+    return;
+  }
+  for (int i = 0; i < desc->method_count(); ++i)
+  {
+    const ::google::protobuf::MethodDescriptor* method = desc->method(i);
+    Method m = { static_cast<int>(methods_.size()),
+                 service,
+                 method,
+                 &service->GetRequestPrototype(method),
+                 &service->GetResponsePrototype(method),
+                 NULL };
+    ids.push_back(m.id);
+    methods_.push_back(m);
+  }
+  LOG_INFO << "RpcDispatchTable::registerService " << desc->full_name()
+           << " with " << desc->method_count() << " methods";
+}
+
+bool RpcDispatchTable::setExecutor(const std::string& service,
+                                   const std::string& method,
+                                   ThreadPool* pool,
+                                   int maxConcurrentCalls)
+{
+  std::map<std::string, std::vector<int> >::const_iterator it = services_.find(service);
+  if (it == services_.end())
+  {
+    return false;
+  }
+  bool found = false;
+  const std::vector<int>& ids = it->second;
+  for (size_t i = 0; i < ids.size(); ++i)
+  {
+    Method& m = methods_[ids[i]];
+    if (method.empty() || m.descriptor->name() == method)
+    {
+      // each method has its own limit
+      Executor* executor = new Executor;
+      executors_.push_back(executor);
+      executor->pool = pool;
+      executor->maxConcurrentCalls = maxConcurrentCalls;
+      m.executor = executor;
+      found = true;
+    }
+  }
+  return found;
+}
+
+const RpcDispatchTable::Method* RpcDispatchTable::find(const std::string& service,
+                                                       const std::string& method) const
+{
+  std::map<std::string, std::vector<int> >::const_iterator it = services_.find(service);
+  if (it != services_.end())
+  {
+    // services have a few methods, scanning beats hashing
+    const std::vector<int>& ids = it->second;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+      const Method& m = methods_[ids[i]];
+      if (m.descriptor->name() == method)
+      {
+        return &m;
+      }
+    }
+  }
+  return NULL;
+}
+
+RpcDispatchTable::FreeLists& RpcDispatchTable::freeLists()
+{
+  FreeLists*& lists = freeLists_.value();
+  if (lists == NULL)
+  {
+    lists = new FreeLists;
+    MutexLockGuard lock(mutex_);
+    allFreeLists_.push_back(lists);
+  }
+  return *lists;
+}
+
+::google::protobuf::Message* RpcDispatchTable::take(int slot,
+                                                    const ::google::protobuf::Message& prototype)
+{
+  ::google::protobuf::Message* message = freeLists().take(slot);
+  if (message == NULL)
+  {
+    allocated_.increment();
+    message = prototype.New();
+  }
+  return message;
+}
+
+void RpcDispatchTable::give(int slot, ::google::protobuf::Message* message)
+{
+  message->Clear();
+  if (!freeLists().give(slot, message))
+  {
+    delete message;
+  }
+}
@@ -0,0 +1,138 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PROTORPC_RPCDISPATCHTABLE_H
+#define MUDUO_NET_PROTORPC_RPCDISPATCHTABLE_H
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/ThreadLocal.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace google {
+namespace protobuf {
+
+class Message;
+class MethodDescriptor;
+class Service;
+
+}  // namespace protobuf
+}  // namespace google
+
+namespace muduo
+{
+
+class ThreadPool;
+
+namespace net
+{
+
+///
+/// Methods of registered services, resolved once at registration.
+///
+/// Request and response messages are recycled through free lists of
+/// the calling thread, so a busy server stops allocating them.  The
+/// lists are kept after their threads exit, and freed with the table.
+///
+class RpcDispatchTable : boost::noncopyable
+{
+ public:
+  /// Where a method runs, if not in the IO thread.
+  struct Executor : boost::noncopyable
+  {
+    ThreadPool* pool;
+    int maxConcurrentCalls;  // 0 for no limit
+    AtomicInt32 concurrentCalls;  // queued or running
+  };
+
+  struct Method
+  {
+    int id;  // index in the table
+    ::google::protobuf::Service* service;
+    const ::google::protobuf::MethodDescriptor* descriptor;
+    const ::google::protobuf::Message* requestPrototype;
+    const ::google::protobuf::Message* responsePrototype;
+    Executor* executor;  // NULL for the IO thread
+  };
+
+  RpcDispatchTable();
+  ~RpcDispatchTable();
+
+  /// Not thread safe, register all services before serving.
+  void registerService(::google::protobuf::Service* service);
+
+  /// Runs method of service in pool, or all its methods if method is
+  /// empty, with at most maxConcurrentCalls of each method at once.
+  /// Not thread safe, call before serving.
+  /// return false if not found
+  bool setExecutor(const std::string& service,
+                   const std::string& method,
+                   ThreadPool* pool,
+                   int maxConcurrentCalls);
+
+  /// NULL if not found.  Thread safe.
+  const Method* find(const std::string& service, const std::string& method) const;
+
+  /// Thread safe.
+  bool hasService(const std::string& service) const
+  { return services_.find(service) != services_.end(); }
+
+  const Method& method(int id) const
+  { return methods_[id]; }
+
+  int numMethods() const
+  { return static_cast<int>(methods_.size()); }
+
+  /// Takes one from this thread's free list, or allocates one.
+  ::google::protobuf::Message* newRequest(const Method& method)
+  { return take(2 * method.id, *method.requestPrototype); }
+
+  ::google::protobuf::Message* newResponse(const Method& method)
+  { return take(2 * method.id + 1, *method.responsePrototype); }
+
+  /// Clears message and keeps it for reuse in this thread.
+  void releaseRequest(const Method& method, ::google::protobuf::Message* request)
+  { give(2 * method.id, request); }
+
+  void releaseResponse(const Method& method, ::google::protobuf::Message* response)
+  { give(2 * method.id + 1, response); }
+
+  /// Messages allocated so far, not taken from free lists.
+  int64_t numAllocated() const
+  { return allocated_.get(); }
+
+ private:
+  // free lists of one thread, by 2 * id for requests, 2 * id + 1 for responses
+  class FreeLists;
+
+  FreeLists& freeLists();
+  ::google::protobuf::Message* take(int slot, const ::google::protobuf::Message& prototype);
+  void give(int slot, ::google::protobuf::Message* message);
+
+  std::vector<Method> methods_;
+  // full name of service to ids of its methods
+  std::map<std::string, std::vector<int> > services_;
+  boost::ptr_vector<Executor> executors_;
+  MutexLock mutex_;
+  boost::ptr_vector<FreeLists> allFreeLists_;  // @GuardedBy mutex_
+  ThreadLocal<FreeLists*> freeLists_;
+  mutable AtomicInt64 allocated_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_RPCDISPATCHTABLE_H
@@ -22,7 +22,9 @@ using namespace muduo::net;
 RpcServer::RpcServer(EventLoop* loop,
                        const InetAddress& listenAddr)
   : loop_(loop),
-    server_(loop, listenAddr, "RpcServer")
+    server_(loop, listenAddr, "RpcServer"),
+    streamHighWaterMark_(1024 * 1024),
+    acceptedChecksums_(RpcCodec::kDefaultAcceptedChecksums)
 {
   server_.setConnectionCallback(
       boost::bind(&RpcServer::onConnection, this, _1));
@@ -32,8 +34,21 @@ RpcServer::RpcServer(EventLoop* loop,
 
 void RpcServer::registerService(google::protobuf::Service* service)
 {
-  const google::protobuf::ServiceDescriptor* desc = service->GetDescriptor();
-  services_[desc->full_name()] = service;
+  services_.registerService(service);
+}
+
+void RpcServer::setExecutor(google::protobuf::Service* service,
+                            const std::string& method,
+                            ThreadPool* pool,
+                            int maxConcurrentCalls)
+{
+  bool found = services_.setExecutor(service->GetDescriptor()->full_name(),
+                                     method, pool, maxConcurrentCalls);
+  if (!found)
+  {
+    LOG_ERROR << "RpcServer::setExecutor - no method " << method
+              << " in " << service->GetDescriptor()->full_name();
+  }
 }
 
 void RpcServer::start()
@@ -50,13 +65,23 @@ void RpcServer::onConnection(const TcpConnectionPtr& conn)
   {
     RpcChannelPtr channel(new RpcChannel(conn));//channel管理新来的连接
     channel->setServices(&services_);//存放pb service的map结构交给channel
+    channel->setStats(&stats_);
+    channel->setAcceptedChecksums(acceptedChecksums_);
     conn->setMessageCallback(
         boost::bind(&RpcChannel::onMessage, get_pointer(channel), _1, _2, _3));//该连接消息来之后 回调RpcChannel的onMessage方法
+    // queued callbacks may run after the connection is down, they hold channel
+    conn->setHighWaterMarkCallback(
+        boost::bind(&RpcChannel::onHighWaterMark, channel, _1, _2),
+        streamHighWaterMark_);
+    conn->setWriteCompleteCallback(
+        boost::bind(&RpcChannel::onWriteComplete, channel, _1));
     conn->setContext(channel);
   }
   else
   {
     conn->setContext(RpcChannelPtr());
+    conn->setHighWaterMarkCallback(HighWaterMarkCallback(), 0);
+    conn->setWriteCompleteCallback(WriteCompleteCallback());
     // FIXME:
   }
 }
@@ -12,6 +12,8 @@
 #define MUDUO_NET_PROTORPC_RPCSERVER_H
 
 #include <muduo/net/TcpServer.h>
+#include <muduo/net/protorpc/RpcDispatchTable.h>
+#include <muduo/net/protorpc/RpcStats.h>
 
 namespace google {
 namespace protobuf {
@@ -38,8 +40,36 @@ class RpcServer
   }
 
   void registerService(::google::protobuf::Service*);
+
+  /// Runs method of service in pool instead of the IO threads, or all
+  /// its methods if method is empty.  Calls beyond maxConcurrentCalls
+  /// (0 for no limit) of a method, or when the pool's queue is full, are
+  /// rejected with OVERLOADED.  The service must be registered.
+  void setExecutor(::google::protobuf::Service* service,
+                   const std::string& method,
+                   ThreadPool* pool,
+                   int maxConcurrentCalls = 0);
+
+  /// Streamed responses pause while the output buffer of a connection
+  /// holds more than bytes, 1MB by default.  Call before start().
+  void setStreamHighWaterMark(size_t bytes)
+  { streamHighWaterMark_ = bytes; }
+
+  /// Checksums taken from clients, see RpcCodec::setAcceptedChecksums().
+  /// Call before start().
+  void setAcceptedChecksums(int mask)
+  { acceptedChecksums_ = mask; }
+
   void start();
 
+  const RpcDispatchTable& services() const
+  { return services_; }
+
+  /// Calls served, by method.
+  /// Use stats().registerCommands() to show them with Inspector.
+  RpcStats& stats()
+  { return stats_; }
+
  private:
   void onConnection(const TcpConnectionPtr& conn);
 
@@ -49,7 +79,10 @@ class RpcServer
 
   EventLoop* loop_;
   TcpServer server_;
-  std::map<std::string, ::google::protobuf::Service*> services_; //究竟有哪些service？
+  RpcDispatchTable services_; //究竟有哪些service？
+  size_t streamHighWaterMark_;
+  int acceptedChecksums_;
+  RpcStats stats_;
 };
 
 }
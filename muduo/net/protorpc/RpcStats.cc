@@ -0,0 +1,329 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/protorpc/RpcStats.h>
+
+#include <muduo/net/inspect/Inspector.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+
+#include <google/protobuf/descriptor.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <map>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Log-linear buckets of microseconds: values below 8 have their own,
+// every power of 2 above is split into 8, so a bucket is within 12.5%.
+class RpcStats::Histogram
+{
+ public:
+  Histogram()
+  {
+    memset(counts_, 0, sizeof counts_);
+  }
+
+  void add(int64_t value)
+  {
+    ++counts_[bucket(value)];
+  }
+
+  void merge(const Histogram& rhs)
+  {
+    for (int i = 0; i < kBuckets; ++i)
+    {
+      counts_[i] += rhs.counts_[i];
+    }
+  }
+
+  // upper bound of the bucket holding the q-th quantile, 0 if empty
+  int64_t percentile(double q) const
+  {
+    int64_t total = 0;
+    for (int i = 0; i < kBuckets; ++i)
+    {
+      total += counts_[i];
+    }
+    if (total == 0)
+    {
+      return 0;
+    }
+    int64_t rank = std::max(static_cast<int64_t>(q * static_cast<double>(total) + 0.999999),
+                            static_cast<int64_t>(1));
+    int64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i)
+    {
+      seen += counts_[i];
+      if (seen >= rank)
+      {
+        return upperBound(i);
+      }
+    }
+    return upperBound(kBuckets - 1);
+  }
+
+ private:
+  static const int kSubBits = 3;
+  static const int kSubBuckets = 1 << kSubBits;
+  static const int kMaxPower = 36;  // about 19 hours, longer ones go to the last
+  static const int kBuckets = (kMaxPower - kSubBits + 2) * kSubBuckets;
+
+  static int bucket(int64_t value)
+  {
+    if (value < kSubBuckets)
+    {
+      return value < 0 ? 0 : static_cast<int>(value);
+    }
+    int power = 63 - __builtin_clzll(static_cast<unsigned long long>(value));
+    if (power > kMaxPower)
+    {
+      return kBuckets - 1;
+    }
+    int sub = static_cast<int>(value >> (power - kSubBits)) & (kSubBuckets - 1);
+    return (power - kSubBits + 1) * kSubBuckets + sub;
+  }
+
+  static int64_t upperBound(int index)
+  {
+    if (index < kSubBuckets)
+    {
+      return index;
+    }
+    int power = index / kSubBuckets + kSubBits - 1;
+    int64_t width = static_cast<int64_t>(1) << (power - kSubBits);
+    int64_t lower = (kSubBuckets + index % kSubBuckets) * width;
+    return lower + width - 1;
+  }
+
+  int64_t counts_[kBuckets];
+};
+
+class RpcStats::Shard : boost::noncopyable
+{
+ public:
+  struct Counters
+  {
+    Counters()
+      : begun(0),
+        calls(0),
+        requestBytes(0),
+        responseBytes(0),
+        maxLatency(0)
+    {
+      memset(errors, 0, sizeof errors);
+    }
+
+    int64_t begun;
+    int64_t calls;
+    int64_t errors[kNumErrorCodes];
+    int64_t requestBytes;
+    int64_t responseBytes;
+    int64_t maxLatency;
+    Histogram latency;
+  };
+
+  typedef std::map<const ::google::protobuf::MethodDescriptor*, Counters*> CountersMap;
+
+  ~Shard()
+  {
+    for (CountersMap::iterator it = counters_.begin(); it != counters_.end(); ++it)
+    {
+      delete it->second;
+    }
+  }
+
+  // the lock is taken by other threads only to read
+  MutexLock& mutex() const { return mutex_; }
+
+  // @GuardedBy mutex_
+  Counters& of(const ::google::protobuf::MethodDescriptor* method)
+  {
+    Counters*& counters = counters_[method];
+    if (counters == NULL)
+    {
+      counters = new Counters;
+    }
+    return *counters;
+  }
+
+  // @GuardedBy mutex_
+  const CountersMap& counters() const { return counters_; }
+
+ private:
+  mutable MutexLock mutex_;
+  CountersMap counters_;
+};
+
+RpcStats::RpcStats()
+{
+}
+
+RpcStats::~RpcStats()
+{
+}
+
+RpcStats::Shard& RpcStats::shard()
+{
+  Shard*& shard = shard_.value();
+  if (shard == NULL)
+  {
+    shard = new Shard;
+    MutexLockGuard lock(mutex_);
+    shards_.push_back(shard);
+  }
+  return *shard;
+}
+
+void RpcStats::begin(const ::google::protobuf::MethodDescriptor* method, size_t requestBytes)
+{
+  Shard& s = shard();
+  MutexLockGuard lock(s.mutex());
+  Shard::Counters& counters = s.of(method);
+  ++counters.begun;
+  counters.requestBytes += static_cast<int64_t>(requestBytes);
+}
+
+void RpcStats::end(const ::google::protobuf::MethodDescriptor* method,
+                   int error,
+                   size_t responseBytes,
+                   int64_t latencyUs)
+{
+  Shard& s = shard();
+  MutexLockGuard lock(s.mutex());
+  Shard::Counters& counters = s.of(method);
+  ++counters.calls;
+  ++counters.errors[error >= 0 && error < kNumErrorCodes ? error : kNumErrorCodes - 1];
+  counters.responseBytes += static_cast<int64_t>(responseBytes);
+  counters.latency.add(latencyUs);
+  if (latencyUs > counters.maxLatency)
+  {
+    counters.maxLatency = latencyUs;
+  }
+}
+
+std::vector<RpcStats::MethodStats> RpcStats::snapshot() const
+{
+  // begin() and end() of a call may be in different threads
+  typedef std::map<std::string, Shard::Counters> Merged;
+  Merged merged;
+  {
+  MutexLockGuard lock(mutex_);
+  for (size_t i = 0; i < shards_.size(); ++i)
+  {
+    const Shard& s = shards_[i];
+    MutexLockGuard shardLock(s.mutex());
+    const Shard::CountersMap& counters = s.counters();
+    for (Shard::CountersMap::const_iterator it = counters.begin(); it != counters.end(); ++it)
+    {
+      Shard::Counters& sum = merged[it->first->full_name()];
+      const Shard::Counters& c = *it->second;
+      sum.begun += c.begun;
+      sum.calls += c.calls;
+      for (int e = 0; e < kNumErrorCodes; ++e)
+      {
+        sum.errors[e] += c.errors[e];
+      }
+      sum.requestBytes += c.requestBytes;
+      sum.responseBytes += c.responseBytes;
+      sum.maxLatency = std::max(sum.maxLatency, c.maxLatency);
+      sum.latency.merge(c.latency);
+    }
+  }
+  }
+
+  std::vector<MethodStats> result;
+  for (Merged::const_iterator it = merged.begin(); it != merged.end(); ++it)
+  {
+    const Shard::Counters& c = it->second;
+    MethodStats stats;
+    stats.method = it->first;
+    stats.calls = c.calls;
+    stats.inFlight = std::max(c.begun - c.calls, static_cast<int64_t>(0));
+    memcpy(stats.errors, c.errors, sizeof stats.errors);
+    stats.requestBytes = c.requestBytes;
+    stats.responseBytes = c.responseBytes;
+    // a bucket's upper bound may be above the largest value in it
+    stats.p50 = std::min(c.latency.percentile(0.5), c.maxLatency);
+    stats.p99 = std::min(c.latency.percentile(0.99), c.maxLatency);
+    stats.p999 = std::min(c.latency.percentile(0.999), c.maxLatency);
+    stats.maxLatency = c.maxLatency;
+    result.push_back(stats);
+  }
+  return result;
+}
+
+namespace
+{
+
+string methods(const RpcStats* stats, HttpRequest::Method, const Inspector::ArgList&)
+{
+  std::vector<RpcStats::MethodStats> snapshot = stats->snapshot();
+  string result;
+  char buf[256];
+  snprintf(buf, sizeof buf, "%-40s %10s %8s %8s %12s %12s %8s %8s %8s %8s\n",
+           "method", "calls", "inflight", "failed", "req_bytes", "resp_bytes",
+           "p50_us", "p99_us", "p999_us", "max_us");
+  result += buf;
+  for (size_t i = 0; i < snapshot.size(); ++i)
+  {
+    const RpcStats::MethodStats& s = snapshot[i];
+    snprintf(buf, sizeof buf,
+             "%-40s %10lld %8lld %8lld %12lld %12lld %8lld %8lld %8lld %8lld\n",
+             s.method.c_str(),
+             static_cast<long long>(s.calls),
+             static_cast<long long>(s.inFlight),
+             static_cast<long long>(s.calls - s.errors[0]),
+             static_cast<long long>(s.requestBytes),
+             static_cast<long long>(s.responseBytes),
+             static_cast<long long>(s.p50),
+             static_cast<long long>(s.p99),
+             static_cast<long long>(s.p999),
+             static_cast<long long>(s.maxLatency));
+    result += buf;
+  }
+  return result;
+}
+
+string errors(const RpcStats* stats, HttpRequest::Method, const Inspector::ArgList&)
+{
+  std::vector<RpcStats::MethodStats> snapshot = stats->snapshot();
+  string result;
+  char buf[256];
+  for (size_t i = 0; i < snapshot.size(); ++i)
+  {
+    const RpcStats::MethodStats& s = snapshot[i];
+    for (int e = 1; e < RpcStats::kNumErrorCodes; ++e)
+    {
+      if (s.errors[e] > 0)
+      {
+        std::string name = ErrorCode_IsValid(e) ? ErrorCode_Name(static_cast<ErrorCode>(e))
+                                                : "UNKNOWN";
+        snprintf(buf, sizeof buf, "%-40s %-16s %lld\n",
+                 s.method.c_str(), name.c_str(), static_cast<long long>(s.errors[e]));
+        result += buf;
+      }
+    }
+  }
+  return result;
+}
+
+}
+
+void RpcStats::registerCommands(Inspector* ins, const string& module)
+{
+  ins->add(module, "methods", boost::bind(methods, this, _1, _2),
+           "calls, bytes and latency percentiles of each method");
+  ins->add(module, "errors", boost::bind(errors, this, _1, _2),
+           "failed calls of each method by error code");
+}
@@ -0,0 +1,100 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PROTORPC_RPCSTATS_H
+#define MUDUO_NET_PROTORPC_RPCSTATS_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/ThreadLocal.h>
+#include <muduo/base/Types.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <string>
+#include <vector>
+
+namespace google {
+namespace protobuf {
+
+class MethodDescriptor;
+
+}  // namespace protobuf
+}  // namespace google
+
+namespace muduo
+{
+namespace net
+{
+
+class Inspector;
+
+///
+/// Counters and latency histograms of RPC methods, of a client or a server.
+///
+/// Each thread records into its own shard, merged when read, so recording
+/// never waits for other threads.
+///
+class RpcStats : boost::noncopyable
+{
+ public:
+  static const int kNumErrorCodes = 16;
+
+  struct MethodStats
+  {
+    std::string method;  // full name
+    int64_t calls;  // ended
+    int64_t inFlight;
+    int64_t errors[kNumErrorCodes];  // by ErrorCode in rpc.proto, [0] succeeded
+    int64_t requestBytes;
+    int64_t responseBytes;
+    // of ended calls, in microseconds
+    int64_t p50;
+    int64_t p99;
+    int64_t p999;
+    int64_t maxLatency;
+  };
+
+  RpcStats();
+  ~RpcStats();
+
+  /// A call of method starts.  Thread safe.
+  void begin(const ::google::protobuf::MethodDescriptor* method, size_t requestBytes);
+
+  /// A call of method ends with error, one of ErrorCode in rpc.proto.
+  /// Thread safe.
+  void end(const ::google::protobuf::MethodDescriptor* method,
+           int error,
+           size_t responseBytes,
+           int64_t latencyUs);
+
+  /// Merged from all threads, sorted by method.  Thread safe.
+  std::vector<MethodStats> snapshot() const;
+
+  /// Adds "methods" and "errors" commands of module to ins.
+  /// This object must outlive ins.
+  void registerCommands(Inspector* ins, const string& module);
+
+ private:
+  class Histogram;
+  class Shard;
+
+  // of this thread
+  Shard& shard();
+
+  mutable MutexLock mutex_;
+  boost::ptr_vector<Shard> shards_;  // @GuardedBy mutex_, kept after threads exit
+  ThreadLocal<Shard*> shard_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_RPCSTATS_H
@@ -0,0 +1,200 @@
+#include <muduo/net/protorpc/BalancedRpcChannel.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/RpcServer.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+#include <muduo/net/protorpc/tests/RpcTestUtil.h>
+#include <muduo/net/protorpc/tests/rpctest.pb.h>
+
+#include <boost/bind.hpp>
+
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+using namespace muduo;
+using namespace muduo::net;
+using namespace muduo::net::test;
+
+// Two servers in child processes, one of them killed while calls wait
+// for it.  Idempotent calls are retried on the other one, others fail.
+
+// answers after delay, never if it's negative
+class DelayedEcho : public rpctest::EchoService
+{
+ public:
+  DelayedEcho(EventLoop* loop, const string& name, double delay)
+    : loop_(loop),
+      name_(name),
+      delay_(delay)
+  {
+  }
+
+  virtual void Echo(::google::protobuf::RpcController*,
+                    const rpctest::EchoRequest* request,
+                    rpctest::EchoResponse* response,
+                    ::google::protobuf::Closure* done)
+  {
+    answer(request, response, done);
+  }
+
+  virtual void Update(::google::protobuf::RpcController*,
+                      const rpctest::EchoRequest* request,
+                      rpctest::EchoResponse* response,
+                      ::google::protobuf::Closure* done)
+  {
+    answer(request, response, done);
+  }
+
+ private:
+  void answer(const rpctest::EchoRequest* request,
+              rpctest::EchoResponse* response,
+              ::google::protobuf::Closure* done)
+  {
+    response->set_seq(request->seq());
+    response->set_payload(name_.c_str());
+    if (delay_ >= 0)
+    {
+      loop_->runAfter(delay_, boost::bind(&::google::protobuf::Closure::Run, done));
+    }
+  }
+
+  EventLoop* loop_;
+  const string name_;
+  const double delay_;
+};
+
+pid_t startServer(const InetAddress& addr, const string& name, double delay)
+{
+  pid_t pid = ::fork();
+  if (pid == 0)
+  {
+    // don't outlive a failed test
+    ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+    EventLoop loop;
+    DelayedEcho service(&loop, name, delay);
+    RpcServer server(&loop, addr);
+    server.registerService(&service);
+    server.start();
+    loop.loop();
+    _exit(0);
+  }
+  return pid;
+}
+
+EventLoop* g_loop;
+
+bool allConnected(const BalancedRpcChannel* channel)
+{
+  std::vector<BalancedRpcChannel::EndpointStats> stats(channel->stats());
+  for (size_t i = 0; i < stats.size(); ++i)
+  {
+    if (!stats[i].connected)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool allDone(const Call* calls, int n)
+{
+  for (int i = 0; i < n; ++i)
+  {
+    if (!calls[i].done)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::ERROR);
+  // before any EventLoop of this process
+  InetAddress silentAddr("127.0.0.1", 18046);
+  InetAddress slowAddr("127.0.0.1", 18047);
+  pid_t silent = startServer(silentAddr, "silent", -1);
+  pid_t slow = startServer(slowAddr, "slow", 0.5);
+
+  EventLoop loop;
+  g_loop = &loop;
+  std::vector<InetAddress> servers;
+  servers.push_back(silentAddr);
+  servers.push_back(slowAddr);
+  BalancedRpcChannel channel(&loop, servers, "Balanced");
+  channel.addIdempotentMethod("rpctest.EchoService.Echo");
+  channel.connect();
+  waitFor(g_loop, boost::bind(allConnected, &channel));
+
+  // the fewest calls in flight goes first, so each pair is split between
+  // the servers
+  rpctest::EchoService::Stub stub(&channel);
+  const int kCalls = 4;
+  Call calls[kCalls];
+  for (int i = 0; i < kCalls; ++i)
+  {
+    rpctest::EchoRequest request;
+    request.set_seq(i);
+    rpctest::EchoResponse* response = new rpctest::EchoResponse;
+    if (i < 2)
+    {
+      stub.Echo(&calls[i].controller, &request, response, NewCallback(onDone, &calls[i], response));
+    }
+    else
+    {
+      stub.Update(&calls[i].controller, &request, response, NewCallback(onDone, &calls[i], response));
+    }
+  }
+  std::vector<BalancedRpcChannel::EndpointStats> stats(channel.stats());
+  assert(stats[0].outstandingCalls == 2 && stats[1].outstandingCalls == 2);
+
+  // before the slow one answers
+  sleepInLoop(g_loop, 0.1);
+  ::kill(silent, SIGKILL);
+  ::waitpid(silent, NULL, 0);
+  waitFor(g_loop, boost::bind(allDone, calls, kCalls));
+
+  // both Echo calls are answered by the slow one, one of them on retry
+  for (int i = 0; i < 2; ++i)
+  {
+    assert(calls[i].error == NO_ERROR && calls[i].seq == i && calls[i].payload == "slow");
+  }
+  // the Update sent to the silent one is not sent again
+  int failed = 0;
+  for (int i = 2; i < kCalls; ++i)
+  {
+    if (calls[i].controller.Failed())
+    {
+      assert(calls[i].error == NOT_CONNECTED);
+      ++failed;
+    }
+    else
+    {
+      assert(calls[i].seq == i && calls[i].payload == "slow");
+    }
+  }
+  assert(failed == 1);
+
+  // attempts, by server
+  stats = channel.stats();
+  assert(!stats[0].connected);
+  assert(stats[0].calls == 2 && stats[0].failures == 2);
+  assert(stats[1].calls == 3 && stats[1].failures == 0);
+  assert(stats[0].outstandingCalls == 0 && stats[1].outstandingCalls == 0);
+  printf("silent %lld calls %lld failures, slow %lld calls %lld failures\n",
+         static_cast<long long>(stats[0].calls), static_cast<long long>(stats[0].failures),
+         static_cast<long long>(stats[1].calls), static_cast<long long>(stats[1].failures));
+
+  channel.disconnect();
+  sleepInLoop(g_loop, 0.1);
+  ::kill(slow, SIGKILL);
+  ::waitpid(slow, NULL, 0);
+  google::protobuf::ShutdownProtobufLibrary();
+  puts("All pass!!!");
+}
@@ -0,0 +1,336 @@
+#include <muduo/net/protorpc/RpcChannel.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/TcpServer.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+#include <muduo/net/protorpc/tests/RpcTestUtil.h>
+#include <muduo/net/protorpc/tests/rpctest.pb.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+using namespace muduo::net::test;
+
+// Calls of an RpcChannel answered by a raw server, which responds to
+// the requests it picks, in any order, late or twice.
+
+EventLoop* g_loop;
+
+class RawServer
+{
+ public:
+  explicit RawServer(const InetAddress& addr)
+    : server_(g_loop, addr, "RawServer"),
+      codec_(boost::bind(&RawServer::onRpcMessage, this, _1, _2, _3, _4))
+  {
+    server_.setConnectionCallback(boost::bind(&RawServer::onConnection, this, _1));
+    server_.setMessageCallback(boost::bind(&RpcCodec::onMessage, &codec_, _1, _2, _3));
+    server_.start();
+  }
+
+  size_t numRequests() const
+  { return ids_.size(); }
+
+  // id of the request of seq
+  int64_t idOf(int64_t seq) const
+  {
+    for (size_t i = 0; i < ids_.size(); ++i)
+    {
+      if (seqs_[i] == seq)
+      {
+        return ids_[i];
+      }
+    }
+    assert(false);
+    return 0;
+  }
+
+  void respond(int64_t id, int64_t seq)
+  {
+    RpcMessage message;
+    message.set_type(RESPONSE);
+    message.set_id(id);
+    rpctest::EchoResponse response;
+    response.set_seq(seq);
+    RpcCodec::send(conn_, message, response);
+  }
+
+  void shutdown()
+  { conn_->shutdown(); }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    conn_ = conn;
+    conn->setTcpNoDelay(true);
+  }
+
+  void onRpcMessage(const TcpConnectionPtr&,
+                    const RpcMessage& message,
+                    const StringPiece& payload,
+                    Timestamp)
+  {
+    assert(message.type() == REQUEST);
+    rpctest::EchoRequest request;
+    request.ParseFromArray(payload.data(), payload.size());
+    ids_.push_back(message.id());
+    seqs_.push_back(request.seq());
+  }
+
+  TcpServer server_;
+  RpcCodec codec_;
+  TcpConnectionPtr conn_;
+  std::vector<int64_t> ids_;
+  std::vector<int64_t> seqs_;
+};
+
+RawServer* g_server;
+RpcChannelPtr g_channel;
+bool g_connected = false;
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  g_connected = conn->connected();
+  if (conn->connected())
+  {
+    conn->setTcpNoDelay(true);
+    g_channel->setConnection(conn);
+  }
+  else
+  {
+    g_channel->failOutstandingCalls();
+  }
+}
+
+bool hasRequests(size_t n)
+{
+  return g_server->numRequests() >= n;
+}
+
+bool allDone(const std::vector<Call*>* calls, int begin, int end)
+{
+  for (int i = begin; i < end; ++i)
+  {
+    if ((*calls)[i]->done == 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool hasOutstandingCalls(size_t n)
+{
+  return g_channel->numOutstandingCalls() == n;
+}
+
+bool isConnected()
+{
+  return g_connected;
+}
+
+bool isDisconnected()
+{
+  return !g_connected;
+}
+
+// appends calls of seq [calls->size(), calls->size() + n)
+void call(std::vector<Call*>* calls, int n, double timeout)
+{
+  rpctest::EchoService::Stub stub(get_pointer(g_channel));
+  for (int i = 0; i < n; ++i)
+  {
+    Call* c = new Call;
+    c->controller.setTimeout(timeout);
+    rpctest::EchoRequest request;
+    request.set_seq(calls->size());
+    calls->push_back(c);
+    rpctest::EchoResponse* response = new rpctest::EchoResponse;
+    stub.Echo(&c->controller, &request, response, NewCallback(onDone, c, response));
+  }
+}
+
+// a call answered after what the server sent before, which is handled by
+// the time it's done
+void roundTrip(std::vector<Call*>* calls)
+{
+  int seq = static_cast<int>(calls->size());
+  call(calls, 1, 0);
+  waitFor(g_loop, boost::bind(hasRequests, seq + 1));
+  g_server->respond(g_server->idOf(seq), seq);
+  waitFor(g_loop, boost::bind(allDone, calls, seq, seq + 1));
+}
+
+// a call timing out after the timers of those made before with timeout
+void timeoutAfter(std::vector<Call*>* calls, double timeout)
+{
+  int seq = static_cast<int>(calls->size());
+  call(calls, 1, timeout);
+  waitFor(g_loop, boost::bind(allDone, calls, seq, seq + 1));
+  assert((*calls)[seq]->error == TIMEOUT);
+}
+
+void testWrapAroundAndShrink(std::vector<Call*>* calls)
+{
+  // grows the table with many calls outstanding
+  const int kCalls = 2000;
+  const int kKept = 10;  // every 10th stays outstanding
+  int base = static_cast<int>(calls->size());
+  call(calls, kCalls, 0);
+  waitFor(g_loop, boost::bind(hasRequests, base + kCalls));
+  assert(g_channel->numOutstandingCalls() == static_cast<size_t>(kCalls));
+
+  // answers newest first, the table shrinks around the kept ones
+  for (int seq = base + kCalls - 1; seq >= base; --seq)
+  {
+    if (seq % kKept != 0)
+    {
+      g_server->respond(g_server->idOf(seq), seq);
+    }
+  }
+  const size_t kLeft = kCalls / kKept;
+  waitFor(g_loop, boost::bind(hasOutstandingCalls, kLeft));
+  for (int seq = base; seq < base + kCalls; ++seq)
+  {
+    const Call& c = *(*calls)[seq];
+    assert(c.done == (seq % kKept != 0 ? 1 : 0));
+    assert(c.done == 0 || (c.error == NO_ERROR && c.seq == seq));
+  }
+
+  // ids are sequential, newer ones come home to the slots of the kept ones
+  // once they are a table size apart, and probe past them, wrapping around
+  // the end of the table
+  const int kRounds = 100;
+  const int kBatch = 32;
+  for (int round = 0; round < kRounds; ++round)
+  {
+    int first = static_cast<int>(calls->size());
+    call(calls, kBatch, 0);
+    waitFor(g_loop, boost::bind(hasRequests, first + kBatch));
+    assert(g_channel->numOutstandingCalls() == kLeft + kBatch);
+    for (int seq = first + kBatch - 1; seq >= first; --seq)
+    {
+      g_server->respond(g_server->idOf(seq), seq);
+    }
+    waitFor(g_loop, boost::bind(allDone, calls, first, first + kBatch));
+    assert(g_channel->numOutstandingCalls() == kLeft);
+  }
+
+  // still found after all those erases
+  for (int seq = base; seq < base + kCalls; seq += kKept)
+  {
+    g_server->respond(g_server->idOf(seq), seq);
+  }
+  int end = static_cast<int>(calls->size());
+  waitFor(g_loop, boost::bind(allDone, calls, base, end));
+  assert(g_channel->numOutstandingCalls() == 0);
+
+  // a second response of the same call is ignored
+  g_server->respond(g_server->idOf(base), base);
+  roundTrip(calls);
+  for (int seq = base; seq < end; ++seq)
+  {
+    const Call& c = *(*calls)[seq];
+    assert(c.done == 1 && c.error == NO_ERROR && c.seq == seq);
+  }
+}
+
+void testTimeout(std::vector<Call*>* calls)
+{
+  int seq = static_cast<int>(calls->size());
+  call(calls, 1, 0.1);
+  waitFor(g_loop, boost::bind(hasRequests, seq + 1));
+  waitFor(g_loop, boost::bind(allDone, calls, seq, seq + 1));
+  const Call& c = *(*calls)[seq];
+  assert(c.done == 1 && c.error == TIMEOUT);
+  assert(g_channel->numOutstandingCalls() == 0);
+
+  // too late
+  g_server->respond(g_server->idOf(seq), seq);
+  roundTrip(calls);
+  assert(c.done == 1 && c.error == TIMEOUT);
+}
+
+void testFailOutstandingCalls(std::vector<Call*>* calls)
+{
+  int base = static_cast<int>(calls->size());
+  const int kCalls = 10;
+  call(calls, kCalls, 0.2);
+  waitFor(g_loop, boost::bind(hasRequests, base + kCalls));
+  g_channel->failOutstandingCalls();
+  assert(g_channel->numOutstandingCalls() == 0);
+
+  // neither their timers nor late responses run done again
+  for (int seq = base; seq < base + kCalls; ++seq)
+  {
+    g_server->respond(g_server->idOf(seq), seq);
+  }
+  roundTrip(calls);
+  timeoutAfter(calls, 0.2);
+  for (int seq = base; seq < base + kCalls; ++seq)
+  {
+    const Call& c = *(*calls)[seq];
+    assert(c.done == 1 && c.error == NOT_CONNECTED);
+  }
+}
+
+void testDisconnect(std::vector<Call*>* calls)
+{
+  int base = static_cast<int>(calls->size());
+  call(calls, 3, 1.0);
+  waitFor(g_loop, boost::bind(hasRequests, base + 3));
+  g_server->shutdown();
+  waitFor(g_loop, isDisconnected);
+
+  // one more after the connection is down
+  call(calls, 1, 1.0);
+  int end = base + 4;
+  assert(allDone(calls, base, end));
+  assert(g_channel->numOutstandingCalls() == 0);
+  for (int seq = base; seq < end; ++seq)
+  {
+    const Call& c = *(*calls)[seq];
+    assert(c.done == 1 && c.error == NOT_CONNECTED);
+  }
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  g_loop = &loop;
+  InetAddress addr("127.0.0.1", 18041);
+  RawServer server(addr);
+  g_server = &server;
+  g_channel.reset(new RpcChannel);
+  TcpClient client(&loop, addr, "RpcChannelTest");
+  client.setConnectionCallback(onConnection);
+  client.setMessageCallback(boost::bind(&RpcChannel::onMessage, get_pointer(g_channel), _1, _2, _3));
+  client.connect();
+  waitFor(g_loop, isConnected);
+
+  std::vector<Call*> calls;
+  testWrapAroundAndShrink(&calls);
+  testTimeout(&calls);
+  testFailOutstandingCalls(&calls);
+  testDisconnect(&calls);
+
+  // the channel holds the last reference to the client connection,
+  // so the server sees it closed
+  g_channel.reset();
+  sleepInLoop(g_loop, 0.1);
+  for (size_t i = 0; i < calls.size(); ++i)
+  {
+    delete calls[i];
+  }
+  google::protobuf::ShutdownProtobufLibrary();
+  puts("All pass!!!");
+}
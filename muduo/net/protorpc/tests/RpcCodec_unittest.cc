@@ -0,0 +1,330 @@
+#include <muduo/net/protorpc/RpcCodec.h>
+
+#include <muduo/net/Endian.h>
+#include <muduo/net/protorpc/BufferStream.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+#include <muduo/net/protorpc/tests/rpctest.pb.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
+//#define BOOST_TEST_MODULE RpcCodecTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+
+#include <zlib.h>
+
+using muduo::StringPiece;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::BufferOutputStream;
+using muduo::net::RpcCodec;
+using muduo::net::RpcMessage;
+using muduo::net::TcpConnectionPtr;
+
+namespace
+{
+
+// what parse() returns, the payload copied
+struct Parsed
+{
+  Parsed() : error(RpcCodec::kNoError), checksum(RpcCodec::kAdler32) { }
+
+  RpcCodec::ErrorCode error;
+  RpcMessage message;
+  std::string payload;
+  RpcCodec::Checksum checksum;
+};
+
+std::string retrieveAll(Buffer* buf)
+{
+  std::string result(buf->peek(), buf->readableBytes());
+  buf->retrieveAll();
+  return result;
+}
+
+// buf holds one frame, with its length
+Parsed parse(const Buffer& buf)
+{
+  Parsed parsed;
+  int32_t len = RpcCodec::asInt32(buf.peek());
+  BOOST_REQUIRE_EQUAL(static_cast<size_t>(len) + sizeof len, buf.readableBytes());
+  StringPiece payload;
+  parsed.error = RpcCodec::parse(buf.peek() + sizeof len, len,
+                                 RpcCodec::kDefaultAcceptedChecksums
+                                 | (1 << RpcCodec::kNoChecksum),
+                                 &parsed.message, &payload, &parsed.checksum);
+  parsed.payload.assign(payload.data(), payload.size());
+  return parsed;
+}
+
+// a frame of data, as the codec wraps it, with an adler32 checksum
+void frame(Buffer* buf, const std::string& data)
+{
+  buf->append("RPC0", 4);
+  buf->append(data);
+  buf->appendInt32(static_cast<int32_t>(
+      ::adler32(1, reinterpret_cast<const Bytef*>(buf->peek()),
+                static_cast<uInt>(buf->readableBytes()))));
+  int32_t len = muduo::net::sockets::hostToNetwork32(
+      static_cast<int32_t>(buf->readableBytes()));
+  buf->prepend(&len, sizeof len);
+}
+
+// before encode(), the payload was serialized into the message,
+// then the message into a string
+void oldEncode(Buffer* buf, RpcMessage message, const google::protobuf::Message* payload)
+{
+  if (payload && message.type() == muduo::net::REQUEST)
+  {
+    message.set_request(payload->SerializeAsString());
+  }
+  else if (payload)
+  {
+    message.set_response(payload->SerializeAsString());
+  }
+  frame(buf, message.SerializeAsString());
+}
+
+RpcMessage request(int64_t id)
+{
+  RpcMessage message;
+  message.set_type(muduo::net::REQUEST);
+  message.set_id(id);
+  message.set_service("rpctest.EchoService");
+  message.set_method("Echo");
+  message.set_window(16);
+  return message;
+}
+
+rpctest::EchoRequest echoRequest()
+{
+  rpctest::EchoRequest payload;
+  payload.set_seq(42);
+  payload.set_payload(std::string(300, 'x'));
+  return payload;
+}
+
+void checkSame(const Parsed& a, const Parsed& b)
+{
+  BOOST_CHECK_EQUAL(a.error, b.error);
+  BOOST_CHECK_EQUAL(a.message.SerializeAsString(), b.message.SerializeAsString());
+  BOOST_CHECK_EQUAL(a.payload, b.payload);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testRequest)
+{
+  RpcMessage message(request(1));
+  rpctest::EchoRequest payload(echoRequest());
+  RpcCodec::Checksum checksums[] = { RpcCodec::kAdler32, RpcCodec::kCrc32c, RpcCodec::kNoChecksum };
+  for (size_t i = 0; i < sizeof checksums / sizeof checksums[0]; ++i)
+  {
+    Buffer buf;
+    RpcCodec::encode(&buf, message, &payload, checksums[i]);
+    Parsed parsed(parse(buf));
+    BOOST_CHECK_EQUAL(parsed.error, RpcCodec::kNoError);
+    BOOST_CHECK_EQUAL(parsed.checksum, checksums[i]);
+    // the payload is left out of the message
+    BOOST_CHECK(!parsed.message.has_request());
+    BOOST_CHECK_EQUAL(parsed.message.SerializeAsString(), message.SerializeAsString());
+    BOOST_CHECK_EQUAL(parsed.payload, payload.SerializeAsString());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testResponse)
+{
+  RpcMessage message;
+  message.set_type(muduo::net::RESPONSE);
+  message.set_id(2);
+  message.set_more(true);
+  rpctest::EchoResponse payload;
+  payload.set_seq(7);
+  Buffer buf;
+  RpcCodec::encode(&buf, message, &payload);
+  Parsed parsed(parse(buf));
+  BOOST_CHECK_EQUAL(parsed.error, RpcCodec::kNoError);
+  BOOST_CHECK(!parsed.message.has_response());
+  BOOST_CHECK(parsed.message.more());
+  BOOST_CHECK_EQUAL(parsed.message.SerializeAsString(), message.SerializeAsString());
+  BOOST_CHECK_EQUAL(parsed.payload, payload.SerializeAsString());
+
+  // an empty response is still a payload
+  payload.Clear();
+  buf.retrieveAll();
+  RpcCodec::encode(&buf, message, &payload);
+  parsed = parse(buf);
+  BOOST_CHECK_EQUAL(parsed.error, RpcCodec::kNoError);
+  BOOST_CHECK_EQUAL(parsed.payload, std::string());
+}
+
+BOOST_AUTO_TEST_CASE(testErrorAndCredit)
+{
+  RpcMessage error;
+  error.set_type(muduo::net::ERROR);
+  error.set_id(3);
+  error.set_error(muduo::net::NO_METHOD);
+  RpcMessage credit;
+  credit.set_type(muduo::net::CREDIT);
+  credit.set_id(4);
+  credit.set_credit(8);
+
+  RpcMessage* messages[] = { &error, &credit };
+  for (size_t i = 0; i < sizeof messages / sizeof messages[0]; ++i)
+  {
+    Buffer buf;
+    RpcCodec::encode(&buf, *messages[i], NULL);
+    Parsed parsed(parse(buf));
+    BOOST_CHECK_EQUAL(parsed.error, RpcCodec::kNoError);
+    BOOST_CHECK_EQUAL(parsed.message.SerializeAsString(), messages[i]->SerializeAsString());
+    BOOST_CHECK_EQUAL(parsed.payload, std::string());
+
+    Buffer old;
+    oldEncode(&old, *messages[i], NULL);
+    BOOST_CHECK_EQUAL(retrieveAll(&old), retrieveAll(&buf));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testOldEncoding)
+{
+  RpcMessage message(request(5));
+  rpctest::EchoRequest payload(echoRequest());
+  Buffer buf;
+  RpcCodec::encode(&buf, message, &payload);
+  Buffer old;
+  oldEncode(&old, message, &payload);
+  // the payload goes before the window there
+  BOOST_CHECK(retrieveAll(&old) != retrieveAll(&buf));
+  oldEncode(&old, message, &payload);
+  RpcCodec::encode(&buf, message, &payload);
+  checkSame(parse(old), parse(buf));
+
+  // same bytes when the payload is the last field
+  message.clear_window();
+  RpcMessage response;
+  response.set_type(muduo::net::RESPONSE);
+  response.set_id(6);
+  RpcMessage* messages[] = { &message, &response };
+  for (size_t i = 0; i < sizeof messages / sizeof messages[0]; ++i)
+  {
+    Buffer a, b;
+    RpcCodec::encode(&a, *messages[i], &payload);
+    oldEncode(&b, *messages[i], &payload);
+    checkSame(parse(a), parse(b));
+    BOOST_CHECK_EQUAL(retrieveAll(&a), retrieveAll(&b));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testDuplicatedPayload)
+{
+  RpcMessage message;
+  message.set_type(muduo::net::RESPONSE);
+  message.set_id(7);
+  message.set_response("first");
+  std::string data = message.SerializeAsString();
+  // another response field, the old encoder never sent one
+  message.Clear();
+  message.set_response("second");
+  data += message.SerializePartialAsString();
+
+  Buffer buf;
+  frame(&buf, data);
+  BOOST_CHECK_EQUAL(parse(buf).error, RpcCodec::kParseError);
+}
+
+BOOST_AUTO_TEST_CASE(testTruncated)
+{
+  RpcMessage message(request(8));
+  rpctest::EchoRequest payload(echoRequest());
+  Buffer old;
+  oldEncode(&old, message, &payload);
+  std::string data = retrieveAll(&old);
+  data = data.substr(8, data.size() - 12);
+
+  // the payload is cut short, under a good checksum
+  Buffer buf;
+  frame(&buf, data.substr(0, data.size() - 100));
+  BOOST_CHECK_EQUAL(parse(buf).error, RpcCodec::kParseError);
+
+  // the required id is cut off
+  buf.retrieveAll();
+  frame(&buf, data.substr(0, 2));
+  BOOST_CHECK_EQUAL(parse(buf).error, RpcCodec::kParseError);
+
+  // a bad checksum
+  buf.retrieveAll();
+  RpcCodec::encode(&buf, message, &payload);
+  std::string bytes = retrieveAll(&buf);
+  bytes[bytes.size() - 1] ^= 1;
+  buf.append(bytes);
+  BOOST_CHECK_EQUAL(parse(buf).error, RpcCodec::kCheckSumError);
+}
+
+namespace
+{
+
+void onRpcMessage(std::vector<Parsed>* received,
+                  const TcpConnectionPtr&,
+                  const RpcMessage& message,
+                  const StringPiece& payload,
+                  Timestamp)
+{
+  Parsed parsed;
+  parsed.message = message;
+  parsed.payload.assign(payload.data(), payload.size());
+  received->push_back(parsed);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testOnMessageInPieces)
+{
+  std::vector<Parsed> received;
+  RpcCodec codec(boost::bind(onRpcMessage, &received, _1, _2, _3, _4));
+  RpcMessage message(request(9));
+  rpctest::EchoRequest payload(echoRequest());
+  Buffer frames;
+  RpcCodec::encode(&frames, message, &payload);
+  std::string bytes = retrieveAll(&frames);
+  bytes += bytes;
+
+  // byte by byte, each frame comes out once it's complete
+  Buffer input;
+  for (size_t i = 0; i < bytes.size(); ++i)
+  {
+    input.append(bytes.data() + i, 1);
+    codec.onMessage(TcpConnectionPtr(), &input, Timestamp());
+    BOOST_CHECK_EQUAL(received.size(), (i + 1) * 2 / bytes.size());
+  }
+  BOOST_CHECK_EQUAL(input.readableBytes(), 0);
+  BOOST_REQUIRE_EQUAL(received.size(), 2);
+  for (size_t i = 0; i < received.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(received[i].message.SerializeAsString(), message.SerializeAsString());
+    BOOST_CHECK_EQUAL(received[i].payload, payload.SerializeAsString());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testBufferOutputStream)
+{
+  // larger than a block, written without ensureWritableBytes()
+  rpctest::EchoRequest payload;
+  payload.set_payload(std::string(10000, 'y'));
+  int size = payload.ByteSize();
+  Buffer buf;
+  buf.append("head");
+  {
+  BufferOutputStream stream(&buf);
+  google::protobuf::io::CodedOutputStream output(&stream);
+  payload.SerializeWithCachedSizes(&output);
+  output.Trim();
+  BOOST_CHECK_EQUAL(stream.ByteCount(), size);
+  }
+  // the unused part of the last block is backed up
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 4 + size);
+  buf.retrieve(4);
+  BOOST_CHECK_EQUAL(retrieveAll(&buf), payload.SerializeAsString());
+}
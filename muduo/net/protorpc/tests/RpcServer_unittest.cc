@@ -0,0 +1,261 @@
+#include <muduo/net/protorpc/RpcServer.h>
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/protorpc/RpcChannel.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+#include <muduo/net/protorpc/tests/RpcTestUtil.h>
+#include <muduo/net/protorpc/tests/rpctest.pb.h>
+
+#include <google/protobuf/descriptor.pb.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+using namespace muduo::net::test;
+
+// Methods run in thread pools, rejected when over their limit or when
+// the queue of the pool is full, and calls of unknown methods.
+
+EventLoop* g_loop;
+
+// blocks in the pool until the gate is opened
+class BlockingEcho : public rpctest::EchoService
+{
+ public:
+  BlockingEcho()
+    : gate_(1)
+  {
+  }
+
+  virtual void Echo(::google::protobuf::RpcController*,
+                    const rpctest::EchoRequest* request,
+                    rpctest::EchoResponse* response,
+                    ::google::protobuf::Closure* done)
+  {
+    started_.increment();
+    gate_.wait();
+    response->set_seq(request->seq());
+    done->Run();
+  }
+
+  int started()
+  { return started_.get(); }
+
+  void open()
+  { gate_.countDown(); }
+
+ private:
+  AtomicInt32 started_;
+  CountDownLatch gate_;
+};
+
+class Client
+{
+ public:
+  Client(const InetAddress& addr, const string& name)
+    : client_(g_loop, addr, name),
+      channel_(new RpcChannel),
+      connected_(false)
+  {
+    client_.setConnectionCallback(boost::bind(&Client::onConnection, this, _1));
+    client_.setMessageCallback(
+        boost::bind(&RpcChannel::onMessage, get_pointer(channel_), _1, _2, _3));
+    client_.connect();
+  }
+
+  void disconnect()
+  { client_.disconnect(); }
+
+  bool connected() const
+  { return connected_; }
+
+  Call* echo(int64_t seq)
+  {
+    return call(rpctest::EchoService::descriptor()->method(0), seq);
+  }
+
+  Call* call(const ::google::protobuf::MethodDescriptor* method, int64_t seq)
+  {
+    Call* c = new Call;
+    calls_.push_back(c);
+    rpctest::EchoRequest request;
+    request.set_seq(seq);
+    rpctest::EchoResponse* response = new rpctest::EchoResponse;
+    channel_->CallMethod(method, &c->controller, &request, response,
+                         NewCallback(onDone, c, response));
+    return c;
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    connected_ = conn->connected();
+    if (conn->connected())
+    {
+      channel_->setConnection(conn);
+    }
+    else
+    {
+      channel_->failOutstandingCalls();
+    }
+  }
+
+  TcpClient client_;
+  RpcChannelPtr channel_;
+  bool connected_;
+  boost::ptr_vector<Call> calls_;
+};
+
+bool hasDone(const std::vector<Call*>* calls, size_t n)
+{
+  size_t done = 0;
+  for (size_t i = 0; i < calls->size(); ++i)
+  {
+    if ((*calls)[i]->done)
+    {
+      ++done;
+    }
+  }
+  return done >= n;
+}
+
+bool hasStarted(BlockingEcho* service, int n)
+{
+  return service->started() >= n;
+}
+
+void testMaxConcurrentCalls(Client* client, BlockingEcho* service)
+{
+  // at most 2 at once, the others are rejected at once
+  std::vector<Call*> calls;
+  for (int i = 0; i < 4; ++i)
+  {
+    calls.push_back(client->echo(i));
+  }
+  waitFor(g_loop, boost::bind(hasDone, &calls, 2));
+  waitFor(g_loop, boost::bind(hasStarted, service, 2));
+  assert(!calls[0]->done && !calls[1]->done);
+  assert(calls[2]->error == OVERLOADED && calls[3]->error == OVERLOADED);
+
+  service->open();
+  waitFor(g_loop, boost::bind(hasDone, &calls, 4));
+  assert(calls[0]->error == NO_ERROR && calls[0]->seq == 0);
+  assert(calls[1]->error == NO_ERROR && calls[1]->seq == 1);
+
+  // their slots are given back
+  calls.clear();
+  for (int i = 0; i < 2; ++i)
+  {
+    calls.push_back(client->echo(10 + i));
+  }
+  waitFor(g_loop, boost::bind(hasDone, &calls, 2));
+  assert(calls[0]->error == NO_ERROR && calls[1]->error == NO_ERROR);
+  assert(service->started() == 4);
+}
+
+void testFullQueue(Client* client, BlockingEcho* service)
+{
+  // one runs, one waits in the queue of size 1, one is rejected
+  std::vector<Call*> calls;
+  calls.push_back(client->echo(0));
+  waitFor(g_loop, boost::bind(hasStarted, service, 1));
+  calls.push_back(client->echo(1));
+  calls.push_back(client->echo(2));
+  waitFor(g_loop, boost::bind(hasDone, &calls, 1));
+  assert(!calls[0]->done && !calls[1]->done);
+  assert(calls[2]->error == OVERLOADED);
+
+  service->open();
+  waitFor(g_loop, boost::bind(hasDone, &calls, 3));
+  assert(calls[0]->error == NO_ERROR && calls[0]->seq == 0);
+  assert(calls[1]->error == NO_ERROR && calls[1]->seq == 1);
+}
+
+void testUnknownMethod(Client* client)
+{
+  // a method and a service the server doesn't have, of a newer proto
+  google::protobuf::FileDescriptorProto file;
+  file.set_name("newer.proto");
+  file.set_package("rpctest");
+  file.add_message_type()->set_name("Empty");
+  google::protobuf::ServiceDescriptorProto* echo = file.add_service();
+  echo->set_name("EchoService");
+  google::protobuf::MethodDescriptorProto* method = echo->add_method();
+  method->set_name("Missing");
+  method->set_input_type(".rpctest.Empty");
+  method->set_output_type(".rpctest.Empty");
+  google::protobuf::ServiceDescriptorProto* missing = file.add_service();
+  missing->set_name("MissingService");
+  missing->add_method()->CopyFrom(*method);
+  google::protobuf::DescriptorPool pool;
+  const google::protobuf::FileDescriptor* newer = pool.BuildFile(file);
+  assert(newer != NULL);
+
+  std::vector<Call*> calls;
+  calls.push_back(client->call(newer->service(0)->method(0), 0));
+  calls.push_back(client->call(newer->service(1)->method(0), 1));
+  waitFor(g_loop, boost::bind(hasDone, &calls, 2));
+  assert(calls[0]->error == NO_METHOD);
+  assert(calls[1]->error == NO_SERVICE);
+}
+
+bool isConnected(const Client* client)
+{
+  return client->connected();
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  g_loop = &loop;
+
+  ThreadPool limited("Limited");
+  limited.start(4);
+  ThreadPool queued("Queued");
+  queued.setMaxQueueSize(1);
+  queued.start(1);
+
+  BlockingEcho limitedEcho;
+  InetAddress limitedAddr("127.0.0.1", 18044);
+  RpcServer limitedServer(&loop, limitedAddr);
+  limitedServer.registerService(&limitedEcho);
+  limitedServer.setExecutor(&limitedEcho, "Echo", &limited, 2);
+  limitedServer.start();
+
+  BlockingEcho queuedEcho;
+  InetAddress queuedAddr("127.0.0.1", 18045);
+  RpcServer queuedServer(&loop, queuedAddr);
+  queuedServer.registerService(&queuedEcho);
+  queuedServer.setExecutor(&queuedEcho, "", &queued);
+  queuedServer.start();
+
+  {
+  Client limitedClient(limitedAddr, "LimitedClient");
+  Client queuedClient(queuedAddr, "QueuedClient");
+  waitFor(g_loop, boost::bind(isConnected, &limitedClient));
+  waitFor(g_loop, boost::bind(isConnected, &queuedClient));
+
+  testMaxConcurrentCalls(&limitedClient, &limitedEcho);
+  testFullQueue(&queuedClient, &queuedEcho);
+  testUnknownMethod(&limitedClient);
+
+  // closed on both sides before the loop stops
+  limitedClient.disconnect();
+  queuedClient.disconnect();
+  sleepInLoop(g_loop, 0.1);
+  }
+
+  google::protobuf::ShutdownProtobufLibrary();
+  puts("All pass!!!");
+}
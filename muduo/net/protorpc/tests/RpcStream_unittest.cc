@@ -0,0 +1,252 @@
+#include <muduo/net/protorpc/RpcServer.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/protorpc/RpcChannel.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/RpcStats.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+#include <muduo/net/protorpc/tests/RpcTestUtil.h>
+#include <muduo/net/protorpc/tests/rpctest.pb.h>
+
+#include <boost/bind.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <algorithm>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+using namespace muduo::net::test;
+
+// Streamed responses of a server and a client in one loop, held back by
+// the client's credit, and streams cut short by a deadline and by a lost
+// connection.
+
+EventLoop* g_loop;
+const int kWindow = 8;
+
+// a streamed call, seq is of the last response
+struct Stream : Call
+{
+  Stream()
+    : received(0), disconnectAt(-1), produced(0), maxAhead(0)
+  {
+  }
+
+  int received;  // streamed responses
+  int disconnectAt;  // drops the connection after so many
+  // by the server, which is in this loop too
+  int produced;
+  int maxAhead;  // of produced over received
+};
+
+Stream* g_stream;
+TcpClient* g_client;
+
+// fills responses of seq [0, total) of stream, endless if total is negative
+class Producer
+{
+ public:
+  Producer(Stream* stream, int64_t total)
+    : stream_(stream),
+      total_(total)
+  {
+  }
+
+  bool produce(::google::protobuf::Message* message)
+  {
+    if (stream_->produced == total_)
+    {
+      return false;
+    }
+    static_cast<rpctest::EchoResponse*>(message)->set_seq(stream_->produced);
+    ++stream_->produced;
+    stream_->maxAhead = std::max(stream_->maxAhead, stream_->produced - stream_->received);
+    return true;
+  }
+
+ private:
+  Stream* stream_;
+  const int64_t total_;
+};
+
+typedef boost::shared_ptr<Producer> ProducerPtr;
+
+// streams seq responses, then one of seq as the last
+class StreamingEcho : public rpctest::EchoService
+{
+ public:
+  virtual void Echo(::google::protobuf::RpcController* controller,
+                    const rpctest::EchoRequest* request,
+                    rpctest::EchoResponse* response,
+                    ::google::protobuf::Closure* done)
+  {
+    RpcController* c = static_cast<RpcController*>(controller);
+    assert(c && c->streaming());
+    ProducerPtr producer(new Producer(g_stream, request->seq()));
+    c->setProducer(boost::bind(&Producer::produce, producer, _1));
+    last_ = producer;
+    response->set_seq(request->seq());
+    done->Run();
+  }
+
+  // of the last call, expired once the server is done with its stream
+  boost::weak_ptr<Producer> last() const
+  { return last_; }
+
+ private:
+  boost::weak_ptr<Producer> last_;
+};
+
+void onStreamResponse(Stream* stream, const ::google::protobuf::Message& message)
+{
+  // in order, none after the last
+  assert(!stream->done);
+  assert(static_cast<const rpctest::EchoResponse&>(message).seq() == stream->received);
+  ++stream->received;
+  if (stream->received == stream->disconnectAt)
+  {
+    g_client->disconnect();
+  }
+}
+
+RpcChannelPtr g_channel;
+bool g_connected = false;
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  g_connected = conn->connected();
+  if (conn->connected())
+  {
+    conn->setTcpNoDelay(true);
+    g_channel->setConnection(conn);
+  }
+  else
+  {
+    g_channel->failOutstandingCalls();
+  }
+}
+
+bool isConnected()
+{
+  return g_connected;
+}
+
+bool isReleased(const StreamingEcho* service)
+{
+  return service->last().expired();
+}
+
+void call(Stream* stream, int64_t numStreamed)
+{
+  g_stream = stream;
+  stream->controller.setStreamWindow(kWindow);
+  stream->controller.setStreamCallback(boost::bind(onStreamResponse, stream, _1));
+  rpctest::EchoRequest request;
+  request.set_seq(numStreamed);
+  rpctest::EchoResponse* response = new rpctest::EchoResponse;
+  rpctest::EchoService::Stub stub(get_pointer(g_channel));
+  stub.Echo(&stream->controller, &request, response, NewCallback(onDone, static_cast<Call*>(stream), response));
+}
+
+void testCredit(StreamingEcho* service)
+{
+  // many windows long, the server waits for credit after each window
+  const int kStreamed = 100;
+  Stream stream;
+  call(&stream, kStreamed);
+  waitFor(g_loop, boost::bind(isDone, &stream));
+  assert(stream.produced == kStreamed);
+  assert(stream.maxAhead == kWindow);
+
+  // the last one goes to done
+  assert(stream.received == kStreamed);
+  assert(stream.error == NO_ERROR && stream.seq == kStreamed);
+  assert(g_channel->numOutstandingCalls() == 0);
+  assert(isReleased(service));
+}
+
+void testShortStream()
+{
+  // shorter than the window, and no stream at all
+  int lengths[] = { 3, 0 };
+  for (size_t i = 0; i < sizeof lengths / sizeof lengths[0]; ++i)
+  {
+    Stream stream;
+    call(&stream, lengths[i]);
+    waitFor(g_loop, boost::bind(isDone, &stream));
+    assert(stream.received == lengths[i]);
+    assert(stream.error == NO_ERROR && stream.seq == lengths[i]);
+  }
+}
+
+void testDisconnect(StreamingEcho* service)
+{
+  // endless, the client goes away in the middle
+  Stream stream;
+  stream.disconnectAt = 2 * kWindow + 1;
+  call(&stream, -1);
+  waitFor(g_loop, boost::bind(isDone, &stream));
+  assert(stream.error == NOT_CONNECTED);
+  assert(stream.received >= stream.disconnectAt);
+  assert(g_channel->numOutstandingCalls() == 0);
+
+  // the server drops the stream with the connection
+  waitFor(g_loop, boost::bind(isReleased, service));
+}
+
+void testTimeout(StreamingEcho* service)
+{
+  // endless, the deadline is of the whole stream
+  Stream stream;
+  stream.controller.setTimeout(0.1);
+  call(&stream, -1);
+  waitFor(g_loop, boost::bind(isDone, &stream));
+  assert(stream.error == TIMEOUT);
+  assert(stream.received > kWindow);
+  assert(g_channel->numOutstandingCalls() == 0);
+
+  // canceled, the server doesn't wait for credit forever
+  waitFor(g_loop, boost::bind(isReleased, service));
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  g_loop = &loop;
+
+  StreamingEcho service;
+  InetAddress addr("127.0.0.1", 18048);
+  RpcServer server(&loop, addr);
+  server.registerService(&service);
+  server.start();
+
+  g_channel.reset(new RpcChannel);
+  TcpClient client(&loop, addr, "RpcStreamTest");
+  g_client = &client;
+  client.setConnectionCallback(onConnection);
+  client.setMessageCallback(boost::bind(&RpcChannel::onMessage, get_pointer(g_channel), _1, _2, _3));
+  client.connect();
+  waitFor(g_loop, isConnected);
+
+  testCredit(&service);
+  testShortStream();
+  testTimeout(&service);
+  testDisconnect(&service);
+
+  // all ended on the server, the canceled one and the dropped one as such
+  std::vector<RpcStats::MethodStats> stats(server.stats().snapshot());
+  assert(stats.size() == 1);
+  assert(stats[0].calls == 5 && stats[0].inFlight == 0);
+  assert(stats[0].errors[NO_ERROR] == 3 && stats[0].errors[CANCELED] == 1);
+  assert(stats[0].errors[NOT_CONNECTED] == 1);
+
+  g_channel.reset();
+  sleepInLoop(g_loop, 0.1);
+  google::protobuf::ShutdownProtobufLibrary();
+  puts("All pass!!!");
+}
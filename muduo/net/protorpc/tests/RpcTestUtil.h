@@ -0,0 +1,85 @@
+// Helpers of the protorpc unit tests, each of which runs its clients and
+// servers in one EventLoop of the main thread.
+
+#ifndef MUDUO_NET_PROTORPC_TESTS_RPCTESTUTIL_H
+#define MUDUO_NET_PROTORPC_TESTS_RPCTESTUTIL_H
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/tests/rpctest.pb.h>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
+#include <string>
+
+namespace muduo
+{
+namespace net
+{
+namespace test
+{
+
+inline void quitIf(EventLoop* loop, const boost::function<bool ()>& cond, Timestamp deadline)
+{
+  if (cond() || Timestamp::now().microSecondsSinceEpoch() > deadline.microSecondsSinceEpoch())
+  {
+    loop->quit();
+  }
+}
+
+/// Runs loop until cond(), dies after seconds.
+inline void waitFor(EventLoop* loop, const boost::function<bool ()>& cond, double seconds = 5.0)
+{
+  TimerId timer = loop->runEvery(0.01,
+      boost::bind(quitIf, loop, cond, addTime(Timestamp::now(), seconds)));
+  loop->loop();
+  loop->cancel(timer);
+  if (!cond())
+  {
+    LOG_FATAL << "timed out";
+  }
+}
+
+/// Runs loop for seconds, for what has no event to wait for.
+inline void sleepInLoop(EventLoop* loop, double seconds)
+{
+  loop->runAfter(seconds, boost::bind(&EventLoop::quit, loop));
+  loop->loop();
+}
+
+/// An EchoService call, done by onDone(), the channel deletes the response.
+struct Call
+{
+  Call() : done(0), error(-1), seq(-1) { }
+
+  RpcController controller;
+  int done;  // times done was run
+  int error;
+  int64_t seq;  // of the response
+  std::string payload;  // of the response
+};
+
+inline void onDone(Call* call, rpctest::EchoResponse* response)
+{
+  ++call->done;
+  call->error = call->controller.errorCode();
+  if (!call->controller.Failed())
+  {
+    call->seq = response->seq();
+    call->payload = response->payload();
+  }
+}
+
+inline bool isDone(const Call* call)
+{
+  return call->done > 0;
+}
+
+}
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_TESTS_RPCTESTUTIL_H
@@ -115,6 +115,26 @@ BOOST_AUTO_TEST_CASE(testBufferPrepend)
   BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend - 4);
 }
 
+BOOST_AUTO_TEST_CASE(testBufferUnwrite)
+{
+  Buffer buf;
+  buf.append("hello, world");
+  buf.unwrite(7);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 5);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), Buffer::kInitialSize-5);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+
+  // written again in place
+  buf.append("!");
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string("hello!"));
+
+  buf.append("abc");
+  buf.retrieve(1);
+  buf.unwrite(2);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend+1);
+}
+
 BOOST_AUTO_TEST_CASE(testBufferReadInt)
 {
   Buffer buf;
@@ -0,0 +1,122 @@
+#include <muduo/net/ShmConnection.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Side 0 in the main loop sends kTotal bytes through a small ring,
+// side 1 in another thread echoes them back.  Side 0 checks the bytes,
+// then shuts down, both sides must see the disconnection.
+
+const int64_t kTotal = 64 * 1024 * 1024;
+const int kChunk = 4096;
+
+int64_t g_sent = 0;
+int64_t g_received = 0;
+bool g_serverDown = false;
+bool g_clientDown = false;
+
+char byteAt(int64_t offset)
+{
+  return static_cast<char>(offset * 7 + offset / 256);
+}
+
+void sendMore(const ShmConnectionPtr& conn)
+{
+  if (g_sent < kTotal)
+  {
+    char buf[kChunk];
+    for (int i = 0; i < kChunk; ++i)
+    {
+      buf[i] = byteAt(g_sent + i);
+    }
+    g_sent += kChunk;
+    conn->send(buf, sizeof buf);
+  }
+}
+
+void onClientConnection(const ShmConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    sendMore(conn);
+  }
+  else
+  {
+    g_clientDown = true;
+    conn->getLoop()->quit();
+  }
+}
+
+void onClientMessage(const ShmConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  const char* data = buf->peek();
+  for (size_t i = 0; i < buf->readableBytes(); ++i)
+  {
+    if (data[i] != byteAt(g_received + i))
+    {
+      printf("mismatch at %jd\n", g_received + i);
+      abort();
+    }
+  }
+  g_received += buf->readableBytes();
+  buf->retrieveAll();
+  if (g_received == kTotal)
+  {
+    conn->shutdown();
+  }
+}
+
+void onServerConnection(const ShmConnectionPtr& conn)
+{
+  if (!conn->connected())
+  {
+    g_serverDown = true;
+  }
+}
+
+void onServerMessage(const ShmConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+int main()
+{
+  ShmConnection::Handles handles;
+  bool ok = ShmConnection::createHandles(&handles, 64 * 1024);
+  assert(ok); (void)ok;
+
+  EventLoop loop;
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+
+  ShmConnectionPtr client(new ShmConnection(&loop, "client", handles, 0));
+  ShmConnectionPtr server(new ShmConnection(serverLoop, "server", handles, 1));
+  ShmConnection::closeHandles(handles);
+
+  server->setConnectionCallback(onServerConnection);
+  server->setMessageCallback(onServerMessage);
+  server->start();
+
+  client->setConnectionCallback(onClientConnection);
+  client->setMessageCallback(onClientMessage);
+  client->setWriteCompleteCallback(sendMore);
+  client->start();
+
+  Timestamp start = Timestamp::now();
+  loop.loop();
+  double seconds = timeDifference(Timestamp::now(), start);
+
+  printf("%jd bytes echoed in %.3f seconds, %.2f MiB/s\n",
+         g_received, seconds, static_cast<double>(kTotal) / seconds / 1024 / 1024);
+  printf("signals: client %jd server %jd\n", client->signalCount(), server->signalCount());
+  assert(g_received == kTotal);
+  assert(g_clientDown);
+  assert(g_serverDown);
+  puts("ok");
+}
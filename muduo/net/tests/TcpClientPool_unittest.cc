@@ -0,0 +1,206 @@
+#include <muduo/net/TcpClientPool.h>
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+
+#include <boost/bind.hpp>
+
+#include <map>
+
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Two echo servers, the first one in a child process, two connections to
+// each, spread over two IO threads.
+// Keeps kConcurrency requests outstanding until a round of them is done.
+// Then one backend fails requests and is ejected, and the other one is
+// killed, traffic goes where it should each time.
+
+const int kRequests = 10000;
+const int kConcurrency = 8;
+const int kMaxFailures = 2;
+
+TcpClientPool* g_pool = NULL;
+EventLoop* g_loop = NULL;
+AtomicInt32 g_target;
+AtomicInt32 g_sent;
+AtomicInt32 g_received;
+MutexLock g_mutex;
+std::map<string, int> g_perBackend;  // @GuardedBy g_mutex
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+// the child echoes until it's killed
+pid_t startBackend(const InetAddress& addr)
+{
+  pid_t pid = ::fork();
+  if (pid == 0)
+  {
+    // don't outlive a failed test
+    ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+    EventLoop loop;
+    TcpServer server(&loop, addr, "Backend1");
+    server.setMessageCallback(onServerMessage);
+    server.start();
+    loop.loop();
+    _exit(0);
+  }
+  return pid;
+}
+
+void sendRequest()
+{
+  if (g_sent.incrementAndGet() > g_target.get())
+  {
+    return;
+  }
+  TcpConnectionPtr conn = g_pool->acquire();
+  assert(conn);
+  {
+  MutexLockGuard lock(g_mutex);
+  ++g_perBackend[conn->peerAddress().toIpPort()];
+  }
+  conn->send("x");
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  while (buf->readableBytes() > 0)
+  {
+    buf->retrieve(1);
+    g_pool->release(conn);
+    if (g_received.incrementAndGet() == g_target.get())
+    {
+      g_loop->quit();
+      return;
+    }
+    sendRequest();
+  }
+}
+
+void startRequests()
+{
+  for (int i = 0; i < kConcurrency; ++i)
+  {
+    sendRequest();
+  }
+}
+
+// requests per backend of a round of n
+std::map<string, int> runRequests(int n)
+{
+  g_target.getAndSet(n);
+  g_sent.getAndSet(0);
+  g_received.getAndSet(0);
+  {
+  MutexLockGuard lock(g_mutex);
+  g_perBackend.clear();
+  }
+  g_loop->runInLoop(startRequests);
+  g_loop->loop();
+  // all answered, nothing in flight
+  MutexLockGuard lock(g_mutex);
+  for (std::map<string, int>::iterator it = g_perBackend.begin();
+      it != g_perBackend.end(); ++it)
+  {
+    printf("%s %d\n", it->first.c_str(), it->second);
+  }
+  return g_perBackend;
+}
+
+void quitIfConnected(size_t n, Timestamp deadline)
+{
+  if (g_pool->numConnected() == n
+      || Timestamp::now().microSecondsSinceEpoch() > deadline.microSecondsSinceEpoch())
+  {
+    g_loop->quit();
+  }
+}
+
+void waitConnected(size_t n)
+{
+  TimerId timer = g_loop->runEvery(0.01,
+      boost::bind(quitIfConnected, n, addTime(Timestamp::now(), 5.0)));
+  g_loop->loop();
+  g_loop->cancel(timer);
+  if (g_pool->numConnected() != n)
+  {
+    LOG_FATAL << "timed out, " << g_pool->numConnected() << " connected";
+  }
+}
+
+// fails requests on backend until it's ejected
+void failRequests(const InetAddress& backend)
+{
+  int failed = 0;
+  while (failed < kMaxFailures)
+  {
+    TcpConnectionPtr conn = g_pool->acquire();
+    bool ok = conn->peerAddress().toIpPort() != backend.toIpPort();
+    g_pool->release(conn, ok);
+    if (!ok)
+    {
+      ++failed;
+    }
+  }
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  InetAddress addr1("127.0.0.1", 2013), addr2("127.0.0.1", 2014);
+  // before any EventLoop of this process
+  pid_t backend1 = startBackend(addr1);
+
+  EventLoop loop;
+  g_loop = &loop;
+  TcpServer server2(&loop, addr2, "Backend2");
+  server2.setMessageCallback(onServerMessage);
+  server2.start();
+
+  TcpClientPool pool(&loop, "Pool");
+  g_pool = &pool;
+  pool.setThreadNum(2);
+  pool.setConnectionsPerBackend(2);
+  pool.setPolicy(TcpClientPool::kPowerOfTwoChoices);
+  pool.setEjection(kMaxFailures, 60.0);
+  pool.addBackend(addr1);
+  pool.addBackend(addr2);
+  pool.setMessageCallback(onClientMessage);
+  pool.start();
+  waitConnected(4);
+
+  // both take their share
+  std::map<string, int> perBackend = runRequests(kRequests);
+  assert(perBackend.size() == 2);
+  assert(perBackend[addr1.toIpPort()] > kRequests / 4);
+  assert(perBackend[addr2.toIpPort()] > kRequests / 4);
+
+  // the second one fails requests, it's ejected while still connected
+  failRequests(addr2);
+  assert(pool.numConnected() == 4);
+  perBackend = runRequests(kRequests / 10);
+  assert(perBackend.size() == 1 && perBackend[addr1.toIpPort()] == kRequests / 10);
+
+  // the first one is killed, the ejected one is all that's left
+  ::kill(backend1, SIGKILL);
+  ::waitpid(backend1, NULL, 0);
+  waitConnected(2);
+  perBackend = runRequests(kRequests / 10);
+  assert(perBackend.size() == 1 && perBackend[addr2.toIpPort()] == kRequests / 10);
+  (void) perBackend;
+
+  puts("All pass!!!");
+}
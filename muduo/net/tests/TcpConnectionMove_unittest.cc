@@ -0,0 +1,114 @@
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/InetAddress.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// The server sends kNumbers lines from a non-IO thread, while a timer keeps
+// moving the connection among loops.  The client checks they come in order.
+
+const int kNumbers = 200000;
+
+EventLoopThreadPool* g_pool = NULL;
+boost::scoped_ptr<Thread> g_sender;
+TcpConnectionPtr g_serverConn;
+MutexLock g_mutex;
+
+void sendNumbers(TcpConnectionPtr conn)
+{
+  char buf[32];
+  for (int i = 0; i < kNumbers; ++i)
+  {
+    snprintf(buf, sizeof buf, "%d\n", i);
+    conn->send(buf);
+  }
+}
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    {
+    MutexLockGuard lock(g_mutex);
+    g_serverConn = conn;
+    }
+    g_sender.reset(new Thread(boost::bind(sendNumbers, conn), "sender"));
+    g_sender->start();
+  }
+}
+
+// runs in the loop of main thread, as g_pool->getNextLoop() requires.
+void moveServerConnection()
+{
+  TcpConnectionPtr conn;
+  {
+  MutexLockGuard lock(g_mutex);
+  conn = g_serverConn;
+  }
+  if (conn)
+  {
+    conn->moveToLoop(g_pool->getNextLoop());
+  }
+}
+
+int expected = 0;
+
+void onClientMessage(EventLoop* loop, const TcpConnectionPtr& conn,
+                     Buffer* buf, Timestamp)
+{
+  const char* eol = NULL;
+  while ((eol = std::find(buf->peek(), implicit_cast<const char*>(buf->beginWrite()), '\n'))
+         != buf->beginWrite())
+  {
+    int n = atoi(string(buf->peek(), eol).c_str());
+    if (n != expected)
+    {
+      LOG_FATAL << "out of order, expect " << expected << " got " << n;
+    }
+    ++expected;
+    buf->retrieveUntil(eol + 1);
+  }
+  if (expected == kNumbers)
+  {
+    printf("received %d numbers in order\n", expected);
+    loop->quit();
+  }
+}
+
+int main()
+{
+  EventLoop loop;
+  InetAddress listenAddr(2012);
+
+  EventLoopThreadPool pool(&loop);
+  pool.setThreadNum(3);
+  pool.start();
+  g_pool = &pool;
+
+  TcpServer server(&loop, listenAddr, "MoveServer");
+  server.setThreadNum(2);
+  server.setConnectionCallback(onServerConnection);
+  server.start();
+  loop.runEvery(0.001, moveServerConnection);
+
+  TcpClient client(&loop, listenAddr, "MoveClient");
+  client.setMessageCallback(boost::bind(onClientMessage, &loop, _1, _2, _3));
+  client.connect();
+  loop.loop();
+  g_sender->join();
+  g_serverConn.reset();
+}
@@ -0,0 +1,113 @@
+#include <muduo/net/UdpServer.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// An echo server with one SO_REUSEPORT socket per IO thread, and a client
+// socket in the main loop keeping kWindow datagrams in flight until
+// kDatagrams are sent.
+
+const int kDatagrams = 100000;
+const int kWindow = 100;
+const double kIdle = 0.2;
+
+EventLoop* g_loop;
+int sent = 0;
+int received = 0;
+int receivedBefore = 0;  // at the last tick
+int refills = 0;
+
+void onServerDatagram(const UdpSocketPtr& socket, const InetAddress& peerAddr,
+                      const char* data, size_t len, Timestamp)
+{
+  socket->sendTo(peerAddr, data, len);
+}
+
+void sendSome(const UdpSocketPtr& client, const InetAddress& serverAddr, int n)
+{
+  for (int i = 0; i < n && sent < kDatagrams; ++i, ++sent)
+  {
+    client->sendTo(serverAddr, &sent, sizeof sent);
+  }
+}
+
+void onClientDatagram(const InetAddress& serverAddr, const UdpSocketPtr& client,
+                      const InetAddress&, const char*, size_t len, Timestamp)
+{
+  assert(len == sizeof sent);
+  (void) len;
+  // one out for each one back
+  if (++received == kDatagrams)
+  {
+    g_loop->quit();
+  }
+  sendSome(client, serverAddr, 1);
+}
+
+// lost datagrams shrink the window, it's refilled once nothing comes back
+void tick(const InetAddress& serverAddr, const UdpSocketPtr& client)
+{
+  if (received == receivedBefore)
+  {
+    if (sent == kDatagrams)
+    {
+      // the rest are lost
+      g_loop->quit();
+      return;
+    }
+    ++refills;
+    sendSome(client, serverAddr, kWindow);
+  }
+  receivedBefore = received;
+}
+
+void timeout()
+{
+  LOG_FATAL << "timed out, sent " << sent << " received " << received;
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  g_loop = &loop;
+  InetAddress serverAddr("127.0.0.1", 2015);
+  UdpServer server(&loop, serverAddr, "UdpEcho");
+  server.setThreadNum(argc > 1 ? atoi(argv[1]) : 2);
+  server.setReusePort(true);
+  server.setDatagramCallback(onServerDatagram);
+  server.start();
+
+  UdpSocketPtr client(new UdpSocket(&loop, InetAddress("127.0.0.1", 0), "UdpClient"));
+  client->setDatagramCallback(boost::bind(onClientDatagram, serverAddr, _1, _2, _3, _4, _5));
+  client->start();
+  sendSome(client, serverAddr, kWindow);
+
+  TimerId ticker = loop.runEvery(kIdle, boost::bind(tick, serverAddr, client));
+  TimerId deadline = loop.runAfter(30.0, timeout);
+  loop.loop();
+  loop.cancel(ticker);
+  loop.cancel(deadline);
+  printf("sent %d received %d dropped %ld refills %d\n",
+         sent, received, static_cast<long>(client->droppedCount()), refills);
+
+  // loopback loses few, the window never fills the send queue
+  assert(sent == kDatagrams);
+  assert(received <= sent && received > kDatagrams * 99 / 100);
+  assert(client->droppedCount() == 0);
+
+  // nothing goes out after stop
+  client->stop();
+  client->sendTo(serverAddr, &sent, sizeof sent);
+  assert(client->droppedCount() == 1);
+
+  puts("All pass!!!");
+}
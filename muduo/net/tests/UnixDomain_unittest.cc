@@ -0,0 +1,164 @@
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <set>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// An echo server on a unix domain socket whose path is longer than the
+// connection name buffer used to be, with several clients at once.
+// Before that, a server must not take the path of a regular file or of a
+// live socket, and must take over a stale one.
+
+const char* const kPath = "/tmp/muduo_unixdomain_unittest_with_a_rather_long_name.sock";
+const int kClients = 5;
+
+MutexLock g_mutex;
+std::set<string> g_serverConnections;  // @GuardedBy g_mutex
+int g_echoed = 0;
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    // each connection has a name of its own
+    MutexLockGuard lock(g_mutex);
+    bool inserted = g_serverConnections.insert(conn->name()).second;
+    assert(inserted); (void) inserted;
+  }
+}
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+void onClientConnection(int i, const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    char msg[32];
+    snprintf(msg, sizeof msg, "hello %d\r\n", i);
+    conn->send(msg);
+  }
+}
+
+void onClientMessage(EventLoop* loop, int i, const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  if (buf->findCRLF() == NULL)
+  {
+    return;
+  }
+  char expected[32];
+  snprintf(expected, sizeof expected, "hello %d\r\n", i);
+  string line(buf->retrieveAllAsString());
+  assert(line == expected);
+  (void) line;
+  if (++g_echoed == kClients)
+  {
+    loop->quit();
+  }
+}
+
+// in a child process, before any EventLoop of this one
+bool serverDies(const char* path)
+{
+  pid_t pid = ::fork();
+  if (pid == 0)
+  {
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress::fromUnixPath(path), "Dies");
+    _exit(0);
+  }
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+  return WIFSIGNALED(status);
+}
+
+bool isSocket(const char* path)
+{
+  struct stat st;
+  return ::lstat(path, &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+void testExistingPath()
+{
+  ::unlink(kPath);
+  int fd = ::open(kPath, O_WRONLY | O_CREAT, 0600);
+  assert(fd >= 0);
+  ::close(fd);
+  assert(serverDies(kPath));
+  assert(::access(kPath, F_OK) == 0 && !isSocket(kPath));
+  ::unlink(kPath);
+
+  InetAddress addr(InetAddress::fromUnixPath(kPath));
+  int listenfd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  assert(listenfd >= 0);
+  int ret = ::bind(listenfd, addr.getSockAddr(), addr.getSockAddrLen());
+  assert(ret == 0);
+  ret = ::listen(listenfd, 5);
+  assert(ret == 0); (void) ret;
+  assert(serverDies(kPath));
+  assert(isSocket(kPath));
+
+  // leaves a stale socket behind for main()
+  ::close(listenfd);
+  assert(isSocket(kPath));
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  testExistingPath();
+
+  EventLoop loop;
+  InetAddress serverAddr(InetAddress::fromUnixPath(kPath));
+  TcpServer server(&loop, serverAddr, "UnixEcho");
+  server.setConnectionCallback(onServerConnection);
+  server.setMessageCallback(onServerMessage);
+  server.setThreadNum(2);
+  server.start();
+
+  boost::ptr_vector<TcpClient> clients;
+  for (int i = 0; i < kClients; ++i)
+  {
+    char name[32];
+    snprintf(name, sizeof name, "UnixClient%d", i);
+    TcpClient* client = new TcpClient(&loop, serverAddr, name);
+    clients.push_back(client);
+    client->setConnectionCallback(boost::bind(onClientConnection, i, _1));
+    client->setMessageCallback(boost::bind(onClientMessage, &loop, i, _1, _2, _3));
+    client->connect();
+  }
+
+  loop.runAfter(5.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+  printf("echoed %d of %d, %zd server connections\n",
+         g_echoed, kClients, g_serverConnections.size());
+  assert(g_echoed == kClients);
+  assert(g_serverConnections.size() == static_cast<size_t>(kClients));
+
+  for (int i = 0; i < kClients; ++i)
+  {
+    clients[i].disconnect();
+  }
+  loop.runAfter(0.1, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+  ::unlink(kPath);
+  puts("All pass!!!");
+}